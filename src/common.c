@@ -24,6 +24,11 @@
 #include <sys/syscall.h>
 #include <sys/types.h>
 #include <unistd.h>
+#if defined(__AVX2__)
+# include <immintrin.h>
+#elif defined(__SSE2__)
+# include <emmintrin.h>
+#endif
 
 #include "common.h"
 #include "parser.h"
@@ -1340,6 +1345,242 @@ ly_realloc(void *ptr, size_t size)
     return new_mem;
 }
 
+struct ly_par_pool {
+    struct ly_ctx *ctx;
+    int (*task_clb)(void *arg, uint32_t task);
+    void *arg;
+    uint32_t task_count;
+    uint32_t next_task;     /* the first task not yet taken by any thread */
+    uint32_t failed;        /* the first failed task, task_count if none */
+    pthread_mutex_t lock;   /* protects next_task and failed */
+    int *rc;                /* return values of the tasks */
+    struct ly_err_item **errs; /* errors generated by the tasks */
+    enum int_log_opts ilo;  /* internal logging options of the calling thread */
+};
+
+/**
+ * @brief Run the tasks of a pool until there are none left.
+ *
+ * @param[in] pool Pool with the tasks.
+ * @param[in] last_eitem Last error item of the current thread before running any task.
+ */
+static void
+ly_par_work(struct ly_par_pool *pool, struct ly_err_item *last_eitem)
+{
+    uint32_t task;
+
+    while (1) {
+        pthread_mutex_lock(&pool->lock);
+        task = pool->next_task;
+        if (task < pool->task_count) {
+            ++pool->next_task;
+        }
+        if (task > pool->failed) {
+            /* the result is decided by an earlier task, no reason to run the rest */
+            task = pool->task_count;
+        }
+        pthread_mutex_unlock(&pool->lock);
+        if (task == pool->task_count) {
+            break;
+        }
+
+        pool->rc[task] = pool->task_clb(pool->arg, task);
+        pool->errs[task] = ly_err_detach(pool->ctx, last_eitem);
+        if (pool->rc[task]) {
+            pthread_mutex_lock(&pool->lock);
+            if (task < pool->failed) {
+                pool->failed = task;
+            }
+            pthread_mutex_unlock(&pool->lock);
+        }
+    }
+}
+
+static void *
+ly_par_thread(void *arg)
+{
+    struct ly_par_pool *pool = (struct ly_par_pool *)arg;
+
+    /* log the same way as the calling thread */
+    log_opt = pool->ilo;
+    ly_par_work(pool, NULL);
+    return NULL;
+}
+
+int
+ly_par_threads(const struct ly_ctx *ctx)
+{
+    long threads;
+
+    if (ctx->val_threads) {
+        return ctx->val_threads;
+    }
+
+    threads = sysconf(_SC_NPROCESSORS_ONLN);
+    return (threads > 1) ? (int)threads : 1;
+}
+
+int
+ly_par_run(struct ly_ctx *ctx, uint32_t task_count, int (*task_clb)(void *arg, uint32_t task), void *arg)
+{
+    struct ly_par_pool pool;
+    struct ly_err_item *last_eitem;
+    pthread_t *threads = NULL;
+    enum int_log_opts prev_ilo;
+    uint32_t i, thread_count;
+    int ret = 0;
+
+    thread_count = ly_par_threads(ctx);
+    if (thread_count > task_count) {
+        thread_count = task_count;
+    }
+    if ((thread_count < 2) || (log_opt == ILO_ERR2WRN)) {
+        /* nothing to parallelize (warnings would be printed by several threads at once) */
+        for (i = 0; !ret && (i < task_count); ++i) {
+            ret = task_clb(arg, i);
+        }
+        return ret;
+    }
+
+    memset(&pool, 0, sizeof pool);
+    pool.ctx = ctx;
+    pool.task_clb = task_clb;
+    pool.arg = arg;
+    pool.task_count = task_count;
+    pool.failed = task_count;
+    pool.ilo = (log_opt == ILO_LOG) ? ILO_STORE : log_opt;
+    pool.rc = calloc(task_count, sizeof *pool.rc);
+    pool.errs = calloc(task_count, sizeof *pool.errs);
+    threads = malloc((thread_count - 1) * sizeof *threads);
+    if (!pool.rc || !pool.errs || !threads) {
+        LOGMEM(ctx);
+        free(pool.rc);
+        free(pool.errs);
+        free(threads);
+        return -1;
+    }
+    pthread_mutex_init(&pool.lock, NULL);
+
+    for (i = 0; i < thread_count - 1; ++i) {
+        if (pthread_create(&threads[i], NULL, ly_par_thread, &pool)) {
+            /* the rest of the tasks will be run by the threads already created */
+            break;
+        }
+    }
+    thread_count = i;
+
+    /* the calling thread works, too, but its previous errors must be kept */
+    last_eitem = (struct ly_err_item *)ly_err_first(ctx);
+    if (last_eitem) {
+        last_eitem = last_eitem->prev;
+    }
+    prev_ilo = log_opt;
+    log_opt = pool.ilo;
+    ly_par_work(&pool, last_eitem);
+    log_opt = prev_ilo;
+
+    for (i = 0; i < thread_count; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&pool.lock);
+
+    /* process the errors in the order of the tasks up to the first failed one, as if run serially, so that
+     * the result does not depend on thread scheduling */
+    ly_ilo_change(ctx, ILO_STORE, &prev_ilo, &last_eitem);
+    for (i = 0; i < task_count; ++i) {
+        if (i > pool.failed) {
+            ly_err_free(pool.errs[i]);
+        } else {
+            ly_err_attach(ctx, pool.errs[i]);
+        }
+    }
+    ly_ilo_restore(ctx, prev_ilo, last_eitem, 1);
+    if (pool.failed < task_count) {
+        ret = pool.rc[pool.failed];
+    }
+
+    free(pool.rc);
+    free(pool.errs);
+    free(threads);
+    return ret;
+}
+
+/* the vectorized variants read whole aligned blocks, so they may read behind the terminating NUL,
+ * but never across a page boundary */
+#ifdef __GNUC__
+__attribute__((no_sanitize_address))
+#endif
+size_t
+ly_strplain_len(const char *str, const char *stop, int ws)
+{
+    char s[4];
+    int i;
+
+    /* missing stop characters are replaced by NUL, which ends the run anyway */
+    for (i = 0; i < 4 && stop[i]; ++i) {
+        s[i] = stop[i];
+    }
+    for (; i < 4; ++i) {
+        s[i] = '\0';
+    }
+
+#if defined(__AVX2__)
+    const char *p = (const char *)((uintptr_t)str & ~(uintptr_t)31);
+    const __m256i s0 = _mm256_set1_epi8(s[0]), s1 = _mm256_set1_epi8(s[1]), s2 = _mm256_set1_epi8(s[2]),
+            s3 = _mm256_set1_epi8(s[3]), ctrl = _mm256_set1_epi8(0x20), tab = _mm256_set1_epi8(ws ? 0x9 : 0x20),
+            lf = _mm256_set1_epi8(ws ? 0xa : 0x20), cr = _mm256_set1_epi8(ws ? 0xd : 0x20);
+    __m256i v, wsp, special;
+    uint32_t mask;
+
+    mask = 0xffffffffu << (str - p);
+    for (;; p += 32) {
+        v = _mm256_load_si256((const __m256i *)p);
+        /* signed comparison catches both control characters and bytes >= 0x80 */
+        wsp = _mm256_or_si256(_mm256_cmpeq_epi8(v, tab), _mm256_or_si256(_mm256_cmpeq_epi8(v, lf), _mm256_cmpeq_epi8(v, cr)));
+        special = _mm256_andnot_si256(wsp, _mm256_cmpgt_epi8(ctrl, v));
+        special = _mm256_or_si256(special, _mm256_or_si256(_mm256_cmpeq_epi8(v, s0), _mm256_cmpeq_epi8(v, s1)));
+        special = _mm256_or_si256(special, _mm256_or_si256(_mm256_cmpeq_epi8(v, s2), _mm256_cmpeq_epi8(v, s3)));
+        mask &= (uint32_t)_mm256_movemask_epi8(special);
+        if (mask) {
+            return (p + __builtin_ctz(mask)) - str;
+        }
+        mask = 0xffffffffu;
+    }
+#elif defined(__SSE2__)
+    const char *p = (const char *)((uintptr_t)str & ~(uintptr_t)15);
+    const __m128i s0 = _mm_set1_epi8(s[0]), s1 = _mm_set1_epi8(s[1]), s2 = _mm_set1_epi8(s[2]),
+            s3 = _mm_set1_epi8(s[3]), ctrl = _mm_set1_epi8(0x20), tab = _mm_set1_epi8(ws ? 0x9 : 0x20),
+            lf = _mm_set1_epi8(ws ? 0xa : 0x20), cr = _mm_set1_epi8(ws ? 0xd : 0x20);
+    __m128i v, wsp, special;
+    uint32_t mask;
+
+    mask = 0xffffu << (str - p);
+    for (;; p += 16) {
+        v = _mm_load_si128((const __m128i *)p);
+        /* signed comparison catches both control characters and bytes >= 0x80 */
+        wsp = _mm_or_si128(_mm_cmpeq_epi8(v, tab), _mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr)));
+        special = _mm_andnot_si128(wsp, _mm_cmplt_epi8(v, ctrl));
+        special = _mm_or_si128(special, _mm_or_si128(_mm_cmpeq_epi8(v, s0), _mm_cmpeq_epi8(v, s1)));
+        special = _mm_or_si128(special, _mm_or_si128(_mm_cmpeq_epi8(v, s2), _mm_cmpeq_epi8(v, s3)));
+        mask &= (uint32_t)_mm_movemask_epi8(special);
+        if (mask) {
+            return (p + __builtin_ctz(mask)) - str;
+        }
+        mask = 0xffffu;
+    }
+#else
+    const char *p;
+
+    for (p = str; ((unsigned char)*p >= 0x20 && (unsigned char)*p < 0x80)
+            || (ws && (*p == 0x9 || *p == 0xa || *p == 0xd)); ++p) {
+        if (*p == s[0] || *p == s[1] || *p == s[2] || *p == s[3]) {
+            break;
+        }
+    }
+    return p - str;
+#endif
+}
+
 int
 ly_strequal_(const char *s1, const char *s2)
 {
@@ -1385,6 +1626,32 @@ dec64cmp(int64_t num1, uint8_t dig1, int64_t num2, uint8_t dig2)
     return (num1 > num2 ? 1 : -1);
 }
 
+/*
+ * Bob Jenkin's one-at-a-time hash
+ * http://www.burtleburtle.net/bob/hash/doobs.html
+ *
+ * LYB hashes are stored in the data, so unlike dict_hash_multi() this hash must never change.
+ */
+static uint32_t
+lyb_hash_multi(uint32_t hash, const char *key_part, size_t len)
+{
+    uint32_t i;
+
+    if (key_part) {
+        for (i = 0; i < len; ++i) {
+            hash += key_part[i];
+            hash += (hash << 10);
+            hash ^= (hash >> 6);
+        }
+    } else {
+        hash += (hash << 3);
+        hash ^= (hash >> 11);
+        hash += (hash << 15);
+    }
+
+    return hash;
+}
+
 LYB_HASH
 lyb_hash(struct lys_node *sibling, uint8_t collision_id)
 {
@@ -1401,8 +1668,8 @@ lyb_hash(struct lys_node *sibling, uint8_t collision_id)
 
     mod = lys_node_module(sibling);
 
-    full_hash = dict_hash_multi(0, mod->name, strlen(mod->name));
-    full_hash = dict_hash_multi(full_hash, sibling->name, strlen(sibling->name));
+    full_hash = lyb_hash_multi(0, mod->name, strlen(mod->name));
+    full_hash = lyb_hash_multi(full_hash, sibling->name, strlen(sibling->name));
     if (collision_id) {
         if (collision_id > strlen(mod->name)) {
             /* fine, we will not hash more bytes, just use more bits from the hash than previously */
@@ -1411,9 +1678,9 @@ lyb_hash(struct lys_node *sibling, uint8_t collision_id)
             /* use one more byte from the module name than before */
             ext_len = collision_id;
         }
-        full_hash = dict_hash_multi(full_hash, mod->name, ext_len);
+        full_hash = lyb_hash_multi(full_hash, mod->name, ext_len);
     }
-    full_hash = dict_hash_multi(full_hash, NULL, 0);
+    full_hash = lyb_hash_multi(full_hash, NULL, 0);
 
     /* use the shortened hash */
     hash = full_hash & (LYB_HASH_MASK >> collision_id);
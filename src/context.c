@@ -13,6 +13,7 @@
  */
 
 #define _GNU_SOURCE
+#include <assert.h>
 #include <pthread.h>
 #include <stddef.h>
 #include <stdlib.h>
@@ -69,6 +70,128 @@ static struct internal_modules_s {
     {"ietf-yang-library", IETF_YANG_LIB_REV, (const char*)ietf_yang_library_2019_01_04_yin, 1, LYS_IN_YIN}
 };
 
+#ifdef LY_ENABLED_CACHE
+
+/**
+ * @brief Record of the module indexes.
+ */
+struct ly_mod_rec {
+    const char *key;            /* module name or namespace */
+    size_t key_len;
+    const char *rev;            /* module revision, only in the revision index */
+    struct lys_module *mod;
+    int idx;                    /* index of the module in the list of modules */
+};
+
+static int
+ly_mod_rec_equal(void *val1_p, void *val2_p, int mod, void *UNUSED(cb_data))
+{
+    struct ly_mod_rec *rec1 = val1_p, *rec2 = val2_p;
+
+    if (mod) {
+        return rec1->mod == rec2->mod;
+    }
+
+    if ((rec1->key_len != rec2->key_len) || strncmp(rec1->key, rec2->key, rec1->key_len)) {
+        return 0;
+    }
+    return (rec1->rev == rec2->rev) || (rec1->rev && rec2->rev && !strcmp(rec1->rev, rec2->rev));
+}
+
+static uint32_t
+ly_mod_rec_hash(const char *key, size_t key_len, const char *rev)
+{
+    uint32_t hash;
+
+    hash = dict_hash_multi(0, key, key_len);
+    if (rev) {
+        hash = dict_hash_multi(hash, rev, strlen(rev));
+    }
+    return dict_hash_multi(hash, NULL, 0);
+}
+
+static int
+ly_ctx_module_index_insert(struct ly_modules_list *models, struct lys_module *mod, int idx)
+{
+    struct ly_mod_rec rec;
+
+    rec.mod = mod;
+    rec.idx = idx;
+    rec.rev = NULL;
+
+    rec.key = mod->name;
+    rec.key_len = strlen(mod->name);
+    if (lyht_insert(models->name_idx, &rec, ly_mod_rec_hash(rec.key, rec.key_len, NULL), NULL) == -1) {
+        return -1;
+    }
+    if (mod->rev_size) {
+        rec.rev = mod->rev[0].date;
+        if (lyht_insert(models->rev_idx, &rec, ly_mod_rec_hash(rec.key, rec.key_len, rec.rev), NULL) == -1) {
+            return -1;
+        }
+        rec.rev = NULL;
+    }
+
+    rec.key = mod->ns;
+    rec.key_len = strlen(mod->ns);
+    if (lyht_insert(models->ns_idx, &rec, ly_mod_rec_hash(rec.key, rec.key_len, NULL), NULL) == -1) {
+        return -1;
+    }
+
+    return 0;
+}
+
+static void
+ly_ctx_module_index_free(struct ly_modules_list *models)
+{
+    lyht_free(models->name_idx);
+    lyht_free(models->ns_idx);
+    lyht_free(models->rev_idx);
+    models->name_idx = NULL;
+    models->ns_idx = NULL;
+    models->rev_idx = NULL;
+}
+
+#endif
+
+void
+ly_ctx_module_index_update(struct ly_ctx *ctx, struct lys_module *mod)
+{
+#ifdef LY_ENABLED_CACHE
+    struct ly_modules_list *models = &ctx->models;
+    int i;
+
+    if (mod && models->name_idx) {
+        assert(models->list[models->used - 1] == mod);
+        if (ly_ctx_module_index_insert(models, mod, models->used - 1)) {
+            /* the modules will be searched for in the list */
+            ly_ctx_module_index_free(models);
+        }
+        return;
+    }
+
+    /* rebuild the indexes so that the indexes in the list are correct, it also means no records are ever
+     * removed and lookups never modify the hash tables so they can be done by several threads at once */
+    ly_ctx_module_index_free(models);
+    models->name_idx = lyht_new(LYHT_MIN_SIZE, sizeof(struct ly_mod_rec), ly_mod_rec_equal, NULL, 1);
+    models->ns_idx = lyht_new(LYHT_MIN_SIZE, sizeof(struct ly_mod_rec), ly_mod_rec_equal, NULL, 1);
+    models->rev_idx = lyht_new(LYHT_MIN_SIZE, sizeof(struct ly_mod_rec), ly_mod_rec_equal, NULL, 1);
+    if (!models->name_idx || !models->ns_idx || !models->rev_idx) {
+        ly_ctx_module_index_free(models);
+        return;
+    }
+    for (i = 0; i < models->used; ++i) {
+        if (ly_ctx_module_index_insert(models, models->list[i], i)) {
+            ly_ctx_module_index_free(models);
+            return;
+        }
+    }
+#else
+    (void)ctx;
+    (void)mod;
+#endif
+}
+
 API unsigned int
 ly_ctx_internal_modules_count(struct ly_ctx *ctx)
 {
@@ -80,17 +203,13 @@ ly_ctx_internal_modules_count(struct ly_ctx *ctx)
     return ctx->internal_module_count;
 }
 
-API struct ly_ctx *
-ly_ctx_new(const char *search_dir, int options)
+struct ly_ctx *
+ly_ctx_new_empty(const char *search_dir, int options)
 {
-    FUN_IN;
-
     struct ly_ctx *ctx = NULL;
-    struct lys_module *module;
     char *search_dir_list;
     char *sep, *dir;
     int rc = EXIT_SUCCESS;
-    int i;
 
     ctx = calloc(1, sizeof *ctx);
     LY_CHECK_ERR_RETURN(!ctx, LOGMEM(NULL), NULL);
@@ -98,6 +217,11 @@ ly_ctx_new(const char *search_dir, int options)
     /* dictionary */
     lydict_init(&ctx->dict);
 
+#ifdef LY_ENABLED_CACHE
+    pthread_mutex_init(&ctx->cache_lock, NULL);
+    pthread_mutex_init(&ctx->root_lock, NULL);
+#endif
+
     /* plugins */
     ly_load_plugins();
 
@@ -107,9 +231,21 @@ ly_ctx_new(const char *search_dir, int options)
         goto error;
     }
 
+    /* compiled regular expressions */
+    if (lyp_regex_cache_init(ctx)) {
+        goto error;
+    }
+
+#ifdef LY_ENABLED_CACHE
+    /* indexes of top-level data siblings */
+    if (lyd_root_nodes_init(ctx)) {
+        goto error;
+    }
+#endif
+
     /* models list */
     ctx->models.list = calloc(16, sizeof *ctx->models.list);
-    LY_CHECK_ERR_RETURN(!ctx->models.list, LOGMEM(NULL); free(ctx), NULL);
+    LY_CHECK_ERR_GOTO(!ctx->models.list, LOGMEM(NULL), error);
     ctx->models.flags = options;
     ctx->models.used = 0;
     ctx->models.size = 16;
@@ -132,6 +268,28 @@ ly_ctx_new(const char *search_dir, int options)
     }
     ctx->models.module_set_id = 1;
 
+    return ctx;
+
+error:
+    /* cleanup */
+    ly_ctx_destroy(ctx, NULL);
+    return NULL;
+}
+
+API struct ly_ctx *
+ly_ctx_new(const char *search_dir, int options)
+{
+    FUN_IN;
+
+    struct ly_ctx *ctx;
+    struct lys_module *module;
+    int i;
+
+    ctx = ly_ctx_new_empty(search_dir, options);
+    if (!ctx) {
+        return NULL;
+    }
+
     /* load internal modules */
     if (options & LY_CTX_NOYANGLIBRARY) {
         ctx->internal_module_count = LY_INTERNAL_MODULE_COUNT - 2;
@@ -419,6 +577,32 @@ ly_ctx_unset_trusted(struct ly_ctx *ctx)
     ly_ctx_unset_option(ctx, LY_CTX_TRUSTED);
 }
 
+API void
+ly_ctx_set_validation_threads(struct ly_ctx *ctx, uint16_t threads)
+{
+    FUN_IN;
+
+    if (!ctx) {
+        LOGARG;
+        return;
+    }
+
+    ctx->val_threads = threads;
+}
+
+API uint16_t
+ly_ctx_get_validation_threads(const struct ly_ctx *ctx)
+{
+    FUN_IN;
+
+    if (!ctx) {
+        LOGARG;
+        return 0;
+    }
+
+    return ctx->val_threads;
+}
+
 API int
 ly_ctx_get_options(struct ly_ctx *ctx)
 {
@@ -533,6 +717,9 @@ ly_ctx_destroy(struct ly_ctx *ctx, void (*private_destructor)(const struct lys_n
     }
 
     /* models list */
+#ifdef LY_ENABLED_CACHE
+    ly_ctx_module_index_free(&ctx->models);
+#endif
     for (; ctx->models.used > 0; ctx->models.used--) {
         /* remove the applied deviations and augments */
         lys_sub_module_remove_devs_augs(ctx->models.list[ctx->models.used - 1]);
@@ -547,6 +734,18 @@ ly_ctx_destroy(struct ly_ctx *ctx, void (*private_destructor)(const struct lys_n
     }
     free(ctx->models.list);
 
+#ifdef LY_ENABLED_CACHE
+    lys_child_index_free_retired(ctx);
+    resolve_must_cache_free(ctx);
+    lyd_val_deps_free(ctx);
+    pthread_mutex_destroy(&ctx->cache_lock);
+    lyd_root_nodes_free(ctx);
+    pthread_mutex_destroy(&ctx->root_lock);
+#endif
+
+    /* compiled regular expressions */
+    lyp_regex_cache_free(ctx);
+
     /* clean the error list */
     ly_err_clean(ctx, 0);
     pthread_key_delete(ctx->errlist_key);
@@ -643,6 +842,129 @@ ly_ctx_get_submodule(const struct ly_ctx *ctx, const char *module, const char *r
     return ret;
 }
 
+#ifdef LY_ENABLED_CACHE
+
+/**
+ * @brief Get a module from the context module indexes, same as ly_ctx_get_module_by().
+ */
+static const struct lys_module *
+ly_ctx_get_module_by_idx(const struct ly_ctx *ctx, const char *key, size_t key_len, int is_ns, const char *revision,
+                         int with_disabled, int implemented)
+{
+    struct hash_table *ht;
+    struct ly_mod_rec rec, *match, *result = NULL;
+    struct lys_module *mod;
+    uint32_t hash;
+    int r;
+
+    rec.key = key;
+    rec.key_len = key_len;
+    rec.rev = NULL;
+
+    if (revision && !is_ns) {
+        /* there can be only one module with the name and revision */
+        rec.rev = revision;
+        if (lyht_find(ctx->models.rev_idx, &rec, ly_mod_rec_hash(key, key_len, revision), (void **)&match)
+                || (!with_disabled && match->mod->disabled)) {
+            return NULL;
+        }
+        return match->mod;
+    }
+
+    ht = is_ns ? ctx->models.ns_idx : ctx->models.name_idx;
+    hash = ly_mod_rec_hash(key, key_len, NULL);
+    if (lyht_find(ht, &rec, hash, (void **)&match)) {
+        return NULL;
+    }
+
+    /* choose the same module as if the list of modules was searched in its order */
+    do {
+        if (!ly_mod_rec_equal(&rec, match, 0, NULL)) {
+            /* only the hash is equal */
+            continue;
+        }
+        mod = match->mod;
+        if (!with_disabled && mod->disabled) {
+            continue;
+        }
+
+        if (revision) {
+            /* the first module with the revision */
+            if (mod->rev_size && !strcmp(revision, mod->rev[0].date) && (!result || (match->idx < result->idx))) {
+                result = match;
+            }
+        } else if (implemented) {
+            /* the first implemented module */
+            if (mod->implemented && (!result || (match->idx < result->idx))) {
+                result = match;
+            }
+        } else if (!result) {
+            result = match;
+        } else if (!mod->rev_size) {
+            /* a module without revision only if there is no other with a revision */
+            if (!result->mod->rev_size && (match->idx < result->idx)) {
+                result = match;
+            }
+        } else if (!result->mod->rev_size) {
+            result = match;
+        } else {
+            /* the newest revision, the last one in case of equal revisions */
+            r = strcmp(mod->rev[0].date, result->mod->rev[0].date);
+            if ((r > 0) || (!r && (match->idx > result->idx))) {
+                result = match;
+            }
+        }
+    } while (!lyht_find_next(ht, match, hash, (void **)&match));
+
+    return result ? result->mod : NULL;
+}
+
+#endif
+
+struct lys_module *
+ly_ctx_nget_module_first(const struct ly_ctx *ctx, const char *key, size_t key_len, int is_ns, int all)
+{
+    struct lys_module *result = NULL;
+    const char *str;
+    int i;
+#ifdef LY_ENABLED_CACHE
+    struct ly_mod_rec rec, *match;
+    uint32_t hash;
+    int idx = -1;
+
+    if (ctx->models.name_idx) {
+        rec.key = key;
+        rec.key_len = key_len;
+        rec.rev = NULL;
+        hash = ly_mod_rec_hash(key, key_len, NULL);
+        if (!lyht_find(is_ns ? ctx->models.ns_idx : ctx->models.name_idx, &rec, hash, (void **)&match)) {
+            do {
+                if (ly_mod_rec_equal(&rec, match, 0, NULL) && (all || (match->mod->implemented && !match->mod->disabled))
+                        && (!result || (match->idx < idx))) {
+                    result = match->mod;
+                    idx = match->idx;
+                }
+            } while (!lyht_find_next(is_ns ? ctx->models.ns_idx : ctx->models.name_idx, match, hash, (void **)&match));
+        }
+        return result;
+    }
+#endif
+
+    for (i = 0; i < ctx->models.used; ++i) {
+        if (!all && (!ctx->models.list[i]->implemented || ctx->models.list[i]->disabled)) {
+            /* skip not implemented or disabled modules */
+            continue;
+        }
+        str = (is_ns ? ctx->models.list[i]->ns : ctx->models.list[i]->name);
+        if (!strncmp(str, key, key_len) && !str[key_len]) {
+            result = ctx->models.list[i];
+            break;
+        }
+    }
+
+    return result;
+}
+
 static const struct lys_module *
 ly_ctx_get_module_by(const struct ly_ctx *ctx, const char *key, size_t key_len, int offset, const char *revision,
                      int with_disabled, int implemented)
@@ -656,6 +978,13 @@ ly_ctx_get_module_by(const struct ly_ctx *ctx, const char *key, size_t key_len,
         return NULL;
     }
 
+#ifdef LY_ENABLED_CACHE
+    if (ctx->models.name_idx) {
+        return ly_ctx_get_module_by_idx(ctx, key, key_len ? key_len : strlen(key), offset == offsetof(struct lys_module, ns),
+                                        revision, with_disabled, implemented);
+    }
+#endif
+
     for (i = 0; i < ctx->models.used; i++) {
         if (!with_disabled && ctx->models.list[i]->disabled) {
             /* skip the disabled modules */
@@ -1410,6 +1739,7 @@ imported:
 
     /* update the module-set-id */
     ctx->models.module_set_id++;
+    lys_schema_changed(ctx);
 
     return EXIT_SUCCESS;
 }
@@ -1538,6 +1868,7 @@ checkdependency:
 
     /* update the module-set-id */
     ctx->models.module_set_id++;
+    lys_schema_changed(ctx);
 
     return EXIT_SUCCESS;
 }
@@ -1655,6 +1986,8 @@ imported:
     }
     ctx->models.used = o + 1;
     ctx->models.module_set_id++;
+    lys_schema_changed(ctx);
+    ly_ctx_module_index_update(ctx, NULL);
 
     /* maintain backlinks (start with internal ietf-yang-library which have leafs as possible targets of leafrefs */
     ctx_modules_undo_backlinks(ctx, mods);
@@ -1680,7 +2013,10 @@ ly_ctx_clean(struct ly_ctx *ctx, void (*private_destructor)(const struct lys_nod
         return;
     }
 
-    /* models list */
+    /* models list, search it while the modules are being freed */
+#ifdef LY_ENABLED_CACHE
+    ly_ctx_module_index_free(&ctx->models);
+#endif
     for (; ctx->models.used > ctx->internal_module_count; ctx->models.used--) {
         /* remove the applied deviations and augments */
         lys_sub_module_remove_devs_augs(ctx->models.list[ctx->models.used - 1]);
@@ -1690,6 +2026,8 @@ ly_ctx_clean(struct ly_ctx *ctx, void (*private_destructor)(const struct lys_nod
         ctx->models.list[ctx->models.used - 1] = NULL;
     }
     ctx->models.module_set_id++;
+    lys_schema_changed(ctx);
+    ly_ctx_module_index_update(ctx, NULL);
 
     /* maintain backlinks (actually done only with ietf-yang-library since its leafs can be target of leafref) */
     ctx_modules_undo_backlinks(ctx, NULL);
@@ -34,7 +34,13 @@ struct ly_modules_list {
     uint8_t parsing_sub_modules_count;
     uint8_t parsed_submodules_count;
     uint16_t module_set_id;
+    uint32_t schema_gen; /* changed with every change of the schema trees, invalidates the schema child indexes and dependencies */
     int flags; /* see @ref contextoptions. */
+#ifdef LY_ENABLED_CACHE
+    struct hash_table *name_idx; /* modules by their name, NULL if not available */
+    struct hash_table *ns_idx;   /* modules by their namespace */
+    struct hash_table *rev_idx;  /* modules with a revision by their name and the revision */
+#endif
 };
 
 struct ly_ctx {
@@ -48,7 +54,49 @@ struct ly_ctx {
     void *(*priv_dup_clb)(const void *priv);
 #endif
     pthread_key_t errlist_key;
+    pthread_key_t jit_stack_key;   /* PCRE JIT stack of each thread */
+    void *jit_stacks;              /* JIT stacks of all the threads, freed with the context */
+    pthread_mutex_t regex_lock;    /* protects the regular expression cache and the list of JIT stacks */
+    struct hash_table *regex_cache; /* compiled patterns by their YANG (XSD) form, see lyp_regex_match() */
+    uint16_t val_threads;       /* number of threads for parallel data validation, 0 for all the processors */
+#ifdef LY_ENABLED_CACHE
+    pthread_mutex_t cache_lock; /* serializes building the schema caches created on their first use with data */
+    struct hash_table *must_cache; /* compiled must expressions by their dictionary string, see resolve_must() */
+    void *retired_idx;          /* replaced schema child indexes, freed on the next schema change */
+    struct lyd_val_deps *val_deps; /* reverse dependencies of the schema nodes for incremental data validation */
+    pthread_mutex_t root_lock;  /* protects the records of the indexed top-level data nodes */
+    struct hash_table *root_nodes; /* indexed top-level data nodes with their sibling index, see lyd_root_ht() */
+#endif
     uint8_t internal_module_count;
 };
 
+/**
+ * @brief Create a context without any modules, not even the internal ones.
+ *
+ * @param[in] search_dir Search directories separated by ':', NULL for none.
+ * @param[in] options Context options, see @ref contextoptions.
+ * @return Created context, NULL on error.
+ */
+struct ly_ctx *ly_ctx_new_empty(const char *search_dir, int options);
+
+/**
+ * @brief Update the module indexes of a context after its list of modules has changed.
+ *
+ * @param[in] ctx Context to update.
+ * @param[in] mod Module just added at the end of the list, NULL if the list has changed otherwise.
+ */
+void ly_ctx_module_index_update(struct ly_ctx *ctx, struct lys_module *mod);
+
+/**
+ * @brief Get the first module in the list of modules of a context with a name or namespace.
+ *
+ * @param[in] ctx Context to search in.
+ * @param[in] key Module name or namespace.
+ * @param[in] key_len Length of \p key.
+ * @param[in] is_ns Whether \p key is a namespace.
+ * @param[in] all Whether to return also disabled and not implemented modules.
+ * @return Matching module, NULL if not found.
+ */
+struct lys_module *ly_ctx_nget_module_first(const struct ly_ctx *ctx, const char *key, size_t key_len, int is_ns, int all);
+
 #endif /* LY_CONTEXT_H_ */
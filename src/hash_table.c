@@ -13,10 +13,14 @@
  */
 
 #include <string.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <pthread.h>
 #include <assert.h>
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
 
 #include "common.h"
 #include "context.h"
@@ -38,7 +42,7 @@ lydict_val_eq(void *val1_p, void *val2_p, int UNUSED(mod), void *cb_data)
         return 0;
     }
 
-    if (strncmp(str1, str2, *(size_t *)cb_data) == 0) {
+    if ((strncmp(str1, str2, *(size_t *)cb_data) == 0) && !str2[*(size_t *)cb_data]) {
         return 1;
     }
 
@@ -48,20 +52,25 @@ lydict_val_eq(void *val1_p, void *val2_p, int UNUSED(mod), void *cb_data)
 void
 lydict_init(struct dict_table *dict)
 {
+    unsigned int i;
+
     if (!dict) {
         LOGARG;
         return;
     }
 
-    dict->hash_tab = lyht_new(1024, sizeof(struct dict_rec), lydict_val_eq, NULL, 1);
-    LY_CHECK_ERR_RETURN(!dict->hash_tab, LOGINT(NULL), );
-    pthread_mutex_init(&dict->lock, NULL);
+    for (i = 0; i < LYDICT_SHARD_COUNT; ++i) {
+        dict->shards[i].hash_tab = lyht_new(1024 / LYDICT_SHARD_COUNT, sizeof(struct dict_rec), lydict_val_eq, NULL, 1);
+        LY_CHECK_ERR_RETURN(!dict->shards[i].hash_tab, LOGINT(NULL), );
+        pthread_mutex_init(&dict->shards[i].lock, NULL);
+    }
 }
 
 void
 lydict_clean(struct dict_table *dict)
 {
-    unsigned int i;
+    unsigned int i, j;
+    struct dict_shard *shard;
     struct dict_rec *dict_rec  = NULL;
     struct ht_rec *rec = NULL;
 
@@ -70,49 +79,139 @@ lydict_clean(struct dict_table *dict)
         return;
     }
 
-    for (i = 0; i < dict->hash_tab->size; i++) {
-        /* get ith record */
-        rec = (struct ht_rec *)&dict->hash_tab->recs[i * dict->hash_tab->rec_size];
-        if (rec->hits == 1) {
-            /*
-             * this should not happen, all records inserted into
-             * dictionary are supposed to be removed using lydict_remove()
-             * before calling lydict_clean()
-             */
-            dict_rec  = (struct dict_rec *)rec->val;
-            LOGWRN(NULL, "String \"%s\" not freed from the dictionary, refcount %d", dict_rec->value, dict_rec->refcount);
-            /* if record wasn't removed before free string allocated for that record */
+    for (j = 0; j < LYDICT_SHARD_COUNT; ++j) {
+        shard = &dict->shards[j];
+        for (i = 0; i < shard->hash_tab->size; i++) {
+            if (shard->hash_tab->ctrl[i] != LYHT_CTRL_EMPTY) {
+                /* get ith record */
+                rec = lyht_get_rec(shard->hash_tab->recs, shard->hash_tab->rec_size, i);
+                /*
+                 * this should not happen, all records inserted into
+                 * dictionary are supposed to be removed using lydict_remove()
+                 * before calling lydict_clean()
+                 */
+                dict_rec  = (struct dict_rec *)rec->val;
+                LOGWRN(NULL, "String \"%s\" not freed from the dictionary, refcount %d", dict_rec->value, dict_rec->refcount);
+                /* if record wasn't removed before free string allocated for that record */
 #ifdef NDEBUG
-            free(dict_rec->value);
+                free(dict_rec->value);
 #endif
+            }
         }
-    }
 
-    /* free table and destroy mutex */
-    lyht_free(dict->hash_tab);
-    pthread_mutex_destroy(&dict->lock);
+        /* free table and destroy mutex */
+        lyht_free(shard->hash_tab);
+        pthread_mutex_destroy(&shard->lock);
+    }
 }
 
 /*
- * Bob Jenkin's one-at-a-time hash
- * http://www.burtleburtle.net/bob/hash/doobs.html
+ * wyhash (final version 4) by Wang Yi, public domain
+ * https://github.com/wangyi-fudan/wyhash
  *
- * Spooky hash is faster, but it works only for little endian architectures.
+ * Reads the key by whole words and mixes them using 64x64->128 bit multiplication,
+ * which is emulated on compilers without 128-bit integers. The result depends on the byte order,
+ * so it must never be stored (LYB schema hashes use their own hash function, see lyb_hash()).
  */
+#define LY_WYP0 0xa0761d6478bd642full
+#define LY_WYP1 0xe7037ed1a0b428dbull
+#define LY_WYP2 0x8ebc6af09c88c6e3ull
+
+static inline uint64_t
+dict_wymum(uint64_t a, uint64_t b)
+{
+#ifdef __SIZEOF_INT128__
+    __uint128_t r = (__uint128_t)a * b;
+
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+#else
+    uint64_t ha = a >> 32, hb = b >> 32, la = (uint32_t)a, lb = (uint32_t)b, hi, lo;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32), c = t < rl;
+
+    lo = t + (rm1 << 32);
+    c += lo < t;
+    hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    return lo ^ hi;
+#endif
+}
+
+static inline uint64_t
+dict_wyr8(const uint8_t *p)
+{
+    uint64_t v;
+
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline uint64_t
+dict_wyr4(const uint8_t *p)
+{
+    uint32_t v;
+
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static uint64_t
+dict_wyhash(const char *key, size_t len, uint64_t seed)
+{
+    const uint8_t *p = (const uint8_t *)key;
+    uint64_t a, b, see1, see2;
+    size_t i;
+
+    seed ^= dict_wymum(seed ^ LY_WYP0, LY_WYP1);
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (dict_wyr4(p) << 32) | dict_wyr4(p + ((len >> 3) << 2));
+            b = (dict_wyr4(p + len - 4) << 32) | dict_wyr4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        i = len;
+        if (i > 48) {
+            see1 = see2 = seed;
+            do {
+                seed = dict_wymum(dict_wyr8(p) ^ LY_WYP1, dict_wyr8(p + 8) ^ seed);
+                see1 = dict_wymum(dict_wyr8(p + 16) ^ LY_WYP2, dict_wyr8(p + 24) ^ see1);
+                see2 = dict_wymum(dict_wyr8(p + 32) ^ LY_WYP0, dict_wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = dict_wymum(dict_wyr8(p) ^ LY_WYP1, dict_wyr8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = dict_wyr8(p + i - 16);
+        b = dict_wyr8(p + i - 8);
+    }
+
+    return dict_wymum(LY_WYP1 ^ len, dict_wymum(a ^ LY_WYP1, b ^ seed));
+}
+
 static uint32_t
 dict_hash(const char *key, size_t len)
 {
-    uint32_t hash, i;
+    uint64_t hash = dict_wyhash(key, len, 0);
 
-    for (hash = i = 0; i < len; ++i) {
-        hash += key[i];
-        hash += (hash << 10);
-        hash ^= (hash >> 6);
-    }
-    hash += (hash << 3);
-    hash ^= (hash >> 11);
-    hash += (hash << 15);
-    return hash;
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+/*
+ * The hash tables index their records by the low bits of the hash,
+ * so the shard is selected by the high bits to keep the two independent.
+ */
+static struct dict_shard *
+dict_shard(struct ly_ctx *ctx, uint32_t hash)
+{
+    return &ctx->dict.shards[hash >> (32 - LYDICT_SHARD_BITS)];
 }
 
 /*
@@ -124,21 +223,16 @@ dict_hash(const char *key, size_t len)
 uint32_t
 dict_hash_multi(uint32_t hash, const char *key_part, size_t len)
 {
-    uint32_t i;
+    uint64_t h;
 
-    if (key_part) {
-        for (i = 0; i < len; ++i) {
-            hash += key_part[i];
-            hash += (hash << 10);
-            hash ^= (hash >> 6);
-        }
-    } else {
-        hash += (hash << 3);
-        hash ^= (hash >> 11);
-        hash += (hash << 15);
+    if (!key_part) {
+        /* every part is already fully mixed into the hash */
+        return hash;
     }
 
-    return hash;
+    /* the previous hash seeds the next part */
+    h = dict_wyhash(key_part, len, hash);
+    return (uint32_t)(h ^ (h >> 32));
 }
 
 API void
@@ -149,6 +243,7 @@ lydict_remove(struct ly_ctx *ctx, const char *value)
     size_t len;
     int ret;
     uint32_t hash;
+    struct dict_shard *shard;
     struct dict_rec rec, *match = NULL;
     char *val_p;
 
@@ -158,16 +253,17 @@ lydict_remove(struct ly_ctx *ctx, const char *value)
 
     len = strlen(value);
     hash = dict_hash(value, len);
+    shard = dict_shard(ctx, hash);
 
     /* create record for lyht_find call */
     rec.value = (char *)value;
     rec.refcount = 0;
 
-    pthread_mutex_lock(&ctx->dict.lock);
+    pthread_mutex_lock(&shard->lock);
     /* set len as data for compare callback */
-    lyht_set_cb_data(ctx->dict.hash_tab, (void *)&len);
+    lyht_set_cb_data(shard->hash_tab, (void *)&len);
     /* check if value is already inserted */
-    ret = lyht_find(ctx->dict.hash_tab, &rec, hash, (void **)&match);
+    ret = lyht_find(shard->hash_tab, &rec, hash, (void **)&match);
 
     if (ret == 0) {
         LY_CHECK_ERR_GOTO(!match, LOGINT(ctx), finish);
@@ -181,32 +277,37 @@ lydict_remove(struct ly_ctx *ctx, const char *value)
              * free it after it is removed from hash table
              */
             val_p = match->value;
-            ret = lyht_remove(ctx->dict.hash_tab, &rec, hash);
+            ret = lyht_remove(shard->hash_tab, &rec, hash);
             free(val_p);
             LY_CHECK_ERR_GOTO(ret, LOGINT(ctx), finish);
         }
     }
 
 finish:
-    pthread_mutex_unlock(&ctx->dict.lock);
+    pthread_mutex_unlock(&shard->lock);
 }
 
 static char *
 dict_insert(struct ly_ctx *ctx, char *value, size_t len, int zerocopy)
 {
+    struct dict_shard *shard;
     struct dict_rec *match = NULL, rec;
+    char *result = NULL;
     int ret = 0;
     uint32_t hash;
 
     hash = dict_hash(value, len);
+    shard = dict_shard(ctx, hash);
+
+    pthread_mutex_lock(&shard->lock);
     /* set len as data for compare callback */
-    lyht_set_cb_data(ctx->dict.hash_tab, (void *)&len);
+    lyht_set_cb_data(shard->hash_tab, (void *)&len);
     /* create record for lyht_insert */
     rec.value = value;
     rec.refcount = 1;
 
     LOGDBG(LY_LDGDICT, "inserting \"%s\"", rec.value);
-    ret = lyht_insert(ctx->dict.hash_tab, (void *)&rec, hash, (void **)&match);
+    ret = lyht_insert(shard->hash_tab, (void *)&rec, hash, (void **)&match);
     if (ret == 1) {
         match->refcount++;
         if (zerocopy) {
@@ -219,17 +320,20 @@ dict_insert(struct ly_ctx *ctx, char *value, size_t len, int zerocopy)
              * record is already inserted in hash table
              */
             match->value = malloc(sizeof *match->value * (len + 1));
-            LY_CHECK_ERR_RETURN(!match->value, LOGMEM(ctx), NULL);
+            LY_CHECK_ERR_GOTO(!match->value, LOGMEM(ctx), finish);
             memcpy(match->value, value, len);
             match->value[len] = '\0';
         }
     } else {
         /* lyht_insert returned error */
         LOGINT(ctx);
-        return NULL;
+        goto finish;
     }
+    result = match->value;
 
-    return match->value;
+finish:
+    pthread_mutex_unlock(&shard->lock);
+    return result;
 }
 
 API const char *
@@ -237,8 +341,6 @@ lydict_insert(struct ly_ctx *ctx, const char *value, size_t len)
 {
     FUN_IN;
 
-    const char *result;
-
     if (!value) {
         return NULL;
     }
@@ -247,11 +349,7 @@ lydict_insert(struct ly_ctx *ctx, const char *value, size_t len)
         len = strlen(value);
     }
 
-    pthread_mutex_lock(&ctx->dict.lock);
-    result = dict_insert(ctx, (char *)value, len, 0);
-    pthread_mutex_unlock(&ctx->dict.lock);
-
-    return result;
+    return dict_insert(ctx, (char *)value, len, 0);
 }
 
 API const char *
@@ -259,17 +357,11 @@ lydict_insert_zc(struct ly_ctx *ctx, char *value)
 {
     FUN_IN;
 
-    const char *result;
-
     if (!value) {
         return NULL;
     }
 
-    pthread_mutex_lock(&ctx->dict.lock);
-    result = dict_insert(ctx, value, strlen(value), 1);
-    pthread_mutex_unlock(&ctx->dict.lock);
-
-    return result;
+    return dict_insert(ctx, value, strlen(value), 1);
 }
 
 struct ht_rec *
@@ -278,6 +370,28 @@ lyht_get_rec(unsigned char *recs, uint16_t rec_size, uint32_t idx)
     return (struct ht_rec *)&recs[idx * rec_size];
 }
 
+/**
+ * @brief Allocate the control bytes and records of a hash table, all the records are empty.
+ *
+ * @param[in] ht Hash table with the size and record size set.
+ * @return 0 on success, -1 on error.
+ */
+static int
+lyht_alloc(struct hash_table *ht)
+{
+    ht->ctrl = malloc(ht->size + LYHT_GROUP_SIZE);
+    ht->recs = malloc((size_t)ht->size * ht->rec_size);
+    if (!ht->ctrl || !ht->recs) {
+        free(ht->ctrl);
+        free(ht->recs);
+        LOGMEM(NULL);
+        return -1;
+    }
+    memset(ht->ctrl, LYHT_CTRL_EMPTY, ht->size + LYHT_GROUP_SIZE);
+
+    return 0;
+}
+
 struct hash_table *
 lyht_new(uint32_t size, uint16_t val_size, values_equal_cb val_equal, void *cb_data, int resize)
 {
@@ -301,10 +415,11 @@ lyht_new(uint32_t size, uint16_t val_size, values_equal_cb val_equal, void *cb_d
     ht->cb_data = cb_data;
     ht->resize = (uint16_t)resize;
 
-    ht->rec_size = (sizeof(struct ht_rec) - 1) + val_size;
+    ht->val_size = val_size;
+    ht->rec_size = offsetof(struct ht_rec, val) + val_size;
+    ht->rec_size = (ht->rec_size + LYHT_REC_ALIGN - 1) & ~(LYHT_REC_ALIGN - 1);
     /* allocate the records correctly */
-    ht->recs = calloc(size, ht->rec_size);
-    LY_CHECK_ERR_RETURN(!ht->recs, free(ht); LOGMEM(NULL), NULL);
+    LY_CHECK_ERR_RETURN(lyht_alloc(ht), free(ht), NULL);
 
     return ht;
 }
@@ -338,13 +453,14 @@ lyht_dup(const struct hash_table *orig)
         return NULL;
     }
 
-    ht = lyht_new(orig->size, orig->rec_size - (sizeof(struct ht_rec) - 1), orig->val_equal, orig->cb_data, orig->resize ? 1 : 0);
-    if (!ht) {
-        return NULL;
-    }
+    ht = malloc(sizeof *ht);
+    LY_CHECK_ERR_RETURN(!ht, LOGMEM(NULL), NULL);
+
+    *ht = *orig;
+    LY_CHECK_ERR_RETURN(lyht_alloc(ht), free(ht), NULL);
 
-    memcpy(ht->recs, orig->recs, (size_t)orig->used * (size_t)orig->rec_size);
-    ht->used = orig->used;
+    memcpy(ht->ctrl, orig->ctrl, orig->size + LYHT_GROUP_SIZE);
+    memcpy(ht->recs, orig->recs, (size_t)orig->size * orig->rec_size);
     return ht;
 }
 
@@ -352,233 +468,278 @@ void
 lyht_free(struct hash_table *ht)
 {
     if (ht) {
+        free(ht->ctrl);
         free(ht->recs);
         free(ht);
     }
 }
 
-static int
-lyht_resize(struct hash_table *ht, int enlarge)
+static inline int
+lyht_ctz(uint32_t mask)
 {
-    struct ht_rec *rec;
-    unsigned char *old_recs;
-    uint32_t i, old_size;
-    int ret;
-
-    old_recs = ht->recs;
-    old_size = ht->size;
+#ifdef __GNUC__
+    return __builtin_ctz(mask);
+#else
+    int i;
 
-    if (enlarge) {
-        /* double the size */
-        ht->size <<= 1;
-    } else {
-        /* half the size */
-        ht->size >>= 1;
-    }
+    for (i = 0; !(mask & 1); ++i, mask >>= 1);
+    return i;
+#endif
+}
 
-    ht->recs = calloc(ht->size, ht->rec_size);
-    LY_CHECK_ERR_RETURN(!ht->recs, LOGMEM(NULL); ht->recs = old_recs; ht->size = old_size, -1);
+/**
+ * @brief Compare a group of control bytes.
+ *
+ * @param[in] ctrl First control byte of the group.
+ * @param[in] h2 Control byte to look for.
+ * @param[out] match Bit mask of the control bytes equal to \p h2.
+ * @param[out] empty Bit mask of the empty records.
+ */
+static inline void
+lyht_group_match(const uint8_t *ctrl, uint8_t h2, uint32_t *match, uint32_t *empty)
+{
+#ifdef __SSE2__
+    __m128i group = _mm_loadu_si128((const __m128i *)ctrl);
 
-    /* reset used, it will increase again */
-    ht->used = 0;
+    *match = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)h2)));
+    /* only the empty control byte has the highest bit set */
+    *empty = (uint32_t)_mm_movemask_epi8(group);
+#else
+    uint32_t i;
 
-    /* add all the old records into the new records array */
-    for (i = 0; i < old_size; ++i) {
-        rec = lyht_get_rec(old_recs, ht->rec_size, i);
-        if (rec->hits > 0) {
-            ret = lyht_insert(ht, rec->val, rec->hash, NULL);
-            assert(!ret);
-            (void)ret;
+    *match = *empty = 0;
+    for (i = 0; i < LYHT_GROUP_SIZE; ++i) {
+        if (ctrl[i] == h2) {
+            *match |= 1U << i;
+        }
+        if (ctrl[i] == LYHT_CTRL_EMPTY) {
+            *empty |= 1U << i;
         }
     }
-
-    /* final touches */
-    free(old_recs);
-    return 0;
+#endif
 }
 
-/* return: 0 - hash found, returned its record,
- *         1 - hash not found, returned the record where it would be inserted */
-static int
-lyht_find_first(struct hash_table *ht, uint32_t hash, struct ht_rec **rec_p)
+/* the top hash bits select the dictionary shard, so use the ones under them */
+#define LYHT_H2(hash) ((uint8_t)(((hash) >> 21) & 0x7f))
+
+/**
+ * @brief Set the control byte of a record including its copies behind the end.
+ */
+static inline void
+lyht_set_ctrl(struct hash_table *ht, uint32_t idx, uint8_t ctrl)
 {
-    struct ht_rec *rec, *inval_rec = NULL;
-    uint32_t i, idx;
+    uint32_t i;
 
-    if (rec_p) {
-        *rec_p = NULL;
+    ht->ctrl[idx] = ctrl;
+    for (i = ht->size + idx; i < ht->size + LYHT_GROUP_SIZE; i += ht->size) {
+        ht->ctrl[i] = ctrl;
     }
+}
 
-    idx = i = hash & (ht->size - 1);
-    rec = lyht_get_rec(ht->recs, ht->rec_size, idx);
+/**
+ * @brief State of probing the records of one hash.
+ */
+struct lyht_probe {
+    uint32_t idx;         /* first record of the current group */
+    uint32_t probed;      /* number of records probed before the current group */
+    uint32_t match;       /* records of the current group with a matching control byte, not yet returned */
+    uint32_t end;         /* whether the current group ends the probe sequence */
+    uint8_t h2;           /* control byte of the hash */
+};
 
-    /* skip through overflow and deleted records */
-    while ((rec->hits != 0) && ((rec->hits == -1) || ((rec->hash & (ht->size - 1)) != idx))) {
-        if ((rec->hits == -1) && !inval_rec) {
-            /* remember the first invalid record we found while searching for this hash */
-            inval_rec = rec;
-        }
-        i = (i + 1) % ht->size;
-        if (i == idx) {
-            /* we went through all the records (very unlikely, but possible when many records are invalid),
-             * just return not found */
-            assert(inval_rec);
-            if (rec_p) {
-                *rec_p = inval_rec;
-            }
-            return 1;
-        }
-        rec = lyht_get_rec(ht->recs, ht->rec_size, i);
+static void
+lyht_probe_group(struct hash_table *ht, struct lyht_probe *probe)
+{
+    uint32_t empty;
+
+    lyht_group_match(&ht->ctrl[probe->idx], probe->h2, &probe->match, &empty);
+    if (empty) {
+        /* the records behind the first empty one belong to other probe sequences */
+        probe->match &= (empty & -empty) - 1;
+        probe->end = 1;
     }
+}
+
+static void
+lyht_probe_init(struct hash_table *ht, uint32_t hash, struct lyht_probe *probe)
+{
+    probe->idx = hash & (ht->size - 1);
+#ifdef __GNUC__
+    /* the record is most likely at its hash index, load it while the control bytes are compared */
+    __builtin_prefetch(lyht_get_rec(ht->recs, ht->rec_size, probe->idx));
+#endif
+    probe->probed = 0;
+    probe->end = 0;
+    probe->h2 = LYHT_H2(hash);
+    lyht_probe_group(ht, probe);
+}
 
-    if (rec->hits == 0) {
-        /* we could not find the value */
-        if (rec_p) {
-            /* return the first empty (or invalid) record found */
-            *rec_p = inval_rec ? inval_rec : rec;
+/**
+ * @brief Get the next record of a probe sequence with a matching control byte.
+ *
+ * @param[in] ht Hash table.
+ * @param[in,out] probe Probe state.
+ * @param[out] idx Index of the record.
+ * @return 0 if a record was returned, 1 if there are no more.
+ */
+static int
+lyht_probe_next(struct hash_table *ht, struct lyht_probe *probe, uint32_t *idx)
+{
+    while (!probe->match) {
+        probe->probed += LYHT_GROUP_SIZE;
+        if (probe->end || (probe->probed >= ht->size)) {
+            return 1;
         }
-        return 1;
+        probe->idx = (probe->idx + LYHT_GROUP_SIZE) & (ht->size - 1);
+        lyht_probe_group(ht, probe);
     }
 
-    /* we have found a record with equal (shortened) hash,
-     * move it to the first invalid record so that the next search is faster */
-    if (inval_rec) {
-        memcpy(inval_rec, rec, ht->rec_size);
-        rec->hits = -1;
-        rec = inval_rec;
-    }
-    if (rec_p) {
-        *rec_p = rec;
-    }
+    *idx = (probe->idx + lyht_ctz(probe->match)) & (ht->size - 1);
+    probe->match &= probe->match - 1;
     return 0;
 }
 
 /**
- * @brief Search for the next collision.
+ * @brief Find the first empty record of a probe sequence.
  *
- * @param[in] ht Hash table to search in.
- * @param[in,out] last Last returned collision record.
- * @param[in] first First collision record (hits > 1).
- * @return 0 when hash collision found, \p last points to this next collision,
- *         1 when hash collision not found, \p last points to the record where it would be inserted.
+ * @param[in] ht Hash table.
+ * @param[in] hash Hash of the sequence.
+ * @param[out] idx Index of the empty record.
+ * @return 0 on success, 1 if the table is full.
  */
 static int
-lyht_find_collision(struct hash_table *ht, struct ht_rec **last, struct ht_rec *first)
+lyht_find_empty(struct hash_table *ht, uint32_t hash, uint32_t *idx)
 {
-    struct ht_rec *inval_rec = NULL;
-    uint32_t i, idx;
+    uint32_t i, probed, match, empty;
 
-    assert(last && *last);
+    i = hash & (ht->size - 1);
+    for (probed = 0; probed < ht->size; probed += LYHT_GROUP_SIZE) {
+        lyht_group_match(&ht->ctrl[i], LYHT_CTRL_EMPTY, &match, &empty);
+        if (empty) {
+            *idx = (i + lyht_ctz(empty)) & (ht->size - 1);
+            return 0;
+        }
+        i = (i + LYHT_GROUP_SIZE) & (ht->size - 1);
+    }
 
-    idx = (*last)->hash & (ht->size - 1);
-    i = (((unsigned char *)*last) - ht->recs) / ht->rec_size;
+    return 1;
+}
 
-    do {
-        i = (i + 1) % ht->size;
-        *last = lyht_get_rec(ht->recs, ht->rec_size, i);
-        if (*last == first) {
-            /* we went through all the records (very unlikely, but possible when many records are invalid),
-             * just return an invalid record */
-            assert(inval_rec);
-            *last = inval_rec;
-            return 1;
-        }
+/**
+ * @brief Find the record of a value.
+ *
+ * @param[in] ht Hash table to search in.
+ * @param[in] val_p Pointer to the value to find.
+ * @param[in] hash Hash of the value.
+ * @param[in] mod Whether the table is going to be modified, passed to the callback.
+ * @param[out] idx Index of the matching record.
+ * @return 0 on success, 1 on not found.
+ */
+static int
+lyht_find_idx(struct hash_table *ht, void *val_p, uint32_t hash, int mod, uint32_t *idx)
+{
+    struct lyht_probe probe;
+    struct ht_rec *rec;
 
-        if (((*last)->hits == -1) && !inval_rec) {
-            inval_rec = *last;
-        }
-    } while (((*last)->hits != 0) && (((*last)->hits == -1) || (((*last)->hash & (ht->size - 1)) != idx)));
-
-    if ((*last)->hits > 0) {
-        /* we found a collision, so move it to the first invalid record so the next search is faster */
-        assert((*last)->hits == 1);
-        if (inval_rec) {
-            memcpy(inval_rec, *last, ht->rec_size);
-            (*last)->hits = -1;
-            *last = inval_rec;
+    lyht_probe_init(ht, hash, &probe);
+    while (!lyht_probe_next(ht, &probe, idx)) {
+        rec = lyht_get_rec(ht->recs, ht->rec_size, *idx);
+        if ((rec->hash == hash) && ht->val_equal(val_p, &rec->val, mod, ht->cb_data)) {
+            return 0;
         }
-        return 0;
     }
 
-    /* no next collision found, return the record where it would be inserted */
-    if (inval_rec) {
-        *last = inval_rec;
-    } /* else (*last)->hits == 0, it is already correct */
     return 1;
 }
 
-int
-lyht_find(struct hash_table *ht, void *val_p, uint32_t hash, void **match_p)
+/**
+ * @brief Resize a hash table, all the records are moved into new arrays without comparing any values.
+ *
+ * @param[in] ht Hash table to resize.
+ * @param[in] operation 1 to double the size, -1 to half the size.
+ * @param[in,out] idx Index of a record to follow, its new index is returned, optional.
+ * @return 0 on success, -1 on error.
+ */
+static int
+lyht_resize(struct hash_table *ht, int operation, uint32_t *idx)
 {
-    struct ht_rec *rec, *crec;
-    uint32_t i, c;
+    struct ht_rec *rec;
+    unsigned char *old_recs;
+    uint8_t *old_ctrl;
+    uint32_t i, new_idx, old_size;
     int r;
 
-    if (lyht_find_first(ht, hash, &rec)) {
-        /* not found */
-        return 1;
+    old_ctrl = ht->ctrl;
+    old_recs = ht->recs;
+    old_size = ht->size;
+
+    if (operation > 0) {
+        /* double the size */
+        ht->size <<= 1;
+    } else {
+        /* half the size */
+        ht->size >>= 1;
     }
-    if ((rec->hash == hash) && ht->val_equal(val_p, &rec->val, 0, ht->cb_data)) {
-        /* even the value matches */
-        if (match_p) {
-            *match_p = rec->val;
-        }
-        return 0;
+
+    if (lyht_alloc(ht)) {
+        ht->ctrl = old_ctrl;
+        ht->recs = old_recs;
+        ht->size = old_size;
+        return -1;
     }
 
-    /* some collisions, we need to go through them, too */
-    crec = rec;
-    c = rec->hits;
-    for (i = 1; i < c; ++i) {
-        r = lyht_find_collision(ht, &rec, crec);
+    /* add all the old records into the new arrays, they are all distinct */
+    for (i = 0; i < old_size; ++i) {
+        if (old_ctrl[i] == LYHT_CTRL_EMPTY) {
+            continue;
+        }
+        rec = lyht_get_rec(old_recs, ht->rec_size, i);
+        r = lyht_find_empty(ht, rec->hash, &new_idx);
         assert(!r);
         (void)r;
 
-        /* compare values */
-        if ((rec->hash == hash) && ht->val_equal(val_p, &rec->val, 0, ht->cb_data)) {
-            if (match_p) {
-                *match_p = rec->val;
-            }
-            return 0;
+        lyht_set_ctrl(ht, new_idx, old_ctrl[i]);
+        memcpy(lyht_get_rec(ht->recs, ht->rec_size, new_idx), rec, ht->rec_size);
+        if (idx && (*idx == i)) {
+            *idx = new_idx;
+            idx = NULL;
         }
     }
 
-    /* not found even in collisions */
-    return 1;
+    /* final touches */
+    free(old_ctrl);
+    free(old_recs);
+    return 0;
 }
 
 int
-lyht_find_next(struct hash_table *ht, void *val_p, uint32_t hash, void **match_p)
+lyht_find(struct hash_table *ht, void *val_p, uint32_t hash, void **match_p)
 {
-    struct ht_rec *rec, *crec;
-    uint32_t i, c;
-    int r, found = 0;
+    uint32_t idx;
 
-    if (lyht_find_first(ht, hash, &rec)) {
-        /* not found, cannot happen */
-        assert(0);
-    }
-
-    if ((rec->hash == hash) && ht->val_equal(val_p, &rec->val, 1, ht->cb_data)) {
-        /* previously returned value */
-        found = 1;
+    if (lyht_find_idx(ht, val_p, hash, 0, &idx)) {
+        /* not found */
+        return 1;
     }
 
-    if (rec->hits == 1) {
-        /* there are no more similar values */
-        assert(rec->hash == hash);
-        assert(found);
-        return 1;
+    if (match_p) {
+        *match_p = lyht_get_rec(ht->recs, ht->rec_size, idx)->val;
     }
+    return 0;
+}
 
-    /* go through collisions and find next one after the previous one */
-    crec = rec;
-    c = rec->hits;
-    for (i = 1; i < c; ++i) {
-        r = lyht_find_collision(ht, &rec, crec);
-        assert(!r);
-        (void)r;
+int
+lyht_find_next(struct hash_table *ht, void *val_p, uint32_t hash, void **match_p)
+{
+    struct lyht_probe probe;
+    struct ht_rec *rec;
+    uint32_t idx;
+    int found = 0;
 
+    /* records with equal hashes keep their order in the probe sequence, removal included */
+    lyht_probe_init(ht, hash, &probe);
+    while (!lyht_probe_next(ht, &probe, &idx)) {
+        rec = lyht_get_rec(ht->recs, ht->rec_size, idx);
         if (rec->hash != hash) {
             /* a normal collision, we are not interested in those */
             continue;
@@ -592,13 +753,10 @@ lyht_find_next(struct hash_table *ht, void *val_p, uint32_t hash, void **match_p
             return 0;
         }
 
-        if (!ht->val_equal(val_p, &rec->val, 1, ht->cb_data)) {
-            /* already returned value, skip */
-            continue;
+        if (ht->val_equal(val_p, &rec->val, 1, ht->cb_data)) {
+            /* this one was returned previously, continue looking */
+            found = 1;
         }
-
-        /* this one was returned previously, continue looking */
-        found = 1;
     }
 
     /* the last equal value was already returned */
@@ -608,16 +766,14 @@ lyht_find_next(struct hash_table *ht, void *val_p, uint32_t hash, void **match_p
 
 /* prints little-endian numbers, will also work on big-endian just the values will look weird */
 static char *
-lyht_dbgprint_val2str(void *val_p, int32_t hits, uint16_t rec_size)
+lyht_dbgprint_val2str(void *val_p, int filled, uint16_t val_size)
 {
     char *val;
-    int32_t i, j, val_size;
-
-    val_size = rec_size - (sizeof(struct ht_rec) - 1);
+    int32_t i, j;
 
     val = malloc(val_size * 2 + 1);
     for (i = 0, j = val_size - 1; i < val_size; ++i, --j) {
-        if (hits > 0) {
+        if (filled) {
             sprintf(val + i * 2, "%02x", *(((uint8_t *)val_p) + j));
         } else {
             sprintf(val + i * 2, "  ");
@@ -648,13 +804,12 @@ lyht_dbgprint_ht(struct hash_table *ht, const char *info)
 
     for (i = 0; i < ht->size; ++i) {
         rec = lyht_get_rec(ht->recs, ht->rec_size, i);
-        val = lyht_dbgprint_val2str(&rec->val, rec->hits, ht->rec_size);
-        if (rec->hits > 0) {
-            LOGDBG(LY_LDGHASH, "[%*u] val  %s  hash  %10u %% %*u  hits  %2d",
-                   (int)i_len, i, val, rec->hash, (int)i_len, rec->hash & (ht->size - 1), rec->hits);
+        val = lyht_dbgprint_val2str(&rec->val, ht->ctrl[i] != LYHT_CTRL_EMPTY, ht->val_size);
+        if (ht->ctrl[i] != LYHT_CTRL_EMPTY) {
+            LOGDBG(LY_LDGHASH, "[%*u] val  %s  hash  %10u %% %*u",
+                   (int)i_len, i, val, rec->hash, (int)i_len, rec->hash & (ht->size - 1));
         } else {
-            LOGDBG(LY_LDGHASH, "[%*u] val  %s  hash  %10s %% %*s  hits  %2d",
-                   (int)i_len, i, val, "", (int)i_len, "", rec->hits);
+            LOGDBG(LY_LDGHASH, "[%*u] val  %s", (int)i_len, i, val);
         }
         free(val);
     }
@@ -662,75 +817,46 @@ lyht_dbgprint_ht(struct hash_table *ht, const char *info)
 }
 
 static void
-lyht_dbgprint_value(void *val_p, uint32_t hash, uint16_t rec_size, const char *operation)
+lyht_dbgprint_value(void *val_p, uint32_t hash, uint16_t val_size, const char *operation)
 {
     if (LY_LLDBG > ly_log_level) {
         return;
     }
 
-    char *val = lyht_dbgprint_val2str(val_p, 1, rec_size);
+    char *val = lyht_dbgprint_val2str(val_p, 1, val_size);
     LOGDBG(LY_LDGHASH, "%s value %s with hash %u", operation, val, hash);
     free(val);
 }
 
 int
 lyht_insert_with_resize_cb(struct hash_table *ht, void *val_p, uint32_t hash,
-                           values_equal_cb resize_val_equal, void **match_p)
+                           values_equal_cb UNUSED(resize_val_equal), void **match_p)
 {
-    struct ht_rec *rec, *crec = NULL;
-    int32_t i;
+    struct ht_rec *rec;
+    uint32_t idx;
     int r, ret;
-    values_equal_cb old_val_equal;
 
     lyht_dbgprint_ht(ht, "before");
-    lyht_dbgprint_value(val_p, hash, ht->rec_size, "inserting");
+    lyht_dbgprint_value(val_p, hash, ht->val_size, "inserting");
 
-    if (!lyht_find_first(ht, hash, &rec)) {
-        /* we found matching shortened hash */
-        if ((rec->hash == hash) && ht->val_equal(val_p, &rec->val, 1, ht->cb_data)) {
-            /* even the value matches */
-            if (match_p) {
-                *match_p = (void *)&rec->val;
-            }
-            return 1;
-        }
-
-        /* some collisions, we need to go through them, too */
-        crec = rec;
-        for (i = 1; i < crec->hits; ++i) {
-            r = lyht_find_collision(ht, &rec, crec);
-            assert(!r);
-
-            /* compare values */
-            if ((rec->hash == hash) && ht->val_equal(val_p, &rec->val, 1, ht->cb_data)) {
-                if (match_p) {
-                    *match_p = (void *)&rec->val;
-                }
-                return 1;
-            }
+    if (!lyht_find_idx(ht, val_p, hash, 1, &idx)) {
+        /* the value is already there */
+        if (match_p) {
+            *match_p = lyht_get_rec(ht->recs, ht->rec_size, idx)->val;
         }
-
-        /* value not found, get the record where it will be inserted */
-        r = lyht_find_collision(ht, &rec, crec);
-        assert(r);
-    }
-
-    /* insert it into the returned record */
-    assert(rec->hits < 1);
-    rec->hash = hash;
-    rec->hits = 1;
-    memcpy(&rec->val, val_p, ht->rec_size - (sizeof(struct ht_rec) - 1));
-    if (match_p) {
-        *match_p = (void *)&rec->val;
+        return 1;
     }
 
-    if (crec) {
-        /* there was a collision, increase hits */
-        if (crec->hits == INT32_MAX) {
-            LOGINT(NULL);
-        }
-        ++crec->hits;
+    /* insert it into the first empty record */
+    if (lyht_find_empty(ht, hash, &idx)) {
+        /* a full table that cannot be resized */
+        LOGINT(NULL);
+        return -1;
     }
+    rec = lyht_get_rec(ht->recs, ht->rec_size, idx);
+    rec->hash = hash;
+    memcpy(&rec->val, val_p, ht->val_size);
+    lyht_set_ctrl(ht, idx, LYHT_H2(hash));
 
     /* check size & enlarge if needed */
     ret = 0;
@@ -742,23 +868,15 @@ lyht_insert_with_resize_cb(struct hash_table *ht, void *val_p, uint32_t hash,
             ht->resize = 2;
         }
         if ((ht->resize == 2) && (r >= LYHT_ENLARGE_PERCENTAGE)) {
-            if (resize_val_equal) {
-                old_val_equal = lyht_set_cb(ht, resize_val_equal);
-            }
-
-            /* enlarge */
-            ret = lyht_resize(ht, 1);
-            /* if hash_table was resized, we need to find new matching value */
-            if (ret == 0 && match_p) {
-                lyht_find(ht, val_p, hash, match_p);
-            }
-
-            if (resize_val_equal) {
-                lyht_set_cb(ht, old_val_equal);
-            }
+            /* enlarge, the inserted record is followed so no values need to be compared */
+            ret = lyht_resize(ht, 1, &idx);
         }
     }
 
+    if (match_p) {
+        *match_p = lyht_get_rec(ht->recs, ht->rec_size, idx)->val;
+    }
+
     lyht_dbgprint_ht(ht, "after");
     return ret;
 }
@@ -772,55 +890,31 @@ lyht_insert(struct hash_table *ht, void *val_p, uint32_t hash, void **match_p)
 int
 lyht_remove(struct hash_table *ht, void *val_p, uint32_t hash)
 {
-    struct ht_rec *rec, *crec;
-    int32_t i;
-    int first_matched = 0, r, ret;
+    struct ht_rec *rec;
+    uint32_t idx, i, mask;
+    int r, ret;
 
     lyht_dbgprint_ht(ht, "before");
-    lyht_dbgprint_value(val_p, hash, ht->rec_size, "removing");
+    lyht_dbgprint_value(val_p, hash, ht->val_size, "removing");
 
-    if (lyht_find_first(ht, hash, &rec)) {
-        /* hash not found */
+    if (lyht_find_idx(ht, val_p, hash, 1, &idx)) {
+        /* value not found */
         LOGDBG(LY_LDGHASH, "remove failed");
         return 1;
     }
-    if ((rec->hash == hash) && ht->val_equal(val_p, &rec->val, 1, ht->cb_data)) {
-        /* even the value matches */
-        first_matched = 1;
-    }
-
-    /* we always need to go through collisions */
-    crec = rec;
-    for (i = 1; i < crec->hits; ++i) {
-        r = lyht_find_collision(ht, &rec, crec);
-        assert(!r);
-
-        /* compare values */
-        if (!first_matched && (rec->hash == hash) && ht->val_equal(val_p, &rec->val, 1, ht->cb_data)) {
-            break;
-        }
-    }
 
-    if (i < crec->hits) {
-        /* one of collisions matched, reduce collision count, remove the record */
-        assert(!first_matched);
-        --crec->hits;
-        rec->hits = -1;
-    } else if (first_matched) {
-        /* the first record matches */
-        if (crec != rec) {
-            /* ... and there are some collisions so put the last collision in its place keeping the correct collision count */
-            rec->hits = crec->hits - 1;
-            memcpy(crec, rec, ht->rec_size);
+    /* shift back all the following records of the run that may be stored closer to their hash index,
+     * so that no probe sequence is interrupted by the removed record */
+    lyht_set_ctrl(ht, idx, LYHT_CTRL_EMPTY);
+    mask = ht->size - 1;
+    for (i = (idx + 1) & mask; ht->ctrl[i] != LYHT_CTRL_EMPTY; i = (i + 1) & mask) {
+        rec = lyht_get_rec(ht->recs, ht->rec_size, i);
+        if (((i - (rec->hash & mask)) & mask) >= ((i - idx) & mask)) {
+            memcpy(lyht_get_rec(ht->recs, ht->rec_size, idx), rec, ht->rec_size);
+            lyht_set_ctrl(ht, idx, ht->ctrl[i]);
+            lyht_set_ctrl(ht, i, LYHT_CTRL_EMPTY);
+            idx = i;
         }
-
-        /* this matching record was removed and is not valid anymore */
-        rec->hits = -1;
-    } else {
-        /* value not found even in collisions */
-        assert(!first_matched);
-        LOGDBG(LY_LDGHASH, "remove failed");
-        return 1;
     }
 
     /* check size & shrink if needed */
@@ -830,7 +924,7 @@ lyht_remove(struct hash_table *ht, void *val_p, uint32_t hash)
         r = (ht->used * 100) / ht->size;
         if ((r < LYHT_SHRINK_PERCENTAGE) && (ht->size > LYHT_MIN_SIZE)) {
             /* shrink */
-            ret = lyht_resize(ht, 0);
+            ret = lyht_resize(ht, -1, NULL);
         }
     }
 
@@ -55,22 +55,32 @@ typedef int (*values_equal_cb)(void *val1_p, void *val2_p, int mod, void *cb_dat
 /** never shrink beyond this size */
 #define LYHT_MIN_SIZE 8
 
+/** number of control bytes probed at once */
+#define LYHT_GROUP_SIZE 16
+
+/** control byte of an empty record, filled records store 7 bits of their hash */
+#define LYHT_CTRL_EMPTY 0x80
+
+/** alignment of the records and so of the stored values */
+#define LYHT_REC_ALIGN 8
+
 /**
  * @brief Generic hash table record.
  */
 struct ht_rec {
     uint32_t hash;        /* hash of the value */
-    int32_t hits;         /* (collision/overflow value count - 1) (a filled entry has 1 hit),
-                           * special value (-1) means a deleted record) */
+    uint32_t padding;     /* aligns the value */
     unsigned char val[1]; /* arbitrary-size value */
-} _PACKED;
+};
 
 /**
  * @brief (Very) generic hash table.
  *
  * Hash table with open addressing collision resolution and
  * linear probing of interval 1 (next free record is used).
- * Removal is lazy (removed records are only marked).
+ * Every record has a control byte, they are kept in a separate array
+ * so that whole groups of them are compared at once.
+ * Removal shifts the following records back so no deleted records remain.
  */
 struct hash_table {
     uint32_t used;        /* number of values stored in the hash table (filled records) */
@@ -81,6 +91,9 @@ struct hash_table {
                            * 1 - enlarging is enabled, *
                            * 2 - both shrinking and enlarging is enabled */
     uint16_t rec_size;    /* real size (in bytes) of one record for accessing recs array */
+    uint16_t val_size;    /* size (in bytes) of the stored values */
+    uint8_t *ctrl;        /* control bytes of the records followed by LYHT_GROUP_SIZE bytes repeating them
+                           * from the start, so that a group can be read from any index */
     unsigned char *recs;  /* pointer to the hash table itself (array of struct ht_rec) */
 };
 
@@ -89,14 +102,25 @@ struct dict_rec {
     uint32_t refcount;
 } _PACKED;
 
+/** the dictionary is split into 2^LYDICT_SHARD_BITS independently locked parts */
+#define LYDICT_SHARD_BITS 4
+#define LYDICT_SHARD_COUNT (1 << LYDICT_SHARD_BITS)
+
 /**
- * dictionary to store repeating strings
+ * part of the dictionary with its own lock, strings are split among the shards by their hash
  */
-struct dict_table {
+struct dict_shard {
     struct hash_table *hash_tab;
     pthread_mutex_t lock;
 };
 
+/**
+ * dictionary to store repeating strings
+ */
+struct dict_table {
+    struct dict_shard shards[LYDICT_SHARD_COUNT];
+};
+
 /**
  * @brief Initiate content (non-zero values) of the dictionary
  *
@@ -201,15 +225,14 @@ int lyht_find_next(struct hash_table *ht, void *val_p, uint32_t hash, void **mat
 int lyht_insert(struct hash_table *ht, void *val_p, uint32_t hash, void **match_p);
 
 /**
- * @brief Insert a value into hash table. Same functionality as lyht_insert()
- * but allows to specify a temporary val equal callback to be used in case the hash table
- * will be resized after successful insertion.
+ * @brief Insert a value into hash table. Same functionality as lyht_insert(),
+ * kept for compatibility from the time resizing re-inserted all the values.
  *
  * @param[in] ht Hash table to insert into.
  * @param[in] val_p Pointer to the value to insert. Be careful, if the values stored in the hash table
  * are pointers, \p val_p must be a pointer to a pointer.
  * @param[in] hash Hash of the stored value.
- * @param[in] resize_val_equal Val equal callback to use for resizing.
+ * @param[in] resize_val_equal Not used, resizing never compares the values.
  * @param[out] match_p Pointer to the stored value, optional
  * @return 0 on success, 1 if already inserted, -1 on error.
  */
@@ -589,16 +589,25 @@ ly_vlog_build_path_print(char **path, uint16_t *index, const char *str, uint16_t
 int
 ly_vlog_build_path(enum LY_VLOG_ELEM elem_type, const void *elem, char **path, int schema_all_prefixes, int data_no_last_predicate)
 {
-    int i, j, yang_data_extension = 0;
-    struct lys_node_list *slist;
+    int yang_data_extension = 0;
     struct lys_node *sparent = NULL;
-    struct lyd_node *dlist, *diter;
     const struct lys_module *top_smodule = NULL;
-    const char *name, *prefix = NULL, *val_end, *val_start, *ext_name;
-    char *str;
+    const char *name, *prefix = NULL;
     uint16_t length, index;
     size_t len;
 
+    if ((elem_type == LY_VLOG_LYD) && elem) {
+        /* data paths are built forwards */
+        *path = NULL;
+        len = 0;
+        if (lyd_path_build(elem, path, &len, data_no_last_predicate) < 0) {
+            free(*path);
+            *path = NULL;
+            return -1;
+        }
+        return 0;
+    }
+
     length = 0;
     *path = malloc(1);
     LY_CHECK_ERR_RETURN(!(*path), LOGMEM(NULL), -1);
@@ -671,138 +680,6 @@ ly_vlog_build_path(enum LY_VLOG_ELEM elem_type, const void *elem, char **path, i
                 elem = lys_parent((struct lys_node *)elem);
             } while (elem && (((struct lys_node *)elem)->nodetype == LYS_USES));
             break;
-        case LY_VLOG_LYD:
-            name = ((struct lyd_node *)elem)->schema->name;
-            if (!((struct lyd_node *)elem)->parent ||
-                    lyd_node_module((struct lyd_node *)elem) != lyd_node_module(((struct lyd_node *)elem)->parent)) {
-                prefix = lyd_node_module((struct lyd_node *)elem)->name;
-            } else {
-                prefix = NULL;
-            }
-
-            /* handle predicates (keys) in case of lists */
-            if (!data_no_last_predicate || index) {
-                if (((struct lyd_node *)elem)->schema->nodetype == LYS_LIST) {
-                    dlist = (struct lyd_node *)elem;
-                    slist = (struct lys_node_list *)((struct lyd_node *)elem)->schema;
-                    if (slist->keys_size) {
-                        /* schema list with keys - use key values in predicates */
-                        for (i = slist->keys_size - 1; i > -1; i--) {
-                            LY_TREE_FOR(dlist->child, diter) {
-                                if (diter->schema == (struct lys_node *)slist->keys[i]) {
-                                    break;
-                                }
-                            }
-                            if (diter && ((struct lyd_node_leaf_list *)diter)->value_str) {
-                                if (strchr(((struct lyd_node_leaf_list *)diter)->value_str, '\'')) {
-                                    val_start = "=\"";
-                                    val_end = "\"]";
-                                } else {
-                                    val_start = "='";
-                                    val_end = "']";
-                                }
-
-                                /* print value */
-                                if (ly_vlog_build_path_print(path, &index, val_end, 2, &length)) {
-                                    return -1;
-                                }
-                                len = strlen(((struct lyd_node_leaf_list *)diter)->value_str);
-                                if (ly_vlog_build_path_print(path, &index,
-                                        ((struct lyd_node_leaf_list *)diter)->value_str, len, &length)) {
-                                    return -1;
-                                }
-
-                                /* print schema name */
-                                if (ly_vlog_build_path_print(path, &index, val_start, 2, &length)) {
-                                    return -1;
-                                }
-                                len = strlen(diter->schema->name);
-                                if (ly_vlog_build_path_print(path, &index, diter->schema->name, len, &length)) {
-                                    return -1;
-                                }
-
-                                if (lyd_node_module(dlist) != lyd_node_module(diter)) {
-                                    if (ly_vlog_build_path_print(path, &index, ":", 1, &length)) {
-                                        return -1;
-                                    }
-                                    len = strlen(lyd_node_module(diter)->name);
-                                    if (ly_vlog_build_path_print(path, &index, lyd_node_module(diter)->name, len, &length)) {
-                                        return -1;
-                                    }
-                                }
-
-                                if (ly_vlog_build_path_print(path, &index, "[", 1, &length)) {
-                                    return -1;
-                                }
-                            }
-                        }
-                    } else {
-                        /* schema list without keys - use instance position */
-                        i = j = lyd_list_pos(dlist);
-                        len = 1;
-                        while (j > 9) {
-                            ++len;
-                            j /= 10;
-                        }
-
-                        if (ly_vlog_build_path_print(path, &index, "]", 1, &length)) {
-                            return -1;
-                        }
-
-                        str = malloc(len + 1);
-                        LY_CHECK_ERR_RETURN(!str, LOGMEM(NULL), -1);
-                        sprintf(str, "%d", i);
-
-                        if (ly_vlog_build_path_print(path, &index, str, len, &length)) {
-                            free(str);
-                            return -1;
-                        }
-                        free(str);
-
-                        if (ly_vlog_build_path_print(path, &index, "[", 1, &length)) {
-                            return -1;
-                        }
-                    }
-                } else if (((struct lyd_node *)elem)->schema->nodetype == LYS_LEAFLIST &&
-                        ((struct lyd_node_leaf_list *)elem)->value_str) {
-                    if (strchr(((struct lyd_node_leaf_list *)elem)->value_str, '\'')) {
-                        val_start = "[.=\"";
-                        val_end = "\"]";
-                    } else {
-                        val_start = "[.='";
-                        val_end = "']";
-                    }
-
-                    if (ly_vlog_build_path_print(path, &index, val_end, 2, &length)) {
-                        return -1;
-                    }
-                    len = strlen(((struct lyd_node_leaf_list *)elem)->value_str);
-                    if (ly_vlog_build_path_print(path, &index, ((struct lyd_node_leaf_list *)elem)->value_str, len, &length)) {
-                        return -1;
-                    }
-                    if (ly_vlog_build_path_print(path, &index, val_start, 4, &length)) {
-                        return -1;
-                    }
-                }
-            }
-
-            /* check if it is yang-data top element */
-            if (!((struct lyd_node *)elem)->parent) {
-                ext_name = lyp_get_yang_data_template_name(elem);
-                if (ext_name) {
-                    if (ly_vlog_build_path_print(path, &index, name, strlen(name), &length)) {
-                        return -1;
-                    }
-                    if (ly_vlog_build_path_print(path, &index, "/", 1, &length)) {
-                        return -1;
-                    }
-                    yang_data_extension = 1;
-                    name = ext_name;
-               }
-            }
-
-            elem = ((struct lyd_node *)elem)->parent;
-            break;
         case LY_VLOG_STR:
             len = strlen((const char *)elem);
             if (ly_vlog_build_path_print(path, &index, (const char *)elem, len, &length)) {
@@ -982,6 +859,57 @@ ly_err_free_next(struct ly_ctx *ctx, struct ly_err_item *last_eitem)
     }
 }
 
+/**
+ * @brief Disconnect all the errors newer than \p last_eitem from the error list of the current thread.
+ */
+struct ly_err_item *
+ly_err_detach(struct ly_ctx *ctx, struct ly_err_item *last_eitem)
+{
+    struct ly_err_item *first, *eitem;
+
+    first = pthread_getspecific(ctx->errlist_key);
+    if (!first) {
+        return NULL;
+    }
+
+    if (!last_eitem) {
+        pthread_setspecific(ctx->errlist_key, NULL);
+        return first;
+    }
+
+    eitem = last_eitem->next;
+    if (eitem) {
+        eitem->prev = first->prev;
+        first->prev = last_eitem;
+        last_eitem->next = NULL;
+    }
+    return eitem;
+}
+
+/**
+ * @brief Append the errors \p eitem to the error list of the current thread.
+ */
+void
+ly_err_attach(struct ly_ctx *ctx, struct ly_err_item *eitem)
+{
+    struct ly_err_item *first, *last;
+
+    if (!eitem) {
+        return;
+    }
+
+    first = pthread_getspecific(ctx->errlist_key);
+    if (!first) {
+        pthread_setspecific(ctx->errlist_key, eitem);
+        return;
+    }
+
+    last = first->prev;
+    first->prev = eitem->prev;
+    last->next = eitem;
+    eitem->prev = last;
+}
+
 /**
  * @brief Properly clean errors from \p ctx based on the user and internal logging options
  * after resolving schema/data unres.
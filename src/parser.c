@@ -239,6 +239,13 @@ lyp_data_check_options(struct ly_ctx *ctx, int options, const char *func)
         }
     }
 
+    /* LYD_OPT_VAL_INCR can be used only with LYD_OPT_DATA or LYD_OPT_CONFIG */
+    if ((options & LYD_OPT_VAL_INCR) && (x != LYD_OPT_DATA) && (x != LYD_OPT_CONFIG)) {
+        LOGERR(ctx, LY_EINVAL, "%s: Invalid options 0x%x (LYD_OPT_VAL_INCR can be used only with LYD_OPT_DATA or LYD_OPT_CONFIG)",
+               func, options);
+        return 1;
+    }
+
     /* "is power of 2" algorithm, with 0 exception */
     if (x && !(x && !(x & (x - 1)))) {
         LOGERR(ctx, LY_EINVAL, "%s: Invalid options 0x%x (multiple data type flags set).", func, options);
@@ -598,14 +605,52 @@ validate_length_range(uint8_t kind, uint64_t unum, int64_t snum, int64_t fnum, u
     return EXIT_SUCCESS;
 }
 
+#ifdef LY_ENABLED_CACHE
+
+/**
+ * @brief Precompile all the patterns of a string type into its cache. The cache is published only
+ * once it is complete so that other threads never see it partially built.
+ *
+ * @param[in] ctx Context to use.
+ * @param[in] type String type with the patterns.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on error.
+ */
+static int
+lyp_precompile_patterns(struct ly_ctx *ctx, struct lys_type *type)
+{
+    void **precomp;
+    unsigned int i;
+
+    precomp = calloc(2 * type->info.str.pat_count, sizeof *precomp);
+    LY_CHECK_ERR_RETURN(!precomp, LOGMEM(ctx), EXIT_FAILURE);
+
+    for (i = 0; i < type->info.str.pat_count; ++i) {
+        if (lyp_precompile_pattern(ctx, &type->info.str.patterns[i].expr[1], (pcre**)&precomp[i * 2],
+                                   (pcre_extra**)&precomp[i * 2 + 1])) {
+            for (; i; --i) {
+                pcre_free((pcre*)precomp[2 * (i - 1)]);
+                pcre_free_study((pcre_extra*)precomp[2 * (i - 1) + 1]);
+            }
+            free(precomp);
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* other threads may be reading it without the lock */
+    __atomic_store_n(&type->info.str.patterns_pcre, precomp, __ATOMIC_RELEASE);
+    return EXIT_SUCCESS;
+}
+
+#endif
+
 /* logs directly */
 static int
 validate_pattern(struct ly_ctx *ctx, const char *val_str, struct lys_type *type, struct lyd_node *node)
 {
     int rc;
     unsigned int i;
-#ifndef LY_ENABLED_CACHE
-    pcre *precomp;
+#ifdef LY_ENABLED_CACHE
+    void **patterns_pcre;
 #endif
 
     assert(ctx && (type->base == LY_TYPE_STRING));
@@ -619,31 +664,28 @@ validate_pattern(struct ly_ctx *ctx, const char *val_str, struct lys_type *type,
     }
 
 #ifdef LY_ENABLED_CACHE
-    /* there is no cache, build it */
-    if (!type->info.str.patterns_pcre && type->info.str.pat_count) {
-        type->info.str.patterns_pcre = malloc(2 * type->info.str.pat_count * sizeof *type->info.str.patterns_pcre);
-        LY_CHECK_ERR_RETURN(!type->info.str.patterns_pcre, LOGMEM(ctx), -1);
-
-        for (i = 0; i < type->info.str.pat_count; ++i) {
-            if (lyp_precompile_pattern(ctx, &type->info.str.patterns[i].expr[1],
-                                       (pcre**)&type->info.str.patterns_pcre[i * 2],
-                                       (pcre_extra**)&type->info.str.patterns_pcre[i * 2 + 1])) {
-                return EXIT_FAILURE;
-            }
+    /* there is no cache, build it (only once even if several threads are parsing data) */
+    patterns_pcre = __atomic_load_n(&type->info.str.patterns_pcre, __ATOMIC_ACQUIRE);
+    if (!patterns_pcre && type->info.str.pat_count) {
+        pthread_mutex_lock(&ctx->cache_lock);
+        if (!type->info.str.patterns_pcre && lyp_precompile_patterns(ctx, type)) {
+            pthread_mutex_unlock(&ctx->cache_lock);
+            return EXIT_FAILURE;
         }
+        patterns_pcre = type->info.str.patterns_pcre;
+        pthread_mutex_unlock(&ctx->cache_lock);
     }
 #endif
 
     for (i = 0; i < type->info.str.pat_count; ++i) {
 #ifdef LY_ENABLED_CACHE
-        rc = pcre_exec((pcre *)type->info.str.patterns_pcre[2 * i], (pcre_extra *)type->info.str.patterns_pcre[2 * i + 1],
+        rc = pcre_exec((pcre *)patterns_pcre[2 * i], (pcre_extra *)patterns_pcre[2 * i + 1],
                        val_str, strlen(val_str), 0, 0, NULL, 0);
 #else
-        if (lyp_check_pattern(ctx, &type->info.str.patterns[i].expr[1], &precomp)) {
+        rc = lyp_regex_match(ctx, &type->info.str.patterns[i].expr[1], val_str);
+        if (rc == -1) {
             return EXIT_FAILURE;
         }
-        rc = pcre_exec(precomp, NULL, val_str, strlen(val_str), 0, 0, NULL, 0);
-        free(precomp);
 #endif
         if ((rc && type->info.str.patterns[i].expr[0] == 0x06) || (!rc && type->info.str.patterns[i].expr[0] == 0x15)) {
             LOGVAL(ctx, LYE_NOCONSTR, LY_VLOG_LYD, node, val_str, &type->info.str.patterns[i].expr[1]);
@@ -944,25 +986,264 @@ lyp_check_pattern(struct ly_ctx *ctx, const char *pattern, pcre **pcre_precomp)
     return EXIT_SUCCESS;
 }
 
+/**
+ * @brief JIT stack of a thread, all the stacks of a context are linked so that they can be freed with it.
+ */
+struct lyp_jit_stack {
+    struct ly_ctx *ctx;
+    void *stack;                    /**< pcre_jit_stack */
+    struct lyp_jit_stack *prev, *next;
+};
+
+#ifdef PCRE_STUDY_JIT_COMPILE
+
+/* initial and maximal size of the JIT stack of a thread */
+#define LYP_JIT_STACK_START (32 * 1024)
+#define LYP_JIT_STACK_MAX (512 * 1024)
+
+/**
+ * @brief PCRE callback returning the JIT stack of the current thread, the compiled patterns
+ * are shared by all the threads using the context.
+ */
+static pcre_jit_stack *
+lyp_jit_stack(void *arg)
+{
+    struct ly_ctx *ctx = arg;
+    struct lyp_jit_stack *rec;
+
+    rec = pthread_getspecific(ctx->jit_stack_key);
+    if (rec) {
+        return rec->stack;
+    }
+
+    rec = calloc(1, sizeof *rec);
+    if (!rec) {
+        /* NULL makes PCRE use a small stack of its own */
+        return NULL;
+    }
+    rec->ctx = ctx;
+    rec->stack = pcre_jit_stack_alloc(LYP_JIT_STACK_START, LYP_JIT_STACK_MAX);
+    if (!rec->stack || pthread_setspecific(ctx->jit_stack_key, rec)) {
+        if (rec->stack) {
+            pcre_jit_stack_free(rec->stack);
+        }
+        free(rec);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&ctx->regex_lock);
+    rec->next = ctx->jit_stacks;
+    if (rec->next) {
+        rec->next->prev = rec;
+    }
+    ctx->jit_stacks = rec;
+    pthread_mutex_unlock(&ctx->regex_lock);
+
+    return rec->stack;
+}
+
+#endif
+
+static void
+lyp_jit_stack_rec_free(struct lyp_jit_stack *rec)
+{
+#ifdef PCRE_STUDY_JIT_COMPILE
+    pcre_jit_stack_free(rec->stack);
+#endif
+    free(rec);
+}
+
+/**
+ * @brief Thread-specific data destructor of the JIT stack of an exiting thread.
+ */
+static void
+lyp_jit_stack_free(void *arg)
+{
+    struct lyp_jit_stack *rec = arg;
+    struct ly_ctx *ctx = rec->ctx;
+
+    pthread_mutex_lock(&ctx->regex_lock);
+    if (rec->prev) {
+        rec->prev->next = rec->next;
+    } else {
+        ctx->jit_stacks = rec->next;
+    }
+    if (rec->next) {
+        rec->next->prev = rec->prev;
+    }
+    pthread_mutex_unlock(&ctx->regex_lock);
+
+    lyp_jit_stack_rec_free(rec);
+}
+
 int
 lyp_precompile_pattern(struct ly_ctx *ctx, const char *pattern, pcre** pcre_cmp, pcre_extra **pcre_std)
 {
     const char *err_msg = NULL;
+    int options = 0;
 
     if (lyp_check_pattern(ctx, pattern, pcre_cmp)) {
         return EXIT_FAILURE;
     }
 
     if (pcre_std && pcre_cmp) {
-        (*pcre_std) = pcre_study(*pcre_cmp, 0, &err_msg);
+#ifdef PCRE_STUDY_JIT_COMPILE
+        /* ignored if PCRE is built without JIT support */
+        options |= PCRE_STUDY_JIT_COMPILE;
+#endif
+        (*pcre_std) = pcre_study(*pcre_cmp, options, &err_msg);
         if (err_msg) {
             LOGWRN(ctx, "Studying pattern \"%s\" failed (%s).", pattern, err_msg);
         }
+#ifdef PCRE_STUDY_JIT_COMPILE
+        if (*pcre_std) {
+            pcre_assign_jit_stack(*pcre_std, lyp_jit_stack, ctx);
+        }
+#endif
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Record of the regular expression cache.
+ */
+struct lyp_regex {
+    char *pattern;          /**< YANG pattern */
+    pcre *pcre_cmp;         /**< compiled pattern */
+    pcre_extra *pcre_std;   /**< studied pattern, can be NULL */
+};
+
+static int
+lyp_regex_equal(void *val1_p, void *val2_p, int UNUSED(mod), void *UNUSED(cb_data))
+{
+    return !strcmp(((struct lyp_regex *)val1_p)->pattern, ((struct lyp_regex *)val2_p)->pattern);
+}
+
+int
+lyp_regex_cache_init(struct ly_ctx *ctx)
+{
+    ctx->regex_cache = lyht_new(8, sizeof(struct lyp_regex), lyp_regex_equal, NULL, 1);
+    LY_CHECK_ERR_RETURN(!ctx->regex_cache, LOGMEM(ctx), EXIT_FAILURE);
+
+    if (pthread_key_create(&ctx->jit_stack_key, lyp_jit_stack_free)) {
+        LOGERR(ctx, LY_ESYS, "pthread_key_create() in %s failed", __func__);
+        lyht_free(ctx->regex_cache);
+        ctx->regex_cache = NULL;
+        return EXIT_FAILURE;
     }
+    pthread_mutex_init(&ctx->regex_lock, NULL);
 
     return EXIT_SUCCESS;
 }
 
+void
+lyp_regex_cache_free(struct ly_ctx *ctx)
+{
+    struct lyp_regex *regex;
+    struct lyp_jit_stack *rec;
+    uint32_t i;
+
+    if (!ctx->regex_cache) {
+        return;
+    }
+
+    for (i = 0; i < ctx->regex_cache->size; ++i) {
+        if (ctx->regex_cache->ctrl[i] != LYHT_CTRL_EMPTY) {
+            regex = (struct lyp_regex *)lyht_get_rec(ctx->regex_cache->recs, ctx->regex_cache->rec_size, i)->val;
+            free(regex->pattern);
+            pcre_free(regex->pcre_cmp);
+            pcre_free_study(regex->pcre_std);
+        }
+    }
+    lyht_free(ctx->regex_cache);
+    ctx->regex_cache = NULL;
+
+    /* the destructor is not called anymore, free the stacks of all the threads that have not exited yet */
+    pthread_key_delete(ctx->jit_stack_key);
+    while ((rec = ctx->jit_stacks)) {
+        ctx->jit_stacks = rec->next;
+        lyp_jit_stack_rec_free(rec);
+    }
+    pthread_mutex_destroy(&ctx->regex_lock);
+}
+
+/**
+ * @brief Add a compiled pattern into the regular expression cache of a context.
+ *
+ * @param[in] ctx Context with the cache.
+ * @param[in,out] regex Compiled pattern, replaced by the cached one if another thread was faster.
+ * @param[in] hash Hash of the pattern.
+ * @return Whether the pattern is cached (and must not be freed) or not.
+ */
+static int
+lyp_regex_cache_add(struct ly_ctx *ctx, struct lyp_regex *regex, uint32_t hash)
+{
+    struct lyp_regex *match;
+    int r, cached = 0;
+
+    pthread_mutex_lock(&ctx->regex_lock);
+    if (ctx->regex_cache->used >= LYP_REGEX_CACHE_MAX) {
+        goto unlock;
+    }
+
+    regex->pattern = strdup(regex->pattern);
+    LY_CHECK_ERR_GOTO(!regex->pattern, LOGMEM(ctx), unlock);
+
+    r = lyht_insert(ctx->regex_cache, regex, hash, (void **)&match);
+    if (r == 1) {
+        /* compiled by another thread meanwhile */
+        free(regex->pattern);
+        pcre_free(regex->pcre_cmp);
+        pcre_free_study(regex->pcre_std);
+        *regex = *match;
+        cached = 1;
+    } else if (!r) {
+        cached = 1;
+    } else {
+        free(regex->pattern);
+    }
+
+unlock:
+    pthread_mutex_unlock(&ctx->regex_lock);
+    return cached;
+}
+
+int
+lyp_regex_match(struct ly_ctx *ctx, const char *pattern, const char *str)
+{
+    struct lyp_regex regex, *match;
+    uint32_t hash;
+    int rc, cached = 0;
+
+    regex.pattern = (char *)pattern;
+    hash = dict_hash_multi(0, pattern, strlen(pattern));
+    hash = dict_hash_multi(hash, NULL, 0);
+
+    pthread_mutex_lock(&ctx->regex_lock);
+    if (!lyht_find(ctx->regex_cache, &regex, hash, (void **)&match)) {
+        /* copy the record, it may be moved by other threads, but the compiled pattern stays */
+        regex = *match;
+        cached = 1;
+    }
+    pthread_mutex_unlock(&ctx->regex_lock);
+
+    if (!cached) {
+        if (lyp_precompile_pattern(ctx, pattern, &regex.pcre_cmp, &regex.pcre_std)) {
+            return -1;
+        }
+        cached = lyp_regex_cache_add(ctx, &regex, hash);
+    }
+
+    rc = pcre_exec(regex.pcre_cmp, regex.pcre_std, str, strlen(str), 0, 0, NULL, 0);
+
+    if (!cached) {
+        pcre_free(regex.pcre_cmp);
+        pcre_free_study(regex.pcre_std);
+    }
+    return rc ? 1 : 0;
+}
+
 /**
  * @brief Change the value into its canonical form. In libyang, additionally to the RFC,
  * all identities have their module as a prefix in their canonical form.
@@ -2746,8 +3027,9 @@ lyp_check_circmod_pop(struct ly_ctx *ctx)
         return;
     }
 
-    /* update the list of currently being parsed modules */
+    /* update the list of currently being parsed modules, the parsed schema could have changed other modules */
     ctx->models.parsing_sub_modules_count--;
+    lys_schema_changed(ctx);
     if (!ctx->models.parsing_sub_modules_count) {
         free(ctx->models.parsing_sub_modules);
         ctx->models.parsing_sub_modules = NULL;
@@ -3675,6 +3957,8 @@ lyp_ctx_add_module(struct lys_module *module)
     }
     module->ctx->models.list[module->ctx->models.used++] = module;
     module->ctx->models.module_set_id++;
+    lys_schema_changed(module->ctx);
+    ly_ctx_module_index_update(module->ctx, module);
 
     return 0;
 }
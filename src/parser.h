@@ -42,6 +42,8 @@ struct lys_submodule *yin_read_submodule(struct lys_module *module, const char *
  * @{
  */
 struct lyd_node *xml_read_data(struct ly_ctx *ctx, const char *data, int options);
+struct lyd_node *lyd_parse_xml_mem(struct ly_ctx *ctx, const char *data, int options, const struct lyd_node *rpc_act,
+                                   const struct lyd_node *data_tree, const char *yang_data_name);
 
 /**@} xmldata */
 
@@ -59,7 +61,7 @@ struct lyd_node *lyd_parse_json(struct ly_ctx *ctx, const char *data, int option
  * @{
  */
 struct lyd_node *lyd_parse_lyb(struct ly_ctx *ctx, const char *data, int options, const struct lyd_node *data_tree,
-                               const char *yang_data_name, int *parsed);
+                               const char *yang_data_name, const struct ly_set *filter, int *parsed);
 
 /**@} lybdata */
 
@@ -110,6 +112,38 @@ int lyp_check_length_range(struct ly_ctx *ctx, const char *expr, struct lys_type
 int lyp_check_pattern(struct ly_ctx *ctx, const char *pattern, pcre **pcre_precomp);
 int lyp_precompile_pattern(struct ly_ctx *ctx, const char *pattern, pcre** pcre_cmp, pcre_extra **pcre_std);
 
+/**
+ * @brief Maximum number of compiled patterns in the regular expression cache of a context, patterns
+ * beyond it are compiled for every match.
+ */
+#define LYP_REGEX_CACHE_MAX 1024
+
+/**
+ * @brief Initialize the regular expression cache and the JIT stacks of a context.
+ *
+ * @param[in] ctx Context to initialize.
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on error.
+ */
+int lyp_regex_cache_init(struct ly_ctx *ctx);
+
+/**
+ * @brief Free the regular expression cache and the JIT stacks of all the threads of a context.
+ *
+ * @param[in] ctx Context to clean.
+ */
+void lyp_regex_cache_free(struct ly_ctx *ctx);
+
+/**
+ * @brief Match a string against a YANG pattern, which is compiled only once and kept in the
+ * regular expression cache of the context. Logs directly.
+ *
+ * @param[in] ctx Context with the cache.
+ * @param[in] pattern YANG pattern to match.
+ * @param[in] str String to match.
+ * @return 0 if the string matches, 1 if it does not, -1 on error.
+ */
+int lyp_regex_match(struct ly_ctx *ctx, const char *pattern, const char *str);
+
 int fill_yin_type(struct lys_module *module, struct lys_node *parent, struct lyxml_elem *yin, struct lys_type *type,
                   int tpdftype, struct unres_schema *unres);
 
@@ -56,34 +56,48 @@ skip_ws(const char *data)
     return len;
 }
 
+/* makes room for at least need bytes in the lyjson_parse_text() result buffer, logs directly */
+static int
+lyjson_text_reserve(struct ly_ctx *ctx, char **buf, size_t *size, size_t need)
+{
+    size_t new_size;
+
+    if (need <= *size) {
+        return EXIT_SUCCESS;
+    }
+
+    /* strings without escapes are a single run, size them exactly */
+    for (new_size = *size ? *size * 2 : need; new_size < need; new_size *= 2);
+    *buf = ly_realloc(*buf, new_size);
+    LY_CHECK_ERR_RETURN(!*buf, LOGMEM(ctx), EXIT_FAILURE);
+    *size = new_size;
+    return EXIT_SUCCESS;
+}
+
 static char *
 lyjson_parse_text(struct ly_ctx *ctx, const char *data, unsigned int *len)
 {
-#define BUFSIZE 1024
-
-    char buf[BUFSIZE];
     char *result = NULL, *aux;
-    int o, size = 0;
+    size_t o = 0, size = 0, plain;
     unsigned int r, i;
     int32_t value;
 
-    for (*len = o = 0; data[*len] && data[*len] != '"'; o++) {
-        if (o > BUFSIZE - 3) {
-            /* add buffer into the result */
-            if (result) {
-                size = size + o;
-                aux = ly_realloc(result, size + 1);
-                LY_CHECK_ERR_RETURN(!aux, LOGMEM(ctx), NULL);
-                result = aux;
-            } else {
-                size = o;
-                result = malloc((size + 1) * sizeof *result);
-                LY_CHECK_ERR_RETURN(!result, LOGMEM(ctx), NULL);
+    for (*len = 0; data[*len] && data[*len] != '"'; ) {
+        /* copy the whole run of unescaped ASCII characters at once */
+        plain = ly_strplain_len(&data[*len], "\"\\", 0);
+        if (plain) {
+            if (lyjson_text_reserve(ctx, &result, &size, o + plain + 1)) {
+                goto error;
             }
-            memcpy(&result[size - o], buf, o);
+            memcpy(&result[o], &data[*len], plain);
+            o += plain;
+            *len += plain;
+            continue;
+        }
 
-            /* write again into the beginning of the buffer */
-            o = 0;
+        /* any character is written as at most 4 bytes */
+        if (lyjson_text_reserve(ctx, &result, &size, o + 4 + 1)) {
+            goto error;
         }
 
         if (data[*len] == '\\') {
@@ -143,12 +157,12 @@ lyjson_parse_text(struct ly_ctx *ctx, const char *data, unsigned int *len)
                 goto error;
 
             }
-            r = pututf8(ctx, &buf[o], value);
+            r = pututf8(ctx, &result[o], value);
             if (!r) {
                 LOGVAL(ctx, LYE_XML_INVAL, LY_VLOG_NONE, NULL, "character UTF8 character");
                 goto error;
             }
-            o += r - 1; /* o is ++ in for loop */
+            o += r;
             (*len) += i; /* number of read characters */
         } else if ((unsigned char)(data[*len]) < 0x20) {
             /* In C, char != unsigned char != signed char, so let's work with ASCII explicitly */
@@ -157,35 +171,26 @@ lyjson_parse_text(struct ly_ctx *ctx, const char *data, unsigned int *len)
             goto error;
         } else {
             /* unescaped character */
-            r = copyutf8(ctx, &buf[o], &data[*len]);
+            r = copyutf8(ctx, &result[o], &data[*len]);
             if (!r) {
                 goto error;
             }
 
-            o += r - 1;     /* o is ++ in for loop */
+            o += r;
             (*len) += r;
         }
     }
 
-#undef BUFSIZE
-
-    if (o) {
-        if (result) {
-            size = size + o;
-            aux = ly_realloc(result, size + 1);
-            LY_CHECK_ERR_RETURN(!aux, LOGMEM(ctx), NULL);
-            result = aux;
-        } else {
-            size = o;
-            result = malloc((size + 1) * sizeof *result);
-            LY_CHECK_ERR_RETURN(!result, LOGMEM(ctx), NULL);
-        }
-        memcpy(&result[size - o], buf, o);
-    }
     if (result) {
-        result[size] = '\0';
+        result[o] = '\0';
+        if (o + 1 < size) {
+            /* the result is usually stored in the dictionary, do not keep the spare space */
+            aux = realloc(result, o + 1);
+            if (aux) {
+                result = aux;
+            }
+        }
     } else {
-        size = 0;
         result = strdup("");
         LY_CHECK_ERR_RETURN(!result, LOGMEM(ctx), NULL);
     }
@@ -534,7 +539,7 @@ inval:
             }
 
             /* another instance of the leaf-list */
-            new = calloc(1, sizeof(struct lyd_node_leaf_list));
+            new = (struct lyd_node_leaf_list *)lyd_node_alloc(leaf->schema, (struct lyd_node *)leaf, options);
             LY_CHECK_ERR_RETURN(!new, LOGMEM(ctx), 0);
 
             new->parent = leaf->parent;
@@ -860,7 +865,9 @@ json_parse_data(struct ly_ctx *ctx, const char *data, const struct lys_node *sch
     unsigned int flag_leaflist = 0;
     int i;
     uint8_t pos;
-    char *name, *prefix = NULL, *str = NULL;
+    const char *id, *name, *prefix = NULL;
+    unsigned int id_len, nam_len, pref_len = 0;
+    char *str = NULL, *colon;
     const struct lys_module *module = NULL;
     struct lys_node *schema = NULL;
     const struct lys_node *sparent = NULL;
@@ -876,7 +883,24 @@ json_parse_data(struct ly_ctx *ctx, const char *data, const struct lys_node *sch
     }
     len++;
 
-    str = lyjson_parse_text(ctx, &data[len], &r);
+    /* member names rarely need unescaping, so use them directly from the input if possible */
+    id = &data[len];
+    r = id_len = ly_strplain_len(id, "\"\\", 0);
+    colon = memchr(id, ':', id_len);
+    if ((data[len + r] != '"') || (colon && ((colon == id + (id[0] == '@')) || (colon == id + id_len - 1)))
+            || ctx->data_clb) {
+        /* escaped member name or one with an empty part, make a terminated copy, which is also needed
+         * if the prefix may be passed to the data callback */
+        str = lyjson_parse_text(ctx, &data[len], &r);
+        if (!str) {
+            goto error;
+        }
+        id = str;
+        id_len = strlen(str);
+        if ((colon = strchr(str, ':'))) {
+            *colon = '\0';
+        }
+    }
     if (!r) {
         goto error;
     } else if (data[len + r] != '"') {
@@ -884,17 +908,21 @@ json_parse_data(struct ly_ctx *ctx, const char *data, const struct lys_node *sch
                "JSON data (missing quotation-mark at the end of string)");
         goto error;
     }
-    if ((name = strchr(str, ':'))) {
-        *name = '\0';
-        name++;
-        prefix = str;
+    if (colon) {
+        name = colon + 1;
+        nam_len = id_len - (name - id);
+        prefix = id;
+        pref_len = colon - id;
         if (prefix[0] == '@') {
             prefix++;
+            pref_len--;
         }
     } else {
-        name = str;
+        name = id;
+        nam_len = id_len;
         if (name[0] == '@') {
             name++;
+            nam_len--;
         }
     }
 
@@ -908,7 +936,7 @@ json_parse_data(struct ly_ctx *ctx, const char *data, const struct lys_node *sch
     len++;
     len += skip_ws(&data[len]);
 
-    if (str[0] == '@' && !str[1]) {
+    if ((id[0] == '@') && ((id_len == 1) || (colon == id + 1))) {
         /* process attribute of the parent object (container or list) */
         if (!(*parent)) {
             LOGVAL(ctx, LYE_XML_INVAL, LY_VLOG_NONE, NULL, "attribute with no corresponding element to belongs to");
@@ -944,7 +972,7 @@ json_parse_data(struct ly_ctx *ctx, const char *data, const struct lys_node *sch
     if (!(*parent)) {
         /* starting in root */
         /* get the proper schema */
-        module = ly_ctx_get_module(ctx, prefix, NULL, 0);
+        module = ly_ctx_nget_module(ctx, prefix, pref_len, NULL, 0);
         if (ctx->data_clb) {
             if (!module) {
                 module = ctx->data_clb(ctx, prefix, NULL, 0, ctx->data_clb_data);
@@ -959,16 +987,20 @@ json_parse_data(struct ly_ctx *ctx, const char *data, const struct lys_node *sch
                 if (sparent) {
                     /* get the proper schema node */
                     while ((schema = (struct lys_node *) lys_getnext(schema, sparent, module, 0))) {
-                        if (!strcmp(schema->name, name)) {
+                        if (!strncmp(schema->name, name, nam_len) && !schema->name[nam_len]) {
                             break;
                         }
                     }
                 }
             } else {
-                /* get the proper schema node */
-                while ((schema = (struct lys_node *) lys_getnext(schema, NULL, module, 0))) {
-                    if (!strcmp(schema->name, name)) {
-                        break;
+                /* get the proper schema node, top-level choices can also include nodes of the augmenting modules,
+                 * which are not indexed under this module's name, so go through the nodes if not found */
+                if (lys_child_index_find(module, NULL, module->name, 0, name, nam_len, 0, (const struct lys_node **)&schema)
+                        || !schema) {
+                    while ((schema = (struct lys_node *) lys_getnext(schema, NULL, module, 0))) {
+                        if (!strncmp(schema->name, name, nam_len) && !schema->name[nam_len]) {
+                            break;
+                        }
                     }
                 }
             }
@@ -976,7 +1008,7 @@ json_parse_data(struct ly_ctx *ctx, const char *data, const struct lys_node *sch
     } else {
         if (prefix) {
             /* get the proper module to give the chance to load/implement it */
-            module = ly_ctx_get_module(ctx, prefix, NULL, 1);
+            module = ly_ctx_nget_module(ctx, prefix, pref_len, NULL, 1);
             if (ctx->data_clb) {
                 if (!module) {
                     ctx->data_clb(ctx, prefix, NULL, 0, ctx->data_clb_data);
@@ -1000,19 +1032,27 @@ json_parse_data(struct ly_ctx *ctx, const char *data, const struct lys_node *sch
         }
 
         if (schema_parent) {
-            while ((schema = (struct lys_node *)lys_getnext(schema, schema_parent, NULL, 0))) {
-                if (!strcmp(schema->name, name)
-                        && ((prefix && !strcmp(lys_node_module(schema)->name, prefix))
-                        || (!prefix && (lys_node_module(schema) == lys_node_module(schema_parent))))) {
-                    break;
+            if (lys_child_index_find(NULL, schema_parent, prefix ? prefix : lys_node_module(schema_parent)->name, pref_len,
+                                     name, nam_len, 0, (const struct lys_node **)&schema)) {
+                while ((schema = (struct lys_node *)lys_getnext(schema, schema_parent, NULL, 0))) {
+                    if (!strncmp(schema->name, name, nam_len) && !schema->name[nam_len]
+                            && ((prefix && !strncmp(lys_node_module(schema)->name, prefix, pref_len)
+                            && !lys_node_module(schema)->name[pref_len])
+                            || (!prefix && (lys_node_module(schema) == lys_node_module(schema_parent))))) {
+                        break;
+                    }
                 }
             }
         } else {
-            while ((schema = (struct lys_node *)lys_getnext(schema, (*parent)->schema, NULL, 0))) {
-                if (!strcmp(schema->name, name)
-                        && ((prefix && !strcmp(lys_node_module(schema)->name, prefix))
-                        || (!prefix && (lys_node_module(schema) == lyd_node_module(*parent))))) {
-                    break;
+            if (lys_child_index_find(NULL, (*parent)->schema, prefix ? prefix : lyd_node_module(*parent)->name, pref_len,
+                                     name, nam_len, 0, (const struct lys_node **)&schema)) {
+                while ((schema = (struct lys_node *)lys_getnext(schema, (*parent)->schema, NULL, 0))) {
+                    if (!strncmp(schema->name, name, nam_len) && !schema->name[nam_len]
+                            && ((prefix && !strncmp(lys_node_module(schema)->name, prefix, pref_len)
+                            && !lys_node_module(schema)->name[pref_len])
+                            || (!prefix && (lys_node_module(schema) == lyd_node_module(*parent))))) {
+                        break;
+                    }
                 }
             }
         }
@@ -1021,6 +1061,12 @@ json_parse_data(struct ly_ctx *ctx, const char *data, const struct lys_node *sch
     module = lys_node_module(schema);
     if (!module || !module->implemented || module->disabled) {
         if (options & LYD_OPT_STRICT) {
+            if (!str) {
+                /* the name is still a part of the input */
+                str = strndup(name, nam_len);
+                LY_CHECK_ERR_GOTO(!str, LOGMEM(ctx), error);
+                name = str;
+            }
             LOGVAL(ctx, LYE_INELEM, (*parent ? LY_VLOG_LYD : LY_VLOG_NONE), (*parent), name);
             goto error;
         } else {
@@ -1032,7 +1078,7 @@ json_parse_data(struct ly_ctx *ctx, const char *data, const struct lys_node *sch
         }
     }
 
-    if (str[0] == '@') {
+    if (id[0] == '@') {
         /* attribute for some sibling node */
         if (data[len] == '[') {
             flag_leaflist = 1;
@@ -1076,26 +1122,7 @@ attr_repeat:
         return len;
     }
 
-    switch (schema->nodetype) {
-    case LYS_CONTAINER:
-    case LYS_LIST:
-    case LYS_NOTIF:
-    case LYS_RPC:
-    case LYS_ACTION:
-        result = calloc(1, sizeof *result);
-        break;
-    case LYS_LEAF:
-    case LYS_LEAFLIST:
-        result = calloc(1, sizeof(struct lyd_node_leaf_list));
-        break;
-    case LYS_ANYXML:
-    case LYS_ANYDATA:
-        result = calloc(1, sizeof(struct lyd_node_anydata));
-        break;
-    default:
-        LOGINT(ctx);
-        goto error;
-    }
+    result = lyd_node_alloc(schema, *parent ? *parent : (prev ? prev : first_sibling), options);
     LY_CHECK_ERR_GOTO(!result, LOGMEM(ctx), error);
 
     result->prev = result;
@@ -1314,7 +1341,7 @@ attr_repeat:
                 }
 
                 /* another instance of the list */
-                new = calloc(1, sizeof *new);
+                new = lyd_node_alloc(list->schema, list, options);
                 LY_CHECK_ERR_GOTO(!new, LOGMEM(ctx), error);
                 new->parent = list->parent;
                 new->prev = list;
@@ -1580,6 +1607,7 @@ lyd_parse_json(struct ly_ctx *ctx, const char *data, int options, const struct l
             && lyd_check_mandatory_tree((act_notif ? act_notif : result), ctx, NULL, 0, options)) {
         goto error;
     }
+    lyd_val_clean(result, NULL, 0, options);
 
     free(unres->node);
     free(unres->type);
@@ -43,8 +43,9 @@
 #define LYB_HAVE_READ_GOTO(r, d, go) if (r < 0) goto go; d += r;
 #define LYB_HAVE_READ_RETURN(r, d, ret) if (r < 0) return ret; d += r;
 
+/* version 1 reading function handles reading size information */
 static int
-lyb_read(const char *data, uint8_t *buf, size_t count, struct lyb_state *lybs)
+lyb_read_chunks(const char *data, uint8_t *buf, size_t count, struct lyb_state *lybs)
 {
     int ret = 0, i, empty_chunk_i;
     size_t to_read;
@@ -106,6 +107,34 @@ lyb_read(const char *data, uint8_t *buf, size_t count, struct lyb_state *lybs)
     return ret;
 }
 
+static int
+lyb_read(const char *data, uint8_t *buf, size_t count, struct lyb_state *lybs)
+{
+    if (lybs->version == LYB_VERSION_1) {
+        return lyb_read_chunks(data, buf, count, lybs);
+    }
+
+    /* subtree lengths are known in advance, the data are contiguous */
+    if (buf) {
+        memcpy(buf, data, count);
+    }
+    lybs->offset += count;
+
+    return count;
+}
+
+/* number of bytes left in the current chunk (version 1) or the whole current subtree (version 2) */
+static size_t
+lyb_left(struct lyb_state *lybs)
+{
+    if (lybs->version == LYB_VERSION_1) {
+        return lybs->written[lybs->used - 1];
+    }
+
+    assert(lybs->written[lybs->used - 1] >= lybs->offset);
+    return lybs->written[lybs->used - 1] - lybs->offset;
+}
+
 static int
 lyb_read_number(void *num, size_t num_size, size_t bytes, const char *data, struct lyb_state *lybs)
 {
@@ -170,8 +199,8 @@ lyb_read_string(const char *data, char **str, int with_length, struct lyb_state
         LYB_HAVE_READ_GOTO(r, data, error);
     } else {
         /* read until the end of this subtree */
-        len = lybs->written[lybs->used - 1];
-        if (lybs->position[lybs->used - 1]) {
+        len = lyb_left(lybs);
+        if ((lybs->version == LYB_VERSION_1) && lybs->position[lybs->used - 1]) {
             next_chunk = 1;
         }
     }
@@ -208,19 +237,65 @@ error:
     return -1;
 }
 
+/* read a string until the end of this subtree directly into the dictionary */
+static int
+lyb_read_dict_string(const char *data, const char **str, struct lyb_state *lybs)
+{
+    int ret;
+    size_t len;
+    char *buf;
+
+    if (lybs->version == LYB_VERSION_1) {
+        ret = lyb_read_string(data, &buf, 0, lybs);
+        if (ret > -1) {
+            *str = lydict_insert_zc(lybs->ctx, buf);
+        }
+        return ret;
+    }
+
+    /* the string is stored contiguously, no need for a copy */
+    len = lyb_left(lybs);
+    *str = lydict_insert(lybs->ctx, len ? data : "", len);
+    return lyb_read(data, NULL, len, lybs);
+}
+
 static void
 lyb_read_stop_subtree(struct lyb_state *lybs)
 {
-    if (lybs->written[lybs->used - 1]) {
+    if (lyb_left(lybs)) {
         LOGINT(lybs->ctx);
     }
 
     --lybs->used;
 }
 
+static int
+lyb_read_varint(const char *data, uint32_t *num, struct lyb_state *lybs)
+{
+    int ret = 0;
+    uint8_t byte;
+
+    /* unsigned LEB128, 7 bits in every byte with the highest bit set if another byte follows */
+    *num = 0;
+    do {
+        if (ret == LYB_VARINT_MAX_BYTES) {
+            LOGERR(lybs->ctx, LY_EINVAL, "Invalid LYB subtree length.");
+            return -1;
+        }
+        byte = data[ret];
+        *num |= (uint32_t)(byte & 0x7F) << (7 * ret);
+        ++ret;
+    } while (byte & 0x80);
+
+    lybs->offset += ret;
+    return ret;
+}
+
 static int
 lyb_read_start_subtree(const char *data, struct lyb_state *lybs)
 {
+    int ret;
+    uint32_t len;
     uint8_t meta_buf[LYB_META_BYTES];
 
     if (lybs->used == lybs->size) {
@@ -231,6 +306,18 @@ lyb_read_start_subtree(const char *data, struct lyb_state *lybs)
         LY_CHECK_ERR_RETURN(!lybs->written || !lybs->position || !lybs->inner_chunks, LOGMEM(lybs->ctx), -1);
     }
 
+    if (lybs->version != LYB_VERSION_1) {
+        /* read the subtree length, remember where it ends */
+        ret = lyb_read_varint(data, &len, lybs);
+        if (ret < 0) {
+            return -1;
+        }
+
+        lybs->written[lybs->used] = lybs->offset + len;
+        ++lybs->used;
+        return ret;
+    }
+
     memcpy(meta_buf, data, LYB_META_BYTES);
 
     ++lybs->used;
@@ -297,34 +384,16 @@ error:
 }
 
 static struct lyd_node *
-lyb_new_node(const struct lys_node *schema)
+lyb_new_node(const struct lys_node *schema, const struct lyd_node *near, int options)
 {
     struct lyd_node *node;
 
-    switch (schema->nodetype) {
-    case LYS_CONTAINER:
-    case LYS_LIST:
-    case LYS_NOTIF:
-    case LYS_RPC:
-    case LYS_ACTION:
-        node = calloc(sizeof(struct lyd_node), 1);
-        break;
-    case LYS_LEAF:
-    case LYS_LEAFLIST:
-        node = calloc(sizeof(struct lyd_node_leaf_list), 1);
+    node = lyd_node_alloc(schema, near, options);
+    LY_CHECK_ERR_RETURN(!node, LOGMEM(schema->module->ctx), NULL);
 
-        if (((struct lys_node_leaf *)schema)->type.base == LY_TYPE_LEAFREF) {
-            node->validity |= LYD_VAL_LEAFREF;
-        }
-        break;
-    case LYS_ANYDATA:
-    case LYS_ANYXML:
-        node = calloc(sizeof(struct lyd_node_anydata), 1);
-        break;
-    default:
-        return NULL;
+    if ((schema->nodetype & (LYS_LEAF | LYS_LEAFLIST)) && (((struct lys_node_leaf *)schema)->type.base == LY_TYPE_LEAFREF)) {
+        node->validity |= LYD_VAL_LEAFREF;
     }
-    LY_CHECK_ERR_RETURN(!node, LOGMEM(schema->module->ctx), NULL);
 
     /* fill basic info */
     node->schema = (struct lys_node *)schema;
@@ -341,7 +410,6 @@ static int
 lyb_parse_anydata(struct lyd_node *node, const char *data, struct lyb_state *lybs)
 {
     int r, ret = 0;
-    char *str = NULL;
     struct lyd_node_anydata *any = (struct lyd_node_anydata *)node;
 
     /* read value type */
@@ -357,11 +425,8 @@ lyb_parse_anydata(struct lyd_node *node, const char *data, struct lyb_state *lyb
         ret += (r = lyb_read_string(data, &any->value.mem, 0, lybs));
         LYB_HAVE_READ_RETURN(r, data, -1);
     } else {
-        ret += (r = lyb_read_string(data, &str, 0, lybs));
+        ret += (r = lyb_read_dict_string(data, &any->value.str, lybs));
         LYB_HAVE_READ_RETURN(r, data, -1);
-
-        /* add to dictionary */
-        any->value.str = lydict_insert_zc(node->schema->module->ctx, str);
     }
 
     return ret;
@@ -374,17 +439,12 @@ lyb_parse_val_1(struct lys_type *type, LY_DATA_TYPE value_type, uint8_t value_fl
 {
     int r, ret;
     size_t i;
-    char *str = NULL;
     uint8_t byte;
     uint64_t num;
 
     if (value_flags & LY_VALUE_USER) {
         /* just read value_str */
-        ret = lyb_read_string(data, &str, 0, lybs);
-        if (ret > -1) {
-            *value_str = lydict_insert_zc(lybs->ctx, str);
-        }
-        return ret;
+        return lyb_read_dict_string(data, value_str, lybs);
     }
 
     /* find the correct structure, go through leafrefs and typedefs */
@@ -406,19 +466,13 @@ lyb_parse_val_1(struct lys_type *type, LY_DATA_TYPE value_type, uint8_t value_fl
     case LY_TYPE_IDENT:
     case LY_TYPE_UNION:
         /* we do not actually fill value now, but value_str */
-        ret = lyb_read_string(data, &str, 0, lybs);
-        if (ret > -1) {
-            *value_str = lydict_insert_zc(lybs->ctx, str);
-        }
+        ret = lyb_read_dict_string(data, value_str, lybs);
         break;
     case LY_TYPE_BINARY:
     case LY_TYPE_STRING:
     case LY_TYPE_UNKNOWN:
         /* read string */
-        ret = lyb_read_string(data, &str, 0, lybs);
-        if (ret > -1) {
-            value->string = lydict_insert_zc(lybs->ctx, str);
-        }
+        ret = lyb_read_dict_string(data, &value->string, lybs);
         break;
     case LY_TYPE_BITS:
         value->bit = calloc(type->info.bits.count, sizeof *value->bit);
@@ -679,6 +733,10 @@ parse_reference:
                 return -1;
             }
         } else if (type->base == LY_TYPE_LEAFREF) {
+            if (value_type != LY_TYPE_LEAFREF) {
+                /* value union was filled with the target type value, same as lyp_parse_value() does */
+                *value_flags |= LY_VALUE_UNRES;
+            }
             if (unres_data_add(unres, (struct lyd_node *)leaf, UNRES_LEAFREF)) {
                 return -1;
             }
@@ -811,6 +869,30 @@ lyb_parse_attr_name(const struct lys_module *mod, const char *data, struct lys_e
     return ret;
 }
 
+static int
+lyb_skip_subtree(const char *data, struct lyb_state *lybs)
+{
+    int r, ret = 0;
+
+    if (lybs->version != LYB_VERSION_1) {
+        /* just move to the end of the subtree */
+        return lyb_read(data, NULL, lyb_left(lybs), lybs);
+    }
+
+    do {
+        /* first skip any meta information inside */
+        r = lybs->inner_chunks[lybs->used - 1] * LYB_META_BYTES;
+        data += r;
+        ret += r;
+
+        /* then read data */
+        ret += (r = lyb_read(data, NULL, lybs->written[lybs->used - 1], lybs));
+        LYB_HAVE_READ_RETURN(r, data, -1);
+    } while (lybs->written[lybs->used - 1]);
+
+    return ret;
+}
+
 static int
 lyb_parse_attributes(struct lyd_node *node, const char *data, int options, struct unres_data *unres, struct lyb_state *lybs)
 {
@@ -842,10 +924,8 @@ lyb_parse_attributes(struct lyd_node *node, const char *data, int options, struc
 
         if (!mod || !ext) {
             /* unknown attribute, skip it */
-            do {
-                ret += (r = lyb_read(data, NULL, lybs->written[lybs->used - 1], lybs));
-                LYB_HAVE_READ_GOTO(r, data, error);
-            } while (lybs->written[lybs->used - 1]);
+            ret += (r = lyb_skip_subtree(data, lybs));
+            LYB_HAVE_READ_GOTO(r, data, error);
             goto stop_subtree;
         }
 
@@ -999,25 +1079,6 @@ finish:
     return ret;
 }
 
-static int
-lyb_skip_subtree(const char *data, struct lyb_state *lybs)
-{
-    int r, ret = 0;
-
-    do {
-        /* first skip any meta information inside */
-        r = lybs->inner_chunks[lybs->used - 1] * LYB_META_BYTES;
-        data += r;
-        ret += r;
-
-        /* then read data */
-        ret += (r = lyb_read(data, NULL, lybs->written[lybs->used - 1], lybs));
-        LYB_HAVE_READ_RETURN(r, data, -1);
-    } while (lybs->written[lybs->used - 1]);
-
-    return ret;
-}
-
 static int
 lyb_parse_subtree(const char *data, struct lyd_node *parent, struct lyd_node **first_sibling, const char *yang_data_name,
         int options, struct unres_data *unres, struct lyb_state *lybs)
@@ -1058,10 +1119,22 @@ lyb_parse_subtree(const char *data, struct lyd_node *parent, struct lyd_node **f
         goto stop_subtree;
     }
 
+    if (lybs->filter && !lybs->filter_level) {
+        if (ly_set_contains(lybs->filter, snode) > -1) {
+            /* filter node, parse its whole subtree */
+            lybs->filter_level = lybs->used;
+        } else if (ly_set_contains(lybs->filter_anc, snode) == -1) {
+            /* filtered out, skip it whole */
+            ret += (r = lyb_skip_subtree(data, lybs));
+            LYB_HAVE_READ_GOTO(r, data, error);
+            goto stop_subtree;
+        }
+    }
+
     /*
      * read the node
      */
-    node = lyb_new_node(snode);
+    node = lyb_new_node(snode, parent ? parent : *first_sibling, options);
     if (!node) {
         goto error;
     }
@@ -1116,7 +1189,7 @@ lyb_parse_subtree(const char *data, struct lyd_node *parent, struct lyd_node **f
     }
 
     /* read all descendants */
-    while (lybs->written[lybs->used - 1]) {
+    while (lyb_left(lybs)) {
         ret += (r = lyb_parse_subtree(data, node, NULL, NULL, options, unres, lybs));
         LYB_HAVE_READ_GOTO(r, data, error);
     }
@@ -1143,6 +1216,11 @@ lyb_parse_subtree(const char *data, struct lyd_node *parent, struct lyd_node **f
 #endif
 
 stop_subtree:
+    if (lybs->filter_level == lybs->used) {
+        /* filter node subtree parsed */
+        lybs->filter_level = 0;
+    }
+
     /* end the subtree */
     lyb_read_stop_subtree(lybs);
 
@@ -1212,18 +1290,73 @@ lyb_parse_magic_number(const char *data, struct lyb_state *lybs)
 static int
 lyb_parse_header(const char *data, struct lyb_state *lybs)
 {
-    int ret = 0;
+    int r, ret = 0;
     uint8_t byte = 0;
 
-    /* TODO version, any flags? */
-    ret += lyb_read(data, (uint8_t *)&byte, sizeof byte, lybs);
+    /* version, no flags */
+    ret += (r = lyb_read(data, (uint8_t *)&byte, sizeof byte, lybs));
+    LYB_HAVE_READ_RETURN(r, data, -1);
+
+    switch (byte) {
+    case LYB_VERSION_1:
+    case LYB_VERSION_2:
+        lybs->version = byte;
+        break;
+    default:
+        LOGERR(lybs->ctx, LY_EINVAL, "Unsupported LYB format version \"0x%02x\".", byte);
+        return -1;
+    }
 
     return ret;
 }
 
+static int
+lyb_parse_filter(const struct ly_set *filter, struct lyb_state *lybs)
+{
+    unsigned int i;
+    uint8_t k;
+    struct lys_node *snode, *parent;
+
+    lybs->filter = ly_set_new();
+    lybs->filter_anc = ly_set_new();
+    LY_CHECK_ERR_RETURN(!lybs->filter || !lybs->filter_anc, LOGMEM(lybs->ctx), -1);
+
+    for (i = 0; i < filter->number; ++i) {
+        snode = filter->set.s[i];
+        if (!snode || !(snode->nodetype & (LYS_CONTAINER | LYS_LIST | LYS_LEAF | LYS_LEAFLIST | LYS_ANYDATA
+                | LYS_NOTIF | LYS_RPC | LYS_ACTION))) {
+            LOGERR(lybs->ctx, LY_EINVAL, "Invalid LYB filter schema node \"%s\".", snode ? snode->name : "");
+            return -1;
+        }
+        if (ly_set_add(lybs->filter, snode, 0) == -1) {
+            return -1;
+        }
+
+        /* all the data ancestors are parsed as well, lists with their keys */
+        for (parent = lys_parent(snode); parent; parent = lys_parent(parent)) {
+            if (!(parent->nodetype & (LYS_CONTAINER | LYS_LIST | LYS_NOTIF | LYS_RPC | LYS_ACTION))) {
+                continue;
+            }
+            if (ly_set_add(lybs->filter_anc, parent, 0) == -1) {
+                return -1;
+            }
+
+            if (parent->nodetype == LYS_LIST) {
+                for (k = 0; k < ((struct lys_node_list *)parent)->keys_size; ++k) {
+                    if (ly_set_add(lybs->filter, ((struct lys_node_list *)parent)->keys[k], 0) == -1) {
+                        return -1;
+                    }
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
 struct lyd_node *
 lyd_parse_lyb(struct ly_ctx *ctx, const char *data, int options, const struct lyd_node *data_tree,
-              const char *yang_data_name, int *parsed)
+              const char *yang_data_name, const struct ly_set *filter, int *parsed)
 {
     int r = 0, ret = 0;
     struct lyd_node *node = NULL, *next, *act_notif = NULL;
@@ -1238,16 +1371,25 @@ lyd_parse_lyb(struct ly_ctx *ctx, const char *data, int options, const struct ly
     lybs.written = malloc(LYB_STATE_STEP * sizeof *lybs.written);
     lybs.position = malloc(LYB_STATE_STEP * sizeof *lybs.position);
     lybs.inner_chunks = malloc(LYB_STATE_STEP * sizeof *lybs.inner_chunks);
-    LY_CHECK_ERR_GOTO(!lybs.written || !lybs.position || !lybs.inner_chunks, LOGMEM(ctx), finish);
     lybs.used = 0;
     lybs.size = LYB_STATE_STEP;
     lybs.models = NULL;
     lybs.mod_count = 0;
     lybs.ctx = ctx;
+    lybs.version = LYB_VERSION_1;
+    lybs.offset = 0;
+    lybs.filter = NULL;
+    lybs.filter_anc = NULL;
+    lybs.filter_level = 0;
+    LY_CHECK_ERR_GOTO(!lybs.written || !lybs.position || !lybs.inner_chunks, LOGMEM(ctx), finish);
 
     unres = calloc(1, sizeof *unres);
     LY_CHECK_ERR_GOTO(!unres, LOGMEM(ctx), finish);
 
+    if ((options & LYD_OPT_LYB_FILTER) && lyb_parse_filter(filter, &lybs)) {
+        goto finish;
+    }
+
     /* read magic number */
     ret += (r = lyb_parse_magic_number(data, &lybs));
     LYB_HAVE_READ_GOTO(r, data, finish);
@@ -1306,6 +1448,8 @@ finish:
     free(lybs.position);
     free(lybs.inner_chunks);
     free(lybs.models);
+    ly_set_free(lybs.filter);
+    ly_set_free(lybs.filter_anc);
     if (unres) {
         free(unres->node);
         free(unres->type);
@@ -1326,7 +1470,6 @@ lyd_lyb_data_length(const char *data)
     struct lyb_state lybs;
     int r = 0, ret = 0, i;
     size_t len;
-    uint8_t buf[LYB_SIZE_MAX];
 
     if (!data) {
         return -1;
@@ -1335,12 +1478,17 @@ lyd_lyb_data_length(const char *data)
     lybs.written = malloc(LYB_STATE_STEP * sizeof *lybs.written);
     lybs.position = malloc(LYB_STATE_STEP * sizeof *lybs.position);
     lybs.inner_chunks = malloc(LYB_STATE_STEP * sizeof *lybs.inner_chunks);
-    LY_CHECK_ERR_GOTO(!lybs.written || !lybs.position || !lybs.inner_chunks, LOGMEM(NULL), finish);
     lybs.used = 0;
     lybs.size = LYB_STATE_STEP;
     lybs.models = NULL;
     lybs.mod_count = 0;
     lybs.ctx = NULL;
+    lybs.version = LYB_VERSION_1;
+    lybs.offset = 0;
+    lybs.filter = NULL;
+    lybs.filter_anc = NULL;
+    lybs.filter_level = 0;
+    LY_CHECK_ERR_GOTO(!lybs.written || !lybs.position || !lybs.inner_chunks, LOGMEM(NULL), finish);
 
     /* read magic number */
     ret += (r = lyb_parse_magic_number(data, &lybs));
@@ -1362,11 +1510,11 @@ lyd_lyb_data_length(const char *data)
         LYB_HAVE_READ_GOTO(r, data, finish);
 
         /* model name */
-        ret += (r = lyb_read(data, buf, len, &lybs));
+        ret += (r = lyb_read(data, NULL, len, &lybs));
         LYB_HAVE_READ_GOTO(r, data, finish);
 
         /* revision */
-        ret += (r = lyb_read(data, buf, 2, &lybs));
+        ret += (r = lyb_read(data, NULL, 2, &lybs));
         LYB_HAVE_READ_GOTO(r, data, finish);
     }
 
@@ -73,6 +73,45 @@ xml_data_search_schemanode(struct lyxml_elem *xml, struct lys_node *start, int o
     return NULL;
 }
 
+/* search the data children of a schema parent, or top-level nodes of a module if there is no parent */
+static struct lys_node *
+xml_data_search_schemachild(struct ly_ctx *ctx, struct lyxml_elem *xml, struct lys_node *sparent,
+                            const struct lys_module *mod, int options)
+{
+    const struct lys_node *iparent, *result;
+    const struct lys_module *ns_mod;
+
+    iparent = sparent;
+    if (sparent && (sparent->nodetype & (LYS_RPC | LYS_ACTION)) && (options & (LYD_OPT_RPC | LYD_OPT_RPCREPLY))) {
+        /* the children are in the input or output */
+        LY_TREE_FOR(sparent->child, iparent) {
+            if (iparent->nodetype == ((options & LYD_OPT_RPC) ? LYS_INPUT : LYS_OUTPUT)) {
+                break;
+            }
+        }
+    }
+
+    if (iparent) {
+        ns_mod = lys_node_module(iparent);
+    } else {
+        ns_mod = mod;
+    }
+    if (!ly_strequal(ns_mod->ns, xml->ns->value, 1)) {
+        /* the node is from another module than its parent */
+        ns_mod = ly_ctx_get_module_by_ns(ctx, xml->ns->value, NULL, 0);
+        if (!ns_mod) {
+            return NULL;
+        }
+    }
+
+    if (!lys_child_index_find(mod, iparent, ns_mod->name, 0, xml->name, 0, LYS_GETNEXT_NOSTATECHECK, &result)) {
+        return (struct lys_node *)result;
+    }
+
+    /* no index, go through the nodes */
+    return xml_data_search_schemanode(xml, sparent ? sparent->child : mod->data, options);
+}
+
 /* logs directly */
 static int
 xml_get_value(struct lyd_node *node, struct lyxml_elem *xml, int editbits, int trusted)
@@ -99,39 +138,40 @@ xml_get_value(struct lyd_node *node, struct lyxml_elem *xml, int editbits, int t
     return EXIT_SUCCESS;
 }
 
-/* logs directly */
+/* logs directly, returns 1 if the element should be ignored */
 static int
-xml_parse_data(struct ly_ctx *ctx, struct lyxml_elem *xml, struct lyd_node *parent, struct lyd_node *first_sibling,
-               struct lyd_node *prev, int options, struct unres_data *unres, struct lyd_node **result,
-               struct lyd_node **act_notif, const char *yang_data_name)
+xml_data_check_mixed(struct ly_ctx *ctx, struct lyxml_elem *xml, int options)
 {
-    const struct lys_module *mod = NULL;
-    struct lyd_node *diter, *dlast;
-    struct lys_node *schema = NULL, *target;
-    const struct lys_node *ext_node;
-    struct lys_node_augment *aug;
-    struct lyd_attr *dattr, *dattr_iter;
-    struct lyxml_attr *attr;
-    struct lyxml_elem *child, *next;
-    int i, j, havechildren, r, editbits = 0, filterflag = 0, found;
-    uint8_t pos;
-    int ret = 0;
-    const char *str = NULL;
-    char *msg;
-
-    assert(xml);
-    assert(result);
-    *result = NULL;
-
     if (xml->flags & LYXML_ELEM_MIXED) {
         if (options & LYD_OPT_STRICT) {
             LOGVAL(ctx, LYE_XML_INVAL, LY_VLOG_XML, xml, "XML element with mixed content");
             return -1;
         } else {
-            return 0;
+            return 1;
         }
     }
 
+    return 0;
+}
+
+/* logs directly, schema is NULL if the element should be ignored */
+static int
+xml_data_find_schema(struct ly_ctx *ctx, struct lyxml_elem *xml, struct lyd_node *parent, int options,
+                     const char *yang_data_name, struct lys_node **schema)
+{
+    const struct lys_module *mod = NULL;
+    struct lys_node *target;
+    const struct lys_node *ext_node;
+    struct lys_node_augment *aug;
+    int j, r;
+
+    *schema = NULL;
+
+    r = xml_data_check_mixed(ctx, xml, options);
+    if (r) {
+        return (r == 1) ? 0 : -1;
+    }
+
     if (!xml->ns || !xml->ns->value) {
         if (options & LYD_OPT_STRICT) {
             LOGVAL(ctx, LYE_XML_MISS, LY_VLOG_XML, xml, "element's", "namespace");
@@ -158,13 +198,13 @@ xml_parse_data(struct ly_ctx *ctx, struct lyxml_elem *xml, struct lyd_node *pare
                 if (yang_data_name) {
                     ext_node = lyp_get_yang_data_template(mod, yang_data_name, strlen(yang_data_name));
                     if (ext_node) {
-                        schema = *((struct lys_node **) lys_ext_complex_get_substmt(LY_STMT_CONTAINER, (struct lys_ext_instance_complex *)ext_node, NULL));
-                        schema = xml_data_search_schemanode(xml, schema, options);
+                        *schema = *((struct lys_node **) lys_ext_complex_get_substmt(LY_STMT_CONTAINER, (struct lys_ext_instance_complex *)ext_node, NULL));
+                        *schema = xml_data_search_schemanode(xml, *schema, options);
                     }
                 }
             } else {
-                schema = xml_data_search_schemanode(xml, mod->data, options);
-                if (!schema) {
+                *schema = xml_data_search_schemachild(ctx, xml, NULL, mod, options);
+                if (!*schema) {
                     /* it still can be the specific case of this module containing an augment of another module
                     * top-level choice or top-level choice's case, bleh */
                     for (j = 0; j < mod->augment_size; ++j) {
@@ -177,16 +217,16 @@ xml_parse_data(struct ly_ctx *ctx, struct lyxml_elem *xml, struct lyd_node *pare
                             }
                             /* 2) now, the data node will be top-level, there are only non-data schema nodes */
                             if (!target) {
-                                while ((schema = (struct lys_node *) lys_getnext(schema, (struct lys_node *) aug, NULL, 0))) {
+                                while ((*schema = (struct lys_node *) lys_getnext(*schema, (struct lys_node *) aug, NULL, 0))) {
                                     /* 3) alright, even the name matches, we found our schema node */
-                                    if (ly_strequal(schema->name, xml->name, 1)) {
+                                    if (ly_strequal((*schema)->name, xml->name, 1)) {
                                         break;
                                     }
                                 }
                             }
                         }
 
-                        if (schema) {
+                        if (*schema) {
                             break;
                         }
                     }
@@ -195,65 +235,65 @@ xml_parse_data(struct ly_ctx *ctx, struct lyxml_elem *xml, struct lyd_node *pare
         }
     } else {
         /* parsing some internal node, we start with parent's schema pointer */
-        schema = xml_data_search_schemanode(xml, parent->schema->child, options);
+        *schema = xml_data_search_schemachild(ctx, xml, parent->schema, NULL, options);
 
         if (ctx->data_clb) {
-            if (schema && !lys_node_module(schema)->implemented) {
-                ctx->data_clb(ctx, lys_node_module(schema)->name, lys_node_module(schema)->ns,
+            if (*schema && !lys_node_module(*schema)->implemented) {
+                ctx->data_clb(ctx, lys_node_module(*schema)->name, lys_node_module(*schema)->ns,
                               LY_MODCLB_NOT_IMPLEMENTED, ctx->data_clb_data);
-            } else if (!schema) {
+            } else if (!*schema) {
                 if (ctx->data_clb(ctx, NULL, xml->ns->value, 0, ctx->data_clb_data)) {
                     /* context was updated, so try to find the schema node again */
-                    schema = xml_data_search_schemanode(xml, parent->schema->child, options);
+                    *schema = xml_data_search_schemachild(ctx, xml, parent->schema, NULL, options);
                 }
             }
         }
     }
 
-    mod = lys_node_module(schema);
+    mod = lys_node_module(*schema);
     if (!mod || !mod->implemented || mod->disabled) {
+        *schema = NULL;
         if (options & LYD_OPT_STRICT) {
             LOGVAL(ctx, LYE_INELEM, (parent ? LY_VLOG_LYD : LY_VLOG_STR), (parent ? (void *)parent : (void *)"/") , xml->name);
             return -1;
-        } else {
-            return 0;
         }
     }
 
-    /* create the element structure */
-    switch (schema->nodetype) {
-    case LYS_CONTAINER:
-    case LYS_LIST:
-    case LYS_NOTIF:
-    case LYS_RPC:
-    case LYS_ACTION:
-        for (i = 0; xml->content && xml->content[i]; ++i) {
-            if (!is_xmlws(xml->content[i])) {
-                msg = malloc(22 + strlen(xml->content) + 1);
-                LY_CHECK_ERR_RETURN(!msg, LOGMEM(ctx), -1);
-                sprintf(msg, "node with text data \"%s\"", xml->content);
-                LOGVAL(ctx, LYE_XML_INVAL, LY_VLOG_XML, xml, msg);
-                free(msg);
-                return -1;
-            }
+    return 0;
+}
+
+/* remove the (failed) node and all the unres items connected with it */
+static void
+xml_parse_data_free(struct unres_data *unres, struct lyd_node **node)
+{
+    int i;
+
+    for (i = unres->count - 1; i >= 0; i--) {
+        /* remove unres items connected with the node being removed */
+        if (unres->node[i] == *node) {
+            unres_data_del(unres, i);
         }
-        *result = calloc(1, sizeof **result);
-        havechildren = 1;
-        break;
-    case LYS_LEAF:
-    case LYS_LEAFLIST:
-        *result = calloc(1, sizeof(struct lyd_node_leaf_list));
-        havechildren = 0;
-        break;
-    case LYS_ANYXML:
-    case LYS_ANYDATA:
-        *result = calloc(1, sizeof(struct lyd_node_anydata));
-        havechildren = 0;
-        break;
-    default:
-        LOGINT(ctx);
-        return -1;
     }
+    lyd_free(*node);
+    *node = NULL;
+}
+
+/* logs directly, creates the node and processes everything up to its children */
+static int
+xml_parse_data_open(struct ly_ctx *ctx, struct lyxml_elem *xml, struct lys_node *schema, struct lyd_node *parent,
+                    struct lyd_node **first_sibling, struct lyd_node *prev, int options, struct unres_data *unres,
+                    struct lyd_node **result, struct lyd_node **act_notif)
+{
+    struct lyd_node *diter;
+    struct lyd_attr *dattr, *dattr_iter;
+    struct lyxml_attr *attr;
+    struct lyxml_elem *child, *next;
+    int i, r, editbits = 0, filterflag = 0, found;
+    uint8_t pos;
+    const char *str = NULL;
+
+    /* create the element structure */
+    *result = lyd_node_alloc(schema, parent ? parent : (prev ? prev : *first_sibling), options);
     LY_CHECK_ERR_RETURN(!(*result), LOGMEM(ctx), -1);
 
     (*result)->prev = *result;
@@ -272,7 +312,7 @@ xml_parse_data(struct ly_ctx *ctx, struct lyxml_elem *xml, struct lyd_node *pare
                 LOGVAL(ctx, LYE_INORDER, LY_VLOG_LYD, *result, schema->name, diter->schema->name);
                 LOGVAL(ctx, LYE_SPEC, LY_VLOG_PREV, NULL, "Invalid position of the key \"%s\" in a list \"%s\".",
                        schema->name, parent->schema->name);
-                free(*result);
+                lyd_node_dealloc(*result);
                 *result = NULL;
                 return -1;
             } else {
@@ -281,7 +321,7 @@ xml_parse_data(struct ly_ctx *ctx, struct lyxml_elem *xml, struct lyd_node *pare
             if (parent->child == diter) {
                 parent->child = *result;
                 /* update first_sibling */
-                first_sibling = *result;
+                *first_sibling = *result;
             }
             if (diter->prev->next) {
                 diter->prev->next = *result;
@@ -301,10 +341,10 @@ xml_parse_data(struct ly_ctx *ctx, struct lyxml_elem *xml, struct lyd_node *pare
             prev->next = *result;
 
             /* fix the "last" pointer */
-            first_sibling->prev = *result;
+            (*first_sibling)->prev = *result;
         } else {
             (*result)->prev = *result;
-            first_sibling = *result;
+            *first_sibling = *result;
         }
     }
     (*result)->validity = ly_new_node_validity((*result)->schema);
@@ -503,20 +543,33 @@ attr_error:
         goto error;
     }
 
-    /* process children */
-    if (havechildren && xml->child) {
-        diter = dlast = NULL;
-        LY_TREE_FOR_SAFE(xml->child, next, child) {
-            r = xml_parse_data(ctx, child, *result, (*result)->child, dlast, options, unres, &diter, act_notif, yang_data_name);
-            if (r) {
+    return 0;
+
+unlink_node_error:
+    lyd_unlink_internal(*result, 2);
+error:
+    xml_parse_data_free(unres, result);
+    return -1;
+}
+
+/* logs directly, finishes the node once its children are processed */
+static int
+xml_parse_data_close(struct ly_ctx *ctx, struct lyxml_elem *xml, struct lyd_node *first_sibling, struct lyd_node *prev,
+                     int options, struct unres_data *unres, struct lyd_node **result)
+{
+    struct lys_node *schema = (*result)->schema;
+    char *msg;
+    int i;
+
+    if (!(schema->nodetype & (LYS_LEAF | LYS_LEAFLIST | LYS_ANYDATA))) {
+        for (i = 0; xml->content && xml->content[i]; ++i) {
+            if (!is_xmlws(xml->content[i])) {
+                msg = malloc(22 + strlen(xml->content) + 1);
+                LY_CHECK_ERR_GOTO(!msg, LOGMEM(ctx), error);
+                sprintf(msg, "node with text data \"%s\"", xml->content);
+                LOGVAL(ctx, LYE_XML_INVAL, LY_VLOG_XML, xml, msg);
+                free(msg);
                 goto error;
-            } else if (options & LYD_OPT_DESTRUCT) {
-                lyxml_free(ctx, child);
-            }
-            if (diter && !diter->next) {
-                /* the child was parsed/created and it was placed as the last child. The child can be inserted
-                 * out of order (not as the last one) in case it is a list's key present out of the correct order */
-                dlast = diter;
             }
         }
     }
@@ -539,50 +592,319 @@ attr_error:
         (*result)->validity |= LYD_VAL_DUP;
     }
 
-    return ret;
+    return 0;
 
-unlink_node_error:
-    lyd_unlink_internal(*result, 2);
 error:
-    /* cleanup */
-    for (i = unres->count - 1; i >= 0; i--) {
-        /* remove unres items connected with the node being removed */
-        if (unres->node[i] == *result) {
-            unres_data_del(unres, i);
+    xml_parse_data_free(unres, result);
+    return -1;
+}
+
+/* logs directly */
+static int
+xml_parse_data(struct ly_ctx *ctx, struct lyxml_elem *xml, struct lyd_node *parent, struct lyd_node *first_sibling,
+               struct lyd_node *prev, int options, struct unres_data *unres, struct lyd_node **result,
+               struct lyd_node **act_notif, const char *yang_data_name)
+{
+    struct lys_node *schema;
+    struct lyd_node *diter, *dlast;
+    struct lyxml_elem *child, *next;
+    int r;
+
+    assert(xml);
+    assert(result);
+    *result = NULL;
+
+    if (xml_data_find_schema(ctx, xml, parent, options, yang_data_name, &schema)) {
+        return -1;
+    } else if (!schema) {
+        /* ignored */
+        return 0;
+    }
+
+    if (xml_parse_data_open(ctx, xml, schema, parent, &first_sibling, prev, options, unres, result, act_notif)) {
+        return -1;
+    }
+
+    /* process children */
+    if (!(schema->nodetype & (LYS_LEAF | LYS_LEAFLIST | LYS_ANYDATA)) && xml->child) {
+        diter = dlast = NULL;
+        LY_TREE_FOR_SAFE(xml->child, next, child) {
+            r = xml_parse_data(ctx, child, *result, (*result)->child, dlast, options, unres, &diter, act_notif, yang_data_name);
+            if (r) {
+                xml_parse_data_free(unres, result);
+                return -1;
+            } else if (options & LYD_OPT_DESTRUCT) {
+                lyxml_free(ctx, child);
+            }
+            if (diter && !diter->next) {
+                /* the child was parsed/created and it was placed as the last child. The child can be inserted
+                 * out of order (not as the last one) in case it is a list's key present out of the correct order */
+                dlast = diter;
+            }
         }
     }
-    lyd_free(*result);
-    *result = NULL;
-    return -1;
+
+    return xml_parse_data_close(ctx, xml, first_sibling, prev, options, unres, result);
 }
 
-API struct lyd_node *
-lyd_parse_xml(struct ly_ctx *ctx, struct lyxml_elem **root, int options, ...)
+/* element processed by the streaming parser */
+struct xml_stream_elem {
+    struct lyd_node *node;          /* data node of the element, NULL if not created (yet) */
+    struct lys_node *schema;        /* schema node of the element */
+    struct lyd_node *first_sibling; /* first sibling of the node when it was created */
+    struct lyd_node *prev;          /* previous sibling of the node when it was created */
+    struct lyd_node *last;          /* last child of the node created so far */
+    int flags;
+#define XML_STREAM_IGNORE 0x01      /* the element is ignored */
+#define XML_STREAM_ACTION 0x02      /* the element is the action envelope */
+#define XML_STREAM_DEFER 0x04       /* the element is a terminal node, processed once it is complete */
+};
+
+/* streaming parser state */
+struct xml_stream {
+    struct ly_ctx *ctx;
+    int options;
+    struct unres_data *unres;
+    const char *yang_data_name;
+    struct lyd_node *reply_parent;  /* parent of the top-level nodes */
+    struct lyd_node *result;        /* first top-level node */
+    struct lyd_node *last;          /* last top-level node */
+    struct lyd_node *act_notif;
+    int roots;                      /* number of processed top-level elements */
+    int done;                       /* no more top-level elements are processed */
+
+    struct xml_stream_elem *elems;  /* stack of the currently open elements */
+    uint32_t count;
+    uint32_t size;
+};
+
+static void
+xml_data_toplevel_add(struct ly_ctx *ctx, struct lyd_node *node, struct lyd_node **result, struct lyd_node **last,
+                      int *options)
 {
-    FUN_IN;
+    if (node) {
+        *last = node;
+        if ((*options & LYD_OPT_DATA_ADD_YANGLIB) && node->schema->module == ctx->models.list[ctx->internal_module_count - 1]) {
+            /* ietf-yang-library data present, so ignore the option to add them */
+            *options &= ~LYD_OPT_DATA_ADD_YANGLIB;
+        }
+    }
+    if (!*result) {
+        *result = node;
+    }
+}
 
-    va_list ap;
-    int r;
-    struct unres_data *unres = NULL;
-    const struct lyd_node *rpc_act = NULL, *data_tree = NULL;
-    struct lyd_node *result = NULL, *iter, *last, *reply_parent = NULL, *reply_top = NULL, *act_notif = NULL;
-    struct lyxml_elem *xmlstart, *xmlelem, *xmlaux, *xmlfree = NULL;
-    const char *yang_data_name = NULL;
+/* get the parent context of a new element, returns 1 if it is a top-level one */
+static int
+xml_stream_parent(struct xml_stream *stream, struct lyd_node **parent, struct lyd_node **first_sibling,
+                  struct lyd_node **prev)
+{
+    struct xml_stream_elem *pelem;
 
-    if (!ctx || !root) {
-        LOGARG;
-        return NULL;
+    if (!stream->count || (stream->elems[stream->count - 1].flags & XML_STREAM_ACTION)) {
+        *parent = stream->reply_parent;
+        *first_sibling = stream->result;
+        *prev = stream->last;
+        return 1;
     }
 
-    if (lyp_data_check_options(ctx, options, __func__)) {
-        return NULL;
+    pelem = &stream->elems[stream->count - 1];
+    *parent = pelem->node;
+    *first_sibling = pelem->node->child;
+    *prev = pelem->last;
+    return 0;
+}
+
+/* remove an ignored node with all its descendants from the data tree and unres */
+static void
+xml_stream_drop(struct xml_stream *stream, struct lyd_node *node)
+{
+    struct lyd_node *iter;
+    int i;
+
+    for (i = stream->unres->count - 1; i >= 0; i--) {
+        for (iter = stream->unres->node[i]; iter && (iter != node); iter = iter->parent);
+        if (iter) {
+            unres_data_del(stream->unres, i);
+        }
+    }
+    for (iter = stream->act_notif; iter && (iter != node); iter = iter->parent);
+    if (iter) {
+        stream->act_notif = NULL;
+    }
+    if (stream->result == node) {
+        stream->result = NULL;
+    }
+    lyd_free(node);
+}
+
+static int
+xml_stream_elem_start(struct lyxml_elem *xml, void *arg)
+{
+    struct xml_stream *stream = arg;
+    struct xml_stream_elem *elem;
+    struct lyd_node *parent, *first_sibling, *prev;
+    void *mem;
+    int toplevel;
+
+    if (stream->count == stream->size) {
+        stream->size = stream->size ? stream->size * 2 : 16;
+        mem = realloc(stream->elems, stream->size * sizeof *stream->elems);
+        LY_CHECK_ERR_RETURN(!mem, LOGMEM(stream->ctx), -1);
+        stream->elems = mem;
     }
+    toplevel = xml_stream_parent(stream, &parent, &first_sibling, &prev);
+    elem = &stream->elems[stream->count++];
+    memset(elem, 0, sizeof *elem);
+
+    if (toplevel) {
+        if (stream->done) {
+            elem->flags = XML_STREAM_IGNORE;
+            return 1;
+        }
+        if ((stream->count == 1) && !stream->roots++ && (stream->options & LYD_OPT_RPC)
+                && !strcmp(xml->name, "action") && xml->ns && !strcmp(xml->ns->value, LY_NSYANG)) {
+            /* it's an action, not a simple RPC */
+            elem->flags = XML_STREAM_ACTION;
+            return 0;
+        }
+    }
+
+    if (xml_data_find_schema(stream->ctx, xml, parent, stream->options, stream->yang_data_name, &elem->schema)) {
+        return -1;
+    } else if (!elem->schema) {
+        elem->flags = XML_STREAM_IGNORE;
+        return 1;
+    } else if (elem->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST | LYS_ANYDATA)) {
+        /* value is needed, process it as a whole */
+        elem->flags = XML_STREAM_DEFER;
+        return 1;
+    }
+
+    elem->first_sibling = first_sibling;
+    elem->prev = prev;
+    if (xml_parse_data_open(stream->ctx, xml, elem->schema, parent, &elem->first_sibling, prev, stream->options,
+                            stream->unres, &elem->node, &stream->act_notif)) {
+        return -1;
+    }
+    if (toplevel && !stream->result) {
+        /* connect it right away so that it is freed on error */
+        stream->result = elem->node;
+    }
+
+    return 0;
+}
+
+static int
+xml_stream_elem_end(struct lyxml_elem *xml, void *arg)
+{
+    struct xml_stream *stream = arg;
+    struct xml_stream_elem *elem;
+    struct lyd_node *parent, *first_sibling, *prev, *node;
+    int toplevel, r;
+
+    elem = &stream->elems[--stream->count];
+    toplevel = xml_stream_parent(stream, &parent, &first_sibling, &prev);
+
+    if (elem->flags & XML_STREAM_ACTION) {
+        /* only the action children are processed */
+        stream->done = 1;
+        return 0;
+    } else if (elem->flags & XML_STREAM_DEFER) {
+        r = xml_data_check_mixed(stream->ctx, xml, stream->options);
+        if (r == -1) {
+            return -1;
+        } else if (!r) {
+            if (xml_parse_data_open(stream->ctx, xml, elem->schema, parent, &first_sibling, prev, stream->options,
+                                    stream->unres, &elem->node, &stream->act_notif)
+                    || xml_parse_data_close(stream->ctx, xml, first_sibling, prev, stream->options, stream->unres,
+                                            &elem->node)) {
+                return -1;
+            }
+        }
+    } else if (elem->node) {
+        r = xml_data_check_mixed(stream->ctx, xml, stream->options);
+        if (r == -1) {
+            return -1;
+        } else if (r == 1) {
+            /* the children were parsed, throw them away */
+            xml_stream_drop(stream, elem->node);
+            elem->node = NULL;
+        } else {
+            node = elem->node;
+            if (xml_parse_data_close(stream->ctx, xml, elem->first_sibling, elem->prev, stream->options, stream->unres,
+                                     &elem->node)) {
+                if (stream->result == node) {
+                    stream->result = NULL;
+                }
+                return -1;
+            }
+        }
+    }
+
+    /* update the parent */
+    if (toplevel) {
+        xml_data_toplevel_add(stream->ctx, elem->node, &stream->result, &stream->last, &stream->options);
+        if (stream->options & LYD_OPT_NOSIBLINGS) {
+            /* stop after the first processed root */
+            stream->done = 1;
+        }
+    } else if (elem->node && !elem->node->next) {
+        /* the child was parsed/created and it was placed as the last child. The child can be inserted
+         * out of order (not as the last one) in case it is a list's key present out of the correct order */
+        stream->elems[stream->count - 1].last = elem->node;
+    }
+
+    return 0;
+}
+
+/* is there no element in the XML document? */
+static int
+xml_data_empty(const char *data)
+{
+    const char *c = data;
+
+    while (*c) {
+        if (is_xmlws(*c)) {
+            ++c;
+        } else if (!strncmp(c, "<?", 2)) {
+            c = strstr(c + 2, "?>");
+            if (!c) {
+                /* let the parser report the missing closing sequence */
+                return 0;
+            }
+            c += 2;
+        } else if (!strncmp(c, "<!--", 4)) {
+            c = strstr(c + 4, "-->");
+            if (!c) {
+                return 0;
+            }
+            c += 3;
+        } else {
+            return 0;
+        }
+    }
+
+    return 1;
+}
 
-    if (!(*root) && !(options & LYD_OPT_RPCREPLY)) {
+/* parse either the XML tree in root or the XML document in data */
+static struct lyd_node *
+xml_parse_(struct ly_ctx *ctx, struct lyxml_elem **root, const char *data, int options, const struct lyd_node *rpc_act,
+           const struct lyd_node *data_tree, const char *yang_data_name)
+{
+    int r, xmlopt;
+    struct unres_data *unres = NULL;
+    struct lyd_node *result = NULL, *iter, *last, *reply_parent = NULL, *reply_top = NULL, *act_notif = NULL;
+    struct lyxml_elem *xmlstart, *xmlelem, *xmlaux, *xmlfree = NULL;
+    struct xml_stream stream;
+    struct lyxml_hooks hooks;
+
+    if ((root ? !(*root) : xml_data_empty(data)) && !(options & LYD_OPT_RPCREPLY)) {
         /* empty tree */
         if (options & (LYD_OPT_RPC | LYD_OPT_NOTIF)) {
             /* error, top level node identify RPC and Notification */
-            LOGERR(ctx, LY_EINVAL, "%s: *root identifies RPC/Notification so it cannot be NULL.", __func__);
+            LOGERR(ctx, LY_EINVAL, "lyd_parse_xml: *root identifies RPC/Notification so it cannot be NULL.");
             return NULL;
         } else if (!(options & LYD_OPT_RPCREPLY)) {
             /* others - no work is needed, just check for missing mandatory nodes */
@@ -595,11 +917,9 @@ lyd_parse_xml(struct ly_ctx *ctx, struct lyxml_elem **root, int options, ...)
     unres = calloc(1, sizeof *unres);
     LY_CHECK_ERR_RETURN(!unres, LOGMEM(ctx), NULL);
 
-    va_start(ap, options);
     if (options & LYD_OPT_RPCREPLY) {
-        rpc_act = va_arg(ap, const struct lyd_node *);
         if (!rpc_act || rpc_act->parent || !(rpc_act->schema->nodetype & (LYS_RPC | LYS_LIST | LYS_CONTAINER))) {
-            LOGERR(ctx, LY_EINVAL, "%s: invalid variable parameter (const struct lyd_node *rpc_act).", __func__);
+            LOGERR(ctx, LY_EINVAL, "lyd_parse_xml: invalid variable parameter (const struct lyd_node *rpc_act).");
             goto error;
         }
         if (rpc_act->schema->nodetype == LYS_RPC) {
@@ -615,7 +935,7 @@ lyd_parse_xml(struct ly_ctx *ctx, struct lyxml_elem **root, int options, ...)
                 LY_TREE_DFS_END(reply_top, iter, reply_parent);
             }
             if (!reply_parent) {
-                LOGERR(ctx, LY_EINVAL, "%s: invalid variable parameter (const struct lyd_node *rpc_act).", __func__);
+                LOGERR(ctx, LY_EINVAL, "lyd_parse_xml: invalid variable parameter (const struct lyd_node *rpc_act).");
                 lyd_free_withsiblings(reply_top);
                 goto error;
             }
@@ -623,18 +943,16 @@ lyd_parse_xml(struct ly_ctx *ctx, struct lyxml_elem **root, int options, ...)
         }
     }
     if (options & (LYD_OPT_RPC | LYD_OPT_NOTIF | LYD_OPT_RPCREPLY)) {
-        data_tree = va_arg(ap, const struct lyd_node *);
         if (data_tree) {
             if (options & LYD_OPT_NOEXTDEPS) {
-                LOGERR(ctx, LY_EINVAL, "%s: invalid parameter (variable arg const struct lyd_node *data_tree and LYD_OPT_NOEXTDEPS set).",
-                       __func__);
+                LOGERR(ctx, LY_EINVAL, "lyd_parse_xml: invalid parameter (variable arg const struct lyd_node *data_tree and LYD_OPT_NOEXTDEPS set).");
                 goto error;
             }
 
             LY_TREE_FOR((struct lyd_node *)data_tree, iter) {
                 if (iter->parent) {
                     /* a sibling is not top-level */
-                    LOGERR(ctx, LY_EINVAL, "%s: invalid variable parameter (const struct lyd_node *data_tree).", __func__);
+                    LOGERR(ctx, LY_EINVAL, "lyd_parse_xml: invalid variable parameter (const struct lyd_node *data_tree).");
                     goto error;
                 }
             }
@@ -644,65 +962,79 @@ lyd_parse_xml(struct ly_ctx *ctx, struct lyxml_elem **root, int options, ...)
 
             /* LYD_OPT_NOSIBLINGS cannot be set in this case */
             if (options & LYD_OPT_NOSIBLINGS) {
-                LOGERR(ctx, LY_EINVAL, "%s: invalid parameter (variable arg const struct lyd_node *data_tree with LYD_OPT_NOSIBLINGS).", __func__);
+                LOGERR(ctx, LY_EINVAL, "lyd_parse_xml: invalid parameter (variable arg const struct lyd_node *data_tree with LYD_OPT_NOSIBLINGS).");
                 goto error;
             }
         }
     }
-    if (options & LYD_OPT_DATA_TEMPLATE) {
-        yang_data_name = va_arg(ap, const char *);
-    }
-
-    if ((*root) && !(options & LYD_OPT_NOSIBLINGS)) {
-        /* locate the first root to process */
-        if ((*root)->parent) {
-            xmlstart = (*root)->parent->child;
-        } else {
-            xmlstart = *root;
-            while(xmlstart->prev->next) {
-                xmlstart = xmlstart->prev;
-            }
-        }
-    } else {
-        xmlstart = *root;
-    }
 
-    if ((options & LYD_OPT_RPC)
-            && !strcmp(xmlstart->name, "action") && !strcmp(xmlstart->ns->value, LY_NSYANG)) {
-        /* it's an action, not a simple RPC */
-        xmlstart = xmlstart->child;
-        if (options & LYD_OPT_DESTRUCT) {
-            /* free it later */
-            xmlfree = xmlstart->parent;
-        }
-    }
-
-    iter = last = NULL;
-    LY_TREE_FOR_SAFE(xmlstart, xmlaux, xmlelem) {
-        r = xml_parse_data(ctx, xmlelem, reply_parent, result, last, options, unres, &iter, &act_notif, yang_data_name);
+    if (!root) {
+        /* streaming, the whole XML tree is never built */
+        memset(&stream, 0, sizeof stream);
+        stream.ctx = ctx;
+        stream.options = options;
+        stream.unres = unres;
+        stream.yang_data_name = yang_data_name;
+        stream.reply_parent = reply_parent;
+        hooks.elem_start = xml_stream_elem_start;
+        hooks.elem_end = xml_stream_elem_end;
+        hooks.arg = &stream;
+
+        xmlopt = (options & LYD_OPT_NOSIBLINGS) ? 0 : LYXML_PARSE_MULTIROOT;
+        r = lyxml_parse_mem_hooks(ctx, data, xmlopt, &hooks);
+        free(stream.elems);
+        result = stream.result;
+        act_notif = stream.act_notif;
+        options = stream.options;
         if (r) {
             if (reply_top) {
                 result = reply_top;
             }
             goto error;
-        } else if (options & LYD_OPT_DESTRUCT) {
-            lyxml_free(ctx, xmlelem);
-            *root = xmlaux;
         }
-        if (iter) {
-            last = iter;
-            if ((options & LYD_OPT_DATA_ADD_YANGLIB) && iter->schema->module == ctx->models.list[ctx->internal_module_count - 1]) {
-                /* ietf-yang-library data present, so ignore the option to add them */
-                options &= ~LYD_OPT_DATA_ADD_YANGLIB;
+    } else {
+        if ((*root) && !(options & LYD_OPT_NOSIBLINGS)) {
+            /* locate the first root to process */
+            if ((*root)->parent) {
+                xmlstart = (*root)->parent->child;
+            } else {
+                xmlstart = *root;
+                while(xmlstart->prev->next) {
+                    xmlstart = xmlstart->prev;
+                }
             }
+        } else {
+            xmlstart = *root;
         }
-        if (!result) {
-            result = iter;
+
+        if ((options & LYD_OPT_RPC)
+                && !strcmp(xmlstart->name, "action") && !strcmp(xmlstart->ns->value, LY_NSYANG)) {
+            /* it's an action, not a simple RPC */
+            xmlstart = xmlstart->child;
+            if (options & LYD_OPT_DESTRUCT) {
+                /* free it later */
+                xmlfree = xmlstart->parent;
+            }
         }
 
-        if (options & LYD_OPT_NOSIBLINGS) {
-            /* stop after the first processed root */
-            break;
+        iter = last = NULL;
+        LY_TREE_FOR_SAFE(xmlstart, xmlaux, xmlelem) {
+            r = xml_parse_data(ctx, xmlelem, reply_parent, result, last, options, unres, &iter, &act_notif, yang_data_name);
+            if (r) {
+                if (reply_top) {
+                    result = reply_top;
+                }
+                goto error;
+            } else if (options & LYD_OPT_DESTRUCT) {
+                lyxml_free(ctx, xmlelem);
+                *root = xmlaux;
+            }
+            xml_data_toplevel_add(ctx, iter, &result, &last, &options);
+
+            if (options & LYD_OPT_NOSIBLINGS) {
+                /* stop after the first processed root */
+                break;
+            }
         }
     }
 
@@ -748,6 +1080,7 @@ lyd_parse_xml(struct ly_ctx *ctx, struct lyxml_elem **root, int options, ...)
             && lyd_check_mandatory_tree((act_notif ? act_notif : result), ctx, NULL, 0, options)) {
         goto error;
     }
+    lyd_val_clean(result, NULL, 0, options);
 
     if (xmlfree) {
         lyxml_free(ctx, xmlfree);
@@ -755,7 +1088,6 @@ lyd_parse_xml(struct ly_ctx *ctx, struct lyxml_elem **root, int options, ...)
     free(unres->node);
     free(unres->type);
     free(unres);
-    va_end(ap);
     return result;
 
 error:
@@ -766,6 +1098,47 @@ error:
     free(unres->node);
     free(unres->type);
     free(unres);
-    va_end(ap);
     return NULL;
 }
+
+API struct lyd_node *
+lyd_parse_xml(struct ly_ctx *ctx, struct lyxml_elem **root, int options, ...)
+{
+    FUN_IN;
+
+    va_list ap;
+    const struct lyd_node *rpc_act = NULL, *data_tree = NULL;
+    const char *yang_data_name = NULL;
+
+    if (!ctx || !root) {
+        LOGARG;
+        return NULL;
+    }
+
+    if (lyp_data_check_options(ctx, options, __func__)) {
+        return NULL;
+    }
+    /* validation-only flag */
+    options &= ~LYD_OPT_VAL_INCR;
+
+    va_start(ap, options);
+    if (options & LYD_OPT_RPCREPLY) {
+        rpc_act = va_arg(ap, const struct lyd_node *);
+    }
+    if (options & (LYD_OPT_RPC | LYD_OPT_NOTIF | LYD_OPT_RPCREPLY)) {
+        data_tree = va_arg(ap, const struct lyd_node *);
+    }
+    if (options & LYD_OPT_DATA_TEMPLATE) {
+        yang_data_name = va_arg(ap, const char *);
+    }
+    va_end(ap);
+
+    return xml_parse_(ctx, root, NULL, options, rpc_act, data_tree, yang_data_name);
+}
+
+struct lyd_node *
+lyd_parse_xml_mem(struct ly_ctx *ctx, const char *data, int options, const struct lyd_node *rpc_act,
+                  const struct lyd_node *data_tree, const char *yang_data_name)
+{
+    return xml_parse_(ctx, NULL, data, options, rpc_act, data_tree, yang_data_name);
+}
@@ -77,134 +77,351 @@ nscmp(const struct lyd_node *node1, const struct lyd_node *node2)
     }
 }
 
+/**
+ * @brief Get the buffer the next output is stored into. Data following a hole are collected
+ * in the hole buffer, memory output goes directly into the resulting string and any other output
+ * is collected in the write buffer until the next flush point.
+ */
+static void
+ly_print_target(struct lyout *out, char ***buf, size_t **len, size_t **size)
+{
+    if (out->hole_count) {
+        *buf = &out->buffered;
+        *len = &out->buf_len;
+        *size = &out->buf_size;
+    } else if (out->type == LYOUT_MEMORY) {
+        *buf = &out->method.mem.buf;
+        *len = &out->method.mem.len;
+        *size = &out->method.mem.size;
+    } else {
+        *buf = &out->wbuf;
+        *len = &out->wbuf_len;
+        *size = &out->wbuf_size;
+    }
+}
+
+/**
+ * @brief Pass the content of the write buffer to the actual output.
+ *
+ * @return 0 on success, -1 on error (errno is set).
+ */
+static int
+ly_print_wbuf_write(struct lyout *out)
+{
+    size_t written = 0;
+    ssize_t r = 0;
+
+    while (written < out->wbuf_len) {
+        switch (out->type) {
+        case LYOUT_FD:
+            r = write(out->method.fd, out->wbuf + written, out->wbuf_len - written);
+            if ((r < 0) && (errno == EINTR)) {
+                continue;
+            }
+            break;
+        case LYOUT_STREAM:
+            r = fwrite(out->wbuf + written, 1, out->wbuf_len - written, out->method.f);
+            if (!r) {
+                r = -1;
+            }
+            break;
+        case LYOUT_CALLBACK:
+            r = out->method.clb.f(out->method.clb.arg, out->wbuf + written, out->wbuf_len - written);
+            if (r >= 0) {
+                /*
+                 * Depending on what the callback function does, errno might
+                 * contain non-zero values that are not real "errors" (EAGAIN or
+                 * EINTR). Reset errno if the callback returns a zero or positive
+                 * value.
+                 */
+                errno = 0;
+            }
+            break;
+        case LYOUT_MEMORY:
+            LOGINT(NULL);
+            r = -1;
+            break;
+        }
+
+        if (r <= 0) {
+            break;
+        }
+        written += r;
+    }
+
+    /* the data are dropped even on error, it is reported via errno */
+    out->wbuf_len = 0;
+    return (r < 0) ? -1 : 0;
+}
+
+/**
+ * @brief Make room for @p count bytes and the terminating zero at the end of the current output buffer.
+ * Buffers grow geometrically, a full write buffer is passed to the output instead of growing.
+ *
+ * @return Pointer to the reserved space, NULL on memory allocation error.
+ */
+static char *
+ly_print_reserve(struct lyout *out, size_t count)
+{
+    char **buf, *aux;
+    size_t *len, *size, new_size;
+
+    ly_print_target(out, &buf, &len, &size);
+
+    if ((buf == &out->wbuf) && *len && (*len + count + 1 > *size)) {
+        /* flush point */
+        ly_print_wbuf_write(out);
+    }
+
+    if (*len + count + 1 > *size) {
+        new_size = *size ? *size : LY_PRINT_BUF_SIZE;
+        while (*len + count + 1 > new_size) {
+            new_size <<= 1;
+        }
+        aux = ly_realloc(*buf, new_size);
+        if (!aux) {
+            *buf = NULL;
+            *len = 0;
+            *size = 0;
+            LOGMEM(NULL);
+            return NULL;
+        }
+        *buf = aux;
+        *size = new_size;
+    }
+
+    return *buf + *len;
+}
+
+/**
+ * @brief Confirm @p count bytes stored into the space returned by ly_print_reserve().
+ */
+static void
+ly_print_commit(struct lyout *out, size_t count)
+{
+    char **buf;
+    size_t *len, *size;
+
+    ly_print_target(out, &buf, &len, &size);
+
+    *len += count;
+    (*buf)[*len] = '\0';
+}
+
+/**
+ * @brief Check whether the format contains only conversions supported by ly_vprint_fast().
+ */
+static int
+ly_print_fast_format(const char *format)
+{
+    for (format = strchr(format, '%'); format; format = strchr(format, '%')) {
+        ++format;
+        if (*format == '-') {
+            ++format;
+        }
+        if (*format == '*') {
+            ++format;
+            if (*format != 's') {
+                return 0;
+            }
+        } else if (!*format || !strchr("sdiuc%", *format)) {
+            return 0;
+        }
+        ++format;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Print literal text, (padded) strings and integers directly into the output buffer,
+ * bypassing printf formatting. Supported conversions are %s, %*s, %-*s, %d, %i, %u, %c and %%.
+ */
+static int
+ly_vprint_fast(struct lyout *out, const char *format, va_list ap)
+{
+    const char *ptr, *str;
+    char num[12], *dst;
+    int count = 0, width, left;
+    size_t len, pad;
+    int64_t i;
+    uint32_t u;
+
+    while (*format) {
+        for (ptr = format; *ptr && (*ptr != '%'); ++ptr);
+        if (ptr > format) {
+            /* literal */
+            len = ptr - format;
+            dst = ly_print_reserve(out, len);
+            if (!dst) {
+                return -1;
+            }
+            memcpy(dst, format, len);
+            ly_print_commit(out, len);
+            count += len;
+            if (!*ptr) {
+                break;
+            }
+        }
+        format = ptr + 1;
+
+        width = 0;
+        left = 0;
+        if (*format == '-') {
+            left = 1;
+            ++format;
+        }
+        if (*format == '*') {
+            width = va_arg(ap, int);
+            if (width < 0) {
+                left = 1;
+                width = -width;
+            }
+            ++format;
+        }
+
+        switch (*format) {
+        case 's':
+            str = va_arg(ap, const char *);
+            if (!str) {
+                str = "(null)";
+            }
+            len = strlen(str);
+            break;
+        case 'c':
+            num[0] = (char)va_arg(ap, int);
+            str = num;
+            len = 1;
+            break;
+        case '%':
+            str = "%";
+            len = 1;
+            break;
+        default:
+            /* integer */
+            if (*format == 'u') {
+                i = va_arg(ap, unsigned int);
+            } else {
+                i = va_arg(ap, int);
+            }
+            u = (i < 0) ? -i : i;
+            dst = &num[sizeof num];
+            do {
+                *(--dst) = '0' + u % 10;
+                u /= 10;
+            } while (u);
+            if (i < 0) {
+                *(--dst) = '-';
+            }
+            str = dst;
+            len = &num[sizeof num] - dst;
+            break;
+        }
+        ++format;
+
+        pad = ((size_t)width > len) ? width - len : 0;
+        dst = ly_print_reserve(out, len + pad);
+        if (!dst) {
+            return -1;
+        }
+        if (!left) {
+            memset(dst, ' ', pad);
+            dst += pad;
+        }
+        memcpy(dst, str, len);
+        if (left) {
+            memset(dst + len, ' ', pad);
+        }
+        ly_print_commit(out, len + pad);
+        count += len + pad;
+    }
+
+    return count;
+}
+
 int
 ly_print(struct lyout *out, const char *format, ...)
 {
-    int count = 0;
-    char *msg = NULL, *aux;
-    va_list ap;
-#ifndef HAVE_VDPRINTF
-    FILE *stream;
-#endif
+    int count;
+    char **buf, *dst;
+    size_t *len, *size;
+    va_list ap, ap2;
 
     va_start(ap, format);
-
-    switch (out->type) {
-    case LYOUT_FD:
-#ifdef HAVE_VDPRINTF
-        count = vdprintf(out->method.fd, format, ap);
-#else
-        stream = fdopen(dup(out->method.fd), "a+");
-        if (stream) {
-            count = vfprintf(stream, format, ap);
-            fclose(stream);
-        }
-#endif
-        break;
-    case LYOUT_STREAM:
-        count = vfprintf(out->method.f, format, ap);
-        break;
-    case LYOUT_MEMORY:
-        count = vasprintf(&msg, format, ap);
-        if (out->method.mem.len + count + 1 > out->method.mem.size) {
-            aux = ly_realloc(out->method.mem.buf, out->method.mem.len + count + 1);
-            if (!aux) {
-                out->method.mem.buf = NULL;
-                out->method.mem.len = 0;
-                out->method.mem.size = 0;
-                LOGMEM(NULL);
-                va_end(ap);
-                return -1;
+    va_copy(ap2, ap);
+
+    if (ly_print_fast_format(format)) {
+        count = ly_vprint_fast(out, format, ap);
+        if (!count) {
+            /* even an empty memory output is expected to be allocated and terminated */
+            if (ly_print_reserve(out, 0)) {
+                ly_print_commit(out, 0);
+            } else {
+                count = -1;
             }
-            out->method.mem.buf = aux;
-            out->method.mem.size = out->method.mem.len + count + 1;
         }
-        memcpy(&out->method.mem.buf[out->method.mem.len], msg, count);
-        out->method.mem.len += count;
-        out->method.mem.buf[out->method.mem.len] = '\0';
-        free(msg);
-        break;
-    case LYOUT_CALLBACK:
-        count = vasprintf(&msg, format, ap);
-        count = out->method.clb.f(out->method.clb.arg, msg, count);
-        if (count >= 0) {
-            /*
-             * Depending on what the callback function does, errno might
-             * contain non-zero values that are not real "errors" (EAGAIN or
-             * EINTR). Reset errno if the callback returns a zero or positive
-             * value.
-             */
-            errno = 0;
-        }
-        free(msg);
-        break;
+        goto cleanup;
+    }
+
+    /* format directly into the buffer, once more after making room if it did not fit */
+    dst = ly_print_reserve(out, 0);
+    if (!dst) {
+        count = -1;
+        goto cleanup;
     }
+    ly_print_target(out, &buf, &len, &size);
+    count = vsnprintf(dst, *size - *len, format, ap);
+    if (count < 0) {
+        goto cleanup;
+    }
+    if ((size_t)count >= *size - *len) {
+        dst = ly_print_reserve(out, count);
+        if (!dst) {
+            count = -1;
+            goto cleanup;
+        }
+        vsnprintf(dst, count + 1, format, ap2);
+    }
+    ly_print_commit(out, count);
 
+cleanup:
+    va_end(ap2);
     va_end(ap);
     return count;
 }
 
-void
+int
 ly_print_flush(struct lyout *out)
 {
-    switch (out->type) {
-    case LYOUT_STREAM:
-        fflush(out->method.f);
-        break;
-    case LYOUT_FD:
-    case LYOUT_MEMORY:
-    case LYOUT_CALLBACK:
-        /* nothing to do */
-        break;
+    int ret = 0;
+
+    if (out->wbuf_len) {
+        ret = ly_print_wbuf_write(out);
     }
+    free(out->wbuf);
+    out->wbuf = NULL;
+    out->wbuf_size = 0;
+
+    if ((out->type == LYOUT_STREAM) && fflush(out->method.f)) {
+        ret = -1;
+    }
+
+    return ret;
 }
 
 int
 ly_write(struct lyout *out, const char *buf, size_t count)
 {
-    if (out->hole_count) {
-        /* we are buffering data after a hole */
-        if (out->buf_len + count > out->buf_size) {
-            out->buffered = ly_realloc(out->buffered, out->buf_len + count);
-            if (!out->buffered) {
-                out->buf_len = 0;
-                out->buf_size = 0;
-                LOGMEM(NULL);
-                return -1;
-            }
-            out->buf_size = out->buf_len + count;
-        }
+    char *dst;
 
-        memcpy(&out->buffered[out->buf_len], buf, count);
-        out->buf_len += count;
-        return count;
-    }
-
-    switch (out->type) {
-    case LYOUT_MEMORY:
-        if (out->method.mem.len + count + 1 > out->method.mem.size) {
-            out->method.mem.buf = ly_realloc(out->method.mem.buf, out->method.mem.len + count + 1);
-            if (!out->method.mem.buf) {
-                out->method.mem.len = 0;
-                out->method.mem.size = 0;
-                LOGMEM(NULL);
-                return -1;
-            }
-            out->method.mem.size = out->method.mem.len + count + 1;
-        }
-        memcpy(&out->method.mem.buf[out->method.mem.len], buf, count);
-        out->method.mem.len += count;
-        out->method.mem.buf[out->method.mem.len] = '\0';
-        return count;
-    case LYOUT_FD:
-        return write(out->method.fd, buf, count);
-    case LYOUT_STREAM:
-        return fwrite(buf, sizeof *buf, count, out->method.f);
-    case LYOUT_CALLBACK:
-        return out->method.clb.f(out->method.clb.arg, buf, count);
+    dst = ly_print_reserve(out, count);
+    if (!dst) {
+        return -1;
     }
+    memcpy(dst, buf, count);
+    ly_print_commit(out, count);
 
-    return 0;
+    return count;
 }
 
 int
@@ -212,36 +429,26 @@ ly_write_skip(struct lyout *out, size_t count, size_t *position)
 {
     switch (out->type) {
     case LYOUT_MEMORY:
-        if (out->method.mem.len + count > out->method.mem.size) {
-            out->method.mem.buf = ly_realloc(out->method.mem.buf, out->method.mem.len + count);
-            if (!out->method.mem.buf) {
-                out->method.mem.len = 0;
-                out->method.mem.size = 0;
-                LOGMEM(NULL);
-                return -1;
-            }
-            out->method.mem.size = out->method.mem.len + count;
+        if (!ly_print_reserve(out, count)) {
+            return -1;
         }
 
         /* save the current position */
         *position = out->method.mem.len;
 
         /* skip the memory */
-        out->method.mem.len += count;
+        ly_print_commit(out, count);
         break;
     case LYOUT_FD:
     case LYOUT_STREAM:
     case LYOUT_CALLBACK:
+        /* increase hole counter, everything from now on is buffered until the hole is filled */
+        ++out->hole_count;
+
         /* buffer the hole */
-        if (out->buf_len + count > out->buf_size) {
-            out->buffered = ly_realloc(out->buffered, out->buf_len + count);
-            if (!out->buffered) {
-                out->buf_len = 0;
-                out->buf_size = 0;
-                LOGMEM(NULL);
-                return -1;
-            }
-            out->buf_size = out->buf_len + count;
+        if (!ly_print_reserve(out, count)) {
+            --out->hole_count;
+            return -1;
         }
 
         /* save the current position */
@@ -249,9 +456,7 @@ ly_write_skip(struct lyout *out, size_t count, size_t *position)
 
         /* skip the memory */
         out->buf_len += count;
-
-        /* increase hole counter */
-        ++out->hole_count;
+        break;
     }
 
     return count;
@@ -390,6 +595,11 @@ lys_print_(struct lyout *out, const struct lys_module *module, LYS_OUTFORMAT for
         break;
     }
 
+    if (ly_print_flush(out) && !ret) {
+        LOGERR(module->ctx, LY_ESYS, "Print error (%s).", strerror(errno));
+        ret = EXIT_FAILURE;
+    }
+
     return ret;
 }
 
@@ -715,17 +925,30 @@ lys_print_target(struct lyout *out, const struct lys_module *module, const char
 static int
 lyd_print_(struct lyout *out, const struct lyd_node *root, LYD_FORMAT format, int options)
 {
+    int ret;
+
     switch (format) {
     case LYD_XML:
-        return xml_print_data(out, root, options);
+        ret = xml_print_data(out, root, options);
+        break;
     case LYD_JSON:
-        return json_print_data(out, root, options);
+        ret = json_print_data(out, root, options);
+        break;
     case LYD_LYB:
-        return lyb_print_data(out, root, options);
+        ret = lyb_print_data(out, root, options);
+        break;
     default:
         LOGERR(root->schema->module->ctx, LY_EINVAL, "Unknown output format.");
-        return EXIT_FAILURE;
+        ret = EXIT_FAILURE;
+        break;
     }
+
+    if (ly_print_flush(out) && !ret) {
+        LOGERR(NULL, LY_ESYS, "Print error (%s).", strerror(errno));
+        ret = EXIT_FAILURE;
+    }
+
+    return ret;
 }
 
 API int
@@ -49,8 +49,16 @@ struct lyout {
 
     /* hole counter */
     size_t hole_count;
+
+    /* write buffer (all types except LYOUT_MEMORY), passed to the output when full and in ly_print_flush() */
+    char *wbuf;
+    size_t wbuf_len;
+    size_t wbuf_size;
 };
 
+/* initial size of the output buffers, they grow geometrically */
+#define LY_PRINT_BUF_SIZE 4096
+
 struct ext_substmt_info_s {
     const char *name;
     const char *arg;
@@ -71,7 +79,14 @@ extern struct ext_substmt_info_s ext_substmt_info[];
  * @brief Generic printer, replacement for printf() / write() / etc
  */
 int ly_print(struct lyout *out, const char *format, ...);
-void ly_print_flush(struct lyout *out);
+
+/**
+ * @brief Flush point, pass all the buffered data to the output and release the write buffer.
+ * Must be called before the output is finished, data following unfilled holes stay buffered.
+ *
+ * @return 0 on success, -1 on output error (errno is set).
+ */
+int ly_print_flush(struct lyout *out);
 int ly_write(struct lyout *out, const char *buf, size_t count);
 int ly_write_skip(struct lyout *out, size_t count, size_t *position);
 int ly_write_skipped(struct lyout *out, size_t position, const char *buf, size_t count);
@@ -316,134 +316,111 @@ lyb_hash_find(struct hash_table *ht, struct lys_node *node)
     return hash;
 }
 
-/* writing function handles writing size information */
+/* writing function, when there is no output, the bytes are only counted (subtree length counting pass) */
 static int
 lyb_write(struct lyout *out, const uint8_t *buf, size_t count, struct lyb_state *lybs)
 {
-    int ret = 0, i, full_chunk_i;
-    size_t r, to_write;
-    uint8_t meta_buf[LYB_META_BYTES];
-
-    assert(out && lybs);
-
-    while (1) {
-        /* check for full data chunks */
-        to_write = count;
-        full_chunk_i = -1;
-        for (i = 0; i < lybs->used; ++i) {
-            /* we want the innermost chunks resolved first, so replace previous full chunks */
-            if (lybs->written[i] + to_write >= LYB_SIZE_MAX) {
-                /* full chunk, do not write more than allowed */
-                to_write = LYB_SIZE_MAX - lybs->written[i];
-                full_chunk_i = i;
-            }
-        }
-
-        if ((full_chunk_i == -1) && !count) {
-            break;
-        }
-
-        /* we are actually writing some data, not just finishing another chunk */
-        if (to_write) {
-            r = ly_write(out, (char *)buf, to_write);
-            if (r < to_write) {
-                return -1;
-            }
-
-            for (i = 0; i < lybs->used; ++i) {
-                /* increase all written counters */
-                lybs->written[i] += r;
-                assert(lybs->written[i] <= LYB_SIZE_MAX);
-            }
-            /* decrease count/buf */
-            count -= r;
-            buf += r;
-
-            ret += r;
-        }
-
-        if (full_chunk_i > -1) {
-            /* write the meta information (inner chunk count and chunk size) */
-            meta_buf[0] = lybs->written[full_chunk_i] & 0xFF;
-            meta_buf[1] = lybs->inner_chunks[full_chunk_i] & 0xFF;
-
-            r = ly_write_skipped(out, lybs->position[full_chunk_i], (char *)meta_buf, LYB_META_BYTES);
-            if (r < LYB_META_BYTES) {
-                return -1;
-            }
+    assert(lybs);
 
-            /* zero written and inner chunks */
-            lybs->written[full_chunk_i] = 0;
-            lybs->inner_chunks[full_chunk_i] = 0;
+    if (out && (ly_write(out, (const char *)buf, count) < (int)count)) {
+        return -1;
+    }
+    lybs->offset += count;
 
-            /* skip space for another chunk size */
-            r = ly_write_skip(out, LYB_META_BYTES, &lybs->position[full_chunk_i]);
-            if (r < LYB_META_BYTES) {
-                return -1;
-            }
+    return count;
+}
 
-            ret += r;
+static int
+lyb_write_varint(uint32_t num, struct lyout *out, struct lyb_state *lybs)
+{
+    uint8_t buf[LYB_VARINT_MAX_BYTES];
+    int count = 0;
 
-            /* increase inner chunk count */
-            for (i = 0; i < full_chunk_i; ++i) {
-                if (lybs->inner_chunks[i] == LYB_INCHUNK_MAX) {
-                    LOGINT(lybs->ctx);
-                    return -1;
-                }
-                ++lybs->inner_chunks[i];
-            }
+    /* unsigned LEB128, 7 bits in every byte with the highest bit set if another byte follows */
+    do {
+        buf[count] = num & 0x7F;
+        num >>= 7;
+        if (num) {
+            buf[count] |= 0x80;
         }
-    }
+        ++count;
+    } while (num);
 
-    return ret;
+    return lyb_write(out, buf, count, lybs);
 }
 
 static int
 lyb_write_stop_subtree(struct lyout *out, struct lyb_state *lybs)
 {
-    int r;
-    uint8_t meta_buf[LYB_META_BYTES];
+    size_t len;
+
+    --lybs->used;
+
+    if (!out) {
+        /* counting, store the subtree length */
+        len = lybs->offset - lybs->written[lybs->used];
+        if (len > UINT32_MAX) {
+            LOGERR(lybs->ctx, LY_EINVAL, "Maximum supported LYB subtree length is %u bytes.", UINT32_MAX);
+            return -1;
+        }
+        lybs->sub_len[lybs->position[lybs->used]] = len;
 
-    /* write the meta chunk information */
-    meta_buf[0] = lybs->written[lybs->used - 1] & 0xFF;
-    meta_buf[1] = lybs->inner_chunks[lybs->used - 1] & 0xFF;
+        /* the length is printed in front of the subtree so it is a part of the parent subtree */
+        lyb_write_varint(len, NULL, lybs);
+        return 0;
+    }
 
-    r = ly_write_skipped(out, lybs->position[lybs->used - 1], (char *)&meta_buf, LYB_META_BYTES);
-    if (r < LYB_META_BYTES) {
+    /* the subtree must have been printed exactly as it was counted */
+    if (lybs->offset != lybs->written[lybs->used]) {
+        LOGINT(lybs->ctx);
         return -1;
     }
 
-    --lybs->used;
     return 0;
 }
 
 static int
 lyb_write_start_subtree(struct lyout *out, struct lyb_state *lybs)
 {
-    int i;
+    int r;
+    void *mem;
 
     if (lybs->used == lybs->size) {
         lybs->size += LYB_STATE_STEP;
         lybs->written = ly_realloc(lybs->written, lybs->size * sizeof *lybs->written);
         lybs->position = ly_realloc(lybs->position, lybs->size * sizeof *lybs->position);
-        lybs->inner_chunks = ly_realloc(lybs->inner_chunks, lybs->size * sizeof *lybs->inner_chunks);
-        LY_CHECK_ERR_RETURN(!lybs->written || !lybs->position || !lybs->inner_chunks, LOGMEM(lybs->ctx), -1);
+        LY_CHECK_ERR_RETURN(!lybs->written || !lybs->position, LOGMEM(lybs->ctx), -1);
     }
 
-    ++lybs->used;
-    lybs->written[lybs->used - 1] = 0;
-    lybs->inner_chunks[lybs->used - 1] = 0;
-
-    /* another inner chunk */
-    for (i = 0; i < lybs->used - 1; ++i) {
-        if (lybs->inner_chunks[i] == LYB_INCHUNK_MAX) {
-            LOGINT(lybs->ctx);
-            return -1;
+    if (!out) {
+        /* counting, remember the subtree start, its length is known only once it is finished */
+        if (lybs->sub_count == lybs->sub_size) {
+            lybs->sub_size = lybs->sub_size ? lybs->sub_size * 2 : LYB_STATE_STEP * 16;
+            mem = realloc(lybs->sub_len, lybs->sub_size * sizeof *lybs->sub_len);
+            LY_CHECK_ERR_RETURN(!mem, LOGMEM(lybs->ctx), -1);
+            lybs->sub_len = mem;
+            mem = realloc(lybs->sub_hash, lybs->sub_size * sizeof *lybs->sub_hash);
+            LY_CHECK_ERR_RETURN(!mem, LOGMEM(lybs->ctx), -1);
+            lybs->sub_hash = mem;
         }
-        ++lybs->inner_chunks[i];
+
+        lybs->written[lybs->used] = lybs->offset;
+        lybs->position[lybs->used] = lybs->sub_count++;
+        ++lybs->used;
+        return 0;
+    }
+
+    /* printing, write the counted subtree length */
+    assert(lybs->sub_count < lybs->sub_size);
+    r = lyb_write_varint(lybs->sub_len[lybs->sub_count], out, lybs);
+    if (r < 0) {
+        return -1;
     }
 
-    return ly_write_skip(out, LYB_META_BYTES, &lybs->position[lybs->used - 1]);
+    lybs->written[lybs->used] = lybs->offset + lybs->sub_len[lybs->sub_count];
+    ++lybs->sub_count;
+    ++lybs->used;
+    return r;
 }
 
 static int
@@ -655,9 +632,10 @@ static int
 lyb_print_header(struct lyout *out)
 {
     int ret = 0;
-    uint8_t byte = 0;
+    uint8_t byte;
 
-    /* TODO version, some other flags? */
+    /* version, no flags */
+    byte = LYB_VERSION_2;
     ret += ly_write(out, (char *)&byte, sizeof byte);
 
     return ret;
@@ -917,6 +895,12 @@ lyb_print_schema_hash(struct lyout *out, struct lys_node *schema, struct hash_ta
     LYB_HASH hash;
     struct lys_node *first_sibling, *parent;
 
+    if (out) {
+        /* printing, the hash was found when counting the subtree lengths */
+        hash = lybs->sub_hash[lybs->sub_count - 1];
+        goto write_hash;
+    }
+
     /* create whole sibling HT if not already created and saved */
     if (!*sibling_ht) {
         /* get first schema data sibling (or input/output) */
@@ -956,7 +940,9 @@ lyb_print_schema_hash(struct lyout *out, struct lys_node *schema, struct hash_ta
     if (!hash) {
         return -1;
     }
+    lybs->sub_hash[lybs->position[lybs->used - 1]] = hash;
 
+write_hash:
     /* write the hash */
     ret += (r = lyb_write(out, &hash, sizeof hash, lybs));
     if (r < 0) {
@@ -1085,6 +1071,7 @@ lyb_print_data(struct lyout *out, const struct lyd_node *root, int options)
     struct lyb_state lybs;
 
     memset(&lybs, 0, sizeof lybs);
+    lybs.version = LYB_VERSION_2;
 
     if (root) {
         lybs.ctx = lyd_node_module(root)->ctx;
@@ -1124,6 +1111,17 @@ lyb_print_data(struct lyout *out, const struct lyd_node *root, int options)
             prev_mod = lyd_node_module(root);
         }
 
+        /* count the lengths of all the subtrees first so that each can be printed in front of its subtree */
+        lybs.sub_count = 0;
+        lybs.offset = 0;
+        r = lyb_print_subtree(NULL, root, &top_sibling_ht, &lybs, 1);
+        if (r < 0) {
+            rc = EXIT_FAILURE;
+            goto finish;
+        }
+
+        /* print the subtree */
+        lybs.sub_count = 0;
         ret += (r = lyb_print_subtree(out, root, &top_sibling_ht, &lybs, 1));
         if (r < 0) {
             rc = EXIT_FAILURE;
@@ -1144,7 +1142,8 @@ lyb_print_data(struct lyout *out, const struct lyd_node *root, int options)
 finish:
     free(lybs.written);
     free(lybs.position);
-    free(lybs.inner_chunks);
+    free(lybs.sub_len);
+    free(lybs.sub_hash);
     for (r = 0; r < lybs.sib_ht_count; ++r) {
         lyht_free(lybs.sib_ht[r].ht);
     }
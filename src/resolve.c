@@ -1169,6 +1169,9 @@ resolve_hash_table_find_equal(void *val1_p, void *val2_p, int mod, void *UNUSED(
     case LYS_LEAF:
     case LYS_ANYXML:
     case LYS_ANYDATA:
+    case LYS_RPC:
+    case LYS_ACTION:
+    case LYS_NOTIF:
         return 1;
     case LYS_LEAFLIST:
         str = ((struct lyd_node_leaf_list *)val2)->value_str;
@@ -1223,21 +1226,18 @@ resolve_hash_table_find_equal(void *val1_p, void *val2_p, int mod, void *UNUSED(
 }
 
 static struct lyd_node *
-resolve_json_data_node_hash(struct lyd_node *parent, struct parsed_pred pp)
+resolve_json_data_node_hash(struct hash_table *ht, struct parsed_pred pp)
 {
     values_equal_cb prev_cb;
     struct lyd_node **ret = NULL;
     uint32_t hash;
     int i;
 
-    assert(parent && parent->hash);
-
     /* set our value equivalence callback that does not require data nodes */
-    prev_cb = lyht_set_cb(parent->ht, resolve_hash_table_find_equal);
+    prev_cb = lyht_set_cb(ht, resolve_hash_table_find_equal);
 
     /* get the hash of the searched node */
-    hash = dict_hash_multi(0, lys_node_module(pp.schema)->name, strlen(lys_node_module(pp.schema)->name));
-    hash = dict_hash_multi(hash, pp.schema->name, strlen(pp.schema->name));
+    hash = lyd_hash_seed((struct lys_node *)pp.schema);
     if (pp.schema->nodetype == LYS_LEAFLIST) {
         assert((pp.len == 1) && (pp.pred[0].name[0] == '.') && (pp.pred[0].nam_len == 1));
         /* leaf-list value in predicate */
@@ -1251,11 +1251,11 @@ resolve_json_data_node_hash(struct lyd_node *parent, struct parsed_pred pp)
     hash = dict_hash_multi(hash, NULL, 0);
 
     /* try to find the node */
-    i = lyht_find(parent->ht, &pp, hash, (void **)&ret);
+    i = lyht_find(ht, &pp, hash, (void **)&ret);
     assert(i || *ret);
 
     /* restore the original callback */
-    lyht_set_cb(parent->ht, prev_cb);
+    lyht_set_cb(ht, prev_cb);
 
     return (i ? NULL : *ret);
 }
@@ -2607,11 +2607,13 @@ resolve_partial_json_data_list_predicate(struct parsed_pred pp, struct lyd_node
  * @param[in] llist_value If the \p nodeid identifies leaf-list, this is expected value of the leaf-list instance.
  * @param[in] options Bitmask of options flags, see @ref pathoptions.
  * @param[out] parsed Number of characters processed in \p id
+ * @param[out] all_siblings Set if the first node of an absolute path was searched for among all the top-level
+ * siblings of \p start, not only \p start and the following ones. Optional.
  * @return The closes parent (or the node itself) from the path
  */
 struct lyd_node *
 resolve_partial_json_data_nodeid(const char *nodeid, const char *llist_value, struct lyd_node *start, int options,
-                                 int *parsed)
+                                 int *parsed, int *all_siblings)
 {
     const char *id, *mod_name, *name, *data_val, *llval;
     int r, ret, mod_name_len, nam_len, is_relative = -1, list_instance_position;
@@ -2623,9 +2625,16 @@ resolve_partial_json_data_nodeid(const char *nodeid, const char *llist_value, st
     const struct lys_node *ssibling, *sparent;
     struct lys_node_list *slist;
     struct parsed_pred pp;
+#ifdef LY_ENABLED_CACHE
+    struct hash_table *sibs_ht;
+#endif
 
     assert(nodeid && start && parsed);
 
+    if (all_siblings) {
+        *all_siblings = 0;
+    }
+
     memset(&pp, 0, sizeof pp);
     ctx = start->schema->module->ctx;
     id = nodeid;
@@ -2758,10 +2767,17 @@ resolve_partial_json_data_nodeid(const char *nodeid, const char *llist_value, st
         }
 
 #ifdef LY_ENABLED_CACHE
-        /* we will not be matching keyless lists or state leaf-lists this way */
-        if (start->parent && start->parent->ht && ((pp.schema->nodetype != LYS_LIST) || ((struct lys_node_list *)pp.schema)->keys_size)
+        /* we will not be matching keyless lists, list positions, or state leaf-lists this way */
+        sibs_ht = NULL;
+        if (((pp.schema->nodetype != LYS_LIST) || (((struct lys_node_list *)pp.schema)->keys_size && !isdigit(pp.pred[0].name[0])))
                 && ((pp.schema->nodetype != LYS_LEAFLIST) || (pp.schema->flags & LYS_CONFIG_W))) {
-            sibling = resolve_json_data_node_hash(start->parent, pp);
+            sibs_ht = start->parent ? start->parent->ht : lyd_root_ht(start);
+        }
+        if (sibs_ht) {
+            sibling = resolve_json_data_node_hash(sibs_ht, pp);
+            if (!start->parent && all_siblings) {
+                *all_siblings = 1;
+            }
         } else
 #endif
         {
@@ -3833,11 +3849,17 @@ unres_data_del(struct unres_data *unres, uint32_t i)
     if (i+1 < unres->count) {
         /* we only move the data, memory is left allocated, why bother */
         memmove(&unres->node[i], &unres->node[i+1], (unres->count-(i+1)) * sizeof *unres->node);
+        if (unres->type) {
+            memmove(&unres->type[i], &unres->type[i+1], (unres->count-(i+1)) * sizeof *unres->type);
+        }
 
     /* deleting the last item */
     } else if (i == 0) {
         free(unres->node);
         unres->node = NULL;
+        free(unres->type);
+        unres->type = NULL;
+        unres->size = 0;
     }
 
     /* if there are no items after and it is not the last one, just move the counter */
@@ -6231,6 +6253,147 @@ resolve_list_keys(struct lys_node_list *list, const char *keys_str)
     return EXIT_SUCCESS;
 }
 
+#ifdef LY_ENABLED_CACHE
+#   define RESOLVE_XPATH_CACHE(compiled) (&(compiled))
+#else
+#   define RESOLVE_XPATH_CACHE(compiled) NULL
+#endif
+
+/**
+ * @brief Evaluate a schema XPath expression (must, when, leafref path). If \p compiled is set,
+ * the expression is compiled only on its first use and the compiled form is reused afterwards.
+ *
+ * @param[in] expr XPath expression in JSON format.
+ * @param[in,out] compiled Pointer to the stored compiled form of \p expr, NULL if not cached.
+ * @param[in] cur_node Current (context) data node.
+ * @param[in] cur_node_type Current (context) data node type.
+ * @param[in] local_mod Local module relative to \p expr.
+ * @param[out] set Result set.
+ * @param[in] options Evaluation options.
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on unresolved when dependency, -1 on error.
+ */
+static int
+resolve_xpath_eval(const char *expr, void **compiled, const struct lyd_node *cur_node,
+                   enum lyxp_node_type cur_node_type, const struct lys_module *local_mod, struct lyxp_set *set,
+                   int options)
+{
+    void *comp;
+
+    if (!compiled) {
+        return lyxp_eval(expr, cur_node, cur_node_type, local_mod, set, options);
+    }
+
+#ifdef LY_ENABLED_CACHE
+    /* other threads may be validating data at the same time, the compiled form must be published only when complete */
+    comp = __atomic_load_n(compiled, __ATOMIC_ACQUIRE);
+    if (!comp) {
+        /* there is no cache, build it (only once even if several threads are validating data) */
+        pthread_mutex_lock(&local_mod->ctx->cache_lock);
+        comp = *compiled;
+        if (!comp) {
+            comp = lyxp_compile_expr(local_mod->ctx, expr);
+            __atomic_store_n(compiled, comp, __ATOMIC_RELEASE);
+        }
+        pthread_mutex_unlock(&local_mod->ctx->cache_lock);
+        if (!comp) {
+            return -1;
+        }
+    }
+#else
+    comp = *compiled;
+#endif
+
+    return lyxp_eval_compiled(comp, cur_node, cur_node_type, local_mod, set, options);
+}
+
+#ifdef LY_ENABLED_CACHE
+
+/**
+ * @brief Record of the compiled must expression cache. Must restrictions are elements of public arrays,
+ * so their compiled expressions are kept in the context instead of in the restrictions.
+ */
+struct resolve_must_rec {
+    const char *expr;           /* dictionary string, referenced by the record */
+    struct lyxp_expr *exp;      /* compiled expression */
+};
+
+static int
+resolve_must_rec_equal(void *val1_p, void *val2_p, int UNUSED(mod), void *UNUSED(cb_data))
+{
+    return ((struct resolve_must_rec *)val1_p)->expr == ((struct resolve_must_rec *)val2_p)->expr;
+}
+
+/**
+ * @brief Get the compiled form of a must expression, it is compiled on its first use.
+ *
+ * @param[in] ctx Context with the cache.
+ * @param[in] expr Must expression, a dictionary string.
+ * @return Compiled expression, NULL on error.
+ */
+static struct lyxp_expr *
+resolve_must_compiled(struct ly_ctx *ctx, const char *expr)
+{
+    struct resolve_must_rec rec, *match;
+    struct lyxp_expr *exp = NULL;
+    uint32_t hash;
+
+    rec.expr = expr;
+    hash = dict_hash_multi(0, (const char *)&expr, sizeof expr);
+    hash = dict_hash_multi(hash, NULL, 0);
+
+    /* several threads may be validating data at once */
+    pthread_mutex_lock(&ctx->cache_lock);
+    if (!ctx->must_cache) {
+        ctx->must_cache = lyht_new(LYHT_MIN_SIZE, sizeof rec, resolve_must_rec_equal, NULL, 1);
+        LY_CHECK_ERR_GOTO(!ctx->must_cache, LOGMEM(ctx), unlock);
+    }
+    if (!lyht_find(ctx->must_cache, &rec, hash, (void **)&match)) {
+        exp = match->exp;
+        goto unlock;
+    }
+
+    rec.exp = lyxp_compile_expr(ctx, expr);
+    if (!rec.exp) {
+        goto unlock;
+    }
+    /* the reference keeps the string, so the same pointer always means the same expression */
+    rec.expr = lydict_insert(ctx, expr, 0);
+    if (lyht_insert(ctx->must_cache, &rec, hash, NULL) == -1) {
+        lydict_remove(ctx, rec.expr);
+        lyxp_expr_free(rec.exp);
+        goto unlock;
+    }
+    exp = rec.exp;
+
+unlock:
+    pthread_mutex_unlock(&ctx->cache_lock);
+    return exp;
+}
+
+void
+resolve_must_cache_free(struct ly_ctx *ctx)
+{
+    struct resolve_must_rec *rec;
+    uint32_t i;
+
+    if (!ctx->must_cache) {
+        return;
+    }
+
+    for (i = 0; i < ctx->must_cache->size; ++i) {
+        if (ctx->must_cache->ctrl[i] != LYHT_CTRL_EMPTY) {
+            rec = (struct resolve_must_rec *)lyht_get_rec(ctx->must_cache->recs, ctx->must_cache->rec_size, i)->val;
+            lydict_remove(ctx, rec->expr);
+            lyxp_expr_free(rec->exp);
+        }
+    }
+    lyht_free(ctx->must_cache);
+    ctx->must_cache = NULL;
+}
+
+#endif
+
 /**
  * @brief Resolve (check) all must conditions of \p node.
  * Logs directly.
@@ -6248,6 +6411,9 @@ resolve_must(struct lyd_node *node, int inout_parent, int ignore_fail)
     struct lys_restr *must;
     struct lyxp_set set;
     struct ly_ctx *ctx = node->schema->module->ctx;
+#ifdef LY_ENABLED_CACHE
+    struct lyxp_expr *exp;
+#endif
 
     assert(node);
     memset(&set, 0, sizeof set);
@@ -6303,9 +6469,16 @@ resolve_must(struct lyd_node *node, int inout_parent, int ignore_fail)
     }
 
     for (i = 0; i < must_size; ++i) {
+#ifdef LY_ENABLED_CACHE
+        exp = resolve_must_compiled(ctx, must[i].expr);
+        if (!exp || lyxp_eval_compiled(exp, node, LYXP_NODE_ELEM, lyd_node_module(node), &set, LYXP_MUST)) {
+            return -1;
+        }
+#else
         if (lyxp_eval(must[i].expr, node, LYXP_NODE_ELEM, lyd_node_module(node), &set, LYXP_MUST)) {
             return -1;
         }
+#endif
 
         lyxp_set_cast(&set, LYXP_SET_BOOLEAN, node, lyd_node_module(node), LYXP_MUST);
 
@@ -6712,8 +6885,9 @@ resolve_when(struct lyd_node *node, int ignore_fail, struct lys_when **failed_wh
     if (!(node->schema->nodetype & (LYS_NOTIF | LYS_RPC | LYS_ACTION)) && snode_get_when(node->schema)) {
         /* make the node dummy for the evaluation */
         node->validity |= LYD_VAL_INUSE;
-        rc = lyxp_eval(snode_get_when(node->schema)->cond, node, LYXP_NODE_ELEM, lyd_node_module(node),
-                       &set, LYXP_WHEN);
+        rc = resolve_xpath_eval(snode_get_when(node->schema)->cond,
+                                RESOLVE_XPATH_CACHE(snode_get_when(node->schema)->cond_compiled), node, LYXP_NODE_ELEM,
+                                lyd_node_module(node), &set, LYXP_WHEN);
         node->validity &= ~LYD_VAL_INUSE;
         if (rc) {
             if (rc == 1) {
@@ -6764,8 +6938,8 @@ resolve_when(struct lyd_node *node, int ignore_fail, struct lys_when **failed_wh
                 goto cleanup;
             }
 
-            rc = lyxp_eval(snode_get_when(sparent)->cond, ctx_node, ctx_node_type, lys_node_module(sparent),
-                           &set, LYXP_WHEN);
+            rc = resolve_xpath_eval(snode_get_when(sparent)->cond, RESOLVE_XPATH_CACHE(snode_get_when(sparent)->cond_compiled),
+                                    ctx_node, ctx_node_type, lys_node_module(sparent), &set, LYXP_WHEN);
 
             if (unlinked_nodes && ctx_node) {
                 if (resolve_when_relink_nodes(ctx_node, unlinked_nodes, ctx_node_type)) {
@@ -6817,8 +6991,9 @@ check_augment:
                 goto cleanup;
             }
 
-            rc = lyxp_eval(snode_get_when(sparent->parent)->cond, ctx_node, ctx_node_type,
-                           lys_node_module(sparent->parent), &set, LYXP_WHEN);
+            rc = resolve_xpath_eval(snode_get_when(sparent->parent)->cond,
+                                    RESOLVE_XPATH_CACHE(snode_get_when(sparent->parent)->cond_compiled), ctx_node,
+                                    ctx_node_type, lys_node_module(sparent->parent), &set, LYXP_WHEN);
 
             /* reconnect nodes, if ctx_node is NULL then all the nodes were unlinked, but linked together,
              * so the tree did not actually change and there is nothing for us to do
@@ -7981,17 +8156,236 @@ error:
     return -1;
 }
 
+/**
+ * @brief Record of the leafref target index, one for every (target schema node, value) pair.
+ */
+struct lref_index_rec {
+    const struct lys_node *schema;
+    const char *value;        /* dictionary string so it can be compared by pointer */
+    struct lyd_node *node;    /* first instance in the data tree */
+};
+
+static uint32_t
+lref_index_hash(const struct lys_node *schema, const char *value)
+{
+    uint32_t hash;
+
+    hash = dict_hash_multi(0, (const char *)&schema, sizeof schema);
+    hash = dict_hash_multi(hash, (const char *)&value, sizeof value);
+    return dict_hash_multi(hash, NULL, 0);
+}
+
+static int
+lref_index_rec_equal(void *val1_p, void *val2_p, int UNUSED(mod), void *UNUSED(cb_data))
+{
+    struct lref_index_rec *rec1 = val1_p, *rec2 = val2_p;
+
+    return (rec1->schema == rec2->schema) && (rec1->value == rec2->value);
+}
+
+static int
+lref_index_snode_equal(void *val1_p, void *val2_p, int UNUSED(mod), void *UNUSED(cb_data))
+{
+    return *(struct lys_node **)val1_p == *(struct lys_node **)val2_p;
+}
+
+/**
+ * @brief Learn whether a leafref can be resolved using the leafref target index. It is possible only
+ * if its path selects all the instances of the target, which means it is absolute and without predicates.
+ *
+ * @param[in] sleaf Schema leafref leaf(-list).
+ * @return non-zero if the index can be used, 0 otherwise.
+ */
+static int
+lref_index_applicable(const struct lys_node_leaf *sleaf)
+{
+    const char *path = sleaf->type.info.lref.path;
+
+    if ((sleaf->type.base != LY_TYPE_LEAFREF) || !sleaf->type.info.lref.target) {
+        return 0;
+    }
+
+    return (path[0] == '/') && !strchr(path, '[');
+}
+
+/**
+ * @brief Add a schema node into the set of indexed schema nodes.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int
+lref_index_add_snode(struct lref_index *lref_idx, const struct lys_node *snode)
+{
+    uint32_t hash;
+
+    hash = dict_hash_multi(0, (const char *)&snode, sizeof snode);
+    hash = dict_hash_multi(hash, NULL, 0);
+    return (lyht_insert(lref_idx->snodes, &snode, hash, NULL) == -1) ? -1 : 0;
+}
+
+static int
+lref_index_has_snode(struct lref_index *lref_idx, const struct lys_node *snode)
+{
+    uint32_t hash;
+
+    hash = dict_hash_multi(0, (const char *)&snode, sizeof snode);
+    hash = dict_hash_multi(hash, NULL, 0);
+    return !lyht_find(lref_idx->snodes, &snode, hash, NULL);
+}
+
+/**
+ * @brief Free leafref target index content.
+ *
+ * @param[in] lref_idx Index to clear.
+ */
+static void
+lref_index_clear(struct lref_index *lref_idx)
+{
+    lyht_free(lref_idx->snodes);
+    lyht_free(lref_idx->recs);
+    memset(lref_idx, 0, sizeof *lref_idx);
+}
+
+/**
+ * @brief Build the leafref target index for all the applicable leafrefs in unres. All the instances
+ * of their target nodes are found in a single pass of the data tree so that resolving each leafref
+ * is then just a hash table lookup instead of an XPath evaluation and a scan of all the target instances.
+ *
+ * @param[in] unres Unres data structure with the leafrefs to resolve.
+ * @param[out] lref_idx Index to build. If no leafrefs benefit from it, it is left empty.
+ * @return 0 on success, -1 on error.
+ */
+static int
+lref_index_build(struct unres_data *unres, struct lref_index *lref_idx)
+{
+    struct lyd_node *root = NULL, *iter, *next, *elem;
+    const struct lys_node *snode, *sparent;
+    struct lys_node_leaf *sleaf;
+    struct lref_index_rec rec;
+    uint32_t i, count = 0;
+
+    memset(lref_idx, 0, sizeof *lref_idx);
+
+    for (i = 0; i < unres->count; ++i) {
+        if ((unres->type[i] == UNRES_LEAFREF) && lref_index_applicable((struct lys_node_leaf *)unres->node[i]->schema)) {
+            ++count;
+            if (!root) {
+                root = unres->node[i];
+            }
+        }
+    }
+    if (count < LREF_INDEX_MIN_COUNT) {
+        /* evaluating the few paths is cheaper than traversing the whole data tree */
+        return 0;
+    }
+
+    lref_idx->snodes = lyht_new(8, sizeof snode, lref_index_snode_equal, NULL, 1);
+    LY_CHECK_ERR_GOTO(!lref_idx->snodes, LOGMEM(NULL), error);
+    lref_idx->recs = lyht_new(LYHT_MIN_SIZE, sizeof rec, lref_index_rec_equal, NULL, 1);
+    LY_CHECK_ERR_GOTO(!lref_idx->recs, LOGMEM(NULL), error);
+
+    /* remember the targets and their top-level data schema ancestors so that only the relevant top-level subtrees
+     * are traversed, the ancestors are never leaves so they cannot be mistaken for targets */
+    for (i = 0; i < unres->count; ++i) {
+        if (unres->type[i] != UNRES_LEAFREF) {
+            continue;
+        }
+        sleaf = (struct lys_node_leaf *)unres->node[i]->schema;
+        if (!lref_index_applicable(sleaf) || lref_index_has_snode(lref_idx, (struct lys_node *)sleaf->type.info.lref.target)) {
+            continue;
+        }
+
+        /* uses, choice and case have no data instances, skip them */
+        snode = (struct lys_node *)sleaf->type.info.lref.target;
+        for (sparent = lys_parent(snode); sparent; sparent = lys_parent(sparent)) {
+            if (!(sparent->nodetype & (LYS_USES | LYS_CHOICE | LYS_CASE))) {
+                snode = sparent;
+            }
+        }
+        if (lref_index_add_snode(lref_idx, (struct lys_node *)sleaf->type.info.lref.target)
+                || lref_index_add_snode(lref_idx, snode)) {
+            goto error;
+        }
+    }
+
+    /* the same root as used for XPath evaluation of an absolute path, all the unres nodes are in a single data tree */
+    for (; root->parent; root = root->parent);
+    for (; root->prev->next; root = root->prev);
+
+    LY_TREE_FOR(root, iter) {
+        if (!lref_index_has_snode(lref_idx, iter->schema)) {
+            continue;
+        }
+
+        LY_TREE_DFS_BEGIN(iter, next, elem) {
+            if ((elem->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST)) && lref_index_has_snode(lref_idx, elem->schema)) {
+                rec.schema = elem->schema;
+                rec.value = ((struct lyd_node_leaf_list *)elem)->value_str;
+                rec.node = elem;
+                /* only the first instance is stored, the same one XPath evaluation would find */
+                if (lyht_insert(lref_idx->recs, &rec, lref_index_hash(rec.schema, rec.value), NULL) == -1) {
+                    goto error;
+                }
+            }
+            LY_TREE_DFS_END(iter, next, elem);
+        }
+    }
+
+    return 0;
+
+error:
+    lref_index_clear(lref_idx);
+    return -1;
+}
+
+/**
+ * @brief Find the target of a leafref in the leafref target index.
+ *
+ * @param[in] lref_idx Leafref target index.
+ * @param[in] leaf Leafref data node.
+ * @param[out] ret Found target, NULL if there is none.
+ * @return 0 if the index was used, 1 if the leafref must be resolved by evaluating its path.
+ */
+static int
+lref_index_find(struct lref_index *lref_idx, struct lyd_node_leaf_list *leaf, struct lyd_node **ret)
+{
+    struct lys_node_leaf *sleaf = (struct lys_node_leaf *)leaf->schema;
+    struct lref_index_rec rec, *match;
+
+    if (!lref_idx || !lref_idx->recs || !lref_index_applicable(sleaf)) {
+        return 1;
+    }
+
+    rec.schema = (struct lys_node *)sleaf->type.info.lref.target;
+    rec.value = leaf->value_str;
+    rec.node = NULL;
+    if (!lyht_find(lref_idx->recs, &rec, lref_index_hash(rec.schema, rec.value), (void **)&match)) {
+        *ret = match->node;
+    } else {
+        *ret = NULL;
+    }
+    return 0;
+}
+
 static int
-resolve_leafref(struct lyd_node_leaf_list *leaf, const char *path, int req_inst, struct lyd_node **ret)
+resolve_leafref(struct lyd_node_leaf_list *leaf, struct lys_type_info_lref *lref, int req_inst,
+                struct lref_index *lref_idx, struct lyd_node **ret)
 {
     struct lyxp_set xp_set;
+    const char *path = lref->path;
     uint32_t i;
 
     memset(&xp_set, 0, sizeof xp_set);
     *ret = NULL;
 
+    if (!lref_index_find(lref_idx, leaf, ret)) {
+        /* resolved using the index */
+        goto finish;
+    }
+
     /* syntax was already checked, so just evaluate the path using standard XPath */
-    if (lyxp_eval(path, (struct lyd_node *)leaf, LYXP_NODE_ELEM, lyd_node_module((struct lyd_node *)leaf), &xp_set, 0) != EXIT_SUCCESS) {
+    if (resolve_xpath_eval(path, RESOLVE_XPATH_CACHE(lref->path_compiled), (struct lyd_node *)leaf, LYXP_NODE_ELEM,
+                           lyd_node_module((struct lyd_node *)leaf), &xp_set, 0) != EXIT_SUCCESS) {
         return -1;
     }
 
@@ -8013,6 +8407,7 @@ resolve_leafref(struct lyd_node_leaf_list *leaf, const char *path, int req_inst,
 
     lyxp_set_cast(&xp_set, LYXP_SET_EMPTY, (struct lyd_node *)leaf, NULL, 0);
 
+finish:
     if (!*ret) {
         /* reference not found */
         if (req_inst > -1) {
@@ -8067,7 +8462,7 @@ resolve_union(struct lyd_node_leaf_list *leaf, struct lys_type *type, int store,
                 req_inst = t->info.lref.req;
             }
 
-            if (!resolve_leafref(leaf, t->info.lref.path, req_inst, &ret)) {
+            if (!resolve_leafref(leaf, &t->info.lref, req_inst, NULL, &ret)) {
                 if (store) {
                     if (ret && !(leaf->schema->flags & LYS_LEAFREF_DEP)) {
                         /* valid resolved */
@@ -8175,11 +8570,13 @@ resolve_union(struct lyd_node_leaf_list *leaf, struct lys_type *type, int store,
  * @param[in] node Data node to resolve.
  * @param[in] type Type of the unresolved item.
  * @param[in] ignore_fail 0 - no, 1 - yes, 2 - yes, but only for external dependencies.
+ * @param[in] lref_idx Optional leafref target index to use for resolving leafrefs.
  *
  * @return EXIT_SUCCESS on success, EXIT_FAILURE on forward reference, -1 on error.
  */
 int
-resolve_unres_data_item(struct lyd_node *node, enum UNRES_ITEM type, int ignore_fail, struct lys_when **failed_when)
+resolve_unres_data_item(struct lyd_node *node, enum UNRES_ITEM type, int ignore_fail, struct lref_index *lref_idx,
+                        struct lys_when **failed_when)
 {
     int rc, req_inst, ext_dep;
     struct lyd_node_leaf_list *leaf;
@@ -8203,7 +8600,7 @@ resolve_unres_data_item(struct lyd_node *node, enum UNRES_ITEM type, int ignore_
             rc = 0;
             ret = NULL;
         } else {
-            rc = resolve_leafref(leaf, sleaf->type.info.lref.path, req_inst, &ret);
+            rc = resolve_leafref(leaf, &sleaf->type.info.lref, req_inst, lref_idx, &ret);
         }
         if (!rc) {
             if (ret && !(leaf->schema->flags & LYS_LEAFREF_DEP)) {
@@ -8300,6 +8697,29 @@ resolve_unres_data_item(struct lyd_node *node, enum UNRES_ITEM type, int ignore_
     return EXIT_SUCCESS;
 }
 
+int
+unres_data_reserve(struct unres_data *unres, uint32_t count)
+{
+    uint32_t size;
+
+    if (unres->count + count <= unres->size) {
+        return 0;
+    }
+
+    size = unres->size ? unres->size : UNRES_DATA_MIN_SIZE;
+    while (size < unres->count + count) {
+        size *= 2;
+    }
+
+    unres->node = ly_realloc(unres->node, size * sizeof *unres->node);
+    LY_CHECK_ERR_RETURN(!unres->node, LOGMEM(NULL), -1);
+    unres->type = ly_realloc(unres->type, size * sizeof *unres->type);
+    LY_CHECK_ERR_RETURN(!unres->type, LOGMEM(NULL), -1);
+    unres->size = size;
+
+    return 0;
+}
+
 /**
  * @brief add data unres item
  *
@@ -8315,13 +8735,46 @@ unres_data_add(struct unres_data *unres, struct lyd_node *node, enum UNRES_ITEM
     assert((type == UNRES_LEAFREF) || (type == UNRES_INSTID) || (type == UNRES_WHEN) || (type == UNRES_MUST)
            || (type == UNRES_MUST_INOUT) || (type == UNRES_UNION) || (type == UNRES_UNIQ_LEAVES));
 
+    if (unres_data_reserve(unres, 1)) {
+        return -1;
+    }
+    unres->node[unres->count] = node;
+    unres->type[unres->count] = type;
     unres->count++;
-    unres->node = ly_realloc(unres->node, unres->count * sizeof *unres->node);
-    LY_CHECK_ERR_RETURN(!unres->node, LOGMEM(NULL), -1);
-    unres->node[unres->count - 1] = node;
-    unres->type = ly_realloc(unres->type, unres->count * sizeof *unres->type);
-    LY_CHECK_ERR_RETURN(!unres->type, LOGMEM(NULL), -1);
-    unres->type[unres->count - 1] = type;
+
+    return 0;
+}
+
+static int
+unres_data_ptr_equal(void *val1_p, void *val2_p, int UNUSED(mod), void *UNUSED(cb_data))
+{
+    return *(void **)val1_p == *(void **)val2_p;
+}
+
+static uint32_t
+unres_data_ptr_hash(const void *ptr)
+{
+    uint32_t hash;
+
+    hash = dict_hash_multi(0, (const char *)&ptr, sizeof ptr);
+    return dict_hash_multi(hash, NULL, 0);
+}
+
+/**
+ * @brief Learn whether a data node is in one of the subtrees to be auto-deleted.
+ *
+ * @param[in] del_roots Roots of the subtrees to be deleted.
+ * @param[in] node Data node to check.
+ * @return 1 if it will be deleted, 0 if not.
+ */
+static int
+unres_data_deleted(struct hash_table *del_roots, struct lyd_node *node)
+{
+    for (; node; node = node->parent) {
+        if (!lyht_find(del_roots, &node, unres_data_ptr_hash(node), NULL)) {
+            return 1;
+        }
+    }
 
     return 0;
 }
@@ -8381,6 +8834,245 @@ resolve_unres_data_autodel_diff(struct unres_data *unres, uint32_t unres_i)
     unres->node[unres_i] = NULL;
 }
 
+/**
+ * @brief Unres data items resolved in parallel. The items are grouped by the schema node of their top-level
+ * data node so that all the data accessed by a group are accessed only by its own task.
+ */
+struct unres_par {
+    struct unres_data *unres;
+    uint32_t *items;            /* indices of the unres items resolved in parallel, in groups */
+    uint32_t *groups;           /* index of the first item of each group in items, the last is the item count */
+    uint32_t group_count;
+    uint32_t *resolved;         /* number of items resolved by each group */
+    uint32_t *serial;           /* indices of the unres items accessing other top-level subtrees */
+    uint32_t serial_count;
+    enum UNRES_ITEM type;       /* type of the items to resolve, UNRES_RESOLVED for any type */
+    int ignore_fail;
+    struct lref_index *lref_idx;
+};
+
+struct unres_par_snode {
+    const struct lys_node *snode;
+    int local;
+};
+
+static int
+unres_par_snode_equal(void *val1_p, void *val2_p, int UNUSED(mod), void *UNUSED(cb_data))
+{
+    return ((struct unres_par_snode *)val1_p)->snode == ((struct unres_par_snode *)val2_p)->snode;
+}
+
+/**
+ * @brief Get the schema node of the top-level data node the instances of a schema node are in.
+ */
+static const struct lys_node *
+unres_par_data_top(const struct lys_node *snode)
+{
+    const struct lys_node *top = NULL;
+
+    for (; snode; snode = lys_parent(snode)) {
+        if (snode->nodetype & (LYS_CONTAINER | LYS_LIST | LYS_LEAF | LYS_LEAFLIST | LYS_ANYDATA)) {
+            top = snode;
+        }
+    }
+
+    return top;
+}
+
+/**
+ * @brief Learn whether an unres item accesses only the data in its own top-level subtree.
+ *
+ * @param[in] node Unres data node.
+ * @param[in] type Unres item type.
+ * @param[in] top Schema node of the top-level data node of \p node.
+ * @param[in] must_cache Cache of the must results by the schema nodes (struct unres_par_snode).
+ * @return 1 if local, 0 if not, -1 on error.
+ */
+static int
+unres_par_local(struct lyd_node *node, enum UNRES_ITEM type, const struct lys_node *top, struct hash_table *must_cache)
+{
+    struct lys_node_leaf *sleaf = (struct lys_node_leaf *)node->schema;
+    struct unres_par_snode rec, *match;
+    struct lyxp_set set;
+    enum int_log_opts prev_ilo;
+    uint32_t i, hash;
+
+    switch (type) {
+    case UNRES_UNIQ_LEAVES:
+        /* all the list instances are in the same group */
+        return 1;
+    case UNRES_LEAFREF:
+        if (sleaf->flags & LYS_LEAFREF_DEP) {
+            return 0;
+        }
+        return unres_par_data_top((struct lys_node *)sleaf->type.info.lref.target) == top;
+    case UNRES_MUST:
+        break;
+    default:
+        /* instance-identifiers can point anywhere, when conditions are resolved before */
+        return 0;
+    }
+
+    rec.snode = node->schema;
+    hash = unres_data_ptr_hash(rec.snode);
+    if (!lyht_find(must_cache, &rec, hash, (void **)&match)) {
+        return match->local;
+    }
+
+    /* the schema was already checked, so it can only fail on memory allocation */
+    ly_ilo_change(NULL, ILO_IGNORE, &prev_ilo, NULL);
+    rec.local = !lyxp_node_atomize(node->schema, &set, 0);
+    ly_ilo_restore(NULL, prev_ilo, NULL, 0);
+    for (i = 0; rec.local && (i < set.used); ++i) {
+        if ((set.val.snodes[i].type == LYXP_NODE_ELEM) && (unres_par_data_top(set.val.snodes[i].snode) != top)) {
+            rec.local = 0;
+        }
+    }
+    free(set.val.snodes);
+
+    if (lyht_insert(must_cache, &rec, hash, NULL) == -1) {
+        return -1;
+    }
+    return rec.local;
+}
+
+static void
+unres_par_clear(struct unres_par *par)
+{
+    free(par->items);
+    free(par->groups);
+    free(par->resolved);
+    free(par->serial);
+    memset(par, 0, sizeof *par);
+}
+
+/**
+ * @brief Group the unres items that can be resolved in parallel.
+ *
+ * @param[in] ctx Context to use.
+ * @param[in] unres Unres data structure with the items.
+ * @param[in] ignore_fail Whether to ignore failures, passed to resolve_unres_data_item().
+ * @param[out] par Parallel items, no groups if there is nothing to be gained.
+ * @return 0 on success, -1 on error.
+ */
+static int
+unres_par_build(struct ly_ctx *ctx, struct unres_data *unres, int ignore_fail, struct unres_par *par)
+{
+    struct hash_table *must_cache = NULL;
+    struct ly_set *tops = NULL;
+    struct lyd_node *root;
+    uint32_t i, *group_idx = NULL, item_count = 0;
+    int local, idx = -1;
+
+    memset(par, 0, sizeof *par);
+    par->unres = unres;
+    par->ignore_fail = ignore_fail;
+
+    must_cache = lyht_new(8, sizeof(struct unres_par_snode), unres_par_snode_equal, NULL, 1);
+    tops = ly_set_new();
+    group_idx = malloc(unres->count * sizeof *group_idx);
+    par->serial = malloc(unres->count * sizeof *par->serial);
+    LY_CHECK_ERR_GOTO(!must_cache || !tops || !group_idx || !par->serial, LOGMEM(ctx), error);
+
+    for (i = 0; i < unres->count; ++i) {
+        group_idx[i] = UINT32_MAX;
+        if ((unres->type[i] == UNRES_RESOLVED) || (unres->type[i] == UNRES_WHEN) || (unres->type[i] == UNRES_DELETE)) {
+            continue;
+        }
+
+        for (root = unres->node[i]; root->parent; root = root->parent);
+        local = unres_par_local(unres->node[i], unres->type[i], root->schema, must_cache);
+        if (local == -1) {
+            LOGMEM(ctx);
+            goto error;
+        } else if (!local) {
+            par->serial[par->serial_count++] = i;
+            continue;
+        }
+
+        if ((idx == -1) || (tops->set.s[idx] != root->schema)) {
+            idx = ly_set_add(tops, root->schema, 0);
+            if (idx == -1) {
+                goto error;
+            }
+        }
+        group_idx[i] = idx;
+        ++item_count;
+    }
+
+    if (tops->number > 1) {
+        par->group_count = tops->number;
+        par->groups = calloc(par->group_count + 1, sizeof *par->groups);
+        par->resolved = calloc(par->group_count, sizeof *par->resolved);
+        par->items = malloc(item_count * sizeof *par->items);
+        LY_CHECK_ERR_GOTO(!par->groups || !par->resolved || !par->items, LOGMEM(ctx), error);
+
+        /* counting sort keeping the original order of the items in each group */
+        for (i = 0; i < unres->count; ++i) {
+            if (group_idx[i] != UINT32_MAX) {
+                ++par->groups[group_idx[i] + 1];
+            }
+        }
+        for (i = 0; i < par->group_count; ++i) {
+            par->groups[i + 1] += par->groups[i];
+        }
+        for (i = 0; i < unres->count; ++i) {
+            if (group_idx[i] != UINT32_MAX) {
+                par->items[par->groups[group_idx[i]]++] = i;
+            }
+        }
+        for (i = par->group_count; i > 0; --i) {
+            par->groups[i] = par->groups[i - 1];
+        }
+        par->groups[0] = 0;
+    } else {
+        /* nothing to parallelize */
+        unres_par_clear(par);
+    }
+
+    free(group_idx);
+    ly_set_free(tops);
+    lyht_free(must_cache);
+    return 0;
+
+error:
+    free(group_idx);
+    ly_set_free(tops);
+    lyht_free(must_cache);
+    unres_par_clear(par);
+    return -1;
+}
+
+/**
+ * @brief Resolve the unres items of a single group, callback for ly_par_run().
+ */
+static int
+unres_par_task(void *arg, uint32_t group)
+{
+    struct unres_par *par = (struct unres_par *)arg;
+    struct unres_data *unres = par->unres;
+    uint32_t i, j;
+    int rc;
+
+    for (j = par->groups[group]; j < par->groups[group + 1]; ++j) {
+        i = par->items[j];
+        if ((unres->type[i] == UNRES_RESOLVED) || ((par->type != UNRES_RESOLVED) && (unres->type[i] != par->type))) {
+            continue;
+        }
+
+        rc = resolve_unres_data_item(unres->node[i], unres->type[i], par->ignore_fail, par->lref_idx, NULL);
+        if (!rc) {
+            unres->type[i] = UNRES_RESOLVED;
+            ++par->resolved[group];
+        } else if ((rc == -1) || (par->type != UNRES_LEAFREF)) {
+            /* a forward reference is an error except for leafrefs referencing other leafrefs */
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
 /**
  * @brief Resolve every unres data item in the structure. Logs directly.
  *
@@ -8400,7 +9092,7 @@ resolve_unres_data_autodel_diff(struct unres_data *unres, uint32_t unres_i)
 int
 resolve_unres_data(struct ly_ctx *ctx, struct unres_data *unres, struct lyd_node **root, int options)
 {
-    uint32_t i, j, first, resolved, del_items, stmt_count;
+    uint32_t i, j, k, resolved, del_items, stmt_count, *pending = NULL, pending_count;
     uint8_t prev_when_status;
     int rc, progress, ignore_fail;
     enum int_log_opts prev_ilo;
@@ -8408,15 +9100,21 @@ resolve_unres_data(struct ly_ctx *ctx, struct unres_data *unres, struct lyd_node
     LY_ERR prev_ly_errno = ly_errno;
     struct lyd_node *parent;
     struct lys_when *when;
+    struct lref_index lref_idx;
+    struct unres_par par;
+    struct hash_table *del_roots = NULL;
 
     assert(root);
     assert(unres);
 
+    memset(&lref_idx, 0, sizeof lref_idx);
+    memset(&par, 0, sizeof par);
+
     if (!unres->count) {
         return EXIT_SUCCESS;
     }
 
-    if (options & (LYD_OPT_NOTIF_FILTER | LYD_OPT_GET | LYD_OPT_GETCONFIG | LYD_OPT_EDIT)) {
+    if (options & (LYD_OPT_NOTIF_FILTER | LYD_OPT_GET | LYD_OPT_GETCONFIG | LYD_OPT_EDIT | LYD_OPT_LYB_FILTER)) {
         ignore_fail = 1;
     } else if (options & LYD_OPT_NOEXTDEPS) {
         ignore_fail = 2;
@@ -8433,23 +9131,28 @@ resolve_unres_data(struct ly_ctx *ctx, struct unres_data *unres, struct lyd_node
     /*
      * when-stmt first
      */
-    first = 1;
-    stmt_count = 0;
-    resolved = 0;
+    pending = malloc(unres->count * sizeof *pending);
+    LY_CHECK_ERR_GOTO(!pending, LOGMEM(ctx), error);
+    pending_count = 0;
+    for (i = 0; i < unres->count; i++) {
+        if (unres->type[i] == UNRES_WHEN) {
+            pending[pending_count++] = i;
+        }
+    }
     del_items = 0;
     do {
         if (!ignore_fail) {
             ly_err_free_next(ctx, prev_eitem);
         }
         progress = 0;
-        for (i = 0; i < unres->count; i++) {
-            if (unres->type[i] != UNRES_WHEN) {
+        /* only the items not yet resolved are visited again */
+        for (k = 0, j = 0; k < pending_count; k++) {
+            i = pending[k];
+            if (del_items && unres_data_deleted(del_roots, unres->node[i])) {
+                /* the node is in a subtree to be deleted, it will be removed anyway */
+                unres->type[i] = UNRES_RESOLVED;
                 continue;
             }
-            if (first) {
-                /* count when-stmt nodes in unres list */
-                stmt_count++;
-            }
 
             /* resolve when condition only when all parent when conditions are already resolved */
             for (parent = unres->node[i]->parent;
@@ -8461,16 +9164,18 @@ resolve_unres_data(struct ly_ctx *ctx, struct unres_data *unres, struct lyd_node
                      */
                     unres->node[i]->when_status |= LYD_WHEN_FALSE;
                     unres->type[i] = UNRES_RESOLVED;
-                    resolved++;
                     break;
                 }
             }
             if (parent) {
+                if (unres->type[i] != UNRES_RESOLVED) {
+                    pending[j++] = i;
+                }
                 continue;
             }
 
             prev_when_status = unres->node[i]->when_status;
-            rc = resolve_unres_data_item(unres->node[i], unres->type[i], ignore_fail, &when);
+            rc = resolve_unres_data_item(unres->node[i], unres->type[i], ignore_fail, NULL, &when);
             if (!rc) {
                 /* finish with error/delete the node only if when was changed from true to false, an external
                  * dependency was not required, or it was not provided (the flag would not be passed down otherwise,
@@ -8510,21 +9215,13 @@ resolve_unres_data(struct ly_ctx *ctx, struct unres_data *unres, struct lyd_node
                     unres->type[i] = UNRES_DELETE;
                     del_items++;
 
-                    /* update the rest of unres items */
-                    for (j = 0; j < unres->count; j++) {
-                        if (unres->type[j] == UNRES_RESOLVED || unres->type[j] == UNRES_DELETE) {
-                            continue;
-                        }
-
-                        /* test if the node is in subtree to be deleted */
-                        for (parent = unres->node[j]; parent; parent = parent->parent) {
-                            if (parent == unres->node[i]) {
-                                /* yes, it is */
-                                unres->type[j] = UNRES_RESOLVED;
-                                resolved++;
-                                break;
-                            }
-                        }
+                    /* the rest of unres items in the subtree are skipped */
+                    if (!del_roots) {
+                        del_roots = lyht_new(LYHT_MIN_SIZE, sizeof parent, unres_data_ptr_equal, NULL, 1);
+                        LY_CHECK_ERR_GOTO(!del_roots, LOGMEM(ctx), error);
+                    }
+                    if (lyht_insert(del_roots, &parent, unres_data_ptr_hash(parent), NULL) == -1) {
+                        goto error;
                     }
                 } else {
                     unres->type[i] = UNRES_RESOLVED;
@@ -8532,22 +9229,35 @@ resolve_unres_data(struct ly_ctx *ctx, struct unres_data *unres, struct lyd_node
                 if (!ignore_fail) {
                     ly_err_free_next(ctx, prev_eitem);
                 }
-                resolved++;
                 progress = 1;
             } else if (rc == -1) {
                 goto error;
-            } /* else forward reference */
+            } else {
+                /* forward reference */
+                pending[j++] = i;
+            }
         }
-        first = 0;
-    } while (progress && resolved < stmt_count);
+        pending_count = j;
+    } while (progress && pending_count);
 
     /* do we have some unresolved when-stmt? */
-    if (stmt_count > resolved) {
+    if (pending_count) {
         goto error;
     }
 
+    if (del_items) {
+        /* we had some when-stmt resulted to false, so now we have to sanitize the unres list,
+         * the items in the subtrees to be deleted are not resolved at all */
+        for (i = 0; i < unres->count; i++) {
+            if ((unres->type[i] != UNRES_RESOLVED) && (unres->type[i] != UNRES_DELETE)
+                    && unres_data_deleted(del_roots, unres->node[i])) {
+                unres->type[i] = UNRES_RESOLVED;
+            }
+        }
+        lyht_free(del_roots);
+        del_roots = NULL;
+    }
     for (i = 0; del_items && i < unres->count; i++) {
-        /* we had some when-stmt resulted to false, so now we have to sanitize the unres list */
         if (unres->type[i] != UNRES_DELETE) {
             continue;
         }
@@ -8578,21 +9288,54 @@ resolve_unres_data(struct ly_ctx *ctx, struct unres_data *unres, struct lyd_node
         ly_ilo_restore(ctx, prev_ilo, prev_eitem, 0);
         ly_errno = prev_ly_errno;
     }
-    first = 1;
+    if (lref_index_build(unres, &lref_idx)) {
+        goto error;
+    }
+    if ((options & LYD_OPT_VAL_PARALLEL) && !(options & (LYD_OPT_TYPEMASK & ~LYD_OPT_CONFIG))
+            && !(options & LYD_OPT_TRUSTED) && (unres->count >= UNRES_PAR_MIN_COUNT) && (ly_par_threads(ctx) > 1)) {
+        /* resolve the items of independent top-level subtrees in parallel, the rest serially */
+        if (unres_par_build(ctx, unres, ignore_fail, &par)) {
+            goto error;
+        }
+        par.lref_idx = &lref_idx;
+    }
     stmt_count = 0;
+    for (i = 0; i < unres->count; i++) {
+        if (unres->type[i] == UNRES_LEAFREF) {
+            /* count leafref nodes in unres list */
+            stmt_count++;
+        }
+    }
+    pending_count = 0;
+    for (k = 0; k < (par.group_count ? par.serial_count : unres->count); k++) {
+        i = par.group_count ? par.serial[k] : k;
+        if (unres->type[i] == UNRES_LEAFREF) {
+            pending[pending_count++] = i;
+        }
+    }
     resolved = 0;
     do {
         progress = 0;
-        for (i = 0; i < unres->count; i++) {
-            if (unres->type[i] != UNRES_LEAFREF) {
-                continue;
+        if (par.group_count) {
+            par.type = UNRES_LEAFREF;
+            memset(par.resolved, 0, par.group_count * sizeof *par.resolved);
+            if (ly_par_run(ctx, par.group_count, unres_par_task, &par)) {
+                goto error;
             }
-            if (first) {
-                /* count leafref nodes in unres list */
-                stmt_count++;
+            for (k = 0; k < par.group_count; ++k) {
+                resolved += par.resolved[k];
+                if (par.resolved[k]) {
+                    progress = 1;
+                }
+            }
+            if (progress && !ignore_fail) {
+                ly_err_free_next(ctx, prev_eitem);
             }
+        }
 
-            rc = resolve_unres_data_item(unres->node[i], unres->type[i], ignore_fail, NULL);
+        for (k = 0, j = 0; k < pending_count; k++) {
+            i = pending[k];
+            rc = resolve_unres_data_item(unres->node[i], unres->type[i], ignore_fail, &lref_idx, NULL);
             if (!rc) {
                 unres->type[i] = UNRES_RESOLVED;
                 if (!ignore_fail) {
@@ -8602,10 +9345,17 @@ resolve_unres_data(struct ly_ctx *ctx, struct unres_data *unres, struct lyd_node
                 progress = 1;
             } else if (rc == -1) {
                 goto error;
-            } /* else forward reference */
+            } else {
+                /* forward reference */
+                pending[j++] = i;
+            }
         }
-        first = 0;
+        pending_count = j;
     } while (progress && resolved < stmt_count);
+    free(pending);
+    pending = NULL;
+    lref_index_clear(&lref_idx);
+    par.lref_idx = NULL;
 
     /* do we have some unresolved leafrefs? */
     if (stmt_count > resolved) {
@@ -8621,13 +9371,21 @@ resolve_unres_data(struct ly_ctx *ctx, struct unres_data *unres, struct lyd_node
     /*
      * rest
      */
+    if (par.group_count) {
+        par.type = UNRES_RESOLVED;
+        rc = ly_par_run(ctx, par.group_count, unres_par_task, &par);
+        unres_par_clear(&par);
+        if (rc) {
+            return -1;
+        }
+    }
     for (i = 0; i < unres->count; ++i) {
         if (unres->type[i] == UNRES_RESOLVED) {
             continue;
         }
         assert(!(options & LYD_OPT_TRUSTED) || ((unres->type[i] != UNRES_MUST) && (unres->type[i] != UNRES_MUST_INOUT)));
 
-        rc = resolve_unres_data_item(unres->node[i], unres->type[i], ignore_fail, NULL);
+        rc = resolve_unres_data_item(unres->node[i], unres->type[i], ignore_fail, NULL, NULL);
         if (rc) {
             /* since when was already resolved, a forward reference is an error */
             return -1;
@@ -8641,6 +9399,10 @@ resolve_unres_data(struct ly_ctx *ctx, struct unres_data *unres, struct lyd_node
     return EXIT_SUCCESS;
 
 error:
+    free(pending);
+    lyht_free(del_roots);
+    lref_index_clear(&lref_idx);
+    unres_par_clear(&par);
     if (!ignore_fail) {
         /* print all the new errors */
         ly_ilo_restore(ctx, prev_ilo, prev_eitem, 1);
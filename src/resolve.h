@@ -93,6 +93,7 @@ struct unres_data {
     struct lyd_node **node;
     enum UNRES_ITEM *type;
     uint32_t count;
+    uint32_t size;              /* allocated items of node and type, they grow geometrically */
 
     int store_diff;
     struct lyd_difflist *diff;
@@ -100,6 +101,34 @@ struct unres_data {
     unsigned int diff_idx;
 };
 
+/** initial number of allocated unres data items */
+#define UNRES_DATA_MIN_SIZE 16
+
+/** minimal number of leafrefs to resolve for the leafref target index to be built */
+#define LREF_INDEX_MIN_COUNT 8
+
+/** minimal number of unres data items to resolve them in parallel (#LYD_OPT_VAL_PARALLEL) */
+#define UNRES_PAR_MIN_COUNT 64
+
+#ifdef LY_ENABLED_CACHE
+
+/**
+ * @brief Free the compiled must expressions of a context.
+ *
+ * @param[in] ctx Context with the cache.
+ */
+void resolve_must_cache_free(struct ly_ctx *ctx);
+
+#endif
+
+/**
+ * @brief Leafref target index used while resolving unres DATA leafrefs
+ */
+struct lref_index {
+    struct hash_table *snodes;  /* indexed target schema nodes and their top-level ancestors (struct lys_node *) */
+    struct hash_table *recs;    /* target instances (struct lref_index_rec) */
+};
+
 /**
  * @brief Unresolved items in a SCHEMA
  */
@@ -184,7 +213,7 @@ int resolve_absolute_schema_nodeid(const char *nodeid, const struct lys_module *
 const struct lys_node *resolve_json_nodeid(const char *nodeid, const struct ly_ctx *ctx, const struct lys_node *start, int output);
 
 struct lyd_node *resolve_partial_json_data_nodeid(const char *nodeid, const char *llist_value, struct lyd_node *start,
-                                                  int options, int *parsed);
+                                                  int options, int *parsed, int *all_siblings);
 
 int resolve_len_ran_interval(struct ly_ctx *ctx, const char *str_restr, struct lys_type *type, struct len_ran_intv **ret);
 
@@ -236,9 +265,18 @@ void unres_schema_free(struct lys_module *module, struct unres_schema **unres, i
 int resolve_union(struct lyd_node_leaf_list *leaf, struct lys_type *type, int store, int ignore_fail,
                   struct lys_type **resolved_type);
 
-int resolve_unres_data_item(struct lyd_node *dnode, enum UNRES_ITEM type, int ignore_fail, struct lys_when **failed_when);
+int resolve_unres_data_item(struct lyd_node *dnode, enum UNRES_ITEM type, int ignore_fail, struct lref_index *lref_idx,
+                            struct lys_when **failed_when);
+
+/**
+ * @brief Make sure there is space for more unres data items.
+ *
+ * @param[in] unres Unres data structure to use.
+ * @param[in] count Number of items to be added.
+ * @return 0 on success, -1 on error.
+ */
+int unres_data_reserve(struct unres_data *unres, uint32_t count);
 
-int unres_data_addonly(struct unres_data *unres, struct lyd_node *node, enum UNRES_ITEM type);
 int unres_data_add(struct unres_data *unres, struct lyd_node *node, enum UNRES_ITEM type);
 void unres_data_del(struct unres_data *unres, uint32_t i);
 
@@ -0,0 +1,1889 @@
+/**
+ * @file snapshot.c
+ * @brief Binary snapshots of libyang contexts
+ *
+ * Copyright (c) 2018 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "context.h"
+#include "extensions.h"
+#include "hash_table.h"
+#include "parser.h"
+#include "resolve.h"
+#include "tree_internal.h"
+
+/*
+ * A snapshot holds all the memory blocks of the schemas in a context, their pointers replaced by fixups
+ * (relocations) which are applied once the blocks are copied into their new allocations. Every block
+ * is allocated separately when restored so that the schemas can be modified and freed as usual.
+ *
+ * The image starts with struct snap_header followed by the string records, search directory records,
+ * block records, fixups, indexes of the module blocks, string bytes and finally the block data.
+ * The structures are stored in their native layout so an image can be restored only by the same build
+ * of libyang on the same architecture.
+ */
+
+#define SNAP_MAGIC "LYSNAP\0\1"
+#define SNAP_VERSION 1
+#define SNAP_ALIGN 8
+#define SNAP_ALIGNED(size) (((size) + SNAP_ALIGN - 1) & ~((size_t)SNAP_ALIGN - 1))
+
+/* pointers outside of the image, SNAP_EXTERN_CTX or an index into ly_types */
+#define SNAP_EXTERN_CTX 0
+
+enum snap_fixup_kind {
+    SNAP_REF = 1,    /**< pointer into a block */
+    SNAP_EXTERN,     /**< pointer into the context or a built-in type */
+    SNAP_STR,        /**< dictionary string */
+    SNAP_EXTPLUGIN,  /**< lys_ext#plugin, found again by the extension name */
+    SNAP_SUBSTMT,    /**< lys_ext_instance_complex#substmt, taken from the extension plugin */
+
+    /* used only when creating the image */
+    SNAP_REF_WEAK,   /**< pointer not owned by anything, cleared if it does not point to a block */
+    SNAP_NUL         /**< cached or private data, always cleared */
+};
+
+struct snap_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t layout;            /* hash of the structure layouts and the library version */
+    uint64_t size;              /* size of the whole image */
+    int32_t options;
+    uint16_t module_set_id;
+    uint8_t internal_module_count;
+    uint8_t padding;
+    uint32_t str_count;
+    uint32_t searchdir_count;
+    uint32_t block_count;
+    uint32_t fixup_count;
+    uint32_t module_count;
+    uint32_t padding2;
+    uint64_t str_offset;        /* struct snap_str records */
+    uint64_t searchdir_offset;  /* struct snap_str records */
+    uint64_t block_offset;      /* struct snap_block records */
+    uint64_t fixup_offset;      /* struct snap_fixup records */
+    uint64_t module_offset;     /* uint32_t block indexes */
+};
+
+struct snap_str {
+    uint64_t offset;            /* offset of the NULL-terminated string in the image */
+    uint32_t len;
+    uint32_t refs;              /* number of references to insert into the dictionary */
+};
+
+struct snap_block {
+    uint64_t offset;            /* offset of the data in the image */
+    uint64_t size;
+};
+
+struct snap_fixup {
+    uint32_t block;             /* block with the pointer */
+    uint32_t offset;            /* offset of the pointer in the block */
+    uint32_t kind;              /* enum snap_fixup_kind */
+    uint32_t target;            /* target block, extern or string index */
+    uint64_t target_offset;     /* offset of the pointer target in its block */
+};
+
+/* hash table record of the addresses of blocks and strings */
+struct snap_rec {
+    const void *addr;
+    uint32_t idx;
+};
+
+/* block found while creating a snapshot */
+struct snap_blk {
+    const char *addr;
+    size_t size;
+    uint64_t offset;
+};
+
+/* pointer found while creating a snapshot */
+struct snap_fix {
+    const char *loc;
+    const void *target;
+    uint32_t kind;
+    uint32_t str;
+};
+
+/* string found while creating a snapshot */
+struct snap_string {
+    const char *str;
+    uint32_t refs;
+};
+
+struct snap_ctx {
+    struct ly_ctx *ctx;
+    int err;
+
+    struct hash_table *blk_ht;
+    struct snap_blk *blks;
+    uint32_t blk_count;
+    uint32_t blk_size;
+    uint32_t *order;            /* block indexes sorted by their address */
+
+    struct snap_fix *fixes;
+    uint32_t fix_count;
+    uint32_t fix_size;
+
+    struct hash_table *str_ht;
+    struct snap_string *strs;
+    uint32_t str_count;
+    uint32_t str_size;
+};
+
+static void snap_node(struct snap_ctx *s, struct lys_node *node, int shallow);
+static void snap_exts(struct snap_ctx *s, struct lys_ext_instance ***ext, uint8_t ext_size);
+static void snap_type(struct snap_ctx *s, struct lys_type *type);
+
+/**
+ * @brief Hash of the structure layouts an image depends on.
+ */
+static uint32_t
+snap_layout(void)
+{
+    const size_t layout[] = {
+        sizeof(void *), sizeof(struct ly_set), sizeof(struct lys_module), sizeof(struct lys_submodule),
+        sizeof(struct lys_ext), sizeof(struct lys_ext_instance), offsetof(struct lys_ext_instance_complex, content),
+        sizeof(struct lys_type), sizeof(struct lys_type_bit), sizeof(struct lys_type_enum), sizeof(struct lys_iffeature),
+        sizeof(struct lys_node), sizeof(struct lys_node_container), sizeof(struct lys_node_choice),
+        sizeof(struct lys_node_leaf), sizeof(struct lys_node_leaflist), sizeof(struct lys_node_list),
+        sizeof(struct lys_node_anydata), sizeof(struct lys_node_uses), sizeof(struct lys_node_grp),
+        sizeof(struct lys_node_case), sizeof(struct lys_node_inout), sizeof(struct lys_node_notif),
+        sizeof(struct lys_node_rpc_action), sizeof(struct lys_node_augment), sizeof(struct lys_refine),
+        sizeof(struct lys_deviate), sizeof(struct lys_deviation), sizeof(struct lys_import),
+        sizeof(struct lys_include), sizeof(struct lys_revision), sizeof(struct lys_tpdf), sizeof(struct lys_unique),
+        sizeof(struct lys_feature), sizeof(struct lys_restr), sizeof(struct lys_when), sizeof(struct lys_ident),
+#ifdef LY_ENABLED_CACHE
+        LYS_NODE_HASH_COUNT,
+#endif
+    };
+    uint32_t hash;
+
+    hash = dict_hash_multi(0, (const char *)layout, sizeof layout);
+    hash = dict_hash_multi(hash, LY_VERSION, strlen(LY_VERSION));
+    return dict_hash_multi(hash, NULL, 0);
+}
+
+static int
+snap_rec_equal(void *val1_p, void *val2_p, int UNUSED(mod), void *UNUSED(cb_data))
+{
+    return ((struct snap_rec *)val1_p)->addr == ((struct snap_rec *)val2_p)->addr;
+}
+
+static uint32_t
+snap_rec_hash(const void *addr)
+{
+    uint32_t hash;
+
+    hash = dict_hash_multi(0, (const char *)&addr, sizeof addr);
+    return dict_hash_multi(hash, NULL, 0);
+}
+
+/**
+ * @brief Remember a memory block of the schemas.
+ *
+ * @return 1 if the block is new and its content is to be processed, 0 if it was already known or NULL.
+ */
+static int
+snap_block(struct snap_ctx *s, const void *addr, size_t size)
+{
+    struct snap_rec rec, *match;
+    void *mem;
+    int r;
+
+    if (!addr || s->err) {
+        return 0;
+    }
+
+    rec.addr = addr;
+    rec.idx = s->blk_count;
+    r = lyht_insert(s->blk_ht, &rec, snap_rec_hash(addr), (void **)&match);
+    if (r == 1) {
+        /* already known, shallow copies may use only a part of it */
+        if (s->blks[match->idx].size < size) {
+            s->blks[match->idx].size = size;
+        }
+        return 0;
+    } else if (r) {
+        s->err = 1;
+        return 0;
+    }
+
+    if (s->blk_count == s->blk_size) {
+        mem = realloc(s->blks, (s->blk_size ? s->blk_size * 2 : 1024) * sizeof *s->blks);
+        LY_CHECK_ERR_RETURN(!mem, LOGMEM(s->ctx); s->err = 1, 0);
+        s->blks = mem;
+        s->blk_size = s->blk_size ? s->blk_size * 2 : 1024;
+    }
+    s->blks[s->blk_count].addr = addr;
+    s->blks[s->blk_count].size = size;
+    ++s->blk_count;
+
+    return 1;
+}
+
+static void
+snap_fixup(struct snap_ctx *s, void *loc, uint32_t kind, const void *target, uint32_t str)
+{
+    void *mem;
+
+    if (s->err) {
+        return;
+    }
+
+    if (s->fix_count == s->fix_size) {
+        mem = realloc(s->fixes, (s->fix_size ? s->fix_size * 2 : 4096) * sizeof *s->fixes);
+        LY_CHECK_ERR_RETURN(!mem, LOGMEM(s->ctx); s->err = 1, );
+        s->fixes = mem;
+        s->fix_size = s->fix_size ? s->fix_size * 2 : 4096;
+    }
+    s->fixes[s->fix_count].loc = loc;
+    s->fixes[s->fix_count].kind = kind;
+    s->fixes[s->fix_count].target = target;
+    s->fixes[s->fix_count].str = str;
+    ++s->fix_count;
+}
+
+/**
+ * @brief Pointer to something stored in the snapshot or to the context.
+ */
+static void
+snap_ref(struct snap_ctx *s, void *loc)
+{
+    if (*(void **)loc) {
+        snap_fixup(s, loc, SNAP_REF, *(void **)loc, 0);
+    }
+}
+
+/**
+ * @brief Pointer that may be dangling, it is kept only if it points into the snapshot.
+ */
+static void
+snap_ref_weak(struct snap_ctx *s, void *loc)
+{
+    if (*(void **)loc) {
+        snap_fixup(s, loc, SNAP_REF_WEAK, *(void **)loc, 0);
+    }
+}
+
+/**
+ * @brief Pointer not stored in the snapshot.
+ */
+static void
+snap_nul(struct snap_ctx *s, void *loc)
+{
+    if (*(void **)loc) {
+        snap_fixup(s, loc, SNAP_NUL, NULL, 0);
+    }
+}
+
+/**
+ * @brief Dictionary string, \p owned if the pointer holds a reference of the string.
+ */
+static void
+snap_str(struct snap_ctx *s, const char **loc, int owned)
+{
+    struct snap_rec rec, *match;
+    void *mem;
+    int r;
+
+    if (!*loc || s->err) {
+        return;
+    }
+
+    rec.addr = *loc;
+    rec.idx = s->str_count;
+    r = lyht_insert(s->str_ht, &rec, snap_rec_hash(*loc), (void **)&match);
+    if (!r) {
+        if (s->str_count == s->str_size) {
+            mem = realloc(s->strs, (s->str_size ? s->str_size * 2 : 1024) * sizeof *s->strs);
+            LY_CHECK_ERR_RETURN(!mem, LOGMEM(s->ctx); s->err = 1, );
+            s->strs = mem;
+            s->str_size = s->str_size ? s->str_size * 2 : 1024;
+        }
+        s->strs[s->str_count].str = *loc;
+        s->strs[s->str_count].refs = 0;
+        ++s->str_count;
+    } else if (r != 1) {
+        s->err = 1;
+        return;
+    }
+
+    if (owned) {
+        ++s->strs[match->idx].refs;
+    }
+    snap_fixup(s, loc, SNAP_STR, NULL, match->idx);
+}
+
+/**
+ * @brief Pointer to a block owned by the pointer.
+ *
+ * @return 1 if the block content is to be processed, 0 otherwise.
+ */
+static int
+snap_owned(struct snap_ctx *s, void *loc, size_t size)
+{
+    void *addr = *(void **)loc;
+
+    if (!addr) {
+        return 0;
+    } else if (!size) {
+        /* empty array, nothing to store */
+        snap_nul(s, loc);
+        return 0;
+    }
+
+    snap_fixup(s, loc, SNAP_REF, addr, 0);
+    return snap_block(s, addr, size);
+}
+
+/**
+ * @brief Array of \p count pointers into the snapshot.
+ */
+static void
+snap_refs(struct snap_ctx *s, void *loc, unsigned int count)
+{
+    void **array;
+    unsigned int i;
+
+    if (snap_owned(s, loc, count * sizeof(void *))) {
+        array = *(void ***)loc;
+        for (i = 0; i < count; ++i) {
+            snap_ref(s, &array[i]);
+        }
+    }
+}
+
+/**
+ * @brief Array of \p count dictionary strings.
+ */
+static void
+snap_strs(struct snap_ctx *s, const char ***loc, unsigned int count)
+{
+    unsigned int i;
+
+    if (snap_owned(s, loc, count * sizeof **loc)) {
+        for (i = 0; i < count; ++i) {
+            snap_str(s, &(*loc)[i], 1);
+        }
+    }
+}
+
+static void
+snap_set(struct snap_ctx *s, struct ly_set **loc)
+{
+    struct ly_set *set;
+    unsigned int i;
+
+    if (!snap_owned(s, loc, sizeof **loc)) {
+        return;
+    }
+
+    set = *loc;
+    if (!set->size) {
+        snap_nul(s, &set->set.g);
+    } else if (snap_owned(s, &set->set.g, (set->size + 1) * sizeof *set->set.g)) {
+        for (i = 0; i < set->number; ++i) {
+            snap_ref(s, &set->set.g[i]);
+        }
+        /* unused items and the hash index, created again when needed */
+        for (; i <= set->size; ++i) {
+            snap_nul(s, &set->set.g[i]);
+        }
+    }
+}
+
+static void
+snap_iffeatures(struct snap_ctx *s, struct lys_iffeature **loc, uint8_t size, int shallow)
+{
+    struct lys_iffeature *iff;
+    unsigned int i, expr_size, feat_size;
+
+    if (!snap_owned(s, loc, size * sizeof **loc)) {
+        return;
+    }
+
+    for (i = 0; i < size; ++i) {
+        iff = &(*loc)[i];
+        if (shallow) {
+            /* shared with the original node */
+            snap_ref(s, &iff->expr);
+            snap_ref(s, &iff->features);
+        } else {
+            resolve_iffeature_getsizes(iff, &expr_size, &feat_size);
+            snap_owned(s, &iff->expr, (expr_size + 3) / 4);
+            snap_refs(s, &iff->features, feat_size);
+        }
+        snap_exts(s, &iff->ext, iff->ext_size);
+    }
+}
+
+/**
+ * @brief Restriction, \p borrowed if it is a copy of a restriction owned by someone else.
+ */
+static void
+snap_restr(struct snap_ctx *s, struct lys_restr *restr, int borrowed)
+{
+    snap_str(s, &restr->expr, !borrowed);
+    snap_str(s, &restr->dsc, !borrowed);
+    snap_str(s, &restr->ref, !borrowed);
+    snap_str(s, &restr->eapptag, !borrowed);
+    snap_str(s, &restr->emsg, !borrowed);
+    if (borrowed) {
+        snap_ref_weak(s, &restr->ext);
+    } else {
+        snap_exts(s, &restr->ext, restr->ext_size);
+    }
+}
+
+static void
+snap_restrs(struct snap_ctx *s, struct lys_restr **loc, unsigned int size, int borrowed)
+{
+    unsigned int i;
+
+    if (snap_owned(s, loc, size * sizeof **loc)) {
+        for (i = 0; i < size; ++i) {
+            snap_restr(s, &(*loc)[i], borrowed);
+        }
+    }
+}
+
+static void
+snap_restr_single(struct snap_ctx *s, struct lys_restr **loc)
+{
+    if (snap_owned(s, loc, sizeof **loc)) {
+        snap_restr(s, *loc, 0);
+    }
+}
+
+static void
+snap_when_content(struct snap_ctx *s, struct lys_when *when)
+{
+    snap_str(s, &when->cond, 1);
+    snap_str(s, &when->dsc, 1);
+    snap_str(s, &when->ref, 1);
+    snap_exts(s, &when->ext, when->ext_size);
+#ifdef LY_ENABLED_CACHE
+    snap_nul(s, &when->cond_compiled);
+#endif
+}
+
+static void
+snap_when(struct snap_ctx *s, struct lys_when **loc)
+{
+    if (snap_owned(s, loc, sizeof **loc)) {
+        snap_when_content(s, *loc);
+    }
+}
+
+static void
+snap_uniques(struct snap_ctx *s, struct lys_unique **loc, unsigned int size)
+{
+    unsigned int i;
+
+    if (snap_owned(s, loc, size * sizeof **loc)) {
+        for (i = 0; i < size; ++i) {
+            snap_strs(s, &(*loc)[i].expr, (*loc)[i].expr_size);
+        }
+    }
+}
+
+static void
+snap_tpdf(struct snap_ctx *s, struct lys_tpdf *tpdf)
+{
+    snap_str(s, &tpdf->name, 1);
+    snap_str(s, &tpdf->dsc, 1);
+    snap_str(s, &tpdf->ref, 1);
+    snap_exts(s, &tpdf->ext, tpdf->ext_size);
+    snap_str(s, &tpdf->units, 1);
+    snap_ref(s, &tpdf->module);
+    snap_type(s, &tpdf->type);
+    snap_str(s, &tpdf->dflt, 1);
+}
+
+static void
+snap_tpdfs(struct snap_ctx *s, struct lys_tpdf **loc, unsigned int size)
+{
+    unsigned int i;
+
+    if (snap_owned(s, loc, size * sizeof **loc)) {
+        for (i = 0; i < size; ++i) {
+            snap_tpdf(s, &(*loc)[i]);
+        }
+    }
+}
+
+static void
+snap_type(struct snap_ctx *s, struct lys_type *type)
+{
+    unsigned int i;
+
+    snap_exts(s, &type->ext, type->ext_size);
+    snap_ref(s, &type->der);
+    snap_ref(s, &type->parent);
+
+    switch (type->base) {
+    case LY_TYPE_BINARY:
+        snap_restr_single(s, &type->info.binary.length);
+        break;
+    case LY_TYPE_BITS:
+        if (snap_owned(s, &type->info.bits.bit, type->info.bits.count * sizeof *type->info.bits.bit)) {
+            for (i = 0; i < type->info.bits.count; ++i) {
+                snap_str(s, &type->info.bits.bit[i].name, 1);
+                snap_str(s, &type->info.bits.bit[i].dsc, 1);
+                snap_str(s, &type->info.bits.bit[i].ref, 1);
+                snap_exts(s, &type->info.bits.bit[i].ext, type->info.bits.bit[i].ext_size);
+                snap_iffeatures(s, &type->info.bits.bit[i].iffeature, type->info.bits.bit[i].iffeature_size, 0);
+            }
+        }
+        break;
+    case LY_TYPE_DEC64:
+        snap_restr_single(s, &type->info.dec64.range);
+        break;
+    case LY_TYPE_ENUM:
+        if (snap_owned(s, &type->info.enums.enm, type->info.enums.count * sizeof *type->info.enums.enm)) {
+            for (i = 0; i < type->info.enums.count; ++i) {
+                snap_str(s, &type->info.enums.enm[i].name, 1);
+                snap_str(s, &type->info.enums.enm[i].dsc, 1);
+                snap_str(s, &type->info.enums.enm[i].ref, 1);
+                snap_exts(s, &type->info.enums.enm[i].ext, type->info.enums.enm[i].ext_size);
+                snap_iffeatures(s, &type->info.enums.enm[i].iffeature, type->info.enums.enm[i].iffeature_size, 0);
+            }
+        }
+        break;
+    case LY_TYPE_IDENT:
+        snap_refs(s, &type->info.ident.ref, type->info.ident.count);
+        break;
+    case LY_TYPE_INT8:
+    case LY_TYPE_INT16:
+    case LY_TYPE_INT32:
+    case LY_TYPE_INT64:
+    case LY_TYPE_UINT8:
+    case LY_TYPE_UINT16:
+    case LY_TYPE_UINT32:
+    case LY_TYPE_UINT64:
+        snap_restr_single(s, &type->info.num.range);
+        break;
+    case LY_TYPE_LEAFREF:
+        snap_str(s, &type->info.lref.path, 1);
+        snap_ref(s, &type->info.lref.target);
+#ifdef LY_ENABLED_CACHE
+        snap_nul(s, &type->info.lref.path_compiled);
+#endif
+        break;
+    case LY_TYPE_STRING:
+        snap_restr_single(s, &type->info.str.length);
+        snap_restrs(s, &type->info.str.patterns, type->info.str.pat_count, 0);
+#ifdef LY_ENABLED_CACHE
+        snap_nul(s, &type->info.str.patterns_pcre);
+#endif
+        break;
+    case LY_TYPE_UNION:
+        if (snap_owned(s, &type->info.uni.types, type->info.uni.count * sizeof *type->info.uni.types)) {
+            for (i = 0; i < type->info.uni.count; ++i) {
+                snap_type(s, &type->info.uni.types[i]);
+            }
+        }
+        break;
+    default:
+        /* no pointers in the type information */
+        break;
+    }
+}
+
+/**
+ * @brief NULL-terminated array of \p count dictionary strings.
+ */
+static void
+snap_str_array(struct snap_ctx *s, const char ***loc, unsigned int count)
+{
+    unsigned int i;
+
+    if (snap_owned(s, loc, (count + 1) * sizeof **loc)) {
+        for (i = 0; i < count; ++i) {
+            snap_str(s, &(*loc)[i], 1);
+        }
+    }
+}
+
+/**
+ * @brief Item of a complex extension instance substatement, \p item is the location of the pointer to it.
+ */
+static void
+snap_ext_item(struct snap_ctx *s, LY_STMT stmt, void **item)
+{
+    struct lys_revision *rev;
+    struct lys_unique *unique;
+
+    switch (stmt) {
+    case LY_STMT_TYPE:
+        if (snap_owned(s, item, sizeof(struct lys_type))) {
+            snap_type(s, *item);
+        }
+        break;
+    case LY_STMT_TYPEDEF:
+        if (snap_owned(s, item, sizeof(struct lys_tpdf))) {
+            snap_tpdf(s, *item);
+        }
+        break;
+    case LY_STMT_IFFEATURE:
+        snap_iffeatures(s, (struct lys_iffeature **)item, 1, 0);
+        break;
+    case LY_STMT_MAX:
+    case LY_STMT_MIN:
+    case LY_STMT_POSITION:
+    case LY_STMT_VALUE:
+        snap_owned(s, item, sizeof(uint32_t));
+        break;
+    case LY_STMT_UNIQUE:
+        if (snap_owned(s, item, sizeof(struct lys_unique))) {
+            unique = *item;
+            snap_strs(s, &unique->expr, unique->expr_size);
+        }
+        break;
+    case LY_STMT_LENGTH:
+    case LY_STMT_MUST:
+    case LY_STMT_PATTERN:
+    case LY_STMT_RANGE:
+        snap_restr_single(s, (struct lys_restr **)item);
+        break;
+    case LY_STMT_WHEN:
+        snap_when(s, (struct lys_when **)item);
+        break;
+    case LY_STMT_REVISION:
+        if (snap_owned(s, item, sizeof(struct lys_revision))) {
+            rev = *item;
+            snap_str(s, &rev->dsc, 1);
+            snap_str(s, &rev->ref, 1);
+            snap_exts(s, &rev->ext, rev->ext_size);
+        }
+        break;
+    default:
+        LOGINT(s->ctx);
+        s->err = 1;
+        break;
+    }
+}
+
+/**
+ * @brief Content of a complex extension instance, \p borrowed if it was copied from another instance.
+ */
+static void
+snap_ext_complex(struct snap_ctx *s, struct lys_ext_instance_complex *ext, int borrowed)
+{
+    struct lyext_substmt *substmt = ext->substmt;
+    struct lys_node *node;
+    void **p;
+    unsigned int i, j, count;
+    int many;
+
+    for (i = 0; substmt[i].stmt; i++) {
+        p = (void **)&ext->content[substmt[i].offset];
+        many = (substmt[i].cardinality >= LY_STMT_CARD_SOME);
+
+        switch (substmt[i].stmt) {
+        case LY_STMT_DESCRIPTION:
+        case LY_STMT_REFERENCE:
+        case LY_STMT_UNITS:
+        case LY_STMT_ARGUMENT:
+        case LY_STMT_DEFAULT:
+        case LY_STMT_ERRTAG:
+        case LY_STMT_ERRMSG:
+        case LY_STMT_PREFIX:
+        case LY_STMT_NAMESPACE:
+        case LY_STMT_PRESENCE:
+        case LY_STMT_REVISIONDATE:
+        case LY_STMT_KEY:
+        case LY_STMT_BASE:
+        case LY_STMT_BELONGSTO:
+        case LY_STMT_CONTACT:
+        case LY_STMT_ORGANIZATION:
+        case LY_STMT_PATH:
+            if (!many) {
+                snap_str(s, (const char **)&p[0], !borrowed);
+                if (substmt[i].stmt == LY_STMT_BELONGSTO) {
+                    snap_str(s, (const char **)&p[1], !borrowed);
+                }
+                break;
+            }
+
+            /* NULL-terminated array of strings, belongs-to has another one of prefixes and argument
+             * an array of yin-element values */
+            if (borrowed) {
+                snap_ref(s, &p[0]);
+                if ((substmt[i].stmt == LY_STMT_BELONGSTO) || (substmt[i].stmt == LY_STMT_ARGUMENT)) {
+                    snap_ref(s, &p[1]);
+                }
+                break;
+            }
+            if (!p[0]) {
+                break;
+            }
+            for (count = 0; ((const char **)p[0])[count]; count++);
+            snap_str_array(s, (const char ***)&p[0], count);
+            if (substmt[i].stmt == LY_STMT_BELONGSTO) {
+                snap_str_array(s, (const char ***)&p[1], count);
+            } else if (substmt[i].stmt == LY_STMT_ARGUMENT) {
+                snap_owned(s, &p[1], count + 1);
+            }
+            break;
+        case LY_STMT_TYPE:
+        case LY_STMT_TYPEDEF:
+        case LY_STMT_IFFEATURE:
+        case LY_STMT_MAX:
+        case LY_STMT_MIN:
+        case LY_STMT_POSITION:
+        case LY_STMT_VALUE:
+        case LY_STMT_UNIQUE:
+        case LY_STMT_LENGTH:
+        case LY_STMT_MUST:
+        case LY_STMT_PATTERN:
+        case LY_STMT_RANGE:
+        case LY_STMT_WHEN:
+        case LY_STMT_REVISION:
+            if (borrowed) {
+                snap_ref(s, &p[0]);
+            } else if (many) {
+                /* NULL-terminated array of separately allocated items */
+                if (!p[0]) {
+                    break;
+                }
+                for (count = 0; ((void **)p[0])[count]; count++);
+                if (snap_owned(s, &p[0], (count + 1) * sizeof(void *))) {
+                    for (j = 0; j < count; j++) {
+                        snap_ext_item(s, substmt[i].stmt, &((void **)p[0])[j]);
+                    }
+                }
+            } else {
+                snap_ext_item(s, substmt[i].stmt, &p[0]);
+            }
+            break;
+        case LY_STMT_DIGITS:
+            if (!many) {
+                /* stored directly */
+                break;
+            }
+            if (borrowed) {
+                snap_ref(s, &p[0]);
+            } else if (p[0]) {
+                /* zero-terminated array of values */
+                for (count = 0; ((uint8_t *)p[0])[count]; count++);
+                snap_owned(s, &p[0], count + 1);
+            }
+            break;
+        case LY_STMT_MODULE:
+            if (!many || borrowed) {
+                snap_ref(s, &p[0]);
+            } else if (p[0]) {
+                for (count = 0; ((void **)p[0])[count]; count++);
+                /* including the terminating NULL */
+                snap_refs(s, &p[0], count + 1);
+            }
+            break;
+        case LY_STMT_ACTION:
+        case LY_STMT_ANYDATA:
+        case LY_STMT_ANYXML:
+        case LY_STMT_CASE:
+        case LY_STMT_CHOICE:
+        case LY_STMT_CONTAINER:
+        case LY_STMT_GROUPING:
+        case LY_STMT_INPUT:
+        case LY_STMT_LEAF:
+        case LY_STMT_LEAFLIST:
+        case LY_STMT_LIST:
+        case LY_STMT_NOTIFICATION:
+        case LY_STMT_OUTPUT:
+        case LY_STMT_RPC:
+        case LY_STMT_USES:
+            /* siblings of schema nodes */
+            snap_ref(s, &p[0]);
+            if (!borrowed) {
+                LY_TREE_FOR((struct lys_node *)p[0], node) {
+                    snap_node(s, node, 0);
+                }
+            }
+            break;
+        default:
+            /* flags stored directly */
+            break;
+        }
+    }
+}
+
+static void
+snap_ext_instance(struct snap_ctx *s, struct lys_ext_instance *ext)
+{
+    struct lyext_plugin_complex *plugin = NULL;
+    size_t size = sizeof *ext;
+    int inherited;
+
+    if (ext->flags & LYEXT_OPT_YANG) {
+        LOGERR(s->ctx, LY_EINVAL, "Extension instance \"%s\" is not resolved.", (char *)ext->def);
+        s->err = 1;
+        return;
+    }
+
+    /* inherited instances are shallow copies of the original instance, their content stays with it */
+    inherited = (ext->flags & LYEXT_OPT_INHERIT) ? 1 : 0;
+    if (!inherited && (ext->ext_type == LYEXT_COMPLEX)) {
+        plugin = (struct lyext_plugin_complex *)ext->def->plugin;
+        if (!plugin || (plugin->type != LYEXT_COMPLEX)) {
+            LOGINT(s->ctx);
+            s->err = 1;
+            return;
+        }
+        size = plugin->instance_size;
+    }
+
+    if (!snap_block(s, ext, size)) {
+        return;
+    }
+
+    snap_ref(s, &ext->def);
+    snap_ref(s, &ext->parent);
+    snap_str(s, &ext->arg_value, !inherited);
+    if (inherited) {
+        snap_ref_weak(s, &ext->ext);
+    } else {
+        snap_exts(s, &ext->ext, ext->ext_size);
+    }
+    snap_nul(s, &ext->priv);
+    snap_ref(s, &ext->module);
+
+    if (plugin) {
+        snap_fixup(s, &((struct lys_ext_instance_complex *)ext)->substmt, SNAP_SUBSTMT, NULL, 0);
+        snap_ext_complex(s, (struct lys_ext_instance_complex *)ext, (ext->flags & LYEXT_OPT_CONTENT) ? 1 : 0);
+    }
+}
+
+static void
+snap_exts(struct snap_ctx *s, struct lys_ext_instance ***loc, uint8_t ext_size)
+{
+    unsigned int i;
+
+    if (!snap_owned(s, loc, ext_size * sizeof **loc)) {
+        return;
+    }
+
+    for (i = 0; i < ext_size; ++i) {
+        if ((*loc)[i]) {
+            snap_ref(s, &(*loc)[i]);
+            snap_ext_instance(s, (*loc)[i]);
+        }
+    }
+}
+
+static void
+snap_augment(struct snap_ctx *s, struct lys_node_augment *aug)
+{
+    struct lys_node *child;
+
+    snap_str(s, &aug->target_name, 1);
+    snap_str(s, &aug->dsc, 1);
+    snap_str(s, &aug->ref, 1);
+    snap_exts(s, &aug->ext, aug->ext_size);
+    snap_iffeatures(s, &aug->iffeature, aug->iffeature_size, 0);
+    snap_ref(s, &aug->module);
+    snap_ref(s, &aug->parent);
+    snap_ref(s, &aug->child);
+    if (!aug->target || (aug->flags & LYS_NOTAPPLIED)) {
+        /* children of an applied augment are stored with the target */
+        LY_TREE_FOR(aug->child, child) {
+            snap_node(s, child, 0);
+        }
+    }
+    snap_when(s, &aug->when);
+    snap_ref(s, &aug->target);
+    snap_nul(s, &aug->priv);
+}
+
+static void
+snap_augments(struct snap_ctx *s, struct lys_node_augment **loc, unsigned int size)
+{
+    unsigned int i;
+
+    if (snap_owned(s, loc, size * sizeof **loc)) {
+        for (i = 0; i < size; ++i) {
+            snap_augment(s, &(*loc)[i]);
+        }
+    }
+}
+
+static void
+snap_refines(struct snap_ctx *s, struct lys_refine **loc, unsigned int size)
+{
+    struct lys_refine *rfn;
+    unsigned int i;
+
+    if (!snap_owned(s, loc, size * sizeof **loc)) {
+        return;
+    }
+
+    for (i = 0; i < size; ++i) {
+        rfn = &(*loc)[i];
+        snap_str(s, &rfn->target_name, 1);
+        snap_str(s, &rfn->dsc, 1);
+        snap_str(s, &rfn->ref, 1);
+        snap_exts(s, &rfn->ext, rfn->ext_size);
+        snap_iffeatures(s, &rfn->iffeature, rfn->iffeature_size, 0);
+        snap_ref(s, &rfn->module);
+        snap_restrs(s, &rfn->must, rfn->must_size, 0);
+        snap_strs(s, &rfn->dflt, rfn->dflt_size);
+        if (rfn->target_type & LYS_CONTAINER) {
+            snap_str(s, &rfn->mod.presence, 1);
+        }
+    }
+}
+
+static size_t
+snap_node_size(const struct lys_node *node)
+{
+    switch (node->nodetype) {
+    case LYS_CONTAINER:
+        return sizeof(struct lys_node_container);
+    case LYS_CHOICE:
+        return sizeof(struct lys_node_choice);
+    case LYS_LEAF:
+        return sizeof(struct lys_node_leaf);
+    case LYS_LEAFLIST:
+        return sizeof(struct lys_node_leaflist);
+    case LYS_LIST:
+        return sizeof(struct lys_node_list);
+    case LYS_ANYXML:
+    case LYS_ANYDATA:
+        return sizeof(struct lys_node_anydata);
+    case LYS_USES:
+        return sizeof(struct lys_node_uses);
+    case LYS_GROUPING:
+        return sizeof(struct lys_node_grp);
+    case LYS_CASE:
+        return sizeof(struct lys_node_case);
+    case LYS_INPUT:
+    case LYS_OUTPUT:
+        return sizeof(struct lys_node_inout);
+    case LYS_NOTIF:
+        return sizeof(struct lys_node_notif);
+    case LYS_RPC:
+    case LYS_ACTION:
+        return sizeof(struct lys_node_rpc_action);
+    default:
+        /* augments are stored in arrays */
+        return 0;
+    }
+}
+
+/**
+ * @brief Schema node with its subtree, \p shallow copies share the children and if-features with the original.
+ */
+static void
+snap_node(struct snap_ctx *s, struct lys_node *node, int shallow)
+{
+    struct lys_node *child;
+    struct lys_node_container *cont;
+    struct lys_node_leaf *leaf;
+    struct lys_node_leaflist *llist;
+    struct lys_node_list *list;
+    struct lys_node_anydata *any;
+    struct lys_node_uses *uses;
+    struct lys_node_inout *inout;
+    struct lys_node_notif *notif;
+    size_t size;
+
+    size = snap_node_size(node);
+    if (!size) {
+        LOGINT(s->ctx);
+        s->err = 1;
+        return;
+    }
+    if (!snap_block(s, node, size)) {
+        return;
+    }
+
+    /* common part */
+    snap_str(s, &node->name, 1);
+    if (node->nodetype & (LYS_INPUT | LYS_OUTPUT)) {
+        inout = (struct lys_node_inout *)node;
+        snap_nul(s, &inout->fill1[0]);
+        snap_nul(s, &inout->fill1[1]);
+        snap_nul(s, &inout->padding_iff);
+    } else {
+        snap_str(s, &node->dsc, 1);
+        snap_str(s, &node->ref, 1);
+        snap_iffeatures(s, &node->iffeature, node->iffeature_size, shallow);
+    }
+    snap_exts(s, &node->ext, node->ext_size);
+    snap_ref(s, &node->module);
+    snap_ref(s, &node->parent);
+    snap_ref(s, &node->next);
+    snap_ref(s, &node->prev);
+    snap_nul(s, &node->priv);
+
+    if (node->nodetype & (LYS_LEAF | LYS_LEAFLIST)) {
+        /* leafref backlinks */
+        snap_set(s, (struct ly_set **)&node->child);
+    } else {
+        snap_ref(s, &node->child);
+        if (!shallow) {
+            LY_TREE_FOR(node->child, child) {
+                snap_node(s, child, 0);
+            }
+        }
+    }
+
+    /* specific part */
+    switch (node->nodetype) {
+    case LYS_CONTAINER:
+        cont = (struct lys_node_container *)node;
+#ifdef LY_ENABLED_CACHE
+        snap_nul(s, &cont->child_idx);
+#endif
+        snap_when(s, &cont->when);
+        snap_restrs(s, &cont->must, cont->must_size, 0);
+        snap_tpdfs(s, &cont->tpdf, cont->tpdf_size);
+        snap_str(s, &cont->presence, 1);
+        break;
+    case LYS_CHOICE:
+        snap_when(s, &((struct lys_node_choice *)node)->when);
+        snap_ref(s, &((struct lys_node_choice *)node)->dflt);
+        break;
+    case LYS_LEAF:
+        leaf = (struct lys_node_leaf *)node;
+        snap_when(s, &leaf->when);
+        snap_restrs(s, &leaf->must, leaf->must_size, 0);
+        snap_type(s, &leaf->type);
+        snap_str(s, &leaf->units, 1);
+        snap_str(s, &leaf->dflt, 1);
+        break;
+    case LYS_LEAFLIST:
+        llist = (struct lys_node_leaflist *)node;
+        snap_when(s, &llist->when);
+        snap_restrs(s, &llist->must, llist->must_size, 0);
+        snap_type(s, &llist->type);
+        snap_str(s, &llist->units, 1);
+        snap_strs(s, &llist->dflt, llist->dflt_size);
+        break;
+    case LYS_LIST:
+        list = (struct lys_node_list *)node;
+#ifdef LY_ENABLED_CACHE
+        snap_nul(s, &list->child_idx);
+#endif
+        snap_when(s, &list->when);
+        snap_restrs(s, &list->must, list->must_size, 0);
+        snap_tpdfs(s, &list->tpdf, list->tpdf_size);
+        snap_refs(s, &list->keys, list->keys_size);
+        snap_uniques(s, &list->unique, list->unique_size);
+        snap_str(s, &list->keys_str, 1);
+        break;
+    case LYS_ANYXML:
+    case LYS_ANYDATA:
+        any = (struct lys_node_anydata *)node;
+        snap_when(s, &any->when);
+        snap_restrs(s, &any->must, any->must_size, 0);
+        break;
+    case LYS_USES:
+        uses = (struct lys_node_uses *)node;
+        snap_when(s, &uses->when);
+        snap_refines(s, &uses->refine, uses->refine_size);
+        snap_augments(s, &uses->augment, uses->augment_size);
+        snap_ref(s, &uses->grp);
+        break;
+    case LYS_GROUPING:
+        snap_tpdfs(s, &((struct lys_node_grp *)node)->tpdf, ((struct lys_node_grp *)node)->tpdf_size);
+        break;
+    case LYS_CASE:
+        snap_when(s, &((struct lys_node_case *)node)->when);
+        break;
+    case LYS_INPUT:
+    case LYS_OUTPUT:
+        inout = (struct lys_node_inout *)node;
+#ifdef LY_ENABLED_CACHE
+        snap_nul(s, &inout->child_idx);
+#endif
+        snap_tpdfs(s, &inout->tpdf, inout->tpdf_size);
+        snap_restrs(s, &inout->must, inout->must_size, 0);
+        break;
+    case LYS_NOTIF:
+        notif = (struct lys_node_notif *)node;
+#ifdef LY_ENABLED_CACHE
+        snap_nul(s, &notif->child_idx);
+#endif
+        snap_tpdfs(s, &notif->tpdf, notif->tpdf_size);
+        snap_restrs(s, &notif->must, notif->must_size, 0);
+        break;
+    case LYS_RPC:
+    case LYS_ACTION:
+        snap_tpdfs(s, &((struct lys_node_rpc_action *)node)->tpdf, ((struct lys_node_rpc_action *)node)->tpdf_size);
+        break;
+    default:
+        break;
+    }
+}
+
+static void
+snap_deviation(struct snap_ctx *s, struct lys_deviation *dev)
+{
+    struct lys_deviate *d;
+    unsigned int i;
+
+    snap_str(s, &dev->target_name, 1);
+    snap_str(s, &dev->dsc, 1);
+    snap_str(s, &dev->ref, 1);
+    snap_exts(s, &dev->ext, dev->ext_size);
+
+    if (!dev->deviate) {
+        snap_ref_weak(s, &dev->orig_node);
+        return;
+    }
+
+    /* the removed subtree for not-supported deviations, a shallow copy of the deviated node otherwise */
+    snap_ref(s, &dev->orig_node);
+    if (dev->orig_node) {
+        snap_node(s, dev->orig_node, dev->deviate[0].mod == LY_DEVIATE_NO ? 0 : 1);
+    }
+
+    if (!snap_owned(s, &dev->deviate, dev->deviate_size * sizeof *dev->deviate)) {
+        return;
+    }
+    for (i = 0; i < dev->deviate_size; ++i) {
+        d = &dev->deviate[i];
+        snap_exts(s, &d->ext, d->ext_size);
+        snap_strs(s, &d->dflt, d->dflt_size);
+        snap_str(s, &d->units, 1);
+        if (d->mod == LY_DEVIATE_DEL) {
+            snap_restrs(s, &d->must, d->must_size, 0);
+            snap_uniques(s, &d->unique, d->unique_size);
+        } else {
+            /* the added restrictions were moved into the target, only copies are left here */
+            snap_restrs(s, &d->must, d->must_size, 1);
+            snap_ref_weak(s, &d->unique);
+        }
+        snap_ref_weak(s, &d->type);
+    }
+}
+
+static void
+snap_module(struct snap_ctx *s, struct lys_module *mod)
+{
+    struct lys_node *node;
+    struct lys_ident *ident;
+    struct lys_feature *feat;
+    struct lys_ext *ext;
+    unsigned int i;
+
+    if (!snap_block(s, mod, mod->type ? sizeof(struct lys_submodule) : sizeof(struct lys_module))) {
+        return;
+    }
+
+    snap_ref(s, &mod->ctx);
+    snap_str(s, &mod->name, 1);
+    snap_str(s, &mod->prefix, 1);
+    snap_str(s, &mod->dsc, 1);
+    snap_str(s, &mod->ref, 1);
+    snap_str(s, &mod->org, 1);
+    snap_str(s, &mod->contact, 1);
+    snap_str(s, &mod->filepath, 1);
+
+    if (snap_owned(s, &mod->rev, mod->rev_size * sizeof *mod->rev)) {
+        for (i = 0; i < mod->rev_size; ++i) {
+            snap_exts(s, &mod->rev[i].ext, mod->rev[i].ext_size);
+            snap_str(s, &mod->rev[i].dsc, 1);
+            snap_str(s, &mod->rev[i].ref, 1);
+        }
+    }
+
+    if (snap_owned(s, &mod->imp, mod->imp_size * sizeof *mod->imp)) {
+        for (i = 0; i < mod->imp_size; ++i) {
+            snap_ref(s, &mod->imp[i].module);
+            snap_str(s, &mod->imp[i].prefix, 1);
+            snap_exts(s, &mod->imp[i].ext, mod->imp[i].ext_size);
+            snap_str(s, &mod->imp[i].dsc, 1);
+            snap_str(s, &mod->imp[i].ref, 1);
+        }
+    }
+
+    if (snap_owned(s, &mod->inc, mod->inc_size * sizeof *mod->inc)) {
+        for (i = 0; i < mod->inc_size; ++i) {
+            /* all the submodules are included (and owned) by the main module */
+            snap_ref(s, &mod->inc[i].submodule);
+            if (!mod->type && mod->inc[i].submodule) {
+                snap_module(s, (struct lys_module *)mod->inc[i].submodule);
+            }
+            snap_exts(s, &mod->inc[i].ext, mod->inc[i].ext_size);
+            snap_str(s, &mod->inc[i].dsc, 1);
+            snap_str(s, &mod->inc[i].ref, 1);
+        }
+    }
+
+    snap_tpdfs(s, &mod->tpdf, mod->tpdf_size);
+
+    if (snap_owned(s, &mod->ident, mod->ident_size * sizeof *mod->ident)) {
+        for (i = 0; i < mod->ident_size; ++i) {
+            ident = &mod->ident[i];
+            snap_str(s, &ident->name, 1);
+            snap_str(s, &ident->dsc, 1);
+            snap_str(s, &ident->ref, 1);
+            snap_exts(s, &ident->ext, ident->ext_size);
+            snap_iffeatures(s, &ident->iffeature, ident->iffeature_size, 0);
+            snap_ref(s, &ident->module);
+            snap_refs(s, &ident->base, ident->base_size);
+            snap_set(s, &ident->der);
+        }
+    }
+
+    if (snap_owned(s, &mod->features, mod->features_size * sizeof *mod->features)) {
+        for (i = 0; i < mod->features_size; ++i) {
+            feat = &mod->features[i];
+            snap_str(s, &feat->name, 1);
+            snap_str(s, &feat->dsc, 1);
+            snap_str(s, &feat->ref, 1);
+            snap_exts(s, &feat->ext, feat->ext_size);
+            snap_iffeatures(s, &feat->iffeature, feat->iffeature_size, 0);
+            snap_ref(s, &feat->module);
+            snap_set(s, &feat->depfeatures);
+        }
+    }
+
+    snap_augments(s, &mod->augment, mod->augment_size);
+
+    if (snap_owned(s, &mod->deviation, mod->deviation_size * sizeof *mod->deviation)) {
+        for (i = 0; i < mod->deviation_size; ++i) {
+            snap_deviation(s, &mod->deviation[i]);
+        }
+    }
+
+    if (snap_owned(s, &mod->extensions, mod->extensions_size * sizeof *mod->extensions)) {
+        for (i = 0; i < mod->extensions_size; ++i) {
+            ext = &mod->extensions[i];
+            snap_str(s, &ext->name, 1);
+            snap_str(s, &ext->dsc, 1);
+            snap_str(s, &ext->ref, 1);
+            snap_exts(s, &ext->ext, ext->ext_size);
+            snap_str(s, &ext->argument, 1);
+            snap_ref(s, &ext->module);
+            if (ext->plugin) {
+                snap_fixup(s, &ext->plugin, SNAP_EXTPLUGIN, NULL, 0);
+            }
+        }
+    }
+
+    snap_exts(s, &mod->ext, mod->ext_size);
+
+    if (mod->type) {
+        snap_ref(s, &((struct lys_submodule *)mod)->belongsto);
+        return;
+    }
+
+    /* data of the submodules are stored in the main module */
+    snap_ref(s, &mod->data);
+    LY_TREE_FOR(mod->data, node) {
+        snap_node(s, node, 0);
+    }
+    snap_str(s, &mod->ns, 1);
+#ifdef LY_ENABLED_CACHE
+    snap_nul(s, &mod->data_idx);
+#endif
+}
+
+static int
+snap_blk_cmp(const void *ptr1, const void *ptr2, void *arg)
+{
+    const struct snap_blk *blks = arg;
+    const char *addr1 = blks[*(uint32_t *)ptr1].addr, *addr2 = blks[*(uint32_t *)ptr2].addr;
+
+    return (addr1 > addr2) - (addr1 < addr2);
+}
+
+/**
+ * @brief Find the block containing an address.
+ *
+ * @return Index of the block, -1 if there is no such block.
+ */
+static int64_t
+snap_find(struct snap_ctx *s, const char *addr)
+{
+    uint32_t lo = 0, hi = s->blk_count, mid;
+    const struct snap_blk *blk;
+
+    /* the last block starting at or before the address */
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (s->blks[s->order[mid]].addr <= addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (!lo) {
+        return -1;
+    }
+
+    blk = &s->blks[s->order[lo - 1]];
+    if (addr >= blk->addr + blk->size) {
+        return -1;
+    }
+    return s->order[lo - 1];
+}
+
+/**
+ * @brief Find the structure outside of the image containing an address.
+ *
+ * @return Index of the extern, -1 if there is no such structure.
+ */
+static int
+snap_find_extern(struct snap_ctx *s, const char *addr, uint64_t *offset)
+{
+    int i;
+
+    if ((addr >= (char *)s->ctx) && (addr < (char *)s->ctx + sizeof *s->ctx)) {
+        *offset = addr - (char *)s->ctx;
+        return SNAP_EXTERN_CTX;
+    }
+    for (i = 1; i < LY_DATA_TYPE_COUNT; ++i) {
+        if (ly_types[i] && (addr >= (char *)ly_types[i]) && (addr < (char *)ly_types[i] + sizeof *ly_types[i])) {
+            *offset = addr - (char *)ly_types[i];
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Resolve the fixups, lay out the blocks and write the image.
+ */
+static int
+snap_write(struct snap_ctx *s, char **data, size_t *size)
+{
+    struct snap_header hdr;
+    struct snap_str str_rec;
+    struct snap_block blk_rec;
+    struct snap_fixup *fixups = NULL;
+    struct snap_fix *fix;
+    char *image = NULL, *pos;
+    const char *searchdir;
+    uint64_t offset, str_bytes = 0, str_offset;
+    uint32_t i, j, fix_count = 0, searchdir_count = 0;
+    int64_t b, t;
+    int ext, pass;
+
+    /* blocks by their address */
+    s->order = malloc(s->blk_count * sizeof *s->order);
+    LY_CHECK_ERR_RETURN(!s->order, LOGMEM(s->ctx), -1);
+    for (i = 0; i < s->blk_count; ++i) {
+        s->order[i] = i;
+    }
+    qsort_r(s->order, s->blk_count, sizeof *s->order, snap_blk_cmp, s->blks);
+    for (i = 1; i < s->blk_count; ++i) {
+        if (s->blks[s->order[i - 1]].addr + s->blks[s->order[i - 1]].size > s->blks[s->order[i]].addr) {
+            LOGINT(s->ctx);
+            return -1;
+        }
+    }
+
+    /* resolve the pointers, the fixups applied later must go last */
+    fixups = malloc(s->fix_count * sizeof *fixups);
+    LY_CHECK_ERR_RETURN(!fixups, LOGMEM(s->ctx), -1);
+    for (pass = 0; pass < 3; ++pass) {
+        for (i = 0; i < s->fix_count; ++i) {
+            fix = &s->fixes[i];
+            if ((pass == 0) && ((fix->kind == SNAP_EXTPLUGIN) || (fix->kind == SNAP_SUBSTMT))) {
+                continue;
+            } else if ((pass == 1) && (fix->kind != SNAP_EXTPLUGIN)) {
+                continue;
+            } else if ((pass == 2) && (fix->kind != SNAP_SUBSTMT)) {
+                continue;
+            } else if (fix->kind == SNAP_NUL) {
+                continue;
+            }
+
+            b = snap_find(s, fix->loc);
+            if (b == -1) {
+                LOGINT(s->ctx);
+                goto error;
+            }
+            fixups[fix_count].block = b;
+            fixups[fix_count].offset = fix->loc - s->blks[b].addr;
+            fixups[fix_count].kind = fix->kind;
+            fixups[fix_count].target = 0;
+            fixups[fix_count].target_offset = 0;
+
+            switch (fix->kind) {
+            case SNAP_REF:
+            case SNAP_REF_WEAK:
+                t = snap_find(s, fix->target);
+                if (t > -1) {
+                    fixups[fix_count].kind = SNAP_REF;
+                    fixups[fix_count].target = t;
+                    fixups[fix_count].target_offset = (const char *)fix->target - s->blks[t].addr;
+                } else if ((ext = snap_find_extern(s, fix->target, &fixups[fix_count].target_offset)) > -1) {
+                    fixups[fix_count].kind = SNAP_EXTERN;
+                    fixups[fix_count].target = ext;
+                } else if (fix->kind == SNAP_REF_WEAK) {
+                    /* dangling, cleared */
+                    continue;
+                } else {
+                    LOGERR(s->ctx, LY_EINT, "Schema pointer outside of the context, cannot create a snapshot.");
+                    goto error;
+                }
+                break;
+            case SNAP_STR:
+                fixups[fix_count].target = fix->str;
+                break;
+            default:
+                break;
+            }
+            ++fix_count;
+        }
+    }
+
+    /* layout */
+    memset(&hdr, 0, sizeof hdr);
+    memcpy(hdr.magic, SNAP_MAGIC, sizeof hdr.magic);
+    hdr.version = SNAP_VERSION;
+    hdr.layout = snap_layout();
+    hdr.options = s->ctx->models.flags;
+    hdr.module_set_id = s->ctx->models.module_set_id;
+    hdr.internal_module_count = s->ctx->internal_module_count;
+    hdr.str_count = s->str_count;
+    for (i = 0; s->ctx->models.search_paths && s->ctx->models.search_paths[i]; ++i) {
+        str_bytes += strlen(s->ctx->models.search_paths[i]) + 1;
+    }
+    hdr.searchdir_count = searchdir_count = i;
+    hdr.block_count = s->blk_count;
+    hdr.fixup_count = fix_count;
+    hdr.module_count = s->ctx->models.used;
+    for (i = 0; i < s->str_count; ++i) {
+        str_bytes += strlen(s->strs[i].str) + 1;
+    }
+
+    offset = SNAP_ALIGNED(sizeof hdr);
+    hdr.str_offset = offset;
+    offset += (uint64_t)hdr.str_count * sizeof str_rec;
+    hdr.searchdir_offset = offset;
+    offset += (uint64_t)hdr.searchdir_count * sizeof str_rec;
+    hdr.block_offset = offset;
+    offset += (uint64_t)hdr.block_count * sizeof blk_rec;
+    hdr.fixup_offset = offset;
+    offset += (uint64_t)hdr.fixup_count * sizeof *fixups;
+    hdr.module_offset = offset;
+    offset += (uint64_t)hdr.module_count * sizeof(uint32_t);
+    str_offset = offset;
+    offset = SNAP_ALIGNED(offset + str_bytes);
+    for (i = 0; i < s->blk_count; ++i) {
+        s->blks[i].offset = offset;
+        offset = SNAP_ALIGNED(offset + s->blks[i].size);
+    }
+    hdr.size = offset;
+
+    image = calloc(1, hdr.size);
+    LY_CHECK_ERR_GOTO(!image, LOGMEM(s->ctx), error);
+    memcpy(image, &hdr, sizeof hdr);
+
+    /* strings */
+    pos = image + str_offset;
+    for (i = 0; i < s->str_count + searchdir_count; ++i) {
+        if (i < s->str_count) {
+            searchdir = s->strs[i].str;
+            str_rec.refs = s->strs[i].refs ? s->strs[i].refs : 1;
+        } else {
+            searchdir = s->ctx->models.search_paths[i - s->str_count];
+            str_rec.refs = 0;
+        }
+        str_rec.len = strlen(searchdir);
+        str_rec.offset = pos - image;
+        memcpy(pos, searchdir, str_rec.len + 1);
+        pos += str_rec.len + 1;
+        memcpy(image + hdr.str_offset + (uint64_t)i * sizeof str_rec, &str_rec, sizeof str_rec);
+    }
+
+    /* blocks, with all the pointers cleared */
+    for (i = 0; i < s->blk_count; ++i) {
+        blk_rec.offset = s->blks[i].offset;
+        blk_rec.size = s->blks[i].size;
+        memcpy(image + hdr.block_offset + (uint64_t)i * sizeof blk_rec, &blk_rec, sizeof blk_rec);
+        memcpy(image + s->blks[i].offset, s->blks[i].addr, s->blks[i].size);
+    }
+    for (i = 0; i < s->fix_count; ++i) {
+        b = snap_find(s, s->fixes[i].loc);
+        if (b == -1) {
+            LOGINT(s->ctx);
+            goto error;
+        }
+        memset(image + s->blks[b].offset + (s->fixes[i].loc - s->blks[b].addr), 0, sizeof(void *));
+    }
+
+    memcpy(image + hdr.fixup_offset, fixups, (size_t)fix_count * sizeof *fixups);
+
+    /* modules */
+    for (i = 0; i < hdr.module_count; ++i) {
+        b = snap_find(s, (const char *)s->ctx->models.list[i]);
+        if ((b == -1) || (s->blks[b].addr != (const char *)s->ctx->models.list[i])) {
+            LOGINT(s->ctx);
+            goto error;
+        }
+        j = b;
+        memcpy(image + hdr.module_offset + (uint64_t)i * sizeof j, &j, sizeof j);
+    }
+
+    free(fixups);
+    *data = image;
+    *size = hdr.size;
+    return 0;
+
+error:
+    free(fixups);
+    free(image);
+    return -1;
+}
+
+static void
+snap_clean(struct snap_ctx *s)
+{
+    lyht_free(s->blk_ht);
+    lyht_free(s->str_ht);
+    free(s->blks);
+    free(s->order);
+    free(s->fixes);
+    free(s->strs);
+}
+
+API int
+ly_ctx_snapshot_mem(struct ly_ctx *ctx, char **data, size_t *size)
+{
+    FUN_IN;
+
+    struct snap_ctx s;
+    int i, ret = EXIT_FAILURE;
+
+    if (!ctx || !data || !size) {
+        LOGARG;
+        return EXIT_FAILURE;
+    }
+    if (ctx->models.parsing_sub_modules_count) {
+        LOGERR(ctx, LY_EINVAL, "Cannot create a snapshot of a context while parsing a schema.");
+        return EXIT_FAILURE;
+    }
+
+    memset(&s, 0, sizeof s);
+    s.ctx = ctx;
+    s.blk_ht = lyht_new(1024, sizeof(struct snap_rec), snap_rec_equal, NULL, 1);
+    s.str_ht = lyht_new(1024, sizeof(struct snap_rec), snap_rec_equal, NULL, 1);
+    LY_CHECK_ERR_GOTO(!s.blk_ht || !s.str_ht, LOGMEM(ctx), cleanup);
+
+    for (i = 0; i < ctx->models.used; ++i) {
+        snap_module(&s, ctx->models.list[i]);
+    }
+    if (s.err || snap_write(&s, data, size)) {
+        goto cleanup;
+    }
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    snap_clean(&s);
+    return ret;
+}
+
+API int
+ly_ctx_snapshot_path(struct ly_ctx *ctx, const char *path)
+{
+    FUN_IN;
+
+    char *data;
+    size_t size;
+    FILE *f;
+    int ret = EXIT_SUCCESS;
+
+    if (!ctx || !path) {
+        LOGARG;
+        return EXIT_FAILURE;
+    }
+
+    if (ly_ctx_snapshot_mem(ctx, &data, &size)) {
+        return EXIT_FAILURE;
+    }
+
+    f = fopen(path, "w");
+    if (!f) {
+        LOGERR(ctx, LY_ESYS, "Failed to open file \"%s\" (%s).", path, strerror(errno));
+        free(data);
+        return EXIT_FAILURE;
+    }
+    if ((fwrite(data, 1, size, f) != size) | fclose(f)) {
+        LOGERR(ctx, LY_ESYS, "Failed to write the snapshot into \"%s\" (%s).", path, strerror(errno));
+        ret = EXIT_FAILURE;
+    }
+    free(data);
+
+    return ret;
+}
+
+/**
+ * @brief Check that a table of \p count records of \p rec_size bytes lies in the image.
+ */
+static int
+snap_check_table(const struct snap_header *hdr, uint64_t offset, uint64_t count, size_t rec_size)
+{
+    return (offset > hdr->size) || (count > (hdr->size - offset) / rec_size);
+}
+
+static int
+snap_check_str(const char *data, const struct snap_header *hdr, const struct snap_str *str)
+{
+    return (str->offset >= hdr->size) || (str->len >= hdr->size - str->offset) || data[str->offset + str->len];
+}
+
+static struct ly_ctx *
+snap_load(const char *data, size_t size)
+{
+    struct ly_ctx *ctx = NULL;
+    struct snap_header hdr;
+    struct snap_str str_rec;
+    struct snap_block blk_rec;
+    struct snap_fixup fix;
+    struct lys_ext *ext;
+    struct lys_ext_instance_complex *inst;
+    struct lyext_plugin_complex *plugin;
+    const char **strs = NULL;
+    char **blks = NULL, *loc;
+    uint64_t *blk_sizes = NULL;
+    void *ptr, *mem;
+    uint32_t i, j, idx, str_done = 0;
+
+    if (!data || (size < sizeof hdr)) {
+        LOGERR(NULL, LY_EINVAL, "Invalid context snapshot.");
+        return NULL;
+    }
+    memcpy(&hdr, data, sizeof hdr);
+    if (memcmp(hdr.magic, SNAP_MAGIC, sizeof hdr.magic) || (hdr.version != SNAP_VERSION) || (hdr.size != size)) {
+        LOGERR(NULL, LY_EINVAL, "Invalid context snapshot.");
+        return NULL;
+    }
+    if (hdr.layout != snap_layout()) {
+        LOGERR(NULL, LY_EINVAL, "Context snapshot was created by a different build of libyang.");
+        return NULL;
+    }
+    if (snap_check_table(&hdr, hdr.str_offset, hdr.str_count, sizeof str_rec)
+            || snap_check_table(&hdr, hdr.searchdir_offset, hdr.searchdir_count, sizeof str_rec)
+            || snap_check_table(&hdr, hdr.block_offset, hdr.block_count, sizeof blk_rec)
+            || snap_check_table(&hdr, hdr.fixup_offset, hdr.fixup_count, sizeof fix)
+            || snap_check_table(&hdr, hdr.module_offset, hdr.module_count, sizeof idx)) {
+        LOGERR(NULL, LY_EINVAL, "Invalid context snapshot.");
+        return NULL;
+    }
+
+    ctx = ly_ctx_new_empty(NULL, hdr.options);
+    if (!ctx) {
+        return NULL;
+    }
+    ctx->internal_module_count = hdr.internal_module_count;
+
+    for (i = 0; i < hdr.searchdir_count; ++i) {
+        memcpy(&str_rec, data + hdr.searchdir_offset + (uint64_t)i * sizeof str_rec, sizeof str_rec);
+        LY_CHECK_ERR_GOTO(snap_check_str(data, &hdr, &str_rec), LOGERR(ctx, LY_EINVAL, "Invalid context snapshot."), error);
+        if (ly_ctx_set_searchdir(ctx, data + str_rec.offset)) {
+            goto error;
+        }
+    }
+
+    /* dictionary */
+    strs = calloc(hdr.str_count, sizeof *strs);
+    LY_CHECK_ERR_GOTO(!strs && hdr.str_count, LOGMEM(ctx), error);
+    for (i = 0; i < hdr.str_count; ++i) {
+        memcpy(&str_rec, data + hdr.str_offset + (uint64_t)i * sizeof str_rec, sizeof str_rec);
+        LY_CHECK_ERR_GOTO(snap_check_str(data, &hdr, &str_rec) || !str_rec.refs,
+                          LOGERR(ctx, LY_EINVAL, "Invalid context snapshot."), error);
+        for (j = 0; j < str_rec.refs; ++j) {
+            strs[i] = lydict_insert(ctx, data + str_rec.offset, str_rec.len);
+        }
+        ++str_done;
+    }
+
+    /* blocks */
+    blks = calloc(hdr.block_count, sizeof *blks);
+    blk_sizes = malloc(hdr.block_count * sizeof *blk_sizes);
+    LY_CHECK_ERR_GOTO((!blks || !blk_sizes) && hdr.block_count, LOGMEM(ctx), error);
+    for (i = 0; i < hdr.block_count; ++i) {
+        memcpy(&blk_rec, data + hdr.block_offset + (uint64_t)i * sizeof blk_rec, sizeof blk_rec);
+        if (!blk_rec.size || (blk_rec.offset > hdr.size) || (blk_rec.size > hdr.size - blk_rec.offset)) {
+            LOGERR(ctx, LY_EINVAL, "Invalid context snapshot.");
+            goto error;
+        }
+        blks[i] = malloc(blk_rec.size);
+        LY_CHECK_ERR_GOTO(!blks[i], LOGMEM(ctx), error);
+        memcpy(blks[i], data + blk_rec.offset, blk_rec.size);
+        blk_sizes[i] = blk_rec.size;
+    }
+
+    /* relocation */
+    for (i = 0; i < hdr.fixup_count; ++i) {
+        memcpy(&fix, data + hdr.fixup_offset + (uint64_t)i * sizeof fix, sizeof fix);
+        if ((fix.block >= hdr.block_count) || (fix.offset + sizeof ptr > blk_sizes[fix.block])) {
+            LOGERR(ctx, LY_EINVAL, "Invalid context snapshot.");
+            goto error;
+        }
+        loc = blks[fix.block] + fix.offset;
+
+        switch (fix.kind) {
+        case SNAP_REF:
+            LY_CHECK_ERR_GOTO((fix.target >= hdr.block_count) || (fix.target_offset >= blk_sizes[fix.target]),
+                              LOGERR(ctx, LY_EINVAL, "Invalid context snapshot."), error);
+            ptr = blks[fix.target] + fix.target_offset;
+            break;
+        case SNAP_EXTERN:
+            if (fix.target == SNAP_EXTERN_CTX) {
+                LY_CHECK_ERR_GOTO(fix.target_offset >= sizeof *ctx, LOGERR(ctx, LY_EINVAL, "Invalid context snapshot."), error);
+                ptr = (char *)ctx + fix.target_offset;
+            } else {
+                LY_CHECK_ERR_GOTO((fix.target >= LY_DATA_TYPE_COUNT) || !ly_types[fix.target]
+                                  || (fix.target_offset >= sizeof *ly_types[fix.target]),
+                                  LOGERR(ctx, LY_EINVAL, "Invalid context snapshot."), error);
+                ptr = (char *)ly_types[fix.target] + fix.target_offset;
+            }
+            break;
+        case SNAP_STR:
+            LY_CHECK_ERR_GOTO(fix.target >= hdr.str_count, LOGERR(ctx, LY_EINVAL, "Invalid context snapshot."), error);
+            ptr = (void *)strs[fix.target];
+            break;
+        case SNAP_EXTPLUGIN:
+            /* all the other pointers are already relocated */
+            LY_CHECK_ERR_GOTO((fix.offset < offsetof(struct lys_ext, plugin))
+                              || ((fix.offset - offsetof(struct lys_ext, plugin)) % sizeof *ext),
+                              LOGERR(ctx, LY_EINVAL, "Invalid context snapshot."), error);
+            ext = (struct lys_ext *)(loc - offsetof(struct lys_ext, plugin));
+            ptr = ext_get_plugin(ext->name, ext->module->name, ext->module->rev ? ext->module->rev[0].date : NULL);
+            if (!ptr) {
+                LOGERR(ctx, LY_EINVAL, "Plugin of the extension \"%s:%s\" from the context snapshot not found.",
+                       ext->module->name, ext->name);
+                goto error;
+            }
+            break;
+        case SNAP_SUBSTMT:
+            LY_CHECK_ERR_GOTO(fix.offset != offsetof(struct lys_ext_instance_complex, substmt),
+                              LOGERR(ctx, LY_EINVAL, "Invalid context snapshot."), error);
+            inst = (struct lys_ext_instance_complex *)blks[fix.block];
+            plugin = (struct lyext_plugin_complex *)inst->def->plugin;
+            if (!plugin || (plugin->type != LYEXT_COMPLEX) || (plugin->instance_size != blk_sizes[fix.block])) {
+                LOGERR(ctx, LY_EINVAL, "Plugin of the extension \"%s:%s\" from the context snapshot does not match.",
+                       inst->def->module->name, inst->def->name);
+                goto error;
+            }
+            ptr = plugin->substmt;
+            break;
+        default:
+            LOGERR(ctx, LY_EINVAL, "Invalid context snapshot.");
+            goto error;
+        }
+        memcpy(loc, &ptr, sizeof ptr);
+    }
+
+    /* modules */
+    if (hdr.module_count > (unsigned int)ctx->models.size) {
+        mem = realloc(ctx->models.list, hdr.module_count * sizeof *ctx->models.list);
+        LY_CHECK_ERR_GOTO(!mem, LOGMEM(ctx), error);
+        ctx->models.list = mem;
+        ctx->models.size = hdr.module_count;
+    }
+    for (i = 0; i < hdr.module_count; ++i) {
+        memcpy(&idx, data + hdr.module_offset + (uint64_t)i * sizeof idx, sizeof idx);
+        LY_CHECK_ERR_GOTO(idx >= hdr.block_count, LOGERR(ctx, LY_EINVAL, "Invalid context snapshot."), error);
+        ctx->models.list[i] = (struct lys_module *)blks[idx];
+    }
+    ctx->models.used = hdr.module_count;
+    ctx->models.module_set_id = hdr.module_set_id;
+#ifdef LY_ENABLED_CACHE
+    ly_ctx_module_index_update(ctx, NULL);
+#endif
+
+    free(strs);
+    free(blks);
+    free(blk_sizes);
+    return ctx;
+
+error:
+    for (i = 0; blks && (i < hdr.block_count); ++i) {
+        free(blks[i]);
+    }
+    for (i = 0; i < str_done; ++i) {
+        memcpy(&str_rec, data + hdr.str_offset + (uint64_t)i * sizeof str_rec, sizeof str_rec);
+        for (j = 0; j < str_rec.refs; ++j) {
+            lydict_remove(ctx, strs[i]);
+        }
+    }
+    free(strs);
+    free(blks);
+    free(blk_sizes);
+    ly_ctx_destroy(ctx, NULL);
+    return NULL;
+}
+
+API struct ly_ctx *
+ly_ctx_new_snapshot_mem(const char *data, size_t size)
+{
+    FUN_IN;
+
+    if (!data) {
+        LOGARG;
+        return NULL;
+    }
+
+    return snap_load(data, size);
+}
+
+API struct ly_ctx *
+ly_ctx_new_snapshot_path(const char *path)
+{
+    FUN_IN;
+
+    struct ly_ctx *ctx;
+    struct stat st;
+    size_t length;
+    void *addr;
+    int fd;
+
+    if (!path) {
+        LOGARG;
+        return NULL;
+    }
+
+    fd = open(path, O_RDONLY);
+    if (fd == -1) {
+        LOGERR(NULL, LY_ESYS, "Opening file \"%s\" failed (%s).", path, strerror(errno));
+        return NULL;
+    }
+    if (fstat(fd, &st) == -1) {
+        LOGERR(NULL, LY_ESYS, "Failed to stat \"%s\" (%s).", path, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+    if (lyp_mmap(NULL, fd, 0, &length, &addr)) {
+        close(fd);
+        return NULL;
+    }
+    close(fd);
+    if (!addr) {
+        LOGERR(NULL, LY_EINVAL, "Empty context snapshot \"%s\".", path);
+        return NULL;
+    }
+
+    ctx = snap_load(addr, st.st_size);
+    lyp_munmap(addr, length);
+
+    return ctx;
+}
@@ -32,6 +32,7 @@
 #include "context.h"
 #include "tree_data.h"
 #include "parser.h"
+#include "printer.h"
 #include "resolve.h"
 #include "xml_internal.h"
 #include "tree_internal.h"
@@ -42,6 +43,9 @@ static struct lys_node *lyd_get_schema_inctx(const struct lyd_node *node, struct
 
 static struct lyd_node *lyd_dup_withsiblings_to_ctx(const struct lyd_node *node, int options, struct ly_ctx *ctx);
 
+static struct lyd_node *lyd_dup_withsiblings_r(const struct lyd_node *first, struct lyd_node *parent_dup, int options,
+                                               struct ly_ctx *ctx, int keep_flags);
+
 static struct lyd_node *lyd_new_dummy(struct lyd_node *root, struct lyd_node *parent, const struct lys_node *schema,
                                       const char *value, int dflt);
 
@@ -306,6 +310,9 @@ lyd_hash_table_val_equal(void *val1_p, void *val2_p, int mod, void *UNUSED(cb_da
     case LYS_LEAF:
     case LYS_ANYXML:
     case LYS_ANYDATA:
+    case LYS_RPC:
+    case LYS_ACTION:
+    case LYS_NOTIF:
         return 1;
     case LYS_LEAFLIST:
     case LYS_LIST:
@@ -344,6 +351,26 @@ lyd_hash_keyless_list_dfs(struct lyd_node *child, uint32_t *hash)
     }
 }
 
+uint32_t
+lyd_hash_seed(struct lys_node *schema)
+{
+    const char *mod_name;
+    uint32_t seed;
+
+    /* several threads may be hashing data of the same schema, they all compute and store the same value */
+    seed = __atomic_load_n(&schema->hash_seed, __ATOMIC_RELAXED);
+    if (seed) {
+        return seed;
+    }
+
+    mod_name = lys_node_module(schema)->name;
+    seed = dict_hash_multi(0, mod_name, strlen(mod_name));
+    seed = dict_hash_multi(seed, schema->name, strlen(schema->name));
+
+    __atomic_store_n(&schema->hash_seed, seed, __ATOMIC_RELAXED);
+    return seed;
+}
+
 int
 lyd_hash(struct lyd_node *node)
 {
@@ -351,8 +378,7 @@ lyd_hash(struct lyd_node *node)
     int i;
 
     if ((node->schema->nodetype != LYS_LIST) || lyd_list_has_keys(node)) {
-        node->hash = dict_hash_multi(0, lyd_node_module(node)->name, strlen(lyd_node_module(node)->name));
-        node->hash = dict_hash_multi(node->hash, node->schema->name, strlen(node->schema->name));
+        node->hash = lyd_hash_seed(node->schema);
         if (node->schema->nodetype == LYS_LEAFLIST) {
             node->hash = dict_hash_multi(node->hash, ((struct lyd_node_leaf_list *)node)->value_str,
                                         strlen(((struct lyd_node_leaf_list *)node)->value_str));
@@ -375,6 +401,288 @@ lyd_hash(struct lyd_node *node)
     return 1;
 }
 
+/**
+ * @brief Record of an indexed top-level data node, see ::ly_ctx#root_nodes.
+ */
+struct lyd_root_rec {
+    struct lyd_node *node;
+    struct lyd_root_idx *idx;   /* index of the node and its siblings */
+    uint32_t hash;              /* hash the node is stored with in idx->ht, 0 if it is not there */
+};
+
+static int
+lyd_root_rec_equal(void *val1_p, void *val2_p, int UNUSED(mod), void *UNUSED(cb_data))
+{
+    return ((struct lyd_root_rec *)val1_p)->node == ((struct lyd_root_rec *)val2_p)->node;
+}
+
+static uint32_t
+lyd_root_rec_hash(struct lyd_node *node)
+{
+    uint32_t hash;
+
+    hash = dict_hash_multi(0, (const char *)&node, sizeof node);
+    return dict_hash_multi(hash, NULL, 0);
+}
+
+int
+lyd_root_nodes_init(struct ly_ctx *ctx)
+{
+    ctx->root_nodes = lyht_new(8, sizeof(struct lyd_root_rec), lyd_root_rec_equal, NULL, 1);
+    LY_CHECK_ERR_RETURN(!ctx->root_nodes, LOGMEM(ctx), -1);
+    return 0;
+}
+
+void
+lyd_root_nodes_free(struct ly_ctx *ctx)
+{
+    struct lyd_root_rec *rec;
+    uint32_t i;
+
+    if (!ctx->root_nodes) {
+        return;
+    }
+
+    /* data trees not freed before their context */
+    for (i = 0; i < ctx->root_nodes->size; ++i) {
+        if (ctx->root_nodes->ctrl[i] != LYHT_CTRL_EMPTY) {
+            rec = (struct lyd_root_rec *)lyht_get_rec(ctx->root_nodes->recs, ctx->root_nodes->rec_size, i)->val;
+            if (!--rec->idx->count) {
+                lyht_free(rec->idx->ht);
+                free(rec->idx);
+            }
+        }
+    }
+    lyht_free(ctx->root_nodes);
+    ctx->root_nodes = NULL;
+}
+
+/* ctx->root_lock must be held, the record is valid only until the records change */
+static struct lyd_root_rec *
+lyd_root_rec_find(struct ly_ctx *ctx, struct lyd_node *node)
+{
+    struct lyd_root_rec rec, *match = NULL;
+
+    assert(node->root_idx);
+
+    rec.node = node;
+    if (lyht_find(ctx->root_nodes, &rec, lyd_root_rec_hash(node), (void **)&match)) {
+        assert(0);
+        return NULL;
+    }
+    return match;
+}
+
+/* put the node into the index hash table with its current hash, if it has one */
+static void
+lyd_root_rec_rehash(struct lyd_root_rec *rec)
+{
+    struct lyd_node *node = rec->node;
+    int r;
+
+    if (rec->hash) {
+        r = lyht_remove(rec->idx->ht, &node, rec->hash);
+        assert(!r);
+        (void)r;
+        rec->hash = 0;
+    }
+
+    if (node->hash && ((node->schema->nodetype != LYS_LIST) || lyd_list_has_keys(node))) {
+        r = lyht_insert(rec->idx->ht, &node, node->hash, NULL);
+        assert(!r);
+        (void)r;
+        rec->hash = node->hash;
+    }
+}
+
+/* ctx->root_lock must be held, node is any sibling in the index */
+static struct lyd_node *
+lyd_root_idx_first(struct lyd_root_idx *idx, struct lyd_node *node)
+{
+    if (!idx->first) {
+        idx->first = node;
+    }
+    for (; idx->first->prev->next; idx->first = idx->first->prev);
+    return idx->first;
+}
+
+/* ctx->root_lock must be held */
+static void
+lyd_root_idx_add(struct ly_ctx *ctx, struct lyd_root_idx *idx, struct lyd_node *node)
+{
+    struct lyd_root_rec rec, *match = NULL;
+    int r;
+
+    assert(!node->root_idx && !node->parent);
+
+    rec.node = node;
+    rec.idx = idx;
+    rec.hash = 0;
+    r = lyht_insert(ctx->root_nodes, &rec, lyd_root_rec_hash(node), (void **)&match);
+    assert(!r);
+    (void)r;
+
+    node->root_idx = 1;
+    ++idx->count;
+    lyd_root_rec_rehash(match);
+}
+
+/* ctx->root_lock must be held, frees the index if it was the last node */
+static void
+lyd_root_idx_remove(struct ly_ctx *ctx, struct lyd_node *node)
+{
+    struct lyd_root_rec *rec;
+    struct lyd_root_idx *idx;
+    int r;
+
+    rec = lyd_root_rec_find(ctx, node);
+    idx = rec->idx;
+    if (rec->hash) {
+        r = lyht_remove(idx->ht, &node, rec->hash);
+        assert(!r);
+        (void)r;
+    }
+    r = lyht_remove(ctx->root_nodes, rec, lyd_root_rec_hash(node));
+    assert(!r);
+    (void)r;
+    node->root_idx = 0;
+
+    if (!--idx->count) {
+        lyht_free(idx->ht);
+        free(idx);
+    } else if (idx->first == node) {
+        /* the next sibling becomes the first one if the node is still the first, otherwise it is not known */
+        if (!node->prev->next && node->next && node->next->root_idx && (lyd_root_rec_find(ctx, node->next)->idx == idx)) {
+            idx->first = node->next;
+        } else {
+            idx->first = NULL;
+        }
+    }
+}
+
+/**
+ * @brief Remove a top-level data node from the index of its siblings.
+ *
+ * @param[in] node Indexed node.
+ * @param[out] first First sibling of \p node while it is still linked to its siblings, optional.
+ */
+static void
+lyd_root_unlink(struct lyd_node *node, struct lyd_node **first)
+{
+    struct ly_ctx *ctx = node->schema->module->ctx;
+
+    pthread_mutex_lock(&ctx->root_lock);
+    if (first) {
+        *first = lyd_root_idx_first(lyd_root_rec_find(ctx, node)->idx, node);
+    }
+    lyd_root_idx_remove(ctx, node);
+    pthread_mutex_unlock(&ctx->root_lock);
+}
+
+/**
+ * @brief Add a top-level data node just linked to its siblings into their index, if they have one.
+ *
+ * @param[in] node Inserted node, removed from any previous index.
+ * @param[in] sibling Any other sibling of \p node.
+ */
+static void
+lyd_root_link(struct lyd_node *node, struct lyd_node *sibling)
+{
+    struct ly_ctx *ctx = node->schema->module->ctx;
+    struct lyd_root_idx *idx;
+
+    if (!node->root_idx && (!sibling || !sibling->root_idx)) {
+        return;
+    }
+
+    pthread_mutex_lock(&ctx->root_lock);
+    idx = (sibling && sibling->root_idx) ? lyd_root_rec_find(ctx, sibling)->idx : NULL;
+    if (node->root_idx) {
+        if (lyd_root_rec_find(ctx, node)->idx == idx) {
+            /* still in the same tree */
+            pthread_mutex_unlock(&ctx->root_lock);
+            return;
+        }
+        lyd_root_idx_remove(ctx, node);
+    }
+    if (idx) {
+        lyd_root_idx_add(ctx, idx, node);
+    }
+    pthread_mutex_unlock(&ctx->root_lock);
+}
+
+/**
+ * @brief Update the hash of a top-level data node in the index of its siblings after it has changed.
+ *
+ * @param[in] node Indexed node.
+ */
+static void
+lyd_root_rehash(struct lyd_node *node)
+{
+    struct ly_ctx *ctx = node->schema->module->ctx;
+
+    pthread_mutex_lock(&ctx->root_lock);
+    lyd_root_rec_rehash(lyd_root_rec_find(ctx, node));
+    pthread_mutex_unlock(&ctx->root_lock);
+}
+
+/**
+ * @brief Get the first top-level sibling of an indexed node.
+ *
+ * @param[in] node Indexed node.
+ * @return First sibling of \p node.
+ */
+static struct lyd_node *
+lyd_root_first(struct lyd_node *node)
+{
+    struct ly_ctx *ctx = node->schema->module->ctx;
+    struct lyd_node *first;
+
+    pthread_mutex_lock(&ctx->root_lock);
+    first = lyd_root_idx_first(lyd_root_rec_find(ctx, node)->idx, node);
+    pthread_mutex_unlock(&ctx->root_lock);
+
+    return first;
+}
+
+struct hash_table *
+lyd_root_ht(struct lyd_node *sibling)
+{
+    struct ly_ctx *ctx = sibling->schema->module->ctx;
+    struct lyd_root_idx *idx = NULL;
+    struct lyd_node *first, *iter;
+    uint32_t count;
+
+    assert(!sibling->parent);
+
+    pthread_mutex_lock(&ctx->root_lock);
+    if (sibling->root_idx) {
+        idx = lyd_root_rec_find(ctx, sibling)->idx;
+        goto cleanup;
+    }
+
+    /* an index pays off only for enough siblings */
+    for (first = sibling; first->prev->next; first = first->prev);
+    for (count = 0, iter = first; iter && (count < LY_CACHE_ROOT_MIN_SIBLINGS); iter = iter->next, ++count);
+    if (count < LY_CACHE_ROOT_MIN_SIBLINGS) {
+        goto cleanup;
+    }
+
+    idx = calloc(1, sizeof *idx);
+    LY_CHECK_ERR_GOTO(!idx, LOGMEM(ctx), cleanup);
+    idx->ht = lyht_new(1, sizeof(struct lyd_node *), lyd_hash_table_val_equal, NULL, 1);
+    LY_CHECK_ERR_GOTO(!idx->ht, LOGMEM(ctx); free(idx); idx = NULL, cleanup);
+    idx->first = first;
+
+    LY_TREE_FOR(first, iter) {
+        lyd_root_idx_add(ctx, idx, iter);
+    }
+
+cleanup:
+    pthread_mutex_unlock(&ctx->root_lock);
+    return idx ? idx->ht : NULL;
+}
+
 static void
 lyd_keyless_list_hash_change(struct lyd_node *parent)
 {
@@ -396,6 +704,8 @@ lyd_keyless_list_hash_change(struct lyd_node *parent)
                     r = lyht_insert(parent->parent->ht, &parent, parent->hash, NULL);
                     assert(!r);
                     (void)r;
+                } else if (parent->root_idx) {
+                    lyd_root_rehash(parent);
                 }
             } else if (!lyd_list_has_keys(parent)) {
                 /* a parent is a list without keys so it cannot be a part of any parent hash */
@@ -457,6 +767,9 @@ _lyd_insert_hash(struct lyd_node *node, int keyless_list_check)
                 lyd_keyless_list_hash_change(node->parent);
             }
         }
+    } else if (node->root_idx) {
+        /* a top-level list may have just got its hash */
+        lyd_root_rehash(node);
     }
 }
 
@@ -498,6 +811,9 @@ _lyd_unlink_hash(struct lyd_node *node, struct lyd_node *orig_parent, int keyles
         if (lys_is_key((struct lys_node_leaf *)node->schema, NULL) && orig_parent->hash) {
             _lyd_unlink_hash(orig_parent, orig_parent->parent, 0);
             orig_parent->hash = 0;
+            if (orig_parent->root_idx) {
+                lyd_root_rehash(orig_parent);
+            }
         }
 
         /* if node was in a state data subtree, shouldn't it be a part of a key-less list hash? */
@@ -516,6 +832,44 @@ lyd_unlink_hash(struct lyd_node *node, struct lyd_node *orig_parent)
 
 #endif
 
+/**
+ * @brief Mark the node and all its ancestors as dirty so that incremental validation (#LYD_OPT_VAL_INCR)
+ * descends into them.
+ *
+ * @param[in] node Parent of the changed node, can be NULL for a top-level change.
+ */
+static void
+lyd_val_dirty(struct lyd_node *node)
+{
+    /* if a node is already dirty, so are all its ancestors */
+    for (; node && !(node->validity & LYD_VAL_DIRTY); node = node->parent) {
+        node->validity |= LYD_VAL_DIRTY;
+    }
+}
+
+/**
+ * @brief Check whether incremental validation (#LYD_OPT_VAL_INCR) can skip a data node subtree.
+ *
+ * @param[in] node Data node to check.
+ * @param[in,out] options Validation options, incremental validation is turned off for newly inserted subtrees
+ * since they must be checked completely.
+ * @return 1 if the subtree did not change and can be skipped, 0 otherwise.
+ */
+static int
+lyd_val_incr_skip(const struct lyd_node *node, int *options)
+{
+    if (!(*options & LYD_OPT_VAL_INCR)) {
+        return 0;
+    }
+
+    if (node->validity & LYD_VAL_SUBTREE) {
+        *options &= ~LYD_OPT_VAL_INCR;
+        return 0;
+    }
+
+    return (node->validity & LYD_VAL_DIRTY) ? 0 : 1;
+}
+
 /**
  * @brief get the list of \p data's siblings of the given schema
  */
@@ -700,7 +1054,7 @@ lyd_check_mandatory_subtree(struct lyd_node *tree, struct lyd_node *subtree, str
     struct lyd_node *iter;
     struct ly_set *present = NULL;
     unsigned int u;
-    int ret = EXIT_FAILURE;
+    int opts, ret = EXIT_FAILURE;
 
     assert(schema);
 
@@ -741,8 +1095,12 @@ lyd_check_mandatory_subtree(struct lyd_node *tree, struct lyd_node *subtree, str
 
         /* go recursively */
         for (u = 0; u < present->number; u++) {
+            opts = options;
+            if (lyd_val_incr_skip(present->set.d[u], &opts)) {
+                continue;
+            }
             LY_TREE_FOR(schema->child, siter) {
-                if (lyd_check_mandatory_subtree(tree, present->set.d[u], present->set.d[u], siter, 0, options)) {
+                if (lyd_check_mandatory_subtree(tree, present->set.d[u], present->set.d[u], siter, 0, opts)) {
                     goto error;
                 }
             }
@@ -750,12 +1108,16 @@ lyd_check_mandatory_subtree(struct lyd_node *tree, struct lyd_node *subtree, str
         break;
 
     case LYS_CONTAINER:
+        opts = options;
+        if (present->number && lyd_val_incr_skip(present->set.d[0], &opts)) {
+            break;
+        }
         if (present->number || !((struct lys_node_container *)schema)->presence) {
             /* if we have existing or non-presence container, go recursively */
             LY_TREE_FOR(schema->child, siter) {
                 if (lyd_check_mandatory_subtree(tree, present->number ? present->set.d[0] : NULL,
                                                 present->number ? present->set.d[0] : last_parent,
-                                                siter, 0, options)) {
+                                                siter, 0, opts)) {
                     goto error;
                 }
             }
@@ -925,45 +1287,35 @@ lyd_check_mandatory_tree(struct lyd_node *root, struct ly_ctx *ctx, const struct
 
 static struct lyd_node *
 lyd_parse_(struct ly_ctx *ctx, const struct lyd_node *rpc_act, const char *data, LYD_FORMAT format, int options,
-           const struct lyd_node *data_tree, const char *yang_data_name)
+           const struct lyd_node *data_tree, const char *yang_data_name, const struct ly_set *filter)
 {
-    struct lyxml_elem *xml;
     struct lyd_node *result = NULL;
-    int xmlopt = LYXML_PARSE_MULTIROOT;
 
     if (!ctx || !data) {
         LOGARG;
         return NULL;
     }
 
-    if (options & LYD_OPT_NOSIBLINGS) {
-        xmlopt = 0;
+    /* validation-only flag */
+    options &= ~LYD_OPT_VAL_INCR;
+
+    if ((options & LYD_OPT_LYB_FILTER) && (format != LYD_LYB)) {
+        LOGERR(ctx, LY_EINVAL, "%s: Invalid options 0x%x (LYD_OPT_LYB_FILTER can be used only with LYB format).",
+               __func__, options);
+        return NULL;
     }
 
     /* we must free all the errors, otherwise we are unable to properly check returned ly_errno :-/ */
     ly_errno = LY_SUCCESS;
     switch (format) {
     case LYD_XML:
-        xml = lyxml_parse_mem(ctx, data, xmlopt);
-        if (ly_errno) {
-            break;
-        }
-        if (options & LYD_OPT_RPCREPLY) {
-            result = lyd_parse_xml(ctx, &xml, options, rpc_act, data_tree);
-        } else if (options & (LYD_OPT_RPC | LYD_OPT_NOTIF)) {
-            result = lyd_parse_xml(ctx, &xml, options, data_tree);
-        } else if (options & LYD_OPT_DATA_TEMPLATE) {
-            result = lyd_parse_xml(ctx, &xml, options, yang_data_name);
-        } else {
-            result = lyd_parse_xml(ctx, &xml, options);
-        }
-        lyxml_free_withsiblings(ctx, xml);
+        result = lyd_parse_xml_mem(ctx, data, options, rpc_act, data_tree, yang_data_name);
         break;
     case LYD_JSON:
         result = lyd_parse_json(ctx, data, options, rpc_act, data_tree, yang_data_name);
         break;
     case LYD_LYB:
-        result = lyd_parse_lyb(ctx, data, options, data_tree, yang_data_name, NULL);
+        result = lyd_parse_lyb(ctx, data, options, data_tree, yang_data_name, filter, NULL);
         break;
     default:
         /* error */
@@ -989,6 +1341,7 @@ lyd_parse_data_(struct ly_ctx *ctx, const char *data, LYD_FORMAT format, int opt
 {
     const struct lyd_node *rpc_act = NULL, *data_tree = NULL, *iter;
     const char *yang_data_name = NULL;
+    const struct ly_set *filter = NULL;
 
     if (lyp_data_check_options(ctx, options, __func__)) {
         return NULL;
@@ -1031,8 +1384,15 @@ lyd_parse_data_(struct ly_ctx *ctx, const char *data, LYD_FORMAT format, int opt
     if (options & LYD_OPT_DATA_TEMPLATE) {
         yang_data_name = va_arg(ap, const char *);
     }
+    if (options & LYD_OPT_LYB_FILTER) {
+        filter = va_arg(ap, const struct ly_set *);
+        if (!filter) {
+            LOGERR(ctx, LY_EINVAL, "%s: invalid variable parameter (const struct ly_set *filter).", __func__);
+            return NULL;
+        }
+    }
 
-    return lyd_parse_(ctx, rpc_act, data, format, options, data_tree, yang_data_name);
+    return lyd_parse_(ctx, rpc_act, data, format, options, data_tree, yang_data_name, filter);
 }
 
 API struct lyd_node *
@@ -1351,6 +1711,7 @@ check_leaf_list_backlinks(struct lyd_node *node)
                         /* invalidate the leafref, a change concerning it happened */
                         leaf_list = (struct lyd_node_leaf_list *)data->set.d[j];
                         leaf_list->validity |= LYD_VAL_LEAFREF;
+                        lyd_val_dirty(leaf_list->parent);
                         validity_changed = 1;
                         if (leaf_list->value_type == LY_TYPE_LEAFREF) {
                             /* remove invalid link and put unresolved value back */
@@ -1371,6 +1732,7 @@ check_leaf_list_backlinks(struct lyd_node *node)
     /* invalidate parent to make sure it will be checked in future validation */
     if (validity_changed && node->parent) {
         node->parent->validity |= LYD_VAL_MAND;
+        lyd_val_dirty(node->parent);
     }
 }
 
@@ -1421,6 +1783,7 @@ lyd_change_leaf(struct lyd_node_leaf_list *leaf, const char *val_str)
     if (val_change) {
         /* make the node non-validated */
         leaf->validity = ly_new_node_validity(leaf->schema);
+        lyd_val_dirty(leaf->parent);
 
         /* check possible leafref backlinks */
         check_leaf_list_backlinks((struct lyd_node *)leaf);
@@ -1889,7 +2252,7 @@ lyd_new_path(struct lyd_node *data_tree, const struct ly_ctx *ctx, const char *p
     const struct lys_node *schild, *sparent, *tmp;
     const struct lys_node_list *slist;
     const struct lys_module *module, *prev_mod;
-    int r, i, parsed = 0, mod_name_len, nam_len, val_name_len, val_len;
+    int r, i, parsed = 0, mod_name_len, nam_len, val_name_len, val_len, all_siblings = 0;
     int is_relative = -1, has_predicate, first_iter = 1, edit_leaf;
     int backup_is_relative, backup_mod_name_len, yang_data_name_len;
 
@@ -1909,20 +2272,20 @@ lyd_new_path(struct lyd_node *data_tree, const struct ly_ctx *ctx, const char *p
         if (path[0] == '/') {
             /* absolute path, go through all the siblings and try to find the right parent, if exists,
              * first go through all the next siblings keeping the original order, for positional predicates */
-            for (node = data_tree; !parsed && node; node = node->next) {
+            for (node = data_tree; !parsed && !all_siblings && node; node = node->next) {
                 parent = resolve_partial_json_data_nodeid(id, value_type > LYD_ANYDATA_STRING ? NULL : value, node,
-                                                          options, &parsed);
+                                                          options, &parsed, &all_siblings);
             }
-            if (!parsed) {
+            if (!parsed && !all_siblings) {
                 for (node = data_tree->prev; !parsed && node->next; node = node->prev) {
                     parent = resolve_partial_json_data_nodeid(id, value_type > LYD_ANYDATA_STRING ? NULL : value, node,
-                                                              options, &parsed);
+                                                              options, &parsed, NULL);
                 }
             }
         } else {
             /* relative path, use only the provided data tree root */
             parent = resolve_partial_json_data_nodeid(id, value_type > LYD_ANYDATA_STRING ? NULL : value, data_tree,
-                                                      options, &parsed);
+                                                      options, &parsed, NULL);
         }
         if (parsed == -1) {
             return NULL;
@@ -2033,39 +2396,43 @@ lyd_new_path(struct lyd_node *data_tree, const struct ly_ctx *ctx, const char *p
     while (1) {
         /* find the schema node */
         schild = NULL;
-        while ((schild = lys_getnext(schild, sparent, module, 0))) {
-            if (schild->nodetype & (LYS_CONTAINER | LYS_LEAF | LYS_LEAFLIST | LYS_LIST
-                                    | LYS_ANYDATA | LYS_NOTIF | LYS_RPC | LYS_ACTION)) {
-                /* module comparison */
-                if (mod_name) {
-                    node_mod_name = lys_node_module(schild)->name;
-                    if (strncmp(node_mod_name, mod_name, mod_name_len) || node_mod_name[mod_name_len]) {
+        if (lys_child_index_find(module, sparent, mod_name ? mod_name : prev_mod->name, mod_name ? mod_name_len : 0,
+                                 name, nam_len, 0, &schild)) {
+            /* no index, go through the nodes */
+            while ((schild = lys_getnext(schild, sparent, module, 0))) {
+                if (schild->nodetype & (LYS_CONTAINER | LYS_LEAF | LYS_LEAFLIST | LYS_LIST
+                                        | LYS_ANYDATA | LYS_NOTIF | LYS_RPC | LYS_ACTION)) {
+                    /* module comparison */
+                    if (mod_name) {
+                        node_mod_name = lys_node_module(schild)->name;
+                        if (strncmp(node_mod_name, mod_name, mod_name_len) || node_mod_name[mod_name_len]) {
+                            continue;
+                        }
+                    } else if (lys_node_module(schild) != prev_mod) {
                         continue;
                     }
-                } else if (lys_node_module(schild) != prev_mod) {
-                    continue;
-                }
 
-                /* name check */
-                if (strncmp(schild->name, name, nam_len) || schild->name[nam_len]) {
-                    continue;
-                }
+                    /* name check */
+                    if (strncmp(schild->name, name, nam_len) || schild->name[nam_len]) {
+                        continue;
+                    }
 
-                /* RPC/action in/out check */
-                for (tmp = lys_parent(schild); tmp && (tmp->nodetype == LYS_USES); tmp = lys_parent(tmp));
-                if (tmp) {
-                    if (options & LYD_PATH_OPT_OUTPUT) {
-                        if (tmp->nodetype == LYS_INPUT) {
-                            continue;
-                        }
-                    } else {
-                        if (tmp->nodetype == LYS_OUTPUT) {
-                            continue;
+                    /* RPC/action in/out check */
+                    for (tmp = lys_parent(schild); tmp && (tmp->nodetype == LYS_USES); tmp = lys_parent(tmp));
+                    if (tmp) {
+                        if (options & LYD_PATH_OPT_OUTPUT) {
+                            if (tmp->nodetype == LYS_INPUT) {
+                                continue;
+                            }
+                        } else {
+                            if (tmp->nodetype == LYS_OUTPUT) {
+                                continue;
+                            }
                         }
                     }
-                }
 
-                break;
+                    break;
+                }
             }
         }
 
@@ -2495,6 +2862,10 @@ lyd_merge_node_update(struct lyd_node *target, struct lyd_node *source)
     assert(target->schema->nodetype & (LYS_LEAF | LYS_ANYDATA));
     ctx = target->schema->module->ctx;
 
+    /* the value is going to change, validate the node again */
+    target->validity |= LYD_VAL_MAND;
+    lyd_val_dirty(target->parent);
+
     if (ctx == source->schema->module->ctx) {
         /* source and targets are in the same context */
         if (target->schema->nodetype == LYS_LEAF) {
@@ -2907,6 +3278,72 @@ src_insert:
     return 0;
 }
 
+#ifdef LY_ENABLED_CACHE
+
+/**
+ * @brief Find the top-level target sibling matching a source node using the index of the siblings.
+ *
+ * @param[in] target Top-level target node.
+ * @param[in] src Source node.
+ * @param[out] trg Matching target sibling, NULL if there is none.
+ * @param[out] ret Match result, the same as of lyd_merge_node_equal().
+ * @return 1 if the index was searched, 0 if it cannot be used.
+ */
+static int
+lyd_merge_root_find(struct lyd_node *target, struct lyd_node *src, struct lyd_node **trg, int *ret)
+{
+    struct hash_table *ht;
+    struct lyd_node **trg_p;
+
+    if (target->schema->module->ctx != src->schema->module->ctx) {
+        /* hashes match, but schema nodes do not */
+        return 0;
+    }
+
+    /* trees are supposed to be validated so all nodes must have their hash, but lets not be that strict */
+    if (!src->hash) {
+        lyd_hash(src);
+    }
+    if (!src->hash || !(ht = lyd_root_ht(target))) {
+        return 0;
+    }
+
+    *trg = NULL;
+    *ret = 0;
+    if (lyht_find(ht, &src, src->hash, (void **)&trg_p)) {
+        return 1;
+    }
+    *trg = *trg_p;
+    *ret = 1;
+
+    /* it is a bit more difficult with keyless state lists and leaf-lists */
+    if ((((*trg)->schema->nodetype == LYS_LIST) && !((struct lys_node_list *)(*trg)->schema)->keys_size)
+            || (((*trg)->schema->nodetype == LYS_LEAFLIST) && ((*trg)->schema->flags & LYS_CONFIG_R))) {
+        assert((*trg)->schema->flags & LYS_CONFIG_R);
+
+        while (*trg && (((*trg)->validity & LYD_VAL_INUSE) || !lyd_hash_table_val_equal(&src, trg, 0, NULL))) {
+            /* state lists, find one not-already-found */
+            if (lyht_find_next(ht, trg, src->hash, (void **)&trg_p)) {
+                *trg = NULL;
+            } else {
+                *trg = *trg_p;
+            }
+        }
+        if (*trg) {
+            /* mark it as matched */
+            (*trg)->validity |= LYD_VAL_INUSE;
+            *ret = 2;
+        } else {
+            /* actually, it was matched already and no other instance found, so now not a match */
+            *ret = 0;
+        }
+    }
+
+    return 1;
+}
+
+#endif
+
 /* spends source */
 static int
 lyd_merge_siblings(struct lyd_node *target, struct lyd_node *source, int options)
@@ -2915,59 +3352,64 @@ lyd_merge_siblings(struct lyd_node *target, struct lyd_node *source, int options
     int ret, clear_flag = 0;
     struct ly_ctx *ctx = target->schema->module->ctx; /* shortcut */
 
-    while (target->prev->next) {
-        target = target->prev;
-    }
+    target = lyd_first_sibling(target);
 
     LY_TREE_FOR_SAFE(source, src_backup, src) {
-        LY_TREE_FOR(target, trg) {
+#ifdef LY_ENABLED_CACHE
+        if (!lyd_merge_root_find(target, src, &trg, &ret))
+#endif
+        {
+            LY_TREE_FOR(target, trg) {
+                /* schema match, data match? */
+                ret = lyd_merge_node_schema_equal(trg, src);
+                if (ret == 1) {
+                    ret = lyd_merge_node_equal(trg, src);
+                }
+                if (ret) {
+                    break;
+                }
+            }
+        }
+
+        if (trg && (ret == -1)) {
+            lyd_free_withsiblings(source);
+            return 1;
+        } else if (trg && ret) {
             /* sibling found, merge it */
-            ret = lyd_merge_node_schema_equal(trg, src);
-            if (ret == 1) {
-                ret = lyd_merge_node_equal(trg, src);
+            if (ret == 2) {
+                clear_flag = 1;
             }
-            if (ret > 0) {
+
+            switch (trg->schema->nodetype) {
+            case LYS_LEAF:
+            case LYS_ANYXML:
+            case LYS_ANYDATA:
+                lyd_merge_node_update(trg, src);
+                break;
+            case LYS_LEAFLIST:
+                /* it's already there, nothing to do */
+                break;
+            case LYS_LIST:
+            case LYS_CONTAINER:
+            case LYS_NOTIF:
+            case LYS_RPC:
+            case LYS_INPUT:
+            case LYS_OUTPUT:
+                ret = lyd_merge_parent_children(trg, src->child, options);
                 if (ret == 2) {
                     clear_flag = 1;
-                }
-
-                switch (trg->schema->nodetype) {
-                case LYS_LEAF:
-                case LYS_ANYXML:
-                case LYS_ANYDATA:
-                    lyd_merge_node_update(trg, src);
-                    break;
-                case LYS_LEAFLIST:
-                    /* it's already there, nothing to do */
-                    break;
-                case LYS_LIST:
-                case LYS_CONTAINER:
-                case LYS_NOTIF:
-                case LYS_RPC:
-                case LYS_INPUT:
-                case LYS_OUTPUT:
-                    ret = lyd_merge_parent_children(trg, src->child, options);
-                    if (ret == 2) {
-                        clear_flag = 1;
-                    } else if (ret) {
-                        lyd_free_withsiblings(source);
-                        return 1;
-                    }
-                    break;
-                default:
-                    LOGINT(ctx);
+                } else if (ret) {
                     lyd_free_withsiblings(source);
                     return 1;
                 }
                 break;
-            } else if (ret == -1) {
+            default:
+                LOGINT(ctx);
                 lyd_free_withsiblings(source);
                 return 1;
-            } /* else not equal, nothing to do */
-        }
-
-        /* sibling not found, insert it */
-        if (!trg) {
+            }
+        } else {
+            /* sibling not found, insert it */
             if (ctx != src->schema->module->ctx) {
                 ins = lyd_dup_to_ctx(src, 1, ctx);
             } else {
@@ -3757,10 +4199,14 @@ lyd_diff(struct lyd_node *first, struct lyd_node *second, int options)
 
 #ifdef LY_ENABLED_CACHE
         struct lyd_node **iter_p;
+        struct hash_table *sibs_ht = NULL;
 
-        if (elem1 && elem1->parent && elem1->parent->ht) {
+        if (elem1) {
+            sibs_ht = elem1->parent ? elem1->parent->ht : lyd_root_ht(elem1);
+        }
+        if (sibs_ht) {
             iter = NULL;
-            if (!lyht_find(elem1->parent->ht, &elem2, elem2->hash, (void **)&iter_p)) {
+            if (!lyht_find(sibs_ht, &elem2, elem2->hash, (void **)&iter_p)) {
                 iter = *iter_p;
                 /* we found a match */
                 if (iter->dflt && !(options & LYD_DIFFOPT_WITHDEFAULTS)) {
@@ -3771,7 +4217,7 @@ lyd_diff(struct lyd_node *first, struct lyd_node *second, int options)
                 while (iter && (iter->validity & LYD_VAL_INUSE)) {
                     /* state lists, find one not-already-found */
                     assert((iter->schema->nodetype & (LYS_LIST | LYS_LEAFLIST)) && (iter->schema->flags & LYS_CONFIG_R));
-                    if (lyht_find_next(elem1->parent->ht, &iter, iter->hash, (void **)&iter_p)) {
+                    if (lyht_find_next(sibs_ht, &iter, iter->hash, (void **)&iter_p)) {
                         iter = NULL;
                     } else {
                         iter = *iter_p;
@@ -4186,6 +4632,482 @@ error:
     return NULL;
 }
 
+/**
+ * @brief Print a string quoted and escaped into a diff patch.
+ *
+ * @param[in] out Output to print into.
+ * @param[in] str String to print, NULL for an empty string.
+ */
+static void
+lyd_diff_print_str(struct lyout *out, const char *str)
+{
+    const char *start;
+
+    ly_write(out, "\"", 1);
+    for (start = str; str && *str; ++str) {
+        if ((*str != '"') && (*str != '\\') && (*str != '\n') && (*str != '\t')) {
+            continue;
+        }
+
+        /* flush the plain characters and escape this one */
+        ly_write(out, start, str - start);
+        switch (*str) {
+        case '\n':
+            ly_write(out, "\\n", 2);
+            break;
+        case '\t':
+            ly_write(out, "\\t", 2);
+            break;
+        default:
+            ly_write(out, "\\", 1);
+            ly_write(out, str, 1);
+            break;
+        }
+        start = str + 1;
+    }
+    if (str) {
+        ly_write(out, start, str - start);
+    }
+    ly_write(out, "\"", 1);
+}
+
+/**
+ * @brief Print the data path of a node quoted into a diff patch.
+ *
+ * @param[in] out Output to print into.
+ * @param[in] node Node to print the path of, NULL for an empty path.
+ * @return 0 on success, -1 on error.
+ */
+static int
+lyd_diff_print_path(struct lyout *out, const struct lyd_node *node)
+{
+    char *path = NULL;
+
+    if (node) {
+        path = lyd_path(node);
+        if (!path) {
+            return -1;
+        }
+    }
+    lyd_diff_print_str(out, path);
+    free(path);
+
+    return 0;
+}
+
+/**
+ * @brief Print the value of a leaf, leaf-list or anydata node into a diff patch, preceded by a space.
+ *
+ * Anydata values are preceded by a letter of their type, 's' for a plain string, 'x' for XML and 'j' for JSON.
+ *
+ * @param[in] out Output to print into.
+ * @param[in] node Node to print the value of.
+ * @return 0 on success, -1 on error.
+ */
+static int
+lyd_diff_print_value(struct lyout *out, const struct lyd_node *node)
+{
+    const struct lyd_node_anydata *any;
+    char *str = NULL;
+    int r = 0;
+
+    if (node->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST)) {
+        ly_write(out, " ", 1);
+        lyd_diff_print_str(out, ((struct lyd_node_leaf_list *)node)->value_str);
+        return 0;
+    }
+
+    any = (const struct lyd_node_anydata *)node;
+    if (!any->value.str) {
+        ly_write(out, " s", 2);
+        lyd_diff_print_str(out, NULL);
+        return 0;
+    }
+    switch (any->value_type) {
+    case LYD_ANYDATA_CONSTSTRING:
+        ly_write(out, " s", 2);
+        lyd_diff_print_str(out, any->value.str);
+        break;
+    case LYD_ANYDATA_SXML:
+        ly_write(out, " x", 2);
+        lyd_diff_print_str(out, any->value.str);
+        break;
+    case LYD_ANYDATA_JSON:
+        ly_write(out, " j", 2);
+        lyd_diff_print_str(out, any->value.str);
+        break;
+    case LYD_ANYDATA_DATATREE:
+        r = lyd_print_mem(&str, any->value.tree, LYD_XML, LYP_WITHSIBLINGS);
+        break;
+    case LYD_ANYDATA_XML:
+        r = (lyxml_print_mem(&str, any->value.xml, LYXML_PRINT_SIBLINGS) < 0) ? -1 : 0;
+        break;
+    default:
+        LOGERR(node->schema->module->ctx, LY_EINVAL, "Value of \"%s\" cannot be printed into a diff patch.",
+               node->schema->name);
+        return -1;
+    }
+
+    if ((any->value_type == LYD_ANYDATA_DATATREE) || (any->value_type == LYD_ANYDATA_XML)) {
+        if (!r) {
+            ly_write(out, " x", 2);
+            lyd_diff_print_str(out, str);
+        }
+        free(str);
+    }
+    return r ? -1 : 0;
+}
+
+/**
+ * @brief Print a created node with all its explicit descendants into a diff patch.
+ *
+ * @param[in] out Output to print into.
+ * @param[in] node Created node.
+ * @return 0 on success, -1 on error.
+ */
+static int
+lyd_diff_print_created(struct lyout *out, const struct lyd_node *node)
+{
+    const struct lyd_node *next, *elem;
+
+    LY_TREE_DFS_BEGIN(node, next, elem) {
+        /* default nodes are created by the validation and keys together with their list */
+        if ((elem == node) || (!elem->dflt && !lys_is_key((struct lys_node_leaf *)elem->schema, NULL))) {
+            ly_write(out, "+ ", 2);
+            if (lyd_diff_print_path(out, elem)) {
+                return -1;
+            }
+            if ((elem->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST | LYS_ANYDATA)) && lyd_diff_print_value(out, elem)) {
+                return -1;
+            }
+            ly_write(out, "\n", 1);
+        }
+        LY_TREE_DFS_END(node, next, elem);
+    }
+
+    return 0;
+}
+
+API int
+lyd_diff_print_mem(char **strp, const struct lyd_difflist *diff)
+{
+    FUN_IN;
+
+    struct lyout out;
+    uint32_t i;
+    int r = 0;
+
+    if (!strp || !diff) {
+        LOGARG;
+        return -1;
+    }
+
+    memset(&out, 0, sizeof out);
+    out.type = LYOUT_MEMORY;
+
+    for (i = 0; !r && (diff->type[i] != LYD_DIFF_END); ++i) {
+        switch (diff->type[i]) {
+        case LYD_DIFF_DELETED:
+            ly_write(&out, "- ", 2);
+            r = lyd_diff_print_path(&out, diff->first[i]);
+            break;
+        case LYD_DIFF_CHANGED:
+            ly_write(&out, "= ", 2);
+            r = lyd_diff_print_path(&out, diff->second[i]);
+            if (!r) {
+                r = lyd_diff_print_value(&out, diff->second[i]);
+            }
+            break;
+        case LYD_DIFF_MOVEDAFTER1:
+            /* the moved node and its new predecessor, both in the first tree */
+            ly_write(&out, "> ", 2);
+            r = lyd_diff_print_path(&out, diff->first[i]);
+            if (!r) {
+                ly_write(&out, " ", 1);
+                r = lyd_diff_print_path(&out, diff->second[i]);
+            }
+            break;
+        case LYD_DIFF_CREATED:
+            r = lyd_diff_print_created(&out, diff->second[i]);
+            /* the lines are finished */
+            continue;
+        case LYD_DIFF_MOVEDAFTER2:
+            /* the moved node and its new predecessor, both in the second tree */
+            ly_write(&out, "> ", 2);
+            r = lyd_diff_print_path(&out, diff->second[i]);
+            if (!r) {
+                ly_write(&out, " ", 1);
+                r = lyd_diff_print_path(&out, diff->first[i]);
+            }
+            break;
+        case LYD_DIFF_END:
+            /* unreachable */
+            break;
+        }
+        ly_write(&out, "\n", 1);
+    }
+
+    if (r) {
+        free(out.method.mem.buf);
+        *strp = NULL;
+        return -1;
+    }
+
+    if (!out.method.mem.buf) {
+        /* no differences */
+        *strp = strdup("");
+        LY_CHECK_ERR_RETURN(!*strp, LOGMEM(NULL), -1);
+    } else {
+        *strp = out.method.mem.buf;
+    }
+    return 0;
+}
+
+/**
+ * @brief Parse a quoted string of a diff patch.
+ *
+ * @param[in] ctx Context for logging.
+ * @param[in,out] patch Patch pointing to the opening quote, moved behind the closing quote.
+ * @param[out] str Unescaped string.
+ * @return 0 on success, -1 on error.
+ */
+static int
+lyd_diff_parse_str(struct ly_ctx *ctx, const char **patch, char **str)
+{
+    const char *p = *patch;
+    size_t len = 0;
+
+    if (*p != '"') {
+        LOGERR(ctx, LY_EINVAL, "Invalid diff patch, expected a quoted string (%.10s).", p);
+        return -1;
+    }
+
+    /* the unescaped string is never longer */
+    for (++p; *p && (*p != '"'); ++p) {
+        if ((*p == '\\') && p[1]) {
+            ++p;
+        }
+    }
+    if (!*p) {
+        LOGERR(ctx, LY_EINVAL, "Invalid diff patch, unterminated quoted string.");
+        return -1;
+    }
+    *str = malloc(p - *patch);
+    LY_CHECK_ERR_RETURN(!*str, LOGMEM(ctx), -1);
+
+    for (p = *patch + 1; *p != '"'; ++p) {
+        if (*p == '\\') {
+            ++p;
+            switch (*p) {
+            case 'n':
+                (*str)[len++] = '\n';
+                break;
+            case 't':
+                (*str)[len++] = '\t';
+                break;
+            default:
+                (*str)[len++] = *p;
+                break;
+            }
+        } else {
+            (*str)[len++] = *p;
+        }
+    }
+    (*str)[len] = '\0';
+
+    *patch = p + 1;
+    return 0;
+}
+
+/**
+ * @brief Find the data node with a path, using the hash tables of the siblings.
+ *
+ * @param[in] root Any top-level sibling of the data tree, can be NULL.
+ * @param[in] path Data path of the node as printed by lyd_path().
+ * @param[out] node Found node, NULL if there is none.
+ * @return 0 on success, -1 on error.
+ */
+static int
+lyd_diff_apply_find(struct lyd_node *root, const char *path, struct lyd_node **node)
+{
+    struct lyd_node *iter, *parent = NULL;
+    int parsed = 0, all_siblings = 0;
+
+    *node = NULL;
+    if (!root) {
+        return 0;
+    }
+
+    for (iter = root; !parsed && !all_siblings && iter; iter = iter->next) {
+        parent = resolve_partial_json_data_nodeid(path, NULL, iter, 0, &parsed, &all_siblings);
+    }
+    if (!parsed && !all_siblings) {
+        for (iter = root->prev; !parsed && iter->next; iter = iter->prev) {
+            parent = resolve_partial_json_data_nodeid(path, NULL, iter, 0, &parsed, NULL);
+        }
+    }
+    if (parsed == -1) {
+        return -1;
+    }
+
+    if (parsed && !path[parsed]) {
+        *node = parent;
+    }
+    return 0;
+}
+
+API int
+lyd_diff_apply(struct lyd_node **root, struct ly_ctx *ctx, const char *patch)
+{
+    FUN_IN;
+
+    struct lyd_node *node, *pred, *iter;
+    char *path = NULL, *value = NULL, op;
+    LYD_ANYDATA_VALUETYPE value_type;
+    int ret = -1, has_value;
+
+    if (!root || (!*root && !ctx) || !patch) {
+        LOGARG;
+        return -1;
+    }
+    if (!ctx) {
+        ctx = (*root)->schema->module->ctx;
+    }
+
+    while (*patch) {
+        /* parse the line */
+        op = patch[0];
+        if (!strchr("-=+>", op) || (patch[1] != ' ')) {
+            LOGERR(ctx, LY_EINVAL, "Invalid diff patch, unknown operation (%.10s).", patch);
+            goto cleanup;
+        }
+        patch += 2;
+        if (lyd_diff_parse_str(ctx, &patch, &path)) {
+            goto cleanup;
+        }
+        has_value = 0;
+        value_type = LYD_ANYDATA_CONSTSTRING;
+        if (*patch == ' ') {
+            ++patch;
+            switch (*patch) {
+            case 's':
+                ++patch;
+                break;
+            case 'x':
+                value_type = LYD_ANYDATA_SXML;
+                ++patch;
+                break;
+            case 'j':
+                value_type = LYD_ANYDATA_JSON;
+                ++patch;
+                break;
+            }
+            if (lyd_diff_parse_str(ctx, &patch, &value)) {
+                goto cleanup;
+            }
+            has_value = 1;
+        }
+        if (*patch == '\n') {
+            ++patch;
+        } else if (*patch) {
+            LOGERR(ctx, LY_EINVAL, "Invalid diff patch, unexpected characters (%.10s).", patch);
+            goto cleanup;
+        }
+        if ((op == '=' || op == '>') && !has_value) {
+            LOGERR(ctx, LY_EINVAL, "Invalid diff patch, missing value of \"%s\".", path);
+            goto cleanup;
+        }
+
+        /* find the node */
+        if (lyd_diff_apply_find(*root, path, &node)) {
+            goto cleanup;
+        }
+        if (!node && (op != '+')) {
+            LOGERR(ctx, LY_EINVAL, "Diff patch cannot be applied, node \"%s\" does not exist.", path);
+            goto cleanup;
+        }
+
+        /* apply the change */
+        switch (op) {
+        case '-':
+            if (node == *root) {
+                *root = node->next ? node->next : (node->prev != node ? node->prev : NULL);
+            }
+            lyd_free(node);
+            break;
+        case '=':
+            if (node->schema->nodetype == LYS_LEAF) {
+                if (lyd_change_leaf((struct lyd_node_leaf_list *)node, value) == -1) {
+                    goto cleanup;
+                }
+            } else if (node->schema->nodetype & LYS_ANYDATA) {
+                lyd_new_path_update(node, value, value_type, 0);
+            } else {
+                LOGERR(ctx, LY_EINVAL, "Diff patch cannot be applied, node \"%s\" has no value.", path);
+                goto cleanup;
+            }
+            break;
+        case '+':
+            if (node && node->dflt) {
+                /* the default node becomes explicit */
+                if (node->schema->nodetype == LYS_LEAF) {
+                    if (lyd_change_leaf((struct lyd_node_leaf_list *)node, value) == -1) {
+                        goto cleanup;
+                    }
+                } else {
+                    for (iter = node; iter && iter->dflt; iter = iter->parent) {
+                        iter->dflt = 0;
+                    }
+                }
+            } else if (node) {
+                LOGERR(ctx, LY_EINVAL, "Diff patch cannot be applied, node \"%s\" already exists.", path);
+                goto cleanup;
+            } else {
+                node = lyd_new_path(*root, ctx, path, value, value_type, 0);
+                if (!node) {
+                    goto cleanup;
+                }
+                if (!*root) {
+                    *root = node;
+                }
+            }
+            break;
+        case '>':
+            if (value[0]) {
+                /* move after the predecessor */
+                if (lyd_diff_apply_find(*root, value, &pred)) {
+                    goto cleanup;
+                }
+                if (!pred) {
+                    LOGERR(ctx, LY_EINVAL, "Diff patch cannot be applied, node \"%s\" does not exist.", value);
+                    goto cleanup;
+                }
+                if ((pred->next != node) && lyd_insert_after(pred, node)) {
+                    goto cleanup;
+                }
+            } else {
+                /* move before the first instance */
+                for (iter = lyd_first_sibling(node); iter->schema != node->schema; iter = iter->next);
+                if ((iter != node) && lyd_insert_before(iter, node)) {
+                    goto cleanup;
+                }
+            }
+            break;
+        }
+
+        free(path);
+        path = NULL;
+        free(value);
+        value = NULL;
+    }
+    ret = 0;
+
+cleanup:
+    free(path);
+    free(value);
+    return ret;
+}
+
 static void
 lyd_insert_setinvalid(struct lyd_node *node)
 {
@@ -4193,8 +5115,9 @@ lyd_insert_setinvalid(struct lyd_node *node)
 
     assert(node);
 
-    /* overall validity of the node itself */
-    node->validity = ly_new_node_validity(node->schema);
+    /* overall validity of the node itself and its whole subtree */
+    node->validity = ly_new_node_validity(node->schema) | LYD_VAL_SUBTREE;
+    lyd_val_dirty(node->parent);
 
     /* explore changed unique leaves */
     /* first, get know if there is a list in parents chain */
@@ -4349,7 +5272,7 @@ lyd_insert_common(struct lyd_node *parent, struct lyd_node **sibling, struct lyd
     if (parent) {
         start = parent->child;
     } else {
-        for (start = *sibling; start->prev->next; start = start->prev);
+        start = lyd_first_sibling(*sibling);
     }
 
     /* check placing the node to the appropriate place according to the schema */
@@ -4415,6 +5338,13 @@ lyd_insert_common(struct lyd_node *parent, struct lyd_node **sibling, struct lyd
             }
         }
 
+#ifdef LY_ENABLED_CACHE
+        if (ins->root_idx) {
+            /* a list of top-level siblings is being inserted, each node leaves their index */
+            lyd_root_unlink(ins, NULL);
+        }
+#endif
+
         /* isolate the node to be handled separately */
         ins->prev = ins;
         ins->next = NULL;
@@ -4551,6 +5481,9 @@ lyd_insert_common(struct lyd_node *parent, struct lyd_node **sibling, struct lyd
 
 #ifdef LY_ENABLED_CACHE
         lyd_insert_hash(ins);
+        if (!parent) {
+            lyd_root_link(ins, ins->next ? ins->next : (ins->prev != ins ? ins->prev : NULL));
+        }
 #endif
 
         if (invalidate) {
@@ -4677,7 +5610,7 @@ lyd_insert_nextto(struct lyd_node *sibling, struct lyd_node *node, int before, i
     if (sibling->parent) {
         start = sibling->parent->child;
     } else {
-        for (start = sibling; start->prev->next; start = start->prev);
+        start = lyd_first_sibling(sibling);
     }
 
     /* process the nodes one by one to clean the current tree */
@@ -4783,6 +5716,13 @@ lyd_insert_nextto(struct lyd_node *sibling, struct lyd_node *node, int before, i
         lyd_unlink_hash(iter, iter->parent);
         lyd_insert_hash(iter);
     }
+
+    if (!sibling->parent) {
+        /* move all the nodes into the index of their new top-level siblings */
+        for (iter = node; iter != last->next; iter = iter->next) {
+            lyd_root_link(iter, sibling);
+        }
+    }
 #endif
 
     if (invalidate) {
@@ -5006,18 +5946,790 @@ lyd_schema_sort(struct lyd_node *sibling, int recursive)
     return EXIT_SUCCESS;
 }
 
+/* validity flags of a node that was itself changed, added, or otherwise needs to be checked again */
+#define LYD_VAL_INCR_CHANGED (LYD_VAL_MAND | LYD_VAL_SUBTREE)
+
+/**
+ * @brief Collect the schema nodes of all the changed data nodes for incremental validation.
+ *
+ * @param[in] node Data node to process.
+ * @param[in,out] changes Set of the changed schema nodes.
+ * @return EXIT_SUCCESS or EXIT_FAILURE.
+ */
 static int
-_lyd_validate(struct lyd_node **node, struct lyd_node *data_tree, struct ly_ctx *ctx, const struct lys_module **modules,
-              int mod_count, struct lyd_difflist **diff, int options)
+lyd_val_incr_changes_r(const struct lyd_node *node, struct ly_set *changes)
 {
-    struct lyd_node *root, *next1, *next2, *iter, *act_notif = NULL;
-    int ret = EXIT_FAILURE;
-    unsigned int i;
-    struct unres_data *unres = NULL;
-    const struct lys_module *yanglib_mod;
-
-    unres = calloc(1, sizeof *unres);
-    LY_CHECK_ERR_RETURN(!unres, LOGMEM(NULL), EXIT_FAILURE);
+    const struct lyd_node *iter;
+
+    if (node->validity & LYD_VAL_INCR_CHANGED) {
+        if (ly_set_add(changes, node->schema, 0) == -1) {
+            return EXIT_FAILURE;
+        }
+        if (node->validity & LYD_VAL_SUBTREE) {
+            /* descendants of the schema node are covered as well */
+            return EXIT_SUCCESS;
+        }
+    }
+
+    if ((node->validity & LYD_VAL_DIRTY) && !(node->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST | LYS_ANYDATA))) {
+        LY_TREE_FOR(node->child, iter) {
+            if ((iter->validity & (LYD_VAL_INCR_CHANGED | LYD_VAL_DIRTY)) && lyd_val_incr_changes_r(iter, changes)) {
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Reverse dependencies of the schema nodes for incremental validation, collected once for every
+ * schema generation of a context.
+ */
+struct lyd_val_deps {
+    struct hash_table *ht;      /**< records (::lyd_val_deps_rec) by the schema nodes that others depend on */
+    struct ly_set *any;         /**< schema nodes depending on any change (instance-identifiers) */
+    uint32_t schema_gen;        /**< context schema generation the dependencies were collected in */
+};
+
+/**
+ * @brief Record of the schema nodes whose conditions depend on a schema node or any of its descendants.
+ */
+struct lyd_val_deps_rec {
+    const struct lys_node *snode;
+    struct ly_set *deps;
+};
+
+/* flags of the schema nodes in the incremental validation worklist (::lyd_val_incr_rec) */
+#define LYD_VAL_INCR_MARK    0x01 /* instances are to be checked again */
+#define LYD_VAL_INCR_PARENT  0x02 /* instances are to be marked dirty, their children may have to be created */
+#define LYD_VAL_INCR_DESCEND 0x04 /* a descendant has one of the flags above */
+
+/**
+ * @brief Record of a schema node in the incremental validation worklist.
+ */
+struct lyd_val_incr_rec {
+    const struct lys_node *snode;
+    int flags;
+};
+
+static uint32_t
+lyd_val_snode_hash(const struct lys_node *snode)
+{
+    uint32_t hash;
+
+    hash = dict_hash_multi(0, (const char *)&snode, sizeof snode);
+    return dict_hash_multi(hash, NULL, 0);
+}
+
+static int
+lyd_val_snode_equal(void *val1_p, void *val2_p, int UNUSED(mod), void *UNUSED(cb_data))
+{
+    /* all the records start with the schema node */
+    return *(const struct lys_node **)val1_p == *(const struct lys_node **)val2_p;
+}
+
+static void
+lyd_val_deps_destroy(struct lyd_val_deps *deps)
+{
+    struct lyd_val_deps_rec *rec;
+    uint32_t i;
+
+    if (!deps) {
+        return;
+    }
+
+    if (deps->ht) {
+        for (i = 0; i < deps->ht->size; ++i) {
+            if (deps->ht->ctrl[i] != LYHT_CTRL_EMPTY) {
+                rec = (struct lyd_val_deps_rec *)lyht_get_rec(deps->ht->recs, deps->ht->rec_size, i)->val;
+                ly_set_free(rec->deps);
+            }
+        }
+        lyht_free(deps->ht);
+    }
+    ly_set_free(deps->any);
+    free(deps);
+}
+
+/**
+ * @brief Note that the conditions of a schema node depend on another schema node.
+ *
+ * @param[in] deps Dependencies to add to.
+ * @param[in] snode Schema node \p dep depends on.
+ * @param[in] dep Dependent schema node.
+ * @return EXIT_SUCCESS or EXIT_FAILURE.
+ */
+static int
+lyd_val_deps_add(struct lyd_val_deps *deps, const struct lys_node *snode, const struct lys_node *dep)
+{
+    struct lyd_val_deps_rec rec, *match;
+    uint32_t hash;
+
+    rec.snode = snode;
+    hash = lyd_val_snode_hash(snode);
+    if (lyht_find(deps->ht, &rec, hash, (void **)&match)) {
+        rec.deps = ly_set_new();
+        LY_CHECK_ERR_RETURN(!rec.deps, LOGMEM(snode->module->ctx), EXIT_FAILURE);
+        if (lyht_insert(deps->ht, &rec, hash, (void **)&match) == -1) {
+            ly_set_free(rec.deps);
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* the dependencies of one node are added at once, so a duplicate can only be the last one */
+    if (match->deps->number && (match->deps->set.s[match->deps->number - 1] == dep)) {
+        return EXIT_SUCCESS;
+    }
+    return (ly_set_add(match->deps, (void *)dep, LY_SET_OPT_USEASLIST) == -1) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/**
+ * @brief Collect the dependencies of the conditions (when, must) of a schema node and of the type of its value.
+ *
+ * @param[in] deps Dependencies to add to.
+ * @param[in] schema Schema node to process.
+ * @return EXIT_SUCCESS or EXIT_FAILURE.
+ */
+static int
+lyd_val_deps_node(struct lyd_val_deps *deps, const struct lys_node *schema)
+{
+    const struct lys_node *parent, *siter;
+    const struct lys_node_leaf *sleaf;
+    struct lyxp_set set;
+    uint32_t i;
+
+    if (schema->nodetype & (LYS_LEAF | LYS_LEAFLIST)) {
+        sleaf = (const struct lys_node_leaf *)schema;
+        if ((sleaf->type.base == LY_TYPE_INST)
+                || ((sleaf->type.base == LY_TYPE_UNION) && sleaf->type.info.uni.has_ptr_type)) {
+            /* instance-identifiers can point anywhere */
+            return (ly_set_add(deps->any, (void *)schema, LY_SET_OPT_USEASLIST) == -1) ? EXIT_FAILURE : EXIT_SUCCESS;
+        }
+    }
+
+    /* conditions of the node itself and of its schema-only parents */
+    for (parent = schema;
+            parent && ((parent == schema) || (parent->nodetype & (LYS_USES | LYS_CHOICE | LYS_CASE | LYS_AUGMENT)));
+            parent = (parent->nodetype == LYS_AUGMENT) ? ((struct lys_node_augment *)parent)->target : parent->parent) {
+        if (!lys_has_xpath(parent)) {
+            continue;
+        }
+        if (lyxp_node_atomize(parent, &set, 0)) {
+            return EXIT_FAILURE;
+        }
+        for (i = 0; i < set.used; ++i) {
+            if (set.val.snodes[i].type != LYXP_NODE_ELEM) {
+                continue;
+            }
+            /* a change of the atom or of any of its ancestors */
+            for (siter = set.val.snodes[i].snode; siter; siter = lys_parent(siter)) {
+                if (lyd_val_deps_add(deps, siter, schema)) {
+                    free(set.val.snodes);
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+        free(set.val.snodes);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static int
+lyd_val_deps_collect_r(struct lyd_val_deps *deps, const struct lys_node *sparent, const struct lys_module *module)
+{
+    const struct lys_node *siter = NULL;
+
+    while ((siter = lys_getnext(siter, sparent, module, LYS_GETNEXT_NOSTATECHECK))) {
+        if (siter->nodetype & (LYS_RPC | LYS_ACTION | LYS_NOTIF)) {
+            continue;
+        }
+
+        if (lyd_val_deps_node(deps, siter)) {
+            return EXIT_FAILURE;
+        }
+
+        if ((siter->nodetype & (LYS_CONTAINER | LYS_LIST)) && lyd_val_deps_collect_r(deps, siter, module)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Collect the reverse dependencies of all the schema nodes of a context.
+ *
+ * @param[in] ctx Context.
+ * @return Created dependencies, NULL on error.
+ */
+static struct lyd_val_deps *
+lyd_val_deps_create(struct ly_ctx *ctx)
+{
+    struct lyd_val_deps *deps;
+    const struct lys_module *mod;
+    int i;
+
+    deps = calloc(1, sizeof *deps);
+    LY_CHECK_ERR_RETURN(!deps, LOGMEM(ctx), NULL);
+    deps->schema_gen = __atomic_load_n(&ctx->models.schema_gen, __ATOMIC_ACQUIRE);
+    deps->ht = lyht_new(LYHT_MIN_SIZE, sizeof(struct lyd_val_deps_rec), lyd_val_snode_equal, NULL, 1);
+    deps->any = ly_set_new();
+    LY_CHECK_ERR_GOTO(!deps->ht || !deps->any, LOGMEM(ctx), error);
+
+    for (i = 0; i < ctx->models.used; ++i) {
+        mod = ctx->models.list[i];
+        if (mod->implemented && !mod->disabled && lyd_val_deps_collect_r(deps, NULL, mod)) {
+            goto error;
+        }
+    }
+
+    return deps;
+
+error:
+    lyd_val_deps_destroy(deps);
+    return NULL;
+}
+
+#ifdef LY_ENABLED_CACHE
+
+void
+lyd_val_deps_free(struct ly_ctx *ctx)
+{
+    lyd_val_deps_destroy(ctx->val_deps);
+    ctx->val_deps = NULL;
+}
+
+/* ctx->cache_lock must be held */
+static struct lyd_val_deps *
+lyd_val_deps_get(struct ly_ctx *ctx)
+{
+    if (ctx->val_deps && (ctx->val_deps->schema_gen != __atomic_load_n(&ctx->models.schema_gen, __ATOMIC_ACQUIRE))) {
+        lyd_val_deps_free(ctx);
+    }
+    if (!ctx->val_deps) {
+        ctx->val_deps = lyd_val_deps_create(ctx);
+    }
+    return ctx->val_deps;
+}
+
+#endif
+
+/**
+ * @brief Add a schema node into the incremental validation worklist, its ancestors are added to be descended into.
+ *
+ * @param[in] work Worklist.
+ * @param[in] snode Schema node to add.
+ * @param[in] flags Flags of \p snode.
+ * @return EXIT_SUCCESS or EXIT_FAILURE.
+ */
+static int
+lyd_val_incr_add(struct hash_table *work, const struct lys_node *snode, int flags)
+{
+    struct lyd_val_incr_rec rec, *match;
+
+    for (; snode; snode = lys_parent(snode), flags = LYD_VAL_INCR_DESCEND) {
+        rec.snode = snode;
+        rec.flags = 0;
+        if (lyht_insert(work, &rec, lyd_val_snode_hash(snode), (void **)&match) == -1) {
+            return EXIT_FAILURE;
+        }
+        if ((match->flags & flags) == flags) {
+            /* the ancestors were added with the node before */
+            break;
+        }
+        match->flags |= flags;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Add a schema node depending on a change into the incremental validation worklist.
+ *
+ * @param[in] work Worklist.
+ * @param[in] dep Dependent schema node.
+ * @param[in] modules Only validated modules, all if NULL.
+ * @param[in] mod_count Number of \p modules.
+ * @return EXIT_SUCCESS or EXIT_FAILURE.
+ */
+static int
+lyd_val_incr_add_dep(struct hash_table *work, const struct lys_node *dep, const struct lys_module **modules,
+                     int mod_count)
+{
+    const struct lys_node *sparent;
+    const struct lys_module *mod;
+    int i;
+
+    if (modules) {
+        for (sparent = dep; lys_parent(sparent); sparent = lys_parent(sparent));
+        mod = lys_main_module(sparent->module);
+        for (i = 0; (i < mod_count) && (modules[i] != mod); ++i);
+        if (i == mod_count) {
+            /* its data are not validated */
+            return EXIT_SUCCESS;
+        }
+    }
+
+    if (lyd_val_incr_add(work, dep, LYD_VAL_INCR_MARK)) {
+        return EXIT_FAILURE;
+    }
+
+    if (resolve_applies_when(dep, 0, NULL)) {
+        /* the node may now have to be created as a default node or become mandatory, check its parents */
+        for (sparent = lys_parent(dep); sparent && !(sparent->nodetype & (LYS_CONTAINER | LYS_LIST));
+                sparent = lys_parent(sparent));
+        if (sparent && lyd_val_incr_add(work, sparent, LYD_VAL_INCR_PARENT)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Mark the data nodes in the incremental validation worklist, only the subtrees with such nodes are visited.
+ *
+ * @param[in] node Data node to process.
+ * @param[in] work Worklist.
+ */
+static void
+lyd_val_incr_mark_r(struct lyd_node *node, struct hash_table *work)
+{
+    struct lyd_val_incr_rec rec, *match;
+    struct lyd_node *iter;
+
+    rec.snode = node->schema;
+    if (lyht_find(work, &rec, lyd_val_snode_hash(node->schema), (void **)&match)) {
+        return;
+    }
+
+    if (match->flags & LYD_VAL_INCR_MARK) {
+        node->validity |= LYD_VAL_MAND;
+        lyd_val_dirty(node->parent);
+    }
+    if (match->flags & LYD_VAL_INCR_PARENT) {
+        lyd_val_dirty(node);
+    }
+
+    if ((match->flags & LYD_VAL_INCR_DESCEND) && !(node->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST | LYS_ANYDATA))) {
+        LY_TREE_FOR(node->child, iter) {
+            lyd_val_incr_mark_r(iter, work);
+        }
+    }
+}
+
+/**
+ * @brief Collect the missing top-level schema nodes of the validated modules, one of them was removed.
+ *
+ * @param[in] root First top-level sibling of the data tree.
+ * @param[in] ctx Context.
+ * @param[in] modules Only validated modules, all if NULL.
+ * @param[in] mod_count Number of \p modules.
+ * @param[in,out] changes Set of the changed schema nodes.
+ * @return EXIT_SUCCESS or EXIT_FAILURE.
+ */
+static int
+lyd_val_incr_removed(struct lyd_node *root, struct ly_ctx *ctx, const struct lys_module **modules, int mod_count,
+                     struct ly_set *changes)
+{
+    struct ly_set *present;
+    const struct lys_module *mod;
+    const struct lys_node *siter;
+    struct lyd_node *iter;
+    int i, ret = EXIT_FAILURE;
+
+    present = ly_set_new();
+    LY_CHECK_ERR_RETURN(!present, LOGMEM(ctx), EXIT_FAILURE);
+    LY_TREE_FOR(root, iter) {
+        if (ly_set_add(present, iter->schema, 0) == -1) {
+            goto cleanup;
+        }
+    }
+
+    for (i = 0; i < (modules ? mod_count : (signed)ctx->models.used); ++i) {
+        mod = modules ? modules[i] : ctx->models.list[i];
+        if (!mod->implemented || mod->disabled) {
+            continue;
+        }
+
+        siter = NULL;
+        while ((siter = lys_getnext(siter, NULL, mod, 0))) {
+            if (!(siter->nodetype & (LYS_RPC | LYS_ACTION | LYS_NOTIF)) && (ly_set_contains(present, (void *)siter) == -1)
+                    && (ly_set_add(changes, (void *)siter, 0) == -1)) {
+                goto cleanup;
+            }
+        }
+    }
+
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    ly_set_free(present);
+    return ret;
+}
+
+/**
+ * @brief Prepare a data tree for incremental validation. Find all the changed schema nodes and mark the data nodes
+ * whose conditions depend on them so that they are checked again.
+ *
+ * @param[in] root First top-level sibling of the data tree.
+ * @param[in] ctx Context.
+ * @param[in] modules Only validated modules, all if NULL.
+ * @param[in] mod_count Number of \p modules.
+ * @return EXIT_SUCCESS or EXIT_FAILURE.
+ */
+static int
+lyd_val_incr_prepare(struct lyd_node *root, struct ly_ctx *ctx, const struct lys_module **modules, int mod_count)
+{
+    struct ly_set *changes;
+    struct lyd_val_deps *deps = NULL;
+    struct lyd_val_deps_rec rec, *match;
+    struct hash_table *work = NULL;
+    struct lyd_node *iter;
+    unsigned int i, j;
+    int removed = 0, ret = EXIT_FAILURE;
+
+    changes = ly_set_new();
+    LY_CHECK_ERR_RETURN(!changes, LOGMEM(ctx), EXIT_FAILURE);
+
+    LY_TREE_FOR(root, iter) {
+        removed |= iter->validity & LYD_VAL_TOPDEL;
+        if ((iter->validity & (LYD_VAL_INCR_CHANGED | LYD_VAL_DIRTY)) && lyd_val_incr_changes_r(iter, changes)) {
+            goto cleanup;
+        }
+    }
+    if (removed && lyd_val_incr_removed(root, ctx, modules, mod_count, changes)) {
+        goto cleanup;
+    }
+
+    if (!changes->number || !root) {
+        ret = EXIT_SUCCESS;
+        goto cleanup;
+    }
+
+    work = lyht_new(LYHT_MIN_SIZE, sizeof(struct lyd_val_incr_rec), lyd_val_snode_equal, NULL, 1);
+    LY_CHECK_ERR_GOTO(!work, LOGMEM(ctx), cleanup);
+
+#ifdef LY_ENABLED_CACHE
+    /* several threads may be validating data at once */
+    pthread_mutex_lock(&ctx->cache_lock);
+    deps = lyd_val_deps_get(ctx);
+#else
+    deps = lyd_val_deps_create(ctx);
+#endif
+    if (!deps) {
+        goto unlock;
+    }
+
+    for (i = 0; i < deps->any->number; ++i) {
+        if (lyd_val_incr_add_dep(work, deps->any->set.s[i], modules, mod_count)) {
+            goto unlock;
+        }
+    }
+    for (i = 0; i < changes->number; ++i) {
+        rec.snode = changes->set.s[i];
+        if (lyht_find(deps->ht, &rec, lyd_val_snode_hash(rec.snode), (void **)&match)) {
+            /* nothing depends on it */
+            continue;
+        }
+        for (j = 0; j < match->deps->number; ++j) {
+            if (lyd_val_incr_add_dep(work, match->deps->set.s[j], modules, mod_count)) {
+                goto unlock;
+            }
+        }
+    }
+    ret = EXIT_SUCCESS;
+
+unlock:
+#ifdef LY_ENABLED_CACHE
+    pthread_mutex_unlock(&ctx->cache_lock);
+#else
+    lyd_val_deps_destroy(deps);
+#endif
+    if (ret) {
+        goto cleanup;
+    }
+
+    /* reach the instances of all the dependent nodes at once */
+    LY_TREE_FOR(root, iter) {
+        lyd_val_incr_mark_r(iter, work);
+    }
+
+cleanup:
+    ly_set_free(changes);
+    lyht_free(work);
+    return ret;
+}
+
+/**
+ * @brief Validate only the changed parts of a data subtree.
+ *
+ * @param[in] node Data node to validate.
+ * @param[in] subtree Whether the whole subtree of \p node is to be validated.
+ * @param[in] options Validation options.
+ * @param[in] unres Unresolved data structure.
+ * @return EXIT_SUCCESS or EXIT_FAILURE.
+ */
+static int
+lyd_val_incr_r(struct lyd_node *node, int subtree, int options, struct unres_data *unres)
+{
+    struct lyd_node *iter;
+    int check, leaf;
+
+    subtree = subtree || (node->validity & LYD_VAL_SUBTREE);
+    check = subtree || (node->validity & (LYD_VAL_DUP | LYD_VAL_UNIQUE | LYD_VAL_MAND | LYD_VAL_LEAFREF));
+    leaf = node->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST | LYS_ANYDATA);
+
+    if (!check && !leaf && (node->validity & LYD_VAL_DIRTY)) {
+        /* duplicate instances of children are checked by their parent */
+        LY_TREE_FOR(node->child, iter) {
+            if (iter->validity & LYD_VAL_DUP) {
+                check = 1;
+                break;
+            }
+        }
+    }
+
+    if (check) {
+        if (lyv_data_context(node, options, unres) || lyv_data_content(node, options, unres)) {
+            return EXIT_FAILURE;
+        }
+
+        /* empty non-default, non-presence container without attributes, make it default */
+        if (!node->dflt && (node->schema->nodetype == LYS_CONTAINER) && !node->child
+                && !((struct lys_node_container *)node->schema)->presence && !node->attr) {
+            node->dflt = 1;
+        }
+    }
+
+    if (!leaf && (subtree || (node->validity & LYD_VAL_DIRTY))) {
+        LY_TREE_FOR(node->child, iter) {
+            if ((subtree || (iter->validity & (LYD_VAL_INCR_CHANGED | LYD_VAL_DIRTY | LYD_VAL_DUP | LYD_VAL_UNIQUE
+                                                | LYD_VAL_LEAFREF))) && lyd_val_incr_r(iter, subtree, options, unres)) {
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static void
+lyd_val_clean_r(struct lyd_node *node, int subtree)
+{
+    struct lyd_node *iter;
+
+    subtree = subtree || (node->validity & LYD_VAL_SUBTREE);
+    if (!subtree && !(node->validity & LYD_VAL_DIRTY)) {
+        return;
+    }
+    node->validity &= ~(LYD_VAL_SUBTREE | LYD_VAL_DIRTY);
+
+    if (!(node->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST | LYS_ANYDATA))) {
+        LY_TREE_FOR(node->child, iter) {
+            lyd_val_clean_r(iter, subtree);
+        }
+    }
+}
+
+void
+lyd_val_clean(struct lyd_node *root, const struct lys_module **modules, int mod_count, int options)
+{
+    struct lyd_node *iter;
+    int i;
+
+    if ((options & (LYD_OPT_TYPEMASK & ~LYD_OPT_CONFIG)) || (options & LYD_OPT_TRUSTED)) {
+        /* the tree was not completely validated, keep the marks for the next validation */
+        return;
+    }
+
+    LY_TREE_FOR(root, iter) {
+        if (modules) {
+            for (i = 0; (i < mod_count) && (lyd_node_module(iter) != modules[i]); ++i);
+            if (i == mod_count) {
+                continue;
+            }
+        }
+
+        iter->validity &= ~LYD_VAL_TOPDEL;
+        lyd_val_clean_r(iter, 0);
+
+        if (options & LYD_OPT_NOSIBLINGS) {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Validate a data subtree, only its unres items are resolved later.
+ *
+ * @param[in] root Root of the data subtree.
+ * @param[in] ctx Context for logging.
+ * @param[in] options Validation options.
+ * @param[in] unres Unresolved data structure to add the unres items into.
+ * @param[in,out] act_notif Found nested action or notification.
+ * @return EXIT_SUCCESS or EXIT_FAILURE.
+ */
+static int
+lyd_validate_subtree(struct lyd_node *root, struct ly_ctx *ctx, int options, struct unres_data *unres,
+                     struct lyd_node **act_notif)
+{
+    struct lyd_node *next, *iter;
+
+    LY_TREE_DFS_BEGIN(root, next, iter) {
+        if (iter->parent && (iter->schema->nodetype & (LYS_ACTION | LYS_NOTIF))) {
+            if (!(options & LYD_OPT_ACT_NOTIF) || *act_notif) {
+                LOGVAL(ctx, LYE_INELEM, LY_VLOG_LYD, iter, iter->schema->name);
+                LOGVAL(ctx, LYE_SPEC, LY_VLOG_PREV, NULL, "Unexpected %s node \"%s\".",
+                       (options & LYD_OPT_RPC ? "action" : "notification"), iter->schema->name);
+                return EXIT_FAILURE;
+            }
+            *act_notif = iter;
+        }
+
+        if (lyv_data_context(iter, options, unres) || lyv_data_content(iter, options, unres)) {
+            return EXIT_FAILURE;
+        }
+
+        /* empty non-default, non-presence container without attributes, make it default */
+        if (!iter->dflt && (iter->schema->nodetype == LYS_CONTAINER) && !iter->child
+                    && !((struct lys_node_container *)iter->schema)->presence && !iter->attr) {
+            iter->dflt = 1;
+        }
+
+        LY_TREE_DFS_END(root, next, iter);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+struct lyd_val_par {
+    struct lyd_node **roots;    /* first top-level node of each task */
+    uint32_t *root_counts;      /* number of top-level nodes of each task */
+    struct unres_data *unres;   /* unres items of each task */
+    struct ly_ctx *ctx;
+    int options;
+};
+
+static int
+lyd_validate_par_task(void *arg, uint32_t task)
+{
+    struct lyd_val_par *par = (struct lyd_val_par *)arg;
+    struct lyd_node *root, *act_notif = NULL;
+    uint32_t i;
+
+    for (i = 0, root = par->roots[task]; i < par->root_counts[task]; ++i, root = root->next) {
+        if (lyd_validate_subtree(root, par->ctx, par->options, &par->unres[task], &act_notif)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Validate the top-level data subtrees in parallel. Consecutive instances of a top-level
+ * list are split into several tasks only if there are too many of them.
+ *
+ * @param[in] node First top-level node.
+ * @param[in] ctx Context to use.
+ * @param[in] modules Only the data of these modules are validated, NULL for all the data.
+ * @param[in] mod_count Number of \p modules.
+ * @param[in] options Validation options.
+ * @param[in] unres Unresolved data structure to add all the unres items into, in the same order as if
+ * the subtrees were validated serially.
+ * @return EXIT_SUCCESS or EXIT_FAILURE.
+ */
+static int
+lyd_validate_par(struct lyd_node *node, struct ly_ctx *ctx, const struct lys_module **modules, int mod_count,
+                 int options, struct unres_data *unres)
+{
+    struct lyd_val_par par;
+    struct lyd_node *root, *last = NULL;
+    uint32_t i, root_count = 0, task_count = 0, chunk;
+    int j, ret = EXIT_FAILURE;
+
+    memset(&par, 0, sizeof par);
+    par.ctx = ctx;
+    par.options = options;
+
+    LY_TREE_FOR(node, root) {
+        ++root_count;
+    }
+    par.roots = malloc(root_count * sizeof *par.roots);
+    par.root_counts = malloc(root_count * sizeof *par.root_counts);
+    LY_CHECK_ERR_GOTO(!par.roots || !par.root_counts, LOGMEM(ctx), cleanup);
+
+    chunk = root_count / ly_par_threads(ctx) + 1;
+    LY_TREE_FOR(node, root) {
+        if (modules) {
+            for (j = 0; (j < mod_count) && (lyd_node_module(root) != modules[j]); ++j);
+            if (j == mod_count) {
+                /* skip data that should not be validated */
+                continue;
+            }
+        }
+
+        if (last && (last == root->prev) && (last->schema == root->schema) && (par.root_counts[task_count - 1] < chunk)) {
+            /* another instance of the same top-level list */
+            ++par.root_counts[task_count - 1];
+        } else {
+            par.roots[task_count] = root;
+            par.root_counts[task_count] = 1;
+            ++task_count;
+        }
+        last = root;
+    }
+
+    par.unres = calloc(task_count, sizeof *par.unres);
+    LY_CHECK_ERR_GOTO(!par.unres, LOGMEM(ctx), cleanup);
+
+    if (ly_par_run(ctx, task_count, lyd_validate_par_task, &par)) {
+        goto cleanup;
+    }
+
+    /* merge the unres items */
+    for (i = 0; i < task_count; ++i) {
+        if (!par.unres[i].count) {
+            continue;
+        }
+        if (unres_data_reserve(unres, par.unres[i].count)) {
+            goto cleanup;
+        }
+        memcpy(unres->node + unres->count, par.unres[i].node, par.unres[i].count * sizeof *unres->node);
+        memcpy(unres->type + unres->count, par.unres[i].type, par.unres[i].count * sizeof *unres->type);
+        unres->count += par.unres[i].count;
+    }
+
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    if (par.unres) {
+        for (i = 0; i < task_count; ++i) {
+            free(par.unres[i].node);
+            free(par.unres[i].type);
+        }
+    }
+    free(par.unres);
+    free(par.roots);
+    free(par.root_counts);
+    return ret;
+}
+
+static int
+_lyd_validate(struct lyd_node **node, struct lyd_node *data_tree, struct ly_ctx *ctx, const struct lys_module **modules,
+              int mod_count, struct lyd_difflist **diff, int options)
+{
+    struct lyd_node *root, *start, *next1, *act_notif = NULL;
+    int ret = EXIT_FAILURE;
+    unsigned int i;
+    struct unres_data *unres = NULL;
+    const struct lys_module *yanglib_mod;
+
+    unres = calloc(1, sizeof *unres);
+    LY_CHECK_ERR_RETURN(!unres, LOGMEM(NULL), EXIT_FAILURE);
 
     if (diff) {
         unres->store_diff = 1;
@@ -5031,7 +6743,28 @@ _lyd_validate(struct lyd_node **node, struct lyd_node *data_tree, struct ly_ctx
         options |= LYD_OPT_ACT_NOTIF;
     }
 
-    LY_TREE_FOR_SAFE(*node, next1, root) {
+    if (options & LYD_OPT_VAL_INCR) {
+        if (options & LYD_OPT_WHENAUTODEL) {
+            /* nodes deleted because of their when conditions could affect any other condition */
+            options &= ~LYD_OPT_VAL_INCR;
+        } else if (lyd_val_incr_prepare(*node, ctx, modules, mod_count)) {
+            goto cleanup;
+        }
+    }
+
+    if ((options & LYD_OPT_VAL_PARALLEL) && !(options & (LYD_OPT_TYPEMASK & ~LYD_OPT_CONFIG))
+            && !(options & (LYD_OPT_VAL_INCR | LYD_OPT_NOSIBLINGS)) && *node && (*node)->next
+            && (ly_par_threads((*node)->schema->module->ctx) > 1)) {
+        /* independent top-level subtrees in parallel */
+        if (lyd_validate_par(*node, (*node)->schema->module->ctx, modules, mod_count, options, unres)) {
+            goto cleanup;
+        }
+        start = NULL;
+    } else {
+        start = *node;
+    }
+
+    LY_TREE_FOR_SAFE(start, next1, root) {
         if (modules) {
             for (i = 0; i < (unsigned)mod_count; ++i) {
                 if (lyd_node_module(root) == modules[i]) {
@@ -5044,28 +6777,19 @@ _lyd_validate(struct lyd_node **node, struct lyd_node *data_tree, struct ly_ctx
             }
         }
 
-        LY_TREE_DFS_BEGIN(root, next2, iter) {
-            if (iter->parent && (iter->schema->nodetype & (LYS_ACTION | LYS_NOTIF))) {
-                if (!(options & LYD_OPT_ACT_NOTIF) || act_notif) {
-                    LOGVAL(ctx, LYE_INELEM, LY_VLOG_LYD, iter, iter->schema->name);
-                    LOGVAL(ctx, LYE_SPEC, LY_VLOG_PREV, NULL, "Unexpected %s node \"%s\".",
-                           (options & LYD_OPT_RPC ? "action" : "notification"), iter->schema->name);
-                    goto cleanup;
-                }
-                act_notif = iter;
-            }
-
-            if (lyv_data_context(iter, options, unres) || lyv_data_content(iter, options, unres)) {
+        if (options & LYD_OPT_VAL_INCR) {
+            /* only the changed parts */
+            if (lyd_val_incr_r(root, 0, options, unres)) {
                 goto cleanup;
             }
-
-            /* empty non-default, non-presence container without attributes, make it default */
-            if (!iter->dflt && (iter->schema->nodetype == LYS_CONTAINER) && !iter->child
-                        && !((struct lys_node_container *)iter->schema)->presence && !iter->attr) {
-                iter->dflt = 1;
+            if (options & LYD_OPT_NOSIBLINGS) {
+                break;
             }
+            continue;
+        }
 
-            LY_TREE_DFS_END(root, next2, iter);
+        if (lyd_validate_subtree(root, ctx, options, unres, &act_notif)) {
+            goto cleanup;
         }
 
         if (options & LYD_OPT_NOSIBLINGS) {
@@ -5155,6 +6879,9 @@ _lyd_validate(struct lyd_node **node, struct lyd_node *data_tree, struct ly_ctx
         unres->diff_idx = 0;
     }
 
+    /* the tree is valid, forget all the changes */
+    lyd_val_clean(*node, modules, mod_count, options);
+
     ret = EXIT_SUCCESS;
 
 cleanup:
@@ -5424,7 +7151,7 @@ lyd_dup_attr(struct ly_ctx *ctx, struct lyd_node *parent, struct lyd_attr *attr)
 int
 lyd_unlink_internal(struct lyd_node *node, int permanent)
 {
-    struct lyd_node *iter;
+    struct lyd_node *iter, *first = NULL;
 
     if (!node) {
         LOGARG;
@@ -5435,6 +7162,34 @@ lyd_unlink_internal(struct lyd_node *node, int permanent)
         check_leaf_list_backlinks(node);
     }
 
+    if ((permanent == 1) && node->parent) {
+        /* invalidate the parent, a child is removed */
+        node->parent->validity |= LYD_VAL_MAND;
+        lyd_val_dirty(node->parent);
+    } else if (permanent == 1) {
+        /* top-level node is removed, invalidate another instance of the same schema node (if any) instead */
+        if (node->next && (node->next->schema == node->schema)) {
+            iter = node->next;
+        } else {
+            for (iter = node->prev; (iter != node) && (iter->schema != node->schema); iter = iter->prev);
+        }
+        if (iter != node) {
+            iter->validity |= LYD_VAL_MAND;
+        } else {
+            /* the schema node has no instances left, note the removal for the remaining siblings */
+            for (iter = node->prev; iter != node; iter = iter->prev) {
+                iter->validity |= LYD_VAL_TOPDEL;
+            }
+        }
+    }
+
+#ifdef LY_ENABLED_CACHE
+    if (node->root_idx) {
+        /* remove from the index of top-level siblings, the first sibling is needed when unlinking the last node */
+        lyd_root_unlink(node, node->next ? NULL : &first);
+    }
+#endif
+
     /* unlink from siblings */
     if (node->prev->next) {
         node->prev->next = node->next;
@@ -5445,6 +7200,8 @@ lyd_unlink_internal(struct lyd_node *node, int permanent)
         /* unlinking the last node */
         if (node->parent) {
             iter = node->parent->child;
+        } else if (first) {
+            iter = first;
         } else {
             iter = node->prev;
             while (iter->prev != node) {
@@ -5813,6 +7570,18 @@ lyd_dup_to_ctx(const struct lyd_node *node, int options, struct ly_ctx *ctx)
             break;
         }
 
+        if (!ctx) {
+            /* the same schema, all the descendants can be copied and linked directly */
+            if ((elem->schema->nodetype & (LYS_LIST | LYS_CONTAINER | LYS_RPC | LYS_ACTION | LYS_NOTIF)) && elem->child
+                    && !lyd_dup_withsiblings_r(elem->child, new_node, options, log_ctx, 0)) {
+                goto error;
+            }
+#ifdef LY_ENABLED_CACHE
+            new_node->hash = elem->hash;
+#endif
+            break;
+        }
+
         /* LY_TREE_DFS_END */
         /* select element for the next run - children first,
          * child exception for lyd_node_leaf and lyd_node_leaflist */
@@ -5890,11 +7659,28 @@ lyd_dup(const struct lyd_node *node, int options)
     return lyd_dup_to_ctx(node, options, NULL);
 }
 
+/**
+ * @brief Duplicate siblings with all their descendants and link them directly, without the checks
+ * of the insert functions, which are not needed when copying a valid data (sub)tree.
+ *
+ * @param[in] first First sibling to duplicate.
+ * @param[in] parent_dup Parent of the duplicated siblings, NULL for top-level siblings.
+ * @param[in] options Duplication options.
+ * @param[in] ctx Context of the duplicated nodes.
+ * @param[in] keep_flags Whether to copy the validation flags, which is possible when the whole data tree
+ * is being duplicated.
+ * @return First duplicated sibling, NULL on error.
+ */
 static struct lyd_node *
-lyd_dup_withsiblings_r(const struct lyd_node *first, struct lyd_node *parent_dup, int options, struct ly_ctx *ctx)
+lyd_dup_withsiblings_r(const struct lyd_node *first, struct lyd_node *parent_dup, int options, struct ly_ctx *ctx,
+                       int keep_flags)
 {
     struct lyd_node *first_dup = NULL, *prev_dup = NULL, *last_dup;
     const struct lyd_node *next;
+#ifdef LY_ENABLED_CACHE
+    struct lyd_node *iter;
+    uint32_t hashed = 0;
+#endif
 
     assert(first);
 
@@ -5905,9 +7691,11 @@ lyd_dup_withsiblings_r(const struct lyd_node *first, struct lyd_node *parent_dup
             goto error;
         }
 
-        /* the whole data tree is exactly the same so we can safely copy the validation flags */
-        last_dup->validity = next->validity;
-        last_dup->when_status = next->when_status;
+        if (keep_flags) {
+            /* the whole data tree is exactly the same so we can safely copy the validation flags */
+            last_dup->validity = next->validity;
+            last_dup->when_status = next->when_status;
+        }
 
         last_dup->parent = parent_dup;
         /* connect to the parent or the siblings */
@@ -5922,36 +7710,60 @@ lyd_dup_withsiblings_r(const struct lyd_node *first, struct lyd_node *parent_dup
             last_dup->prev = prev_dup;
         }
 
+        if ((next->schema->nodetype & (LYS_LIST | LYS_CONTAINER | LYS_RPC | LYS_ACTION | LYS_NOTIF)) && next->child) {
+            /* recursively duplicate all children */
+            if (!lyd_dup_withsiblings_r(next->child, last_dup, options, ctx, keep_flags)) {
+                goto error;
+            }
+        }
+
 #ifdef LY_ENABLED_CACHE
-        /* copy hash */
+        /* copy the hash, the whole subtree is the same (so lists have all their keys) */
+        last_dup->hash = next->hash;
         if ((last_dup->schema->nodetype != LYS_LIST) || lyd_list_has_keys(last_dup)) {
-            last_dup->hash = next->hash;
+            ++hashed;
         }
-
-        /* insert into parent */
-        lyd_insert_hash(last_dup);
 #endif
 
-        if ((next->schema->nodetype & (LYS_LIST | LYS_CONTAINER | LYS_RPC | LYS_ACTION | LYS_NOTIF)) && next->child) {
-            /* recursively duplicate all children */
-            if (!lyd_dup_withsiblings_r(next->child, last_dup, options, ctx)) {
-                goto error;
+        prev_dup = last_dup;
+    }
+
+    /* correctly set last sibling */
+    assert(!prev_dup->next);
+    first_dup->prev = prev_dup;
+
+#ifdef LY_ENABLED_CACHE
+    if (parent_dup && (hashed >= LY_CACHE_HT_MIN_CHILDREN)) {
+        /* create the children hash table at once, as large as the original one so that it is never resized */
+        assert(!parent_dup->ht);
+        parent_dup->ht = lyht_new(first->parent->ht ? first->parent->ht->size : 1, sizeof(struct lyd_node *),
+                                  lyd_hash_table_val_equal, NULL, 1);
+        LY_CHECK_ERR_GOTO(!parent_dup->ht, LOGMEM(ctx), error);
+        LY_TREE_FOR(first_dup, iter) {
+            if ((iter->schema->nodetype == LYS_LIST) && !lyd_list_has_keys(iter)) {
+                /* skip lists without keys */
+                continue;
+            }
+
+            if (lyht_insert(parent_dup->ht, &iter, iter->hash, NULL)) {
+                assert(0);
             }
         }
-
-        prev_dup = last_dup;
     }
-
-    /* correctly set last sibling */
-    assert(!prev_dup->next);
-    first_dup->prev = prev_dup;
+#endif
 
     return first_dup;
 
 error:
     /* disconnect and free */
     if (first_dup) {
-        first_dup->parent = NULL;
+        if (parent_dup) {
+            parent_dup->child = NULL;
+        }
+        for (last_dup = first_dup; last_dup; last_dup = last_dup->next) {
+            last_dup->parent = NULL;
+            first_dup->prev = last_dup;
+        }
         lyd_free_withsiblings(first_dup);
     }
     return NULL;
@@ -5996,7 +7808,7 @@ lyd_dup_withsiblings_to_ctx(const struct lyd_node *node, int options, struct ly_
         }
     } else {
         /* duplicating top-level siblings, we can duplicate much more efficiently */
-        ret = lyd_dup_withsiblings_r(node, NULL, options, ctx);
+        ret = lyd_dup_withsiblings_r(node, NULL, options, ctx, 1);
     }
 
     return ret;
@@ -6203,6 +8015,139 @@ lyd_free_value(lyd_val value, LY_DATA_TYPE value_type, uint8_t value_flags, stru
     }
 }
 
+/**
+ * @brief Size (and alignment) of one chunk of a data tree arena.
+ */
+#define LYD_ARENA_CHUNK_SIZE 16384
+
+/**
+ * @brief Chunk of a data tree arena, the nodes are stored right after this header. Chunks are aligned
+ * to their size so that the arena of any node can be found from the node address.
+ */
+struct lyd_arena_chunk {
+    struct lyd_arena *arena;        /**< arena of the chunk */
+    struct lyd_arena_chunk *next;   /**< previously filled chunk */
+};
+
+/**
+ * @brief Data tree arena, nodes are allocated from it one after another (see #LYD_OPT_ARENA).
+ */
+struct lyd_arena {
+    struct lyd_arena_chunk *chunks; /**< all the chunks, the one being filled first */
+    uint32_t used;                  /**< number of bytes used in the first chunk */
+    uint32_t nodes;                 /**< number of allocated nodes not yet freed, accessed atomically because
+                                         nodes moved into other trees may be freed by other threads */
+};
+
+static struct lyd_arena *
+lyd_arena_get(const struct lyd_node *node)
+{
+    return ((struct lyd_arena_chunk *)((uintptr_t)node & ~(uintptr_t)(LYD_ARENA_CHUNK_SIZE - 1)))->arena;
+}
+
+static void *
+lyd_arena_calloc(struct lyd_arena *arena, size_t size)
+{
+    struct lyd_arena_chunk *chunk;
+    void *mem;
+
+    /* keep the nodes aligned */
+    size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+    if (!arena->chunks || (arena->used + size > LYD_ARENA_CHUNK_SIZE)) {
+        if (posix_memalign(&mem, LYD_ARENA_CHUNK_SIZE, LYD_ARENA_CHUNK_SIZE)) {
+            return NULL;
+        }
+        chunk = mem;
+        chunk->arena = arena;
+        chunk->next = arena->chunks;
+        arena->chunks = chunk;
+        arena->used = sizeof *chunk;
+    }
+
+    mem = (char *)arena->chunks + arena->used;
+    arena->used += size;
+    __atomic_add_fetch(&arena->nodes, 1, __ATOMIC_RELAXED);
+
+    memset(mem, 0, size);
+    return mem;
+}
+
+struct lyd_node *
+lyd_node_alloc(const struct lys_node *schema, const struct lyd_node *near, int options)
+{
+    struct lyd_arena *arena;
+    struct lyd_node *node;
+    size_t size;
+
+    switch (schema->nodetype) {
+    case LYS_CONTAINER:
+    case LYS_LIST:
+    case LYS_NOTIF:
+    case LYS_RPC:
+    case LYS_ACTION:
+        size = sizeof(struct lyd_node);
+        break;
+    case LYS_LEAF:
+    case LYS_LEAFLIST:
+        size = sizeof(struct lyd_node_leaf_list);
+        break;
+    case LYS_ANYXML:
+    case LYS_ANYDATA:
+        size = sizeof(struct lyd_node_anydata);
+        break;
+    default:
+        return NULL;
+    }
+
+    if (near && near->arena) {
+        arena = lyd_arena_get(near);
+    } else if (!near && (options & LYD_OPT_ARENA)) {
+        /* the first node of the tree */
+        arena = calloc(1, sizeof *arena);
+        if (!arena) {
+            return NULL;
+        }
+    } else {
+        return calloc(1, size);
+    }
+
+    node = lyd_arena_calloc(arena, size);
+    if (!node) {
+        if (!arena->nodes) {
+            free(arena);
+        }
+        return NULL;
+    }
+    node->arena = 1;
+
+    return node;
+}
+
+void
+lyd_node_dealloc(struct lyd_node *node)
+{
+    struct lyd_arena *arena;
+    struct lyd_arena_chunk *chunk;
+
+    if (!node->arena) {
+        free(node);
+        return;
+    }
+
+    arena = lyd_arena_get(node);
+    if (__atomic_sub_fetch(&arena->nodes, 1, __ATOMIC_ACQ_REL)) {
+        /* the memory is released with the last node */
+        return;
+    }
+
+    while ((chunk = arena->chunks)) {
+        arena->chunks = chunk->next;
+        free(chunk);
+    }
+    free(arena);
+}
+
 static void
 _lyd_free_node(struct lyd_node *node)
 {
@@ -6212,6 +8157,9 @@ _lyd_free_node(struct lyd_node *node)
         return;
     }
 
+    /* any top-level node must have been removed from the index of its siblings */
+    assert(!node->root_idx);
+
     switch (node->schema->nodetype) {
     case LYS_CONTAINER:
     case LYS_LIST:
@@ -6261,7 +8209,7 @@ _lyd_free_node(struct lyd_node *node)
     }
 
     lyd_free_attr(node->schema->module->ctx, node, node->attr, 1);
-    free(node);
+    lyd_node_dealloc(node);
 }
 
 static void
@@ -6331,16 +8279,38 @@ lyd_free_withsiblings(struct lyd_node *node)
         }
     } else {
         /* node is top-level so we are freeing the whole data tree, we can just free nodes without any unlinking */
-        while (node->prev->next) {
-            /* find the first sibling */
-            node = node->prev;
+        node = lyd_first_sibling(node);
+
+#ifdef LY_ENABLED_CACHE
+        if (node->root_idx) {
+            /* only the index of the top-level siblings must be freed */
+            LY_TREE_FOR(node, iter) {
+                lyd_root_unlink(iter, NULL);
+            }
         }
+#endif
 
         /* free it all */
         lyd_free_withsiblings_r(node);
     }
 }
 
+API void
+lyd_free_arena(struct lyd_node *node)
+{
+    FUN_IN;
+
+    if (!node) {
+        return;
+    }
+
+    /* free the whole data tree */
+    while (node->parent) {
+        node = node->parent;
+    }
+    lyd_free_withsiblings(node);
+}
+
 /**
  * Expectations:
  * - list exists in data tree
@@ -6367,95 +8337,371 @@ lyd_get_unique_default(const char* unique_expr, struct lyd_node *list, const cha
         return -1;
     }
 
-    sleaf = (struct lys_node_leaf *)parent;
-    if (sleaf->dflt) {
-        /* leaf has a default value */
-        *dflt = sleaf->dflt;
-    } else if (!(sleaf->flags & LYS_MAND_TRUE)) {
-        /* get the default value from the type */
-        for (tpdf = sleaf->type.der; tpdf && !(*dflt); tpdf = tpdf->type.der) {
-            *dflt = tpdf->dflt;
+    sleaf = (struct lys_node_leaf *)parent;
+    if (sleaf->dflt) {
+        /* leaf has a default value */
+        *dflt = sleaf->dflt;
+    } else if (!(sleaf->flags & LYS_MAND_TRUE)) {
+        /* get the default value from the type */
+        for (tpdf = sleaf->type.der; tpdf && !(*dflt); tpdf = tpdf->type.der) {
+            *dflt = tpdf->dflt;
+        }
+    }
+
+    if (!(*dflt)) {
+        return 0;
+    }
+
+    /* it has default value, but check if it can appear in the data tree under the list */
+    s = ly_set_new();
+    for (parent = lys_parent((struct lys_node *)sleaf); parent != list->schema; parent = lys_parent(parent)) {
+        if (!(parent->nodetype & (LYS_CONTAINER | LYS_CASE | LYS_CHOICE | LYS_USES))) {
+            /* This should be already detected when parsing schema */
+            LOGINT(ctx);
+            ly_set_free(s);
+            return -1;
+        }
+        ly_set_add(s, (void *)parent, LY_SET_OPT_USEASLIST);
+    }
+
+    ly_ilo_change(NULL, ILO_IGNORE, &prev_ilo, NULL);
+    for (i = 0, last = list; i < s->number; i++) {
+        parent = s->set.s[i]; /* shortcut */
+
+        switch (parent->nodetype) {
+        case LYS_CONTAINER:
+            if (last) {
+                /* find instance in the data */
+                r = lyd_find_path(last, parent->name);
+                if (!r || r->number > 1) {
+                    ly_set_free(r);
+                    *dflt = NULL;
+                    goto end;
+                }
+                if (r->number) {
+                    last = r->set.d[0];
+                } else {
+                    last = NULL;
+                }
+                ly_set_free(r);
+            }
+            if (((struct lys_node_container *)parent)->presence) {
+                /* not-instantiated presence container on path */
+                *dflt = NULL;
+                goto end;
+            }
+            break;
+        case LYS_CHOICE :
+            /* check presence of another case */
+            if (!last) {
+                continue;
+            }
+
+            /* remember the case to be searched in choice by lyv_multicases() */
+            if (i + 1 == s->number) {
+                parent = (struct lys_node *)sleaf;
+            } else if (s->set.s[i + 1]->nodetype == LYS_CASE && (i + 2 < s->number) &&
+                    s->set.s[i + 2]->nodetype == LYS_CHOICE) {
+                /* nested choices are covered by lyv_multicases, we just have to pass
+                 * the lowest choice */
+                i++;
+                continue;
+            } else {
+                parent = s->set.s[i + 1];
+            }
+            node = last->child;
+            if (lyv_multicases(NULL, (struct lys_node *)parent, &node, 0, NULL)) {
+                /* another case is present */
+                *dflt = NULL;
+                goto end;
+            }
+            break;
+        default:
+            /* LYS_CASE, LYS_USES */
+            continue;
+        }
+    }
+
+end:
+    ly_ilo_restore(NULL, prev_ilo, NULL, 0);
+    ly_set_free(s);
+    return 0;
+}
+
+/**
+ * @brief Append a string to a data path buffer, enlarging it if needed.
+ *
+ * @param[in,out] buf Path buffer.
+ * @param[in,out] size Size of \p buf.
+ * @param[in,out] len Length of the path in \p buf, increased by \p str_len.
+ * @param[in] str String to append.
+ * @param[in] str_len Length of \p str.
+ * @return 0 on success, -1 on error.
+ */
+static int
+lyd_path_append(char **buf, size_t *size, size_t *len, const char *str, size_t str_len)
+{
+    size_t new_size;
+    char *mem;
+
+    if (*len + str_len + 1 > *size) {
+        new_size = *size ? *size : LY_BUF_STEP;
+        while (*len + str_len + 1 > new_size) {
+            new_size <<= 1;
+        }
+        mem = realloc(*buf, new_size);
+        LY_CHECK_ERR_RETURN(!mem, LOGMEM(NULL), -1);
+        *buf = mem;
+        *size = new_size;
+    }
+
+    memcpy(*buf + *len, str, str_len);
+    *len += str_len;
+    return 0;
+}
+
+/**
+ * @brief Append a predicate with a value to a data path buffer, quoted by the quotes not present in the value.
+ *
+ * @param[in,out] buf Path buffer.
+ * @param[in,out] size Size of \p buf.
+ * @param[in,out] len Length of the path in \p buf.
+ * @param[in] mod_name Module name of the predicate node, NULL if not needed.
+ * @param[in] name Name of the predicate node.
+ * @param[in] value Value of the predicate.
+ * @return 0 on success, -1 on error.
+ */
+static int
+lyd_path_append_predicate(char **buf, size_t *size, size_t *len, const char *mod_name, const char *name,
+                          const char *value)
+{
+    const char *quote = strchr(value, '\'') ? "\"" : "'";
+
+    if (lyd_path_append(buf, size, len, "[", 1)) {
+        return -1;
+    }
+    if (mod_name && (lyd_path_append(buf, size, len, mod_name, strlen(mod_name))
+            || lyd_path_append(buf, size, len, ":", 1))) {
+        return -1;
+    }
+    if (lyd_path_append(buf, size, len, name, strlen(name)) || lyd_path_append(buf, size, len, "=", 1)
+            || lyd_path_append(buf, size, len, quote, 1) || lyd_path_append(buf, size, len, value, strlen(value))
+            || lyd_path_append(buf, size, len, quote, 1) || lyd_path_append(buf, size, len, "]", 1)) {
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Append the path segment of a single data node to a data path buffer.
+ *
+ * @param[in] node Data node.
+ * @param[in] predicate Whether to append also the predicate identifying the list or leaf-list instance.
+ * @param[in,out] buf Path buffer.
+ * @param[in,out] size Size of \p buf.
+ * @param[in,out] len Length of the path in \p buf.
+ * @return 0 on success, -1 on error.
+ */
+static int
+lyd_path_append_node(const struct lyd_node *node, int predicate, char **buf, size_t *size, size_t *len)
+{
+    const struct lys_module *mod;
+    const struct lys_node_list *slist;
+    const struct lyd_node *key;
+    const char *ext_name;
+    char num[16];
+    uint16_t i;
+
+    if (lyd_path_append(buf, size, len, "/", 1)) {
+        return -1;
+    }
+
+    /* prefix, if the module changes */
+    mod = lyd_node_module(node);
+    if (!node->parent || (mod != lyd_node_module(node->parent))) {
+        if (lyd_path_append(buf, size, len, mod->name, strlen(mod->name)) || lyd_path_append(buf, size, len, ":", 1)) {
+            return -1;
+        }
+        if (!node->parent && (ext_name = lyp_get_yang_data_template_name(node))) {
+            /* yang-data top element */
+            if (lyd_path_append(buf, size, len, "#", 1) || lyd_path_append(buf, size, len, ext_name, strlen(ext_name))
+                    || lyd_path_append(buf, size, len, "/", 1)) {
+                return -1;
+            }
+        }
+    }
+
+    if (lyd_path_append(buf, size, len, node->schema->name, strlen(node->schema->name))) {
+        return -1;
+    }
+    if (!predicate) {
+        return 0;
+    }
+
+    if (node->schema->nodetype == LYS_LIST) {
+        slist = (const struct lys_node_list *)node->schema;
+        if (!slist->keys_size) {
+            /* schema list without keys - use instance position */
+            sprintf(num, "[%u]", lyd_list_pos(node));
+            return lyd_path_append(buf, size, len, num, strlen(num));
+        }
+
+        /* schema list with keys - use key values in predicates, the keys are normally the first children in order */
+        key = node->child;
+        for (i = 0; i < slist->keys_size; ++i) {
+            if (!key || (key->schema != (struct lys_node *)slist->keys[i])) {
+                LY_TREE_FOR(node->child, key) {
+                    if (key->schema == (struct lys_node *)slist->keys[i]) {
+                        break;
+                    }
+                }
+            }
+            if (!key) {
+                /* missing key */
+                key = node->child;
+                continue;
+            }
+            if (((struct lyd_node_leaf_list *)key)->value_str && lyd_path_append_predicate(buf, size, len,
+                    (lyd_node_module(key) != mod) ? lyd_node_module(key)->name : NULL, key->schema->name,
+                    ((struct lyd_node_leaf_list *)key)->value_str)) {
+                return -1;
+            }
+            key = key->next;
+        }
+    } else if ((node->schema->nodetype == LYS_LEAFLIST) && ((struct lyd_node_leaf_list *)node)->value_str) {
+        return lyd_path_append_predicate(buf, size, len, NULL, ".", ((struct lyd_node_leaf_list *)node)->value_str);
+    }
+
+    return 0;
+}
+
+int
+lyd_path_build(const struct lyd_node *node, char **buf, size_t *size, int no_last_predicate)
+{
+    const struct lyd_node *iter, *stack_buf[LYD_PATH_STACK_SIZE], **stack = stack_buf;
+    uint32_t depth = 0, i;
+    size_t len = 0;
+    int ret = -1;
+
+    assert(node && buf && size);
+
+    /* ancestors from the top-level one */
+    for (iter = node; iter; iter = iter->parent) {
+        ++depth;
+    }
+    if (depth > LYD_PATH_STACK_SIZE) {
+        stack = malloc(depth * sizeof *stack);
+        LY_CHECK_ERR_RETURN(!stack, LOGMEM(NULL), -1);
+    }
+    i = depth;
+    for (iter = node; iter; iter = iter->parent) {
+        stack[--i] = iter;
+    }
+
+    /* write the path in a single forward pass */
+    for (i = 0; i < depth; ++i) {
+        if (lyd_path_append_node(stack[i], !no_last_predicate || (i < depth - 1), buf, size, &len)) {
+            goto cleanup;
         }
     }
+    if (!*buf && lyd_path_append(buf, size, &len, "", 0)) {
+        goto cleanup;
+    }
+    (*buf)[len] = '\0';
+    ret = (int)len;
 
-    if (!(*dflt)) {
-        return 0;
+cleanup:
+    if (stack != stack_buf) {
+        free(stack);
     }
+    return ret;
+}
 
-    /* it has default value, but check if it can appear in the data tree under the list */
-    s = ly_set_new();
-    for (parent = lys_parent((struct lys_node *)sleaf); parent != list->schema; parent = lys_parent(parent)) {
-        if (!(parent->nodetype & (LYS_CONTAINER | LYS_CASE | LYS_CHOICE | LYS_USES))) {
-            /* This should be already detected when parsing schema */
-            LOGINT(ctx);
-            ly_set_free(s);
-            return -1;
-        }
-        ly_set_add(s, (void *)parent, LY_SET_OPT_USEASLIST);
+API int
+lyd_path_buf(const struct lyd_node *node, char **buf, size_t *size)
+{
+    FUN_IN;
+
+    if (!node || !buf || !size || (!*buf && *size)) {
+        LOGARG;
+        return -1;
     }
 
-    ly_ilo_change(NULL, ILO_IGNORE, &prev_ilo, NULL);
-    for (i = 0, last = list; i < s->number; i++) {
-        parent = s->set.s[i]; /* shortcut */
+    return lyd_path_build(node, buf, size, 0);
+}
 
-        switch (parent->nodetype) {
-        case LYS_CONTAINER:
-            if (last) {
-                /* find instance in the data */
-                r = lyd_find_path(last, parent->name);
-                if (!r || r->number > 1) {
-                    ly_set_free(r);
-                    *dflt = NULL;
-                    goto end;
-                }
-                if (r->number) {
-                    last = r->set.d[0];
-                } else {
-                    last = NULL;
-                }
-                ly_set_free(r);
-            }
-            if (((struct lys_node_container *)parent)->presence) {
-                /* not-instantiated presence container on path */
-                *dflt = NULL;
-                goto end;
-            }
+API char **
+lyd_diff_paths(const struct lyd_difflist *diff)
+{
+    FUN_IN;
+
+    const struct lyd_node *node, *parent = NULL;
+    char **paths = NULL, *data = NULL, *path = NULL;
+    size_t *offsets = NULL, data_size = 0, data_len = 0, path_size = 0, path_len, parent_len = 0;
+    uint32_t count, i;
+    int r;
+
+    if (!diff) {
+        LOGARG;
+        return NULL;
+    }
+
+    for (count = 0; diff->type[count] != LYD_DIFF_END; ++count);
+    offsets = malloc((count ? count : 1) * sizeof *offsets);
+    LY_CHECK_ERR_GOTO(!offsets, LOGMEM(NULL), cleanup);
+
+    for (i = 0; i < count; ++i) {
+        switch (diff->type[i]) {
+        case LYD_DIFF_DELETED:
+        case LYD_DIFF_MOVEDAFTER1:
+            node = diff->first[i];
             break;
-        case LYS_CHOICE :
-            /* check presence of another case */
-            if (!last) {
-                continue;
-            }
+        default:
+            node = diff->second[i];
+            break;
+        }
 
-            /* remember the case to be searched in choice by lyv_multicases() */
-            if (i + 1 == s->number) {
-                parent = (struct lys_node *)sleaf;
-            } else if (s->set.s[i + 1]->nodetype == LYS_CASE && (i + 2 < s->number) &&
-                    s->set.s[i + 2]->nodetype == LYS_CHOICE) {
-                /* nested choices are covered by lyv_multicases, we just have to pass
-                 * the lowest choice */
-                i++;
-                continue;
+        /* consecutive siblings share the path of their parent */
+        if (!i || (node->parent != parent)) {
+            parent = node->parent;
+            if (parent) {
+                r = lyd_path_build(parent, &path, &path_size, 0);
+                if (r < 0) {
+                    goto cleanup;
+                }
+                parent_len = r;
             } else {
-                parent = s->set.s[i + 1];
+                parent_len = 0;
             }
-            node = last->child;
-            if (lyv_multicases(NULL, (struct lys_node *)parent, &node, 0, NULL)) {
-                /* another case is present */
-                *dflt = NULL;
-                goto end;
-            }
-            break;
-        default:
-            /* LYS_CASE, LYS_USES */
-            continue;
+        }
+        path_len = parent_len;
+        if (lyd_path_append_node(node, 1, &path, &path_size, &path_len)) {
+            goto cleanup;
+        }
+
+        offsets[i] = data_len;
+        if (lyd_path_append(&data, &data_size, &data_len, path, path_len)
+                || lyd_path_append(&data, &data_size, &data_len, "", 1)) {
+            goto cleanup;
         }
     }
 
-end:
-    ly_ilo_restore(NULL, prev_ilo, NULL, 0);
-    ly_set_free(s);
-    return 0;
+    /* the pointers followed by all the paths in a single allocation */
+    paths = malloc((count + 1) * sizeof *paths + data_len);
+    LY_CHECK_ERR_GOTO(!paths, LOGMEM(NULL), cleanup);
+    if (data_len) {
+        memcpy(&paths[count + 1], data, data_len);
+    }
+    for (i = 0; i < count; ++i) {
+        paths[i] = (char *)&paths[count + 1] + offsets[i];
+    }
+    paths[count] = NULL;
+
+cleanup:
+    free(offsets);
+    free(data);
+    free(path);
+    return paths;
 }
 
 API char *
@@ -6464,13 +8710,15 @@ lyd_path(const struct lyd_node *node)
     FUN_IN;
 
     char *buf = NULL;
+    size_t size = 0;
 
     if (!node) {
         LOGARG;
         return NULL;
     }
 
-    if (ly_vlog_build_path(LY_VLOG_LYD, node, &buf, 0, 0)) {
+    if (lyd_path_build(node, &buf, &size, 0) < 0) {
+        free(buf);
         return NULL;
     }
 
@@ -6685,6 +8933,10 @@ lyd_first_sibling(struct lyd_node *node)
     /* get the first sibling */
     if (node->parent) {
         start = node->parent->child;
+#ifdef LY_ENABLED_CACHE
+    } else if (node->root_idx) {
+        start = lyd_root_first(node);
+#endif
     } else {
         for (start = node; start->prev->next; start = start->prev);
     }
@@ -6692,6 +8944,145 @@ lyd_first_sibling(struct lyd_node *node)
     return start;
 }
 
+/*
+ * The set array is always allocated with one more item behind ly_set#size, which holds the hash index
+ * of the items (or NULL), so that the public structure stays the same.
+ */
+
+/** index of a set containing some item more than once, such sets are searched linearly */
+static char ly_set_noindex;
+
+#define LY_SET_NOINDEX ((void *)&ly_set_noindex)
+
+static struct hash_table *
+ly_set_index(const struct ly_set *set)
+{
+    if (!set->size || (set->set.g[set->size] == LY_SET_NOINDEX)) {
+        return NULL;
+    }
+    return set->set.g[set->size];
+}
+
+static void
+ly_set_index_free(struct ly_set *set)
+{
+    if (set->size) {
+        lyht_free(ly_set_index(set));
+        set->set.g[set->size] = NULL;
+    }
+}
+
+#ifdef LY_ENABLED_CACHE
+
+/**
+ * @brief Record of a set hash index.
+ */
+struct ly_set_index_rec {
+    void *item;
+    unsigned int idx;
+};
+
+static int
+ly_set_index_equal(void *val1_p, void *val2_p, int UNUSED(mod), void *UNUSED(cb_data))
+{
+    return ((struct ly_set_index_rec *)val1_p)->item == ((struct ly_set_index_rec *)val2_p)->item;
+}
+
+static uint32_t
+ly_set_index_hash(void *item)
+{
+    uint32_t hash;
+
+    hash = dict_hash_multi(0, (const char *)&item, sizeof item);
+    return dict_hash_multi(hash, NULL, 0);
+}
+
+/**
+ * @brief Add an item stored on an index of a set into its hash index.
+ *
+ * @return 0 on success, non-zero if the index was dropped.
+ */
+static int
+ly_set_index_add(struct ly_set *set, unsigned int idx)
+{
+    struct ly_set_index_rec rec;
+    int r;
+
+    rec.item = set->set.g[idx];
+    rec.idx = idx;
+    r = lyht_insert(ly_set_index(set), &rec, ly_set_index_hash(rec.item), NULL);
+    if (r) {
+        /* a duplicate item (or an error), do not use any index until the set is cleaned */
+        lyht_free(ly_set_index(set));
+        set->set.g[set->size] = LY_SET_NOINDEX;
+    }
+    return r;
+}
+
+/**
+ * @brief Create a hash index of a set if it is large enough and has none yet.
+ */
+static void
+ly_set_index_create(struct ly_set *set)
+{
+    unsigned int i;
+
+    if ((set->number < LY_CACHE_SET_MIN_ITEMS) || set->set.g[set->size]) {
+        return;
+    }
+
+    set->set.g[set->size] = lyht_new(1, sizeof(struct ly_set_index_rec), ly_set_index_equal, NULL, 1);
+    if (!set->set.g[set->size]) {
+        return;
+    }
+    for (i = 0; (i < set->number) && !ly_set_index_add(set, i); ++i);
+}
+
+/**
+ * @brief Find an item using the hash index of a set.
+ *
+ * @return Matching index record, NULL if not found.
+ */
+static struct ly_set_index_rec *
+ly_set_index_find(const struct ly_set *set, void *item)
+{
+    struct ly_set_index_rec rec, *match;
+
+    rec.item = item;
+    if (lyht_find(ly_set_index(set), &rec, ly_set_index_hash(item), (void **)&match)) {
+        return NULL;
+    }
+    return match;
+}
+
+#endif
+
+/**
+ * @brief Make sure there is space for some items in a set.
+ *
+ * @param[in] set Set to enlarge.
+ * @param[in] size Minimal new size of the set.
+ * @return 0 on success, -1 on error.
+ */
+static int
+ly_set_resize(struct ly_set *set, unsigned int size)
+{
+    void **new, *index;
+
+    if (set->size >= size) {
+        return 0;
+    }
+
+    index = set->size ? set->set.g[set->size] : NULL;
+    new = realloc(set->set.g, (size + 1) * sizeof *(set->set.g));
+    LY_CHECK_ERR_RETURN(!new, LOGMEM(NULL), -1);
+    set->size = size;
+    set->set.g = new;
+    set->set.g[size] = index;
+
+    return 0;
+}
+
 API struct ly_set *
 ly_set_new(void)
 {
@@ -6704,6 +9095,19 @@ ly_set_new(void)
     return new;
 }
 
+API int
+ly_set_reserve(struct ly_set *set, unsigned int size)
+{
+    FUN_IN;
+
+    if (!set) {
+        LOGARG;
+        return -1;
+    }
+
+    return ly_set_resize(set, size);
+}
+
 API void
 ly_set_free(struct ly_set *set)
 {
@@ -6713,6 +9117,7 @@ ly_set_free(struct ly_set *set)
         return;
     }
 
+    ly_set_index_free(set);
     free(set->set.g);
     free(set);
 }
@@ -6723,11 +9128,21 @@ ly_set_contains(const struct ly_set *set, void *node)
     FUN_IN;
 
     unsigned int i;
+#ifdef LY_ENABLED_CACHE
+    struct ly_set_index_rec *rec;
+#endif
 
     if (!set) {
         return -1;
     }
 
+#ifdef LY_ENABLED_CACHE
+    if (ly_set_index(set)) {
+        rec = ly_set_index_find(set, node);
+        return rec ? (int)rec->idx : -1;
+    }
+#endif
+
     for (i = 0; i < set->number; i++) {
         if (set->set.g[i] == node) {
             /* object found */
@@ -6750,13 +9165,14 @@ ly_set_dup(const struct ly_set *set)
         return NULL;
     }
 
-    new = malloc(sizeof *new);
+    new = calloc(1, sizeof *new);
     LY_CHECK_ERR_RETURN(!new, LOGMEM(NULL), NULL);
-    new->number = set->number;
-    new->size = set->size;
-    new->set.g = malloc(new->size * sizeof *(new->set.g));
-    LY_CHECK_ERR_RETURN(!new->set.g, LOGMEM(NULL); free(new), NULL);
-    memcpy(new->set.g, set->set.g, new->size * sizeof *(new->set.g));
+    if (set->number) {
+        /* the index is created again only if needed */
+        LY_CHECK_ERR_RETURN(ly_set_resize(new, set->number), free(new), NULL);
+        memcpy(new->set.g, set->set.g, set->number * sizeof *(new->set.g));
+        new->number = set->number;
+    }
 
     return new;
 }
@@ -6766,8 +9182,7 @@ ly_set_add(struct ly_set *set, void *node, int options)
 {
     FUN_IN;
 
-    unsigned int i;
-    void **new;
+    int i;
 
     if (!set) {
         LOGARG;
@@ -6776,23 +9191,29 @@ ly_set_add(struct ly_set *set, void *node, int options)
 
     if (!(options & LY_SET_OPT_USEASLIST)) {
         /* search for duplication */
-        for (i = 0; i < set->number; i++) {
-            if (set->set.g[i] == node) {
-                /* already in set */
-                return i;
-            }
+#ifdef LY_ENABLED_CACHE
+        ly_set_index_create(set);
+#endif
+        i = ly_set_contains(set, node);
+        if (i > -1) {
+            /* already in set */
+            return i;
         }
     }
 
     if (set->size == set->number) {
-        new = realloc(set->set.g, (set->size + 8) * sizeof *(set->set.g));
-        LY_CHECK_ERR_RETURN(!new, LOGMEM(NULL), -1);
-        set->size += 8;
-        set->set.g = new;
+        /* grow geometrically */
+        LY_CHECK_RETURN(ly_set_resize(set, set->size ? set->size * 2 : 8), -1);
     }
 
     set->set.g[set->number++] = node;
 
+#ifdef LY_ENABLED_CACHE
+    if (ly_set_index(set)) {
+        ly_set_index_add(set, set->number - 1);
+    }
+#endif
+
     return set->number - 1;
 }
 
@@ -6802,7 +9223,6 @@ ly_set_merge(struct ly_set *trg, struct ly_set *src, int options)
     FUN_IN;
 
     unsigned int i, ret;
-    void **new;
 
     if (!trg) {
         LOGARG;
@@ -6815,6 +9235,9 @@ ly_set_merge(struct ly_set *trg, struct ly_set *src, int options)
 
     if (!(options & LY_SET_OPT_USEASLIST)) {
         /* remove duplicates */
+#ifdef LY_ENABLED_CACHE
+        ly_set_index_create(trg);
+#endif
         i = 0;
         while (i < src->number) {
             if (ly_set_contains(trg, src->set.g[i]) > -1) {
@@ -6826,18 +9249,19 @@ ly_set_merge(struct ly_set *trg, struct ly_set *src, int options)
     }
 
     /* allocate more memory if needed */
-    if (trg->size < trg->number + src->number) {
-        new = realloc(trg->set.g, (trg->number + src->number) * sizeof *(trg->set.g));
-        LY_CHECK_ERR_RETURN(!new, LOGMEM(NULL), -1);
-        trg->size = trg->number + src->number;
-        trg->set.g = new;
-    }
+    LY_CHECK_RETURN(ly_set_resize(trg, trg->number + src->number), -1);
 
     /* copy contents from src into trg */
     memcpy(trg->set.g + trg->number, src->set.g, src->number * sizeof *(src->set.g));
     ret = src->number;
     trg->number += ret;
 
+#ifdef LY_ENABLED_CACHE
+    for (i = trg->number - ret; ly_set_index(trg) && (i < trg->number); ++i) {
+        ly_set_index_add(trg, i);
+    }
+#endif
+
     /* cleanup */
     ly_set_free(src);
     return ret;
@@ -6848,11 +9272,33 @@ ly_set_rm_index(struct ly_set *set, unsigned int index)
 {
     FUN_IN;
 
+#ifdef LY_ENABLED_CACHE
+    struct ly_set_index_rec rec, *match;
+    int r;
+#endif
+
     if (!set || (index + 1) > set->number) {
         LOGARG;
         return EXIT_FAILURE;
     }
 
+#ifdef LY_ENABLED_CACHE
+    if (ly_set_index(set)) {
+        /* the removed item is unique in an indexed set */
+        rec.item = set->set.g[index];
+        r = lyht_remove(ly_set_index(set), &rec, ly_set_index_hash(rec.item));
+        assert(!r);
+        (void)r;
+
+        if (index < set->number - 1) {
+            /* the last item is moved */
+            match = ly_set_index_find(set, set->set.g[set->number - 1]);
+            assert(match);
+            match->idx = index;
+        }
+    }
+#endif
+
     if (index == set->number - 1) {
         /* removing last item in set */
         set->set.g[index] = NULL;
@@ -6871,7 +9317,7 @@ ly_set_rm(struct ly_set *set, void *node)
 {
     FUN_IN;
 
-    unsigned int i;
+    int i;
 
     if (!set || !node) {
         LOGARG;
@@ -6879,12 +9325,11 @@ ly_set_rm(struct ly_set *set, void *node)
     }
 
     /* get index */
-    for (i = 0; i < set->number; i++) {
-        if (set->set.g[i] == node) {
-            break;
-        }
-    }
-    if (i == set->number) {
+#ifdef LY_ENABLED_CACHE
+    ly_set_index_create(set);
+#endif
+    i = ly_set_contains(set, node);
+    if (i == -1) {
         /* node is not in set */
         LOGARG;
         return EXIT_FAILURE;
@@ -6902,6 +9347,8 @@ ly_set_clean(struct ly_set *set)
         return EXIT_FAILURE;
     }
 
+    /* the set may be filled with duplicates the next time */
+    ly_set_index_free(set);
     set->number = 0;
     return EXIT_SUCCESS;
 }
@@ -7346,7 +9793,7 @@ lyd_wd_add_subtree(struct lyd_node **root, struct lyd_node *last_parent, struct
     struct ly_set *present = NULL;
     struct lys_node *siter, *siter_prev;
     struct lyd_node *iter;
-    int i, check_when_must, storing_diff = 0;
+    int i, opts, check_when_must, storing_diff = 0;
 
     assert(root);
 
@@ -7375,7 +9822,11 @@ lyd_wd_add_subtree(struct lyd_node **root, struct lyd_node *last_parent, struct
                 if (schema->nodetype & LYS_LEAFLIST) {
                     lyd_wd_leaflist_cleanup(present, unres);
                 } else if (schema->nodetype != LYS_LEAF) {
-                    if (lyd_wd_add_subtree(root, present->set.d[i], present->set.d[i], schema, 0, options, unres)) {
+                    opts = options;
+                    if (lyd_val_incr_skip(present->set.d[i], &opts)) {
+                        continue;
+                    }
+                    if (lyd_wd_add_subtree(root, present->set.d[i], present->set.d[i], schema, 0, opts, unres)) {
                         goto error;
                     }
                 } /* else LYS_LEAF - nothing to do */
@@ -7507,7 +9958,11 @@ lyd_wd_add_subtree(struct lyd_node **root, struct lyd_node *last_parent, struct
                     } else if (siter->nodetype != LYS_LEAF) {
                         /* recursion */
                         for (i = 0; i < (signed)present->number; i++) {
-                            if (lyd_wd_add_subtree(root, present->set.d[i], present->set.d[i], siter, toplevel, options,
+                            opts = options;
+                            if (lyd_val_incr_skip(present->set.d[i], &opts)) {
+                                continue;
+                            }
+                            if (lyd_wd_add_subtree(root, present->set.d[i], present->set.d[i], siter, toplevel, opts,
                                                    unres)) {
                                 goto error;
                             }
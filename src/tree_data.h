@@ -156,6 +156,13 @@ struct lyd_attr {
                                       are checked for this node if flag #LYD_OPT_OBSOLETE is used. */
 #define LYD_VAL_LEAFREF  0x08    /**< Node is a leafref, which needs to be resolved (it is invalid, new possible
                                       resolvent, or something similar) */
+#define LYD_VAL_SUBTREE  0x10    /**< Node was inserted into the data tree and its whole subtree needs to be validated
+                                      again, used by #LYD_OPT_VAL_INCR */
+#define LYD_VAL_DIRTY    0x20    /**< Some node in the subtree was changed, added or removed since the last validation,
+                                      set on all the ancestors of the change and used by #LYD_OPT_VAL_INCR */
+#define LYD_VAL_TOPDEL   0x40    /**< A top-level sibling with no other instance of its schema node was removed since
+                                      the last validation, set on all the remaining top-level nodes and used by
+                                      #LYD_OPT_VAL_INCR */
 #define LYD_VAL_INUSE    0x80    /**< Internal flag for note about various processing on data, should be used only
                                       internally and removed before libyang returns the node to the caller */
 /**
@@ -181,6 +188,10 @@ struct lyd_node {
     uint8_t dflt:1;                  /**< flag for implicit default node */
     uint8_t when_status:3;           /**< bit for checking if the when-stmt condition is resolved - internal use only,
                                           do not use this value! */
+    uint8_t arena:1;                 /**< flag for a node allocated from a data tree arena (#LYD_OPT_ARENA) - internal
+                                          use only, do not use this value! */
+    uint8_t root_idx:1;              /**< flag for a top-level node in the hash index of its siblings - internal use only,
+                                          do not use this value! */
 
     struct lyd_attr *attr;           /**< pointer to the list of attributes of this node */
     struct lyd_node *next;           /**< pointer to the next sibling node (NULL if there is no one) */
@@ -223,6 +234,10 @@ struct lyd_node_leaf_list {
     uint8_t dflt:1;                  /**< flag for implicit default node */
     uint8_t when_status:3;           /**< bit for checking if the when-stmt condition is resolved - internal use only,
                                           do not use this value! */
+    uint8_t arena:1;                 /**< flag for a node allocated from a data tree arena (#LYD_OPT_ARENA) - internal
+                                          use only, do not use this value! */
+    uint8_t root_idx:1;              /**< flag for a top-level node in the hash index of its siblings - internal use only,
+                                          do not use this value! */
 
     struct lyd_attr *attr;           /**< pointer to the list of attributes of this node */
     struct lyd_node *next;           /**< pointer to the next sibling node (NULL if there is no one) */
@@ -284,6 +299,10 @@ struct lyd_node_anydata {
     uint8_t dflt:1;                  /**< flag for implicit default node */
     uint8_t when_status:3;           /**< bit for checking if the when-stmt condition is resolved - internal use only,
                                           do not use this value! */
+    uint8_t arena:1;                 /**< flag for a node allocated from a data tree arena (#LYD_OPT_ARENA) - internal
+                                          use only, do not use this value! */
+    uint8_t root_idx:1;              /**< flag for a top-level node in the hash index of its siblings - internal use only,
+                                          do not use this value! */
 
     struct lyd_attr *attr;           /**< pointer to the list of attributes of this node */
     struct lyd_node *next;           /**< pointer to the next sibling node (NULL if there is no one) */
@@ -437,6 +456,51 @@ struct lyd_difflist *lyd_diff(struct lyd_node *first, struct lyd_node *second, i
                                              explicit default nodes. */
 /**@} diffoptions */
 
+/**
+ * @brief Print the result of lyd_diff() as a self-contained patch, which can be stored or sent elsewhere and applied
+ * to another instance of the first tree by lyd_diff_apply().
+ *
+ * The patch is a text with one change per line, identifying the nodes by their data paths (see lyd_path()). The
+ * created nodes are printed with all their descendants, except for the list keys and the default nodes. The values
+ * of anydata nodes are printed as XML, unless they are JSON or a plain string. Note that instances of key-less lists
+ * and state leaf-lists are identified by their position.
+ *
+ * @param[out] strp Pointer to store the resulting patch, an empty string if there are no differences. It is supposed
+ *             to be freed by the caller with free().
+ * @param[in] diff Result of lyd_diff() to print.
+ * @return 0 on success, -1 on error.
+ */
+int lyd_diff_print_mem(char **strp, const struct lyd_difflist *diff);
+
+/**
+ * @brief Apply a patch printed by lyd_diff_print_mem() to a data tree.
+ *
+ * The changes are applied in the order they were printed and the nodes are looked up by their paths in the hash
+ * tables of their siblings. The data tree is expected to be the same as the first tree passed to lyd_diff(), if it
+ * differs so that a change cannot be applied (the changed node does not exist or a created node already exists),
+ * an error is returned and the data tree is left with the changes applied so far. The result is not validated.
+ *
+ * @param[in,out] root Any top-level sibling of the data tree to change, it can be changed or become NULL if all the
+ *                top-level nodes are deleted. If NULL, a new data tree is created by the patch.
+ * @param[in] ctx Context of the data tree, required only if \p root points to NULL.
+ * @param[in] patch Patch to apply.
+ * @return 0 on success, -1 on error.
+ */
+int lyd_diff_apply(struct lyd_node **root, struct ly_ctx *ctx, const char *patch);
+
+/**
+ * @brief Build the data paths (see lyd_path()) of all the nodes in the result of lyd_diff() at once.
+ *
+ * The paths of the nodes in the lyd_difflist::first array are provided for #LYD_DIFF_DELETED and
+ * #LYD_DIFF_MOVEDAFTER1 and of the nodes in the lyd_difflist::second array for the other types. Consecutive
+ * siblings reuse the path of their parent, which is built only once.
+ *
+ * @param[in] diff Result of lyd_diff().
+ * @return Array of paths at the same indexes as in \p diff, terminated by NULL, NULL on error. The array and
+ *         all the paths are stored in a single allocation, which is supposed to be freed by the caller with free().
+ */
+char **lyd_diff_paths(const struct lyd_difflist *diff);
+
 /**
  * @brief Build data path (usable as path, see @ref howtoxpath) of the data node.
  * @param[in] node Data node to be processed. Note that the node should be from a complete data tree, having a subtree
@@ -446,6 +510,19 @@ struct lyd_difflist *lyd_diff(struct lyd_node *first, struct lyd_node *second, i
  */
 char *lyd_path(const struct lyd_node *node);
 
+/**
+ * @brief Build data path (usable as path, see @ref howtoxpath) of the data node into a buffer, which can be reused
+ * for many nodes to avoid allocating every path separately.
+ *
+ * @param[in] node Data node to be processed. Note that the node should be from a complete data tree, having a subtree
+ *            (after using lyd_unlink()) can cause generating invalid paths.
+ * @param[in,out] buf Buffer for the path, it is reallocated if too small. If it points to NULL, a new buffer is
+ *                allocated. The caller is supposed to free it with free().
+ * @param[in,out] size Size of \p buf, 0 if it points to NULL.
+ * @return Length of the path stored in \p buf, -1 on error.
+ */
+int lyd_path_buf(const struct lyd_node *node, char **buf, size_t *size);
+
 /**
  * @defgroup parseroptions Data parser options
  * @ingroup datatree
@@ -539,6 +616,31 @@ char *lyd_path(const struct lyd_node *node);
 #define LYD_OPT_VAL_DIFF 0x40000 /**< Flag only for validation, store all the data node changes performed by the validation
                                       in a diff structure. */
 #define LYD_OPT_LYB_MOD_UPDATE 0x80000 /**< Allow to parse data using an updated revision of a module, relevant only for LYB format. */
+#define LYD_OPT_ARENA 0x100000 /**< Allocate the parsed data nodes from a memory arena shared by the whole data tree instead
+                                    of allocating each node separately. The nodes are kept close to each other and their
+                                    memory is released at once when the last node of the tree is freed, so it is best
+                                    suited for short-lived trees that are freed as a whole, see lyd_free_arena().
+                                    Only the node structures are taken from the arena, attributes, values and the child
+                                    hash tables are allocated separately because they hold dictionary strings and have
+                                    to be released node by node anyway. The nodes created later (by the validation or
+                                    lyd_new*() functions) are allocated separately as well. */
+#define LYD_OPT_VAL_INCR 0x200000 /**< Flag only for validation, validate incrementally only the parts of the data tree that
+                                      changed since it was last validated (or parsed). Unchanged subtrees are skipped and
+                                      out of them, only the nodes with when or must conditions referencing the changed
+                                      schema nodes (and leafrefs referencing the changed nodes) are checked again.
+                                      Applicable only with #LYD_OPT_DATA and #LYD_OPT_CONFIG and the data tree must have
+                                      been successfully validated before with the same data type. In combination with
+                                      #LYD_OPT_WHENAUTODEL, the whole data tree is validated. */
+#define LYD_OPT_VAL_PARALLEL 0x400000 /**< Validate independent top-level subtrees in parallel using the number of
+                                      threads set by ly_ctx_set_validation_threads(). The conditions and references
+                                      between different top-level subtrees, the when conditions, and the
+                                      instance-identifiers are always resolved serially. Applicable only with
+                                      #LYD_OPT_DATA and #LYD_OPT_CONFIG, other data types are validated serially. */
+#define LYD_OPT_LYB_FILTER 0x800000 /**< Parse only the subtrees of the schema nodes in the set passed as a variable
+                                      argument together with their ancestors (lists with their keys), skip all the
+                                      other data without creating any nodes. The result is not a valid data tree,
+                                      references outside the parsed subtrees are not resolved. Relevant only for
+                                      LYB format. */
 #define LYD_OPT_DATA_TEMPLATE 0x1000000 /**< Data represents YANG data template. */
 
 /**@} parseroptions */
@@ -575,6 +677,9 @@ char *lyd_path(const struct lyd_node *node);
  *                  - const struct ::lyd_node *data_tree - additional **validated** top-level siblings of a data tree that
  *                    will be used when checking any references ("when", "must" conditions, leafrefs, ...)
  *                    that require some nodes outside their subtree.
+ *                - #LYD_OPT_LYB_FILTER (following any of the previous arguments):
+ *                  - const struct ::ly_set *filter - set of schema data nodes to parse, ly_ctx_find_path() can be
+ *                    used to get them from schema paths.
  * @return Pointer to the built data tree or NULL in case of empty \p data. To free the returned structure,
  *         use lyd_free(). In these cases, the function sets #ly_errno to LY_SUCCESS. In case of error,
  *         #ly_errno contains appropriate error code (see #LY_ERR).
@@ -615,6 +720,9 @@ struct lyd_node *lyd_parse_mem(struct ly_ctx *ctx, const char *data, LYD_FORMAT
  *                  - const struct ::lyd_node *data_tree - additional **validated** top-level siblings of a data tree that
  *                    will be used when checking any references ("when", "must" conditions, leafrefs, ...)
  *                    that require some nodes outside their subtree.
+ *                - #LYD_OPT_LYB_FILTER (following any of the previous arguments):
+ *                  - const struct ::ly_set *filter - set of schema data nodes to parse, ly_ctx_find_path() can be
+ *                    used to get them from schema paths.
  * @return Pointer to the built data tree or NULL in case of empty file. To free the returned structure,
  *         use lyd_free(). In these cases, the function sets #ly_errno to LY_SUCCESS. In case of error,
  *         #ly_errno contains appropriate error code (see #LY_ERR).
@@ -653,6 +761,9 @@ struct lyd_node *lyd_parse_fd(struct ly_ctx *ctx, int fd, LYD_FORMAT format, int
  *                  - const struct ::lyd_node *data_tree - additional **validated** top-level siblings of a data tree that
  *                    will be used when checking any references ("when", "must" conditions, leafrefs, ...)
  *                    that require some nodes outside their subtree.
+ *                - #LYD_OPT_LYB_FILTER (following any of the previous arguments):
+ *                  - const struct ::ly_set *filter - set of schema data nodes to parse, ly_ctx_find_path() can be
+ *                    used to get them from schema paths.
  * @return Pointer to the built data tree or NULL in case of empty file. To free the returned structure,
  *         use lyd_free(). In these cases, the function sets #ly_errno to LY_SUCCESS. In case of error,
  *         #ly_errno contains appropriate error code (see #LY_ERR).
@@ -1292,6 +1403,19 @@ void lyd_free(struct lyd_node *node);
  */
 void lyd_free_withsiblings(struct lyd_node *node);
 
+/**
+ * @brief Free the whole data tree the specified node belongs to, meant mainly for the trees parsed
+ * with #LYD_OPT_ARENA.
+ *
+ * All the nodes are still visited to release their attributes, values, hash tables and dictionary strings,
+ * only the memory of the nodes allocated from an arena is not freed one by one but at once with the last of its
+ * nodes. Nodes moved from the tree into another data tree keep the arena allocated until they are freed as well.
+ * Any data tree can be freed this way, even without an arena.
+ *
+ * @param[in] node Any node of the data tree to be freed.
+ */
+void lyd_free_arena(struct lyd_node *node);
+
 /**
  * @brief Insert attribute into the data node.
  *
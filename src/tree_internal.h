@@ -68,14 +68,23 @@ struct lyd_node_pos {
  * @brief Internal structure for LYB parser/printer.
  */
 struct lyb_state {
-    size_t *written;
-    size_t *position;
-    uint8_t *inner_chunks;
+    size_t *written;            /* per subtree level: v1 - bytes left in the current chunk,
+                                     v2 - offset of the subtree end (subtree start when counting lengths) */
+    size_t *position;           /* per subtree level: v1 - whether another chunk follows the current one,
+                                     v2 printer - index of the subtree length in sub_len when counting lengths */
+    uint8_t *inner_chunks;      /* v1 only: number of inner chunks in the current chunk */
     int used;
     int size;
     const struct lys_module **models;
     int mod_count;
     struct ly_ctx *ctx;
+    uint8_t version;            /* LYB format version being processed */
+    size_t offset;              /* number of bytes read/written (counted) so far */
+
+    /* LYB parser only */
+    struct ly_set *filter;      /* schema nodes parsed with their whole subtrees, NULL if everything is parsed */
+    struct ly_set *filter_anc;  /* schema ancestors of the filter nodes, parsed without the other descendants */
+    int filter_level;           /* subtree level of the filter node being parsed, 0 if none */
 
     /* LYB printer only */
     struct {
@@ -83,11 +92,30 @@ struct lyb_state {
         struct hash_table *ht;
     } *sib_ht;
     int sib_ht_count;
+    uint32_t *sub_len;          /* lengths of all the subtrees of a top-level subtree in the order they are printed */
+    uint8_t *sub_hash;          /* schema hashes of the data node subtrees, in the same order */
+    uint32_t sub_count;         /* number of subtree lengths counted/printed so far */
+    uint32_t sub_size;          /* allocated sub_len items */
 };
 
 /* struct lyb_state allocation step */
 #define LYB_STATE_STEP 4
 
+/**
+ * LYB format versions stored in the header byte
+ *
+ * Version 1 splits the data into chunks of at most LYB_SIZE_MAX bytes, each preceded by its size and the number
+ * of inner chunks it contains (LYB_META_BYTES). Printers of this version stored zero in the header byte.
+ *
+ * Version 2 precedes every subtree (data node or attribute) with its whole length as an unsigned LEB128 varint,
+ * all the values are stored contiguously.
+ */
+#define LYB_VERSION_1 0x00
+#define LYB_VERSION_2 0x02
+
+/* Maximum number of bytes of a subtree length varint (32b length) */
+#define LYB_VARINT_MAX_BYTES 5
+
 /**
  * LYB schema hash constants
  *
@@ -111,7 +139,7 @@ struct lyb_state {
 /* Need to move this first >> collision number (from 0) to get collision ID hash part */
 #define LYB_HASH_COLLISION_ID 0x80
 
-/* How many bytes are reserved for one data chunk SIZE (8B is maximum) */
+/* How many bytes are reserved for one data chunk SIZE (8B is maximum), version 1 only */
 #define LYB_SIZE_BYTES 1
 
 /* Maximum size that will be written into LYB_SIZE_BYTES (must be large enough) */
@@ -160,11 +188,62 @@ int lyb_has_schema_model(struct lys_node *sibling, const struct lys_module **mod
  */
 #   define LY_CACHE_HT_MIN_CHILDREN 4
 
+/**
+ * @brief Minimum number of items for a set to create a hash index of them.
+ */
+#   define LY_CACHE_SET_MIN_ITEMS 32
+
+/**
+ * @brief Minimum number of top-level data siblings to create a hash index of them.
+ */
+#   define LY_CACHE_ROOT_MIN_SIBLINGS 16
+
+/**
+ * @brief Hash index of the top-level siblings of a data tree.
+ *
+ * Top-level nodes have no parent to hold the hash table of them (::lyd_node#ht), so each indexed node
+ * (::lyd_node#root_idx) is recorded in its context together with the index of its siblings. The index
+ * is created on its first use and then maintained when the siblings are inserted, unlinked, or freed.
+ */
+struct lyd_root_idx {
+    struct hash_table *ht;      /* hashed siblings, the same as ::lyd_node#ht of a parent */
+    struct lyd_node *first;     /* first sibling, possibly outdated by inserting before it, NULL if not known */
+    uint32_t count;             /* number of all the siblings in the index, including those not hashed */
+};
+
+    uint32_t lyd_hash_seed(struct lys_node *schema);
+
     int lyd_hash(struct lyd_node *node);
 
     void lyd_insert_hash(struct lyd_node *node);
 
     void lyd_unlink_hash(struct lyd_node *node, struct lyd_node *orig_parent);
+
+/**
+ * @brief Prepare the records of indexed top-level data nodes of a context.
+ *
+ * @param[in] ctx Context to prepare.
+ * @return 0 on success, non-zero on error.
+ */
+    int lyd_root_nodes_init(struct ly_ctx *ctx);
+
+/**
+ * @brief Free the records of indexed top-level data nodes of a context together with any remaining indexes.
+ *
+ * @param[in] ctx Context to clean.
+ */
+    void lyd_root_nodes_free(struct ly_ctx *ctx);
+
+/**
+ * @brief Get the hash table of top-level data siblings, create it if there are enough siblings.
+ *
+ * The table is owned by the data tree, it is freed with the last of its nodes.
+ *
+ * @param[in] sibling Any top-level data node.
+ * @return Hash table of the siblings of \p sibling with the same records as ::lyd_node#ht, NULL if there
+ * are too few of them or on error.
+ */
+    struct hash_table *lyd_root_ht(struct lyd_node *sibling);
 #endif
 
 /**
@@ -484,14 +563,97 @@ int lys_get_sibling(const struct lys_node *siblings, const char *mod_name, int m
 int lys_getnext_data(const struct lys_module *mod, const struct lys_node *parent, const char *name, int nam_len,
                      LYS_NODE type, int getnext_opts, const struct lys_node **ret);
 
+/**
+ * @brief Find a node among the nodes returned by lys_getnext() for a parent using the parent's child index
+ * (created on the first use, only with cache enabled). Does not log.
+ *
+ * @param[in] mod Main module of the node. Must be set if \p parent == NULL (top-level node), ignored otherwise.
+ * @param[in] parent Container, list, notification, input or output, NULL for a top-level node.
+ * @param[in] mod_name Name of the module of the node.
+ * @param[in] mod_name_len Length of \p mod_name, 0 if it is terminated.
+ * @param[in] name Node name.
+ * @param[in] nam_len Length of \p name, 0 if it is terminated.
+ * @param[in] getnext_opts lys_getnext() options, only #LYS_GETNEXT_NOSTATECHECK is supported.
+ * @param[out] ret Found node, NULL if there is no such node.
+ *
+ * @return EXIT_SUCCESS if the index was searched, EXIT_FAILURE if there is no index for the parent and
+ * lys_getnext() must be used instead.
+ */
+int lys_child_index_find(const struct lys_module *mod, const struct lys_node *parent, const char *mod_name,
+                         int mod_name_len, const char *name, int nam_len, int getnext_opts, const struct lys_node **ret);
+
+/**
+ * @brief Note a change of the schema trees of a context, which invalidates all the schema child indexes
+ * and the reverse dependencies for incremental validation. Schemas must not be changed while data are being parsed
+ * or validated, so the indexes replaced since the previous change are not being searched by any thread and are freed.
+ *
+ * @param[in] ctx Context with the changed schemas.
+ */
+void lys_schema_changed(struct ly_ctx *ctx);
+
+#ifdef LY_ENABLED_CACHE
+
+/**
+ * @brief Free the schema child indexes replaced after schema changes, they are kept until
+ * the next schema change or until the context is destroyed because other threads may have been searching them.
+ *
+ * @param[in] ctx Context with the replaced indexes.
+ */
+void lys_child_index_free_retired(struct ly_ctx *ctx);
+
+/**
+ * @brief Free the reverse dependencies of the schema nodes collected for incremental data validation.
+ *
+ * @param[in] ctx Context with the dependencies.
+ */
+void lyd_val_deps_free(struct ly_ctx *ctx);
+
+#endif
+
 int lyd_get_unique_default(const char* unique_expr, struct lyd_node *list, const char **dflt);
 
+/**
+ * @brief Number of ancestors of a data node for which lyd_path_build() needs no allocation.
+ */
+#define LYD_PATH_STACK_SIZE 32
+
+/**
+ * @brief Build the data path of a data node into a buffer, in a single pass from the top-level node.
+ *
+ * @param[in] node Data node.
+ * @param[in,out] buf Buffer for the path, enlarged if needed, can point to NULL.
+ * @param[in,out] size Size of \p buf.
+ * @param[in] no_last_predicate Whether to skip the predicate of \p node itself.
+ * @return Length of the path, -1 on error.
+ */
+int lyd_path_build(const struct lyd_node *node, char **buf, size_t *size, int no_last_predicate);
+
 int lyd_build_relative_data_path(const struct lys_module *module, const struct lyd_node *node, const char *schema_id,
                                  char *buf);
 
 void lyd_free_value(lyd_val value, LY_DATA_TYPE value_type, uint8_t value_flags, struct lys_type *type,
                     const char *value_str, lyd_val *old_val, LY_DATA_TYPE *old_val_type, uint8_t *old_val_flags);
 
+/**
+ * @brief Allocate a new zeroed data node of the size required by its schema node. Does not log.
+ *
+ * With #LYD_OPT_ARENA or if \p near was allocated from an arena, the node is allocated from the arena
+ * of \p near, or a new one if there is none.
+ *
+ * @param[in] schema Schema node of the new data node.
+ * @param[in] near Parent or a sibling of the new node, if any.
+ * @param[in] options Parser options.
+ * @return New node, NULL on error.
+ */
+struct lyd_node *lyd_node_alloc(const struct lys_node *schema, const struct lyd_node *near, int options);
+
+/**
+ * @brief Free the memory of a data node allocated by lyd_node_alloc(), nothing else.
+ *
+ * @param[in] node Node to free.
+ */
+void lyd_node_dealloc(struct lyd_node *node);
+
 int lyd_list_equal(struct lyd_node *node1, struct lyd_node *node2, int with_defaults);
 
 int lys_make_implemented_r(struct lys_module *module, struct unres_schema *unres);
@@ -544,6 +706,17 @@ int lyd_defaults_add_unres(struct lyd_node **root, int options, struct ly_ctx *c
                            int mod_count, const struct lyd_node *data_tree, struct lyd_node *act_notif,
                            struct unres_data *unres, int wd);
 
+/**
+ * @brief Clear the marks of changed data nodes (#LYD_VAL_SUBTREE, #LYD_VAL_DIRTY) after a successful validation
+ * of a data tree so that the next incremental validation (#LYD_OPT_VAL_INCR) checks only the later changes.
+ *
+ * @param[in] root First top-level sibling of the validated data tree.
+ * @param[in] modules Only the validated modules, all if NULL.
+ * @param[in] mod_count Number of \p modules.
+ * @param[in] options Standard @ref parseroptions used for the validation.
+ */
+void lyd_val_clean(struct lyd_node *root, const struct lys_module **modules, int mod_count, int options);
+
 void lys_enable_deviations(struct lys_module *module);
 
 void lys_disable_deviations(struct lys_module *module);
@@ -223,6 +223,255 @@ lys_get_sibling(const struct lys_node *siblings, const char *mod_name, int mod_n
     return EXIT_FAILURE;
 }
 
+#ifdef LY_ENABLED_CACHE
+
+/**
+ * @brief Index of the schema nodes returned by lys_getnext() for a parent (without state checks).
+ */
+struct lys_child_index {
+    struct hash_table *ht;   /**< hash table of the nodes, NULL if there are too few of them to be worth it */
+    uint32_t schema_gen;     /**< context schema generation the index was created in */
+    struct lys_child_index *next_retired; /**< next replaced index in the context list */
+};
+
+/**
+ * @brief Key to search for in a schema child index.
+ */
+struct lys_child_index_key {
+    const char *mod_name;
+    int mod_name_len;
+    const char *name;
+    int nam_len;
+};
+
+static uint32_t
+lys_child_index_hash(const char *mod_name, int mod_name_len, const char *name, int nam_len)
+{
+    uint32_t hash;
+
+    hash = dict_hash_multi(0, mod_name, mod_name_len);
+    hash = dict_hash_multi(hash, name, nam_len);
+    return dict_hash_multi(hash, NULL, 0);
+}
+
+static int
+lys_child_index_val_equal(void *val1_p, void *val2_p, int mod, void *UNUSED(cb_data))
+{
+    struct lys_child_index_key *key;
+    const struct lys_node *node;
+    const char *mod_name;
+
+    node = *(struct lys_node **)val2_p;
+    if (mod) {
+        /* inserting, val1_p is a node as well */
+        return *(struct lys_node **)val1_p == node;
+    }
+
+    /* searching, val1_p is the key */
+    key = (struct lys_child_index_key *)val1_p;
+    if (strncmp(node->name, key->name, key->nam_len) || node->name[key->nam_len]) {
+        return 0;
+    }
+    mod_name = lys_node_module(node)->name;
+    if (strncmp(mod_name, key->mod_name, key->mod_name_len) || mod_name[key->mod_name_len]) {
+        return 0;
+    }
+    return 1;
+}
+
+static struct lys_child_index **
+lys_child_index_ptr(const struct lys_node *parent, const struct lys_module *mod)
+{
+    if (!parent) {
+        return (struct lys_child_index **)&((struct lys_module *)mod)->data_idx;
+    }
+
+    switch (parent->nodetype) {
+    case LYS_CONTAINER:
+        return (struct lys_child_index **)&((struct lys_node_container *)parent)->child_idx;
+    case LYS_LIST:
+        return (struct lys_child_index **)&((struct lys_node_list *)parent)->child_idx;
+    case LYS_NOTIF:
+        return (struct lys_child_index **)&((struct lys_node_notif *)parent)->child_idx;
+    case LYS_INPUT:
+    case LYS_OUTPUT:
+        return (struct lys_child_index **)&((struct lys_node_inout *)parent)->child_idx;
+    default:
+        /* RPC and action children depend on the data type, other nodes are not data parents */
+        return NULL;
+    }
+}
+
+static void
+lys_child_index_free(void *child_idx)
+{
+    struct lys_child_index *idx = (struct lys_child_index *)child_idx;
+
+    if (idx) {
+        lyht_free(idx->ht);
+        free(idx);
+    }
+}
+
+void
+lys_child_index_free_retired(struct ly_ctx *ctx)
+{
+    struct lys_child_index *idx;
+
+    while ((idx = ctx->retired_idx)) {
+        ctx->retired_idx = idx->next_retired;
+        lys_child_index_free(idx);
+    }
+}
+
+static struct lys_child_index *
+lys_child_index_get(const struct lys_node *parent, const struct lys_module *mod)
+{
+    struct ly_ctx *ctx;
+    struct lys_child_index **idx_p, *idx;
+    const struct lys_node *node;
+    uint32_t count, size, schema_gen;
+
+    idx_p = lys_child_index_ptr(parent, mod);
+    if (!idx_p) {
+        return NULL;
+    }
+
+    ctx = parent ? parent->module->ctx : mod->ctx;
+    if (ctx->models.parsing_sub_modules_count) {
+        /* the schema trees are being changed, the index would be recreated all the time */
+        return NULL;
+    }
+    /* several threads may be parsing data at once, the index is read without the lock */
+    schema_gen = __atomic_load_n(&ctx->models.schema_gen, __ATOMIC_ACQUIRE);
+    idx = __atomic_load_n(idx_p, __ATOMIC_ACQUIRE);
+    if (idx && (idx->schema_gen == schema_gen)) {
+        return idx;
+    }
+
+    /* the schema has changed since the index was created (or it was not yet created), only one thread creates it */
+    pthread_mutex_lock(&ctx->cache_lock);
+    idx = *idx_p;
+    if (idx && (idx->schema_gen == schema_gen)) {
+        goto finish;
+    }
+
+    idx = calloc(1, sizeof *idx);
+    LY_CHECK_ERR_GOTO(!idx, LOGMEM(ctx), finish);
+    idx->schema_gen = schema_gen;
+
+    count = 0;
+    node = NULL;
+    while ((node = lys_getnext(node, parent, parent ? NULL : mod, LYS_GETNEXT_NOSTATECHECK))) {
+        ++count;
+    }
+
+    if (count >= LY_CACHE_HT_MIN_CHILDREN) {
+        /* the set of nodes is fixed, so the table is at most half full and never resized */
+        for (size = LYHT_MIN_SIZE; size < count * 2; size <<= 1);
+        idx->ht = lyht_new(size, sizeof node, lys_child_index_val_equal, NULL, 0);
+        LY_CHECK_ERR_GOTO(!idx->ht, free(idx); idx = NULL, finish);
+
+        while ((node = lys_getnext(node, parent, parent ? NULL : mod, LYS_GETNEXT_NOSTATECHECK))) {
+            if (lyht_insert(idx->ht, &node, lys_child_index_hash(lys_node_module(node)->name,
+                    strlen(lys_node_module(node)->name), node->name, strlen(node->name)), NULL) == -1) {
+                lys_child_index_free(idx);
+                idx = NULL;
+                goto finish;
+            }
+        }
+    }
+
+    /* another thread may have just read the previous index, it can be freed only on the next schema change */
+    if (*idx_p) {
+        (*idx_p)->next_retired = ctx->retired_idx;
+        ctx->retired_idx = *idx_p;
+    }
+    __atomic_store_n(idx_p, idx, __ATOMIC_RELEASE);
+
+finish:
+    pthread_mutex_unlock(&ctx->cache_lock);
+    return idx;
+}
+
+#endif
+
+void
+lys_schema_changed(struct ly_ctx *ctx)
+{
+    __atomic_add_fetch(&ctx->models.schema_gen, 1, __ATOMIC_RELEASE);
+#ifdef LY_ENABLED_CACHE
+    /* no data are being parsed while the schema changes, so nobody can be reading the replaced indexes */
+    lys_child_index_free_retired(ctx);
+    lyd_val_deps_free(ctx);
+#endif
+}
+
+int
+lys_child_index_find(const struct lys_module *mod, const struct lys_node *parent, const char *mod_name,
+                     int mod_name_len, const char *name, int nam_len, int getnext_opts, const struct lys_node **ret)
+{
+#ifdef LY_ENABLED_CACHE
+    struct lys_child_index *idx;
+    struct lys_child_index_key key;
+    const struct lys_node *iter, **match;
+
+    assert((mod || parent) && mod_name && name && ret);
+
+    if (getnext_opts & ~LYS_GETNEXT_NOSTATECHECK) {
+        /* the index includes only the nodes returned without any options */
+        return EXIT_FAILURE;
+    }
+
+    if (!parent) {
+        mod = lys_main_module(mod);
+    }
+    idx = lys_child_index_get(parent, mod);
+    if (!idx || !idx->ht) {
+        return EXIT_FAILURE;
+    }
+
+    key.mod_name = mod_name;
+    key.mod_name_len = mod_name_len ? mod_name_len : (int)strlen(mod_name);
+    key.name = name;
+    key.nam_len = nam_len ? nam_len : (int)strlen(name);
+
+    *ret = NULL;
+    if (lyht_find(idx->ht, &key, lys_child_index_hash(key.mod_name, key.mod_name_len, key.name, key.nam_len),
+                  (void **)&match)) {
+        return EXIT_SUCCESS;
+    }
+
+    if (!(getnext_opts & LYS_GETNEXT_NOSTATECHECK)) {
+        if (!parent && (mod->disabled || !mod->implemented)) {
+            return EXIT_SUCCESS;
+        }
+
+        /* check the nodes lys_getnext() would check on its way from the parent, it does not check the augments
+         * because the augmenting nodes are linked directly into the target children */
+        for (iter = *match; iter && (iter != parent);
+                iter = (iter->nodetype == LYS_AUGMENT) ? ((struct lys_node_augment *)iter)->target : iter->parent) {
+            if ((iter->nodetype != LYS_AUGMENT) && lys_is_disabled(iter, 0)) {
+                return EXIT_SUCCESS;
+            }
+        }
+    }
+
+    *ret = *match;
+    return EXIT_SUCCESS;
+#else
+    (void)mod;
+    (void)parent;
+    (void)mod_name;
+    (void)mod_name_len;
+    (void)name;
+    (void)nam_len;
+    (void)getnext_opts;
+    (void)ret;
+    return EXIT_FAILURE;
+#endif
+}
+
 int
 lys_getnext_data(const struct lys_module *mod, const struct lys_node *parent, const char *name, int nam_len,
                  LYS_NODE type, int getnext_opts, const struct lys_node **ret)
@@ -236,6 +485,16 @@ lys_getnext_data(const struct lys_module *mod, const struct lys_node *parent, co
         mod = lys_node_module(parent);
     }
 
+    if (!lys_child_index_find(mod, parent, lys_main_module(mod)->name, 0, name, nam_len, getnext_opts, &node)) {
+        if (!node || (type && !(node->nodetype & type))) {
+            return EXIT_FAILURE;
+        }
+        if (ret) {
+            *ret = node;
+        }
+        return EXIT_SUCCESS;
+    }
+
     /* try to find the node */
     node = NULL;
     while ((node = lys_getnext(node, parent, mod, getnext_opts))) {
@@ -428,6 +687,8 @@ lys_node_unlink(struct lys_node *node)
 
     /* unlink from data model if necessary */
     if (node->module) {
+        lys_schema_changed(node->module->ctx);
+
         /* get main module with data tree */
         main_module = lys_node_module(node);
         if (main_module->data == node) {
@@ -782,6 +1043,8 @@ lys_node_addchild(struct lys_node *parent, struct lys_module *module, struct lys
 
     assert(child);
 
+    lys_schema_changed(ctx);
+
     if (parent) {
         type = parent->nodetype;
         module = parent->module;
@@ -1376,9 +1639,8 @@ lys_search_localfile(const char * const *searchpaths, int cwd, const char *name,
         free(wd);
         free(wn); wn = NULL;
 
-        dirs->number--;
-        wd = (char *)dirs->set.g[dirs->number];
-        dirs->set.g[dirs->number] = NULL;
+        wd = (char *)dirs->set.g[dirs->number - 1];
+        ly_set_rm_index(dirs, dirs->number - 1);
         LOGVRB("Searching for \"%s\" in %s.", name, wd);
 
         if (dir) {
@@ -2345,6 +2607,9 @@ lys_type_free(struct ly_ctx *ctx, struct lys_type *type,
 
     case LY_TYPE_LEAFREF:
         lydict_remove(ctx, type->info.lref.path);
+#ifdef LY_ENABLED_CACHE
+        lyxp_expr_free(type->info.lref.path_compiled);
+#endif
         break;
 
     case LY_TYPE_STRING:
@@ -2435,6 +2700,9 @@ lys_when_free(struct ly_ctx *ctx, struct lys_when *w,
     lydict_remove(ctx, w->cond);
     lydict_remove(ctx, w->dsc);
     lydict_remove(ctx, w->ref);
+#ifdef LY_ENABLED_CACHE
+    lyxp_expr_free(w->cond_compiled);
+#endif
 
     free(w);
 }
@@ -2820,6 +3088,12 @@ lys_node_free(struct lys_node *node, void (*private_destructor)(const struct lys
 
     lys_extension_instances_free(ctx, node->ext, node->ext_size, private_destructor);
 
+#ifdef LY_ENABLED_CACHE
+    if (node->nodetype & (LYS_CONTAINER | LYS_LIST | LYS_NOTIF | LYS_INPUT | LYS_OUTPUT)) {
+        lys_child_index_free(*lys_child_index_ptr(node, NULL));
+    }
+#endif
+
     /* specific part */
     switch (node->nodetype) {
     case LYS_CONTAINER:
@@ -2931,6 +3205,9 @@ module_free_common(struct lys_module *module, void (*private_destructor)(const s
         LY_TREE_FOR_SAFE(module->data, next, iter) {
             lys_node_free(iter, private_destructor, 0);
         }
+#ifdef LY_ENABLED_CACHE
+        lys_child_index_free(module->data_idx);
+#endif
     }
 
     lydict_remove(ctx, module->dsc);
@@ -3825,8 +4102,9 @@ lys_free(struct lys_module *module, void (*private_destructor)(const struct lys_
             if (ctx->models.list[i] == module) {
                 /* move all the models to not change the order in the list */
                 ctx->models.used--;
-                memmove(&ctx->models.list[i], ctx->models.list[i + 1], (ctx->models.used - i) * sizeof *ctx->models.list);
+                memmove(&ctx->models.list[i], &ctx->models.list[i + 1], (ctx->models.used - i) * sizeof *ctx->models.list);
                 ctx->models.list[ctx->models.used] = NULL;
+                ly_ctx_module_index_update(ctx, NULL);
                 /* we are done */
                 break;
             }
@@ -4483,6 +4761,7 @@ apply_aug(struct lys_node_augment *augment, struct unres_schema *unres)
     }
 
     /* reconnect augmenting data into the target - add them to the target child list */
+    lys_schema_changed(augment->module->ctx);
     if (augment->target->child) {
         child = augment->target->child->prev;
         child->next = augment->child;
@@ -4510,6 +4789,8 @@ remove_aug(struct lys_node_augment *augment)
 
     elem = augment->child;
     if (elem) {
+        lys_schema_changed(augment->module->ctx);
+
         LY_TREE_FOR(elem, last) {
             if (!last->next || (last->next->parent != (struct lys_node *)augment)) {
                 break;
@@ -4560,6 +4841,8 @@ lys_switch_deviation(struct lys_deviation *dev, const struct lys_module *module,
         return;
     }
 
+    lys_schema_changed(module->ctx);
+
     if (dev->deviate[0].mod == LY_DEVIATE_NO) {
         if (dev->orig_node) {
             /* removing not-supported deviation ... */
@@ -5063,6 +5346,7 @@ lys_set_implemented(const struct lys_module *module)
     }
     /* recursively make the module implemented */
     ((struct lys_module *)module)->implemented = 1;
+    lys_schema_changed(module->ctx);
     if (lys_make_implemented_r((struct lys_module *)module, unres)) {
         goto error;
     }
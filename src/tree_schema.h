@@ -725,6 +725,11 @@ struct lys_module {
     /* specific module's items in comparison to submodules */
     struct lys_node *data;           /**< first data statement, includes also RPCs and Notifications */
     const char *ns;                  /**< namespace of the module (mandatory) */
+
+#ifdef LY_ENABLED_CACHE
+    void *data_idx;                  /**< index of the top-level data nodes for their fast lookup by name, created on
+                                          the first use. For internal use only. */
+#endif
 };
 
 /**
@@ -927,6 +932,10 @@ struct lys_type_info_lref {
                                   - -1 = false,
                                   - 0 not defined (true),
                                   - 1 = true */
+#ifdef LY_ENABLED_CACHE
+    void *path_compiled;     /**< compiled XPath expression of the path to optimize its evaluation, created on the first
+                                  use. For internal use only. */
+#endif
 };
 
 /**
@@ -1248,6 +1257,7 @@ struct lys_node {
 
 #ifdef LY_ENABLED_CACHE
     uint8_t hash[LYS_NODE_HASH_COUNT]; /**< schema hash required for LYB printer/parser */
+    uint32_t hash_seed;              /**< module and node name hash, data node hashes continue from it */
 #endif
 };
 
@@ -1290,6 +1300,9 @@ struct lys_node_container {
 
 #ifdef LY_ENABLED_CACHE
     uint8_t hash[LYS_NODE_HASH_COUNT]; /**< schema hash required for LYB printer/parser */
+    uint32_t hash_seed;              /**< module and node name hash, data node hashes continue from it */
+    void *child_idx;                 /**< index of the data children for their fast lookup by name, created on the
+                                          first use. For internal use only. */
 #endif
 
     /* specific container's data */
@@ -1381,6 +1394,7 @@ struct lys_node_leaf {
 
 #ifdef LY_ENABLED_CACHE
     uint8_t hash[LYS_NODE_HASH_COUNT]; /**< schema hash required for LYB printer/parser */
+    uint32_t hash_seed;              /**< module and node name hash, data node hashes continue from it */
 #endif
 
     /* specific leaf's data */
@@ -1435,6 +1449,7 @@ struct lys_node_leaflist {
 
 #ifdef LY_ENABLED_CACHE
     uint8_t hash[LYS_NODE_HASH_COUNT]; /**< schema hash required for LYB printer/parser */
+    uint32_t hash_seed;              /**< module and node name hash, data node hashes continue from it */
 #endif
 
     /* specific leaf-list's data */
@@ -1490,6 +1505,9 @@ struct lys_node_list {
 
 #ifdef LY_ENABLED_CACHE
     uint8_t hash[LYS_NODE_HASH_COUNT]; /**< schema hash required for LYB printer/parser */
+    uint32_t hash_seed;              /**< module and node name hash, data node hashes continue from it */
+    void *child_idx;                 /**< index of the data children for their fast lookup by name, created on the
+                                          first use. For internal use only. */
 #endif
 
     /* specific list's data */
@@ -1547,6 +1565,7 @@ struct lys_node_anydata {
 
 #ifdef LY_ENABLED_CACHE
     uint8_t hash[LYS_NODE_HASH_COUNT]; /**< schema hash required for LYB printer/parser */
+    uint32_t hash_seed;              /**< module and node name hash, data node hashes continue from it */
 #endif
 
     /* specific anyxml's data */
@@ -1727,6 +1746,11 @@ struct lys_node_inout {
     /* specific inout's data */
     struct lys_tpdf *tpdf;           /**< array of typedefs */
     struct lys_restr *must;          /**< array of must constraints */
+
+#ifdef LY_ENABLED_CACHE
+    void *child_idx;                 /**< index of the data children for their fast lookup by name, created on the
+                                          first use. For internal use only. */
+#endif
 };
 
 /**
@@ -1765,6 +1789,9 @@ struct lys_node_notif {
 
 #ifdef LY_ENABLED_CACHE
     uint8_t hash[LYS_NODE_HASH_COUNT]; /**< schema hash required for LYB printer/parser */
+    uint32_t hash_seed;              /**< module and node name hash, data node hashes continue from it */
+    void *child_idx;                 /**< index of the data children for their fast lookup by name, created on the
+                                          first use. For internal use only. */
 #endif
 
     /* specific rpc's data */
@@ -1811,6 +1838,7 @@ struct lys_node_rpc_action {
 
 #ifdef LY_ENABLED_CACHE
     uint8_t hash[LYS_NODE_HASH_COUNT]; /**< schema hash required for LYB printer/parser */
+    uint32_t hash_seed;              /**< module and node name hash, data node hashes continue from it */
 #endif
 
     /* specific rpc's data */
@@ -2080,6 +2108,10 @@ struct lys_when {
     struct lys_ext_instance **ext;   /**< array of pointers to the extension instances */
     uint8_t ext_size;                /**< number of elements in #ext array */
     uint16_t flags;                  /**< only flags #LYS_XPCONF_DEP and #LYS_XPSTATE_DEP can be specified */
+#ifdef LY_ENABLED_CACHE
+    void *cond_compiled;             /**< compiled XPath expression of the condition to optimize its evaluation,
+                                          created on the first use. For internal use only. */
+#endif
 };
 
 /**
@@ -249,7 +249,6 @@ lyv_data_unique(struct lyd_node *list)
     uint32_t hash, u, usize = 0;
     struct hash_table **uniqtables = NULL;
     const char *id;
-    char *path;
     struct lys_node_list *slist;
     struct ly_ctx *ctx = list->schema->module->ctx;
 
@@ -260,19 +259,23 @@ lyv_data_unique(struct lyd_node *list)
 
     slist = (struct lys_node_list *)list->schema;
 
-    /* get all list instances */
-    if (ly_vlog_build_path(LY_VLOG_LYD, list, &path, 0, 1)) {
-        return -1;
-    }
-    set = lyd_find_path(list, path);
-    free(path);
+    /* get all list instances, they are all siblings of this one */
+    set = ly_set_new();
     if (!set) {
+        LOGMEM(ctx);
         return -1;
     }
+    LY_TREE_FOR(lyd_first_sibling(list), diter) {
+        if (diter->schema != list->schema) {
+            continue;
+        }
+        if (ly_set_add(set, diter, LY_SET_OPT_USEASLIST) == -1) {
+            ly_set_free(set);
+            return -1;
+        }
 
-    for (i = 0; i < set->number; ++i) {
         /* remove the flag */
-        set->set.d[i]->validity &= ~LYD_VAL_UNIQUE;
+        diter->validity &= ~LYD_VAL_UNIQUE;
     }
 
     if (set->number == 2) {
@@ -452,6 +455,27 @@ lyv_data_dup(struct lyd_node *node, struct lyd_node *start)
     struct hash_table *keystable = NULL;
     const char *id;
     struct ly_ctx *ctx = node->schema->module->ctx;
+#ifdef LY_ENABLED_CACHE
+    struct hash_table *sibs_ht;
+    struct lyd_node *match, **match_p;
+    int r;
+
+    if (!node->parent && node->hash && (sibs_ht = lyd_root_ht(node))) {
+        /* top-level siblings are indexed, it is enough to look for the instances equal to this one,
+         * the flag is kept on a duplicate so that it is checked again by the next validation */
+        for (r = lyht_find(sibs_ht, &node, node->hash, (void **)&match_p);
+                !r;
+                r = lyht_find_next(sibs_ht, &match, node->hash, (void **)&match_p)) {
+            match = *match_p;
+            if ((match != node) && (match->schema == node->schema) && lyv_list_equal(&match, &node, 0, NULL)) {
+                /* instance duplication */
+                return 1;
+            }
+        }
+        node->validity &= ~LYD_VAL_DUP;
+        return 0;
+    }
+#endif
 
     /* get the first list/leaflist instance sibling */
     if (!start) {
@@ -686,6 +710,11 @@ lyv_data_content(struct lyd_node *node, int options, struct unres_data *unres)
     struct lys_iffeature *iff;
     const char *id, *idname;
     struct ly_ctx *ctx;
+#ifdef LY_ENABLED_CACHE
+    struct hash_table *sibs_ht;
+    struct lyd_node **diter_p;
+    int r;
+#endif
 
     assert(node);
     assert(node->schema);
@@ -719,14 +748,32 @@ lyv_data_content(struct lyd_node *node, int options, struct unres_data *unres)
                 /* check number of instances (similar to list uniqueness) for non-list nodes */
 
                 /* find duplicity */
-                start = lyd_first_sibling(node);
-                for (diter = start; diter; diter = diter->next) {
-                    if (diter->schema == schema && diter != node) {
-                        parent = lys_parent(schema);
-                        LOGVAL(ctx, LYE_TOOMANY, LY_VLOG_LYD, node, schema->name,
-                               parent ? (parent->nodetype == LYS_EXT) ? ((struct lys_ext_instance *)parent)->arg_value : parent->name : "data tree");
-                        return 1;
+#ifdef LY_ENABLED_CACHE
+                /* not creating the index of top-level siblings, they may still be being parsed */
+                if (node->root_idx && node->hash && (sibs_ht = lyd_root_ht(node))) {
+                    /* all the instances of the schema node have the same hash in the index of top-level siblings */
+                    for (r = lyht_find(sibs_ht, &node, node->hash, (void **)&diter_p);
+                            !r;
+                            r = lyht_find_next(sibs_ht, &diter, node->hash, (void **)&diter_p)) {
+                        diter = *diter_p;
+                        if ((diter->schema == schema) && (diter != node)) {
+                            break;
+                        }
+                    }
+                    if (r) {
+                        diter = NULL;
                     }
+                } else
+#endif
+                {
+                    start = lyd_first_sibling(node);
+                    for (diter = start; diter && ((diter->schema != schema) || (diter == node)); diter = diter->next);
+                }
+                if (diter) {
+                    parent = lys_parent(schema);
+                    LOGVAL(ctx, LYE_TOOMANY, LY_VLOG_LYD, node, schema->name,
+                           parent ? (parent->nodetype == LYS_EXT) ? ((struct lys_ext_instance *)parent)->arg_value : parent->name : "data tree");
+                    return 1;
                 }
             }
 
@@ -579,98 +579,111 @@ lyxml_getutf8(struct ly_ctx *ctx, const char *buf, unsigned int *read)
 static int
 parse_ignore(struct ly_ctx *ctx, const char *data, const char *endstr, unsigned int *len)
 {
-    unsigned int slen;
-    const char *c = data;
-
-    slen = strlen(endstr);
+    const char *c;
 
-    while (*c && strncmp(c, endstr, slen)) {
-        c++;
-    }
-    if (!*c) {
+    c = strstr(data, endstr);
+    if (!c) {
         LOGVAL(ctx, LYE_XML_MISS, LY_VLOG_NONE, NULL, "closing sequence", endstr);
         return EXIT_FAILURE;
     }
-    c += slen;
+    c += strlen(endstr);
 
     *len = c - data;
     return EXIT_SUCCESS;
 }
 
+/* makes room for at least need bytes in the parse_text() result buffer, logs directly */
+static int
+parse_text_reserve(struct ly_ctx *ctx, char **buf, size_t *size, size_t need)
+{
+    size_t new_size;
+
+    if (need <= *size) {
+        return EXIT_SUCCESS;
+    }
+
+    /* the first run is often the whole text, so allocate it exactly and grow geometrically only later */
+    for (new_size = *size ? *size * 2 : need; new_size < need; new_size *= 2);
+    *buf = ly_realloc(*buf, new_size);
+    LY_CHECK_ERR_RETURN(!*buf, LOGMEM(ctx), EXIT_FAILURE);
+    *size = new_size;
+    return EXIT_SUCCESS;
+}
+
 /* logs directly, fails when return == NULL and *len == 0 */
 static char *
 parse_text(struct ly_ctx *ctx, const char *data, char delim, unsigned int *len)
 {
-#define BUFSIZE 1024
-
-    char buf[BUFSIZE];
     char *result = NULL, *aux;
+    const char *cdend;
     unsigned int r;
-    int o, size = 0;
-    int cdsect = 0;
+    size_t o = 0, size = 0, plain;
+    const char stop[] = {'<', '&', ']', delim, '\0'};
     int32_t n;
 
-    for (*len = o = 0; cdsect || data[*len] != delim; o++) {
-        if (!data[*len] || (!cdsect && !strncmp(&data[*len], "]]>", 3))) {
+    /* beginning of a CDSect does not end the text even if the delimiter is '<' */
+    for (*len = 0; data[*len] != delim || !strncmp(&data[*len], "<![CDATA[", 9); ) {
+        if (!data[*len] || !strncmp(&data[*len], "]]>", 3)) {
             LOGVAL(ctx, LYE_XML_INVAL, LY_VLOG_NONE, NULL, "element content, \"]]>\" found");
             goto error;
         }
 
-loop:
-
-        if (o > BUFSIZE - 4) {
-            /* add buffer into the result */
-            if (result) {
-                size = size + o;
-                result = ly_realloc(result, size + 1);
-            } else {
-                size = o;
-                result = malloc((size + 1) * sizeof *result);
+        /* copy the whole run of plain text at once, the rest is processed character by character */
+        plain = ly_strplain_len(&data[*len], stop, 1);
+        if (plain) {
+            if (parse_text_reserve(ctx, &result, &size, o + plain + 1)) {
+                goto error;
             }
-            LY_CHECK_ERR_RETURN(!result, LOGMEM(ctx), NULL);
-            memcpy(&result[size - o], buf, o);
+            memcpy(&result[o], &data[*len], plain);
+            o += plain;
+            *len += plain;
+            continue;
+        }
 
-            /* write again into the beginning of the buffer */
-            o = 0;
+        /* any character or reference is written as at most 4 bytes */
+        if (parse_text_reserve(ctx, &result, &size, o + 4 + 1)) {
+            goto error;
         }
 
-        if (cdsect || !strncmp(&data[*len], "<![CDATA[", 9)) {
-            /* CDSect */
-            if (!cdsect) {
-                cdsect = 1;
-                *len += 9;
+        if (!strncmp(&data[*len], "<![CDATA[", 9)) {
+            /* CDSect, copied as it is */
+            *len += 9;
+            cdend = strstr(&data[*len], "]]>");
+            if (!cdend) {
+                LOGVAL(ctx, LYE_XML_INVAL, LY_VLOG_NONE, NULL, "element content, \"]]>\" found");
+                goto error;
             }
-            if (data[*len] && !strncmp(&data[*len], "]]>", 3)) {
-                *len += 3;
-                cdsect = 0;
-                o--;            /* we don't write any data in this iteration */
-            } else {
-                buf[o] = data[*len];
-                (*len)++;
+            r = cdend - &data[*len];
+            if (parse_text_reserve(ctx, &result, &size, o + r + 1)) {
+                goto error;
             }
+            memcpy(&result[o], &data[*len], r);
+            o += r;
+            *len += r + 3;
         } else if (data[*len] == '&') {
             (*len)++;
             if (data[*len] != '#') {
                 /* entity reference - only predefined refs are supported */
                 if (!strncmp(&data[*len], "lt;", 3)) {
-                    buf[o] = '<';
+                    result[o] = '<';
                     *len += 3;
                 } else if (!strncmp(&data[*len], "gt;", 3)) {
-                    buf[o] = '>';
+                    result[o] = '>';
                     *len += 3;
                 } else if (!strncmp(&data[*len], "amp;", 4)) {
-                    buf[o] = '&';
+                    result[o] = '&';
                     *len += 4;
                 } else if (!strncmp(&data[*len], "apos;", 5)) {
-                    buf[o] = '\'';
+                    result[o] = '\'';
                     *len += 5;
                 } else if (!strncmp(&data[*len], "quot;", 5)) {
-                    buf[o] = '\"';
+                    result[o] = '\"';
                     *len += 5;
                 } else {
                     LOGVAL(ctx, LYE_XML_INVAL, LY_VLOG_NONE, NULL, "entity reference (only predefined references are supported)");
                     goto error;
                 }
+                o++;
             } else {
                 /* character reference */
                 (*len)++;
@@ -698,47 +711,35 @@ loop:
                     goto error;
 
                 }
-                r = pututf8(ctx, &buf[o], n);
+                r = pututf8(ctx, &result[o], n);
                 if (!r) {
                     LOGVAL(ctx, LYE_XML_INVAL, LY_VLOG_NONE, NULL, "character reference value");
                     goto error;
                 }
-                o += r - 1;     /* o is ++ in for loop */
+                o += r;
                 (*len)++;
             }
         } else {
-            r = copyutf8(ctx, &buf[o], &data[*len]);
+            r = copyutf8(ctx, &result[o], &data[*len]);
             if (!r) {
                 goto error;
             }
 
-            o += r - 1;     /* o is ++ in for loop */
+            o += r;
             (*len) = (*len) + r;
         }
     }
 
-    if (delim == '<' && !strncmp(&data[*len], "<![CDATA[", 9)) {
-        /* ignore loop's end condition on beginning of CDSect */
-        goto loop;
-    }
-#undef BUFSIZE
-
-    if (o) {
-        if (result) {
-            size = size + o;
-            aux = realloc(result, size + 1);
-            result = aux;
-        } else {
-            size = o;
-            result = malloc((size + 1) * sizeof *result);
-        }
-        LY_CHECK_ERR_RETURN(!result, LOGMEM(ctx), NULL);
-        memcpy(&result[size - o], buf, o);
-    }
     if (result) {
-        result[size] = '\0';
+        result[o] = '\0';
+        if (o + 1 < size) {
+            /* the result is usually stored in the dictionary, do not keep the spare space */
+            aux = realloc(result, o + 1);
+            if (aux) {
+                result = aux;
+            }
+        }
     } else {
-        size = 0;
         result = strdup("");
         LY_CHECK_ERR_RETURN(!result, LOGMEM(ctx), NULL)
     }
@@ -868,25 +869,28 @@ error:
     return NULL;
 }
 
-/* logs directly */
-struct lyxml_elem *
-lyxml_parse_elem(struct ly_ctx *ctx, const char *data, unsigned int *len, struct lyxml_elem *parent, int options)
+/* logs directly, elements processed by hooks are freed and NULL is returned in result */
+static int
+lyxml_parse_elem(struct ly_ctx *ctx, const char *data, unsigned int *len, struct lyxml_elem *parent, int options,
+                 struct lyxml_hooks *hooks, struct lyxml_elem **result)
 {
     const char *c = data, *start, *e;
     const char *lws;    /* leading white space for handling mixed content */
-    int uc;
+    int uc, r;
     char *str;
     char *prefix = NULL;
     unsigned int prefix_len = 0;
     struct lyxml_elem *elem = NULL, *child;
     struct lyxml_attr *attr;
+    struct lyxml_hooks *child_hooks;
     unsigned int size;
-    int nons_flag = 0, closed_flag = 0;
+    int nons_flag = 0, closed_flag = 0, child_flag = 0;
 
     *len = 0;
+    *result = NULL;
 
     if (*c != '<') {
-        return NULL;
+        return -1;
     }
 
     /* locate element name */
@@ -896,7 +900,7 @@ lyxml_parse_elem(struct ly_ctx *ctx, const char *data, unsigned int *len, struct
     uc = lyxml_getutf8(ctx, e, &size);
     if (!is_xmlnamestartchar(uc)) {
         LOGVAL(ctx, LYE_XML_INVAL, LY_VLOG_NONE, NULL, "NameStartChar of the element");
-        return NULL;
+        return -1;
     }
     e += size;
     uc = lyxml_getutf8(ctx, e, &size);
@@ -924,12 +928,12 @@ lyxml_parse_elem(struct ly_ctx *ctx, const char *data, unsigned int *len, struct
     if (!*e) {
         LOGVAL(ctx, LYE_EOF, LY_VLOG_NONE, NULL);
         free(prefix);
-        return NULL;
+        return -1;
     }
 
     /* allocate element structure */
     elem = calloc(1, sizeof *elem);
-    LY_CHECK_ERR_RETURN(!elem, free(prefix); LOGMEM(ctx), NULL);
+    LY_CHECK_ERR_RETURN(!elem, free(prefix); LOGMEM(ctx), -1);
 
     elem->next = NULL;
     elem->prev = elem;
@@ -943,19 +947,63 @@ lyxml_parse_elem(struct ly_ctx *ctx, const char *data, unsigned int *len, struct
 
 process:
     ign_xmlws(c);
+    if (strncmp("/>", c, 2) && (*c != '>')) {
+        /* process attribute */
+        attr = parse_attr(ctx, c, &size, elem);
+        if (!attr) {
+            goto error;
+        }
+        c += size;              /* move after processed attribute */
+
+        /* check namespace */
+        if (attr->type == LYXML_ATTR_NS) {
+            if ((!prefix || !prefix[0]) && !attr->name) {
+                if (attr->value) {
+                    /* default prefix */
+                    elem->ns = (struct lyxml_ns *)attr;
+                } else {
+                    /* xmlns="" -> no namespace */
+                    nons_flag = 1;
+                }
+            } else if (prefix && prefix[0] && attr->name && !strncmp(attr->name, prefix, prefix_len + 1)) {
+                /* matching namespace with prefix */
+                elem->ns = (struct lyxml_ns *)attr;
+            }
+        }
+
+        /* go back to finish element processing */
+        goto process;
+    }
+
+    /* start tag processed, the namespace is known now */
+    if (!elem->ns && !nons_flag && parent) {
+        elem->ns = lyxml_get_ns(parent, prefix_len ? prefix : NULL);
+    }
+
+    child_hooks = hooks;
+    if (hooks && hooks->elem_start) {
+        r = hooks->elem_start(elem, hooks->arg);
+        if (r == -1) {
+            goto error;
+        } else if (r == 1) {
+            /* the subtree is parsed as usual */
+            child_hooks = NULL;
+        }
+    }
+
     if (!strncmp("/>", c, 2)) {
         /* we are done, it was EmptyElemTag */
         c += 2;
         elem->content = lydict_insert(ctx, "", 0);
         closed_flag = 1;
-    } else if (*c == '>') {
+    } else {
         /* process element content */
         c++;
         lws = NULL;
 
         while (*c) {
             if (!strncmp(c, "</", 2)) {
-                if (lws && !elem->child) {
+                if (lws && !elem->child && !child_flag) {
                     /* leading white spaces were actually content */
                     goto store_content;
                 }
@@ -1068,10 +1116,10 @@ process:
                     lyxml_add_child(ctx, elem, child);
                     elem->flags |= LYXML_ELEM_MIXED;
                 }
-                child = lyxml_parse_elem(ctx, c, &size, elem, options);
-                if (!child) {
+                if (lyxml_parse_elem(ctx, c, &size, elem, options, child_hooks, &child)) {
                     goto error;
                 }
+                child_flag = 1;
                 c += size;      /* move after processed child element */
             } else if (is_xmlws(*c)) {
                 lws = c;
@@ -1091,7 +1139,7 @@ store_content:
                 elem->content = lydict_insert_zc(ctx, str);
                 c += size;      /* move after processed text content */
 
-                if (elem->child) {
+                if (elem->child || child_flag) {
                     /* we have a mixed content */
                     if (options & LYXML_PARSE_NOMIXEDCONTENT) {
                         LOGVAL(ctx, LYE_XML_INVAL, LY_VLOG_XML, elem, "XML element with mixed content");
@@ -1106,32 +1154,6 @@ store_content:
                 }
             }
         }
-    } else {
-        /* process attribute */
-        attr = parse_attr(ctx, c, &size, elem);
-        if (!attr) {
-            goto error;
-        }
-        c += size;              /* move after processed attribute */
-
-        /* check namespace */
-        if (attr->type == LYXML_ATTR_NS) {
-            if ((!prefix || !prefix[0]) && !attr->name) {
-                if (attr->value) {
-                    /* default prefix */
-                    elem->ns = (struct lyxml_ns *)attr;
-                } else {
-                    /* xmlns="" -> no namespace */
-                    nons_flag = 1;
-                }
-            } else if (prefix && prefix[0] && attr->name && !strncmp(attr->name, prefix, prefix_len + 1)) {
-                /* matching namespace with prefix */
-                elem->ns = (struct lyxml_ns *)attr;
-            }
-        }
-
-        /* go back to finish element processing */
-        goto process;
     }
 
     *len = c - data;
@@ -1141,39 +1163,41 @@ store_content:
         goto error;
     }
 
-    if (!elem->ns && !nons_flag && parent) {
-        elem->ns = lyxml_get_ns(parent, prefix_len ? prefix : NULL);
+    if (hooks && hooks->elem_end) {
+        if (hooks->elem_end(elem, hooks->arg)) {
+            goto error;
+        }
+        lyxml_free(ctx, elem);
+        elem = NULL;
     }
+
     free(prefix);
-    return elem;
+    *result = elem;
+    return 0;
 
 error:
     lyxml_free(ctx, elem);
     free(prefix);
-    return NULL;
+    return -1;
 }
 
 /* logs directly */
-API struct lyxml_elem *
-lyxml_parse_mem(struct ly_ctx *ctx, const char *data, int options)
+static int
+lyxml_parse_mem_(struct ly_ctx *ctx, const char *data, int options, struct lyxml_hooks *hooks, struct lyxml_elem **result)
 {
-    FUN_IN;
-
     const char *c = data;
     unsigned int len;
     struct lyxml_elem *root, *first = NULL, *next;
 
-    if (!ctx) {
-        LOGARG;
-        return NULL;
-    }
+    *result = NULL;
 
 repeat:
     /* process document */
     while (1) {
         if (!*c) {
             /* eof */
-            return first;
+            *result = first;
+            return 0;
         } else if (is_xmlws(*c)) {
             /* skip whitespaces */
             ign_xmlws(c);
@@ -1207,9 +1231,10 @@ repeat:
         }
     }
 
-    root = lyxml_parse_elem(ctx, c, &len, NULL, options);
-    if (!root) {
+    if (lyxml_parse_elem(ctx, c, &len, NULL, options, hooks, &root)) {
         goto error;
+    } else if (!root) {
+        /* processed by the hooks */
     } else if (!first) {
         first = root;
     } else {
@@ -1231,13 +1256,54 @@ repeat:
         }
     }
 
-    return first;
+    *result = first;
+    return 0;
 
 error:
     LY_TREE_FOR_SAFE(first, next, root) {
         lyxml_free(ctx, root);
     }
-    return NULL;
+    return -1;
+}
+
+API struct lyxml_elem *
+lyxml_parse_mem(struct ly_ctx *ctx, const char *data, int options)
+{
+    FUN_IN;
+
+    struct lyxml_elem *first;
+
+    if (!ctx) {
+        LOGARG;
+        return NULL;
+    }
+
+    if (lyxml_parse_mem_(ctx, data, options, NULL, &first)) {
+        return NULL;
+    }
+    return first;
+}
+
+int
+lyxml_parse_mem_hooks(struct ly_ctx *ctx, const char *data, int options, struct lyxml_hooks *hooks)
+{
+    struct lyxml_elem *first;
+    const char *empty;
+    int ret = 0;
+
+    /* elements are freed right after being processed so hold the empty content that most of the inner
+     * elements share, otherwise it would be removed from and inserted into the dictionary over and over */
+    empty = lydict_insert(ctx, "", 0);
+
+    if (lyxml_parse_mem_(ctx, data, options, hooks, &first)) {
+        ret = -1;
+    } else {
+        /* only possible if the hooks skipped some roots */
+        lyxml_free_withsiblings(ctx, first);
+    }
+
+    lydict_remove(ctx, empty);
+    return ret;
 }
 
 API struct lyxml_elem *
@@ -1454,6 +1520,7 @@ lyxml_print_file(FILE *stream, const struct lyxml_elem *elem, int options)
     FUN_IN;
 
     struct lyout out;
+    int r;
 
     if (!stream || !elem) {
         return 0;
@@ -1465,10 +1532,16 @@ lyxml_print_file(FILE *stream, const struct lyxml_elem *elem, int options)
     out.method.f = stream;
 
     if (options & LYXML_PRINT_SIBLINGS) {
-        return dump_siblings(&out, elem, options);
+        r = dump_siblings(&out, elem, options);
     } else {
-        return dump_elem(&out, elem, 0, options, 1);
+        r = dump_elem(&out, elem, 0, options, 1);
     }
+
+    if (ly_print_flush(&out)) {
+        /* buffered data could not be written */
+        return -1;
+    }
+    return r;
 }
 
 API int
@@ -1477,6 +1550,7 @@ lyxml_print_fd(int fd, const struct lyxml_elem *elem, int options)
     FUN_IN;
 
     struct lyout out;
+    int r;
 
     if (fd < 0 || !elem) {
         return 0;
@@ -1488,10 +1562,16 @@ lyxml_print_fd(int fd, const struct lyxml_elem *elem, int options)
     out.method.fd = fd;
 
     if (options & LYXML_PRINT_SIBLINGS) {
-        return dump_siblings(&out, elem, options);
+        r = dump_siblings(&out, elem, options);
     } else {
-        return dump_elem(&out, elem, 0, options, 1);
+        r = dump_elem(&out, elem, 0, options, 1);
+    }
+
+    if (ly_print_flush(&out)) {
+        /* buffered data could not be written */
+        return -1;
     }
+    return r;
 }
 
 API int
@@ -1526,6 +1606,7 @@ lyxml_print_clb(ssize_t (*writeclb)(void *arg, const void *buf, size_t count), v
     FUN_IN;
 
     struct lyout out;
+    int r;
 
     if (!writeclb || !elem) {
         return 0;
@@ -1538,8 +1619,14 @@ lyxml_print_clb(ssize_t (*writeclb)(void *arg, const void *buf, size_t count), v
     out.method.clb.arg = arg;
 
     if (options & LYXML_PRINT_SIBLINGS) {
-        return dump_siblings(&out, elem, options);
+        r = dump_siblings(&out, elem, options);
     } else {
-        return dump_elem(&out, elem, 0, options, 1);
+        r = dump_elem(&out, elem, 0, options, 1);
     }
+
+    if (ly_print_flush(&out)) {
+        /* buffered data could not be written */
+        return -1;
+    }
+    return r;
 }
@@ -108,6 +108,39 @@ void lyxml_unlink_attr(struct lyxml_attr *attr);
  */
 void lyxml_unlink_elem(struct ly_ctx *ctx, struct lyxml_elem *elem, int copy_ns);
 
+/**
+ * @brief Callbacks of the streaming XML parser lyxml_parse_mem_hooks().
+ */
+struct lyxml_hooks {
+    /**
+     * @brief Called once the start tag of an element is parsed, so its attributes and namespace are known, but not its content.
+     * @return 0 to continue, 1 to parse the element subtree as usual (without calling the hooks), -1 on error.
+     */
+    int (*elem_start)(struct lyxml_elem *elem, void *arg);
+
+    /**
+     * @brief Called once the whole element is parsed, the element is freed afterwards. Its children processed by the hooks
+     * were already freed, the others are still present.
+     * @return 0 on success, -1 on error.
+     */
+    int (*elem_end)(struct lyxml_elem *elem, void *arg);
+
+    void *arg;                 /**< Argument passed to the callbacks */
+};
+
+/**
+ * @brief Parse XML document without building the whole tree, every element is passed to the hooks and
+ * freed right after it is processed. The parent elements (with their namespaces) stay available while
+ * processing their children.
+ *
+ * @param[in] ctx libyang context to use.
+ * @param[in] data XML document to parse.
+ * @param[in] options Parser options, see @ref xmlreadoptions.
+ * @param[in] hooks Element callbacks.
+ * @return 0 on success, -1 on error.
+ */
+int lyxml_parse_mem_hooks(struct ly_ctx *ctx, const char *data, int options, struct lyxml_hooks *hooks);
+
 /**
  * @brief Get the first UTF-8 character value (4bytes) from buffer
  * @param[in] ctx Context to store errors in.
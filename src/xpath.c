@@ -26,7 +26,6 @@
 #include <limits.h>
 #include <errno.h>
 #include <math.h>
-#include <pcre.h>
 
 #include "xpath.h"
 #include "libyang.h"
@@ -4534,9 +4533,8 @@ static int
 xpath_re_match(struct lyxp_set **args, uint16_t UNUSED(arg_count), struct lyd_node *cur_node, struct lys_module *local_mod,
                struct lyxp_set *set, int options)
 {
-    pcre *precomp;
     struct lys_node_leaf *sleaf;
-    int ret = EXIT_SUCCESS;
+    int ret = EXIT_SUCCESS, rc;
 
     if (options & LYXP_SNODE_ALL) {
         if ((args[0]->type == LYXP_SET_SNODE_SET) && (sleaf = (struct lys_node_leaf *)warn_get_snode_in_ctx(args[0]))) {
@@ -4569,15 +4567,11 @@ xpath_re_match(struct lyxp_set **args, uint16_t UNUSED(arg_count), struct lyd_no
         return -1;
     }
 
-    if (lyp_check_pattern(local_mod->ctx, args[1]->val.str, &precomp)) {
+    rc = lyp_regex_match(local_mod->ctx, args[1]->val.str, args[0]->val.str);
+    if (rc == -1) {
         return -1;
     }
-    if (pcre_exec(precomp, NULL, args[0]->val.str, strlen(args[0]->val.str), 0, 0, NULL, 0)) {
-        set_fill_boolean(set, 0);
-    } else {
-        set_fill_boolean(set, 1);
-    }
-    free(precomp);
+    set_fill_boolean(set, rc ? 0 : 1);
 
     return EXIT_SUCCESS;
 }
@@ -5348,18 +5342,7 @@ moveto_resolve_model(const char *mod_name_ns, uint16_t mod_nam_ns_len, struct ly
         }
     }
 
-    for (i = 0; i < ctx->models.used; ++i) {
-        if (!import_and_disabled_model && (!ctx->models.list[i]->implemented || ctx->models.list[i]->disabled)) {
-            /* skip not implemented or disabled modules */
-            continue;
-        }
-        str = (is_name ? ctx->models.list[i]->name : ctx->models.list[i]->ns);
-        if (!strncmp(str, mod_name_ns, mod_nam_ns_len) && !str[mod_nam_ns_len]) {
-            return ctx->models.list[i];
-        }
-    }
-
-    return NULL;
+    return ly_ctx_nget_module_first(ctx, mod_name_ns, mod_nam_ns_len, !is_name, import_and_disabled_model);
 }
 
 /**
@@ -8573,58 +8556,86 @@ eval_expr_select(struct lyxp_expr *exp, uint16_t *exp_idx, enum lyxp_expr_type e
     return ret;
 }
 
-int
-lyxp_eval(const char *expr, const struct lyd_node *cur_node, enum lyxp_node_type cur_node_type,
-          const struct lys_module *local_mod, struct lyxp_set *set, int options)
+struct lyxp_expr *
+lyxp_compile_expr(struct ly_ctx *ctx, const char *expr)
 {
-    struct ly_ctx *ctx;
     struct lyxp_expr *exp;
     uint16_t exp_idx = 0;
-    int rc = -1;
-
-    if (!expr || !local_mod || !set) {
-        LOGARG;
-        return EXIT_FAILURE;
-    }
-
-    ctx = local_mod->ctx;
 
     exp = lyxp_parse_expr(ctx, expr);
     if (!exp) {
-        rc = -1;
-        goto finish;
+        return NULL;
     }
 
-    rc = reparse_or_expr(ctx, exp, &exp_idx);
-    if (rc) {
-        goto finish;
+    if (reparse_or_expr(ctx, exp, &exp_idx)) {
+        goto error;
     } else if (exp->used > exp_idx) {
         LOGVAL(ctx, LYE_XPATH_INTOK, LY_VLOG_NONE, NULL, "Unknown", &exp->expr[exp->expr_pos[exp_idx]]);
         LOGVAL(ctx, LYE_SPEC, LY_VLOG_NONE, NULL, "Unparsed characters \"%s\" left at the end of an XPath expression.",
                &exp->expr[exp->expr_pos[exp_idx]]);
-        rc = -1;
-        goto finish;
+        goto error;
     }
 
     print_expr_struct_debug(exp);
 
-    exp_idx = 0;
+    return exp;
+
+error:
+    lyxp_expr_free(exp);
+    return NULL;
+}
+
+int
+lyxp_eval_compiled(const struct lyxp_expr *exp, const struct lyd_node *cur_node, enum lyxp_node_type cur_node_type,
+                   const struct lys_module *local_mod, struct lyxp_set *set, int options)
+{
+    uint16_t exp_idx = 0;
+    int rc;
+
+    if (!exp || !local_mod || !set) {
+        LOGARG;
+        return EXIT_FAILURE;
+    }
+
     memset(set, 0, sizeof *set);
     set->type = LYXP_SET_EMPTY;
     if (cur_node) {
         set_insert_node(set, (struct lyd_node *)cur_node, 0, cur_node_type, 0);
     }
 
-    rc = eval_expr_select(exp, &exp_idx, 0, (struct lyd_node *)cur_node, (struct lys_module *)local_mod, set, options);
+    /* the expression is only read during evaluation */
+    rc = eval_expr_select((struct lyxp_expr *)exp, &exp_idx, 0, (struct lyd_node *)cur_node,
+                          (struct lys_module *)local_mod, set, options);
     if (rc == 2) {
         rc = EXIT_SUCCESS;
     }
     if ((rc == -1) && cur_node) {
-        LOGPATH(ctx, LY_VLOG_LYD, cur_node);
+        LOGPATH(local_mod->ctx, LY_VLOG_LYD, cur_node);
         lyxp_set_cast(set, LYXP_SET_EMPTY, cur_node, local_mod, options);
     }
 
-finish:
+    return rc;
+}
+
+int
+lyxp_eval(const char *expr, const struct lyd_node *cur_node, enum lyxp_node_type cur_node_type,
+          const struct lys_module *local_mod, struct lyxp_set *set, int options)
+{
+    struct lyxp_expr *exp;
+    int rc;
+
+    if (!expr || !local_mod || !set) {
+        LOGARG;
+        return EXIT_FAILURE;
+    }
+
+    exp = lyxp_compile_expr(local_mod->ctx, expr);
+    if (!exp) {
+        return -1;
+    }
+
+    rc = lyxp_eval_compiled(exp, cur_node, cur_node_type, local_mod, set, options);
+
     lyxp_expr_free(exp);
     return rc;
 }
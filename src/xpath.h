@@ -256,6 +256,22 @@ struct lyxp_set {
 int lyxp_eval(const char *expr, const struct lyd_node *cur_node, enum lyxp_node_type cur_node_type,
               const struct lys_module *local_mod, struct lyxp_set *set, int options);
 
+/**
+ * @brief Evaluate an already compiled XPath expression \p exp on data. Works exactly like lyxp_eval(), but
+ * the expression is not parsed again so the same compiled expression can be evaluated repeatedly.
+ *
+ * @param[in] exp Compiled XPath expression (result of lyxp_compile_expr()). It is not modified.
+ * @param[in] cur_node Current (context) data node, see lyxp_eval().
+ * @param[in] cur_node_type Current (context) data node type, see lyxp_eval().
+ * @param[in] local_mod Local module relative to the \p exp.
+ * @param[out] set Result set, see lyxp_eval().
+ * @param[in] options Whether to apply some evaluation restrictions, see lyxp_eval().
+ *
+ * @return EXIT_SUCCESS on success, EXIT_FAILURE on unresolved when dependency, -1 on error.
+ */
+int lyxp_eval_compiled(const struct lyxp_expr *exp, const struct lyd_node *cur_node, enum lyxp_node_type cur_node_type,
+                       const struct lys_module *local_mod, struct lyxp_set *set, int options);
+
 /**
  * @brief Get all the partial XPath nodes (atoms) that are required for \p expr to be evaluated.
  *
@@ -347,6 +363,17 @@ void lyxp_set_free(struct lyxp_set *set);
  */
 struct lyxp_expr *lyxp_parse_expr(struct ly_ctx *ctx, const char *expr);
 
+/**
+ * @brief Parse and reparse (check the grammar of) an XPath expression so that it is ready
+ *        to be evaluated by lyxp_eval_compiled(). Logs directly.
+ *
+ * @param[in] ctx Context for errors.
+ * @param[in] expr XPath expression to compile. It is duplicated.
+ *
+ * @return Compiled expression structure or NULL on error. Free it with lyxp_expr_free().
+ */
+struct lyxp_expr *lyxp_compile_expr(struct ly_ctx *ctx, const char *expr);
+
 /**
  * @brief Frees a parsed XPath expression. \p expr should not be used afterwards.
  *
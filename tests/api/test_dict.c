@@ -246,6 +246,37 @@ test_similar_strings(void **state) {
     lydict_remove(ctx, "bbba");
 }
 
+static void
+test_insert_remove_churn(void **state)
+{
+    (void) state; /* unused */
+    const char *kept[16], *str;
+    char buf[32];
+    int i;
+
+    for (i = 0; i < 16; ++i) {
+        sprintf(buf, "kept%d", i);
+        kept[i] = lydict_insert(ctx, buf, 0);
+        assert_non_null(kept[i]);
+    }
+
+    /* every string is removed right after being inserted, so only deleted records are left behind */
+    for (i = 0; i < 200000; ++i) {
+        sprintf(buf, "churn%d", i);
+        str = lydict_insert(ctx, buf, 0);
+        assert_non_null(str);
+        lydict_remove(ctx, str);
+    }
+
+    for (i = 0; i < 16; ++i) {
+        sprintf(buf, "kept%d", i);
+        str = lydict_insert(ctx, buf, 0);
+        assert_ptr_equal(str, kept[i]);
+        lydict_remove(ctx, str);
+        lydict_remove(ctx, kept[i]);
+    }
+}
+
 int main(void)
 {
     const struct CMUnitTest tests[] = {
@@ -253,6 +284,7 @@ int main(void)
         cmocka_unit_test_setup_teardown(test_lydict_insert_zc, setup_f, teardown_f),
         cmocka_unit_test_setup_teardown(test_lydict_remove, setup_f, teardown_f),
         cmocka_unit_test_setup_teardown(test_similar_strings, setup_f, teardown_f),
+        cmocka_unit_test_setup_teardown(test_insert_remove_churn, setup_f, teardown_f),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
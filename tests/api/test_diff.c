@@ -561,6 +561,211 @@ test_wd1(void **state)
     lyd_free_diff(diff);
 }
 
+static void
+test_patch(void **state)
+{
+    struct state *st = (*state);
+    const char *xml1 = "<df xmlns=\"urn:libyang:tests:defaults\">"
+                         "<foo>1</foo>"
+                         "<llist>1</llist><llist>2</llist><llist>3</llist>"
+                         "<list><name>a</name><value>1</value></list>"
+                         "<list><name>b</name><value>2</value></list>"
+                         "<b1_2>x</b1_2>"
+                       "</df>";
+    const char *xml2 = "<df xmlns=\"urn:libyang:tests:defaults\">"
+                         "<foo>2</foo>"
+                         "<bar><ho>3</ho></bar>"
+                         "<llist>4</llist><llist>3</llist><llist>1</llist>"
+                         "<list><name>a</name><value>5</value></list>"
+                         "<list><name>c \"d\"</name><value>3</value></list>"
+                         "<b1_2>multi\nline\tvalue \"quoted\"</b1_2>"
+                       "</df>";
+    struct lyd_node *third = NULL, *iter;
+    struct lyd_difflist *diff;
+    struct ly_set *set;
+    char *patch;
+
+    assert_ptr_not_equal((st->first = lyd_parse_mem(st->ctx, xml1, LYD_XML, LYD_OPT_CONFIG)), NULL);
+    assert_ptr_not_equal((st->second = lyd_parse_mem(st->ctx, xml2, LYD_XML, LYD_OPT_CONFIG)), NULL);
+
+    assert_ptr_not_equal((diff = lyd_diff(st->first, st->second, 0)), NULL);
+    assert_int_equal(lyd_diff_print_mem(&patch, diff), 0);
+    lyd_free_diff(diff);
+
+    /* apply the patch to a copy of the first tree */
+    assert_ptr_not_equal((third = lyd_dup_withsiblings(st->first, LYD_DUP_OPT_RECURSIVE)), NULL);
+    assert_int_equal(lyd_diff_apply(&third, NULL, patch), 0);
+    assert_int_equal(lyd_validate(&third, LYD_OPT_CONFIG, NULL), 0);
+    assert_ptr_not_equal((diff = lyd_diff(third, st->second, 0)), NULL);
+    assert_int_equal(diff->type[0], LYD_DIFF_END);
+    lyd_free_diff(diff);
+
+    /* the order of the user-ordered instances is the same */
+    assert_ptr_not_equal((set = lyd_find_path(third, "/defaults:df/llist")), NULL);
+    assert_int_equal(set->number, 3);
+    assert_string_equal(((struct lyd_node_leaf_list *)set->set.d[0])->value_str, "4");
+    assert_string_equal(((struct lyd_node_leaf_list *)set->set.d[1])->value_str, "3");
+    assert_string_equal(((struct lyd_node_leaf_list *)set->set.d[2])->value_str, "1");
+    ly_set_free(set);
+
+    /* the patch cannot be applied twice */
+    assert_int_not_equal(lyd_diff_apply(&third, NULL, patch), 0);
+    lyd_free_withsiblings(third);
+
+    /* the patch creates the whole tree */
+    assert_ptr_not_equal((diff = lyd_diff(NULL, st->second, 0)), NULL);
+    free(patch);
+    assert_int_equal(lyd_diff_print_mem(&patch, diff), 0);
+    lyd_free_diff(diff);
+    third = NULL;
+    assert_int_equal(lyd_diff_apply(&third, st->ctx, patch), 0);
+    assert_int_equal(lyd_validate(&third, LYD_OPT_CONFIG, NULL), 0);
+    assert_ptr_not_equal((diff = lyd_diff(third, st->second, 0)), NULL);
+    assert_int_equal(diff->type[0], LYD_DIFF_END);
+    lyd_free_diff(diff);
+
+    /* and deletes it */
+    assert_ptr_not_equal((diff = lyd_diff(third, NULL, 0)), NULL);
+    free(patch);
+    assert_int_equal(lyd_diff_print_mem(&patch, diff), 0);
+    lyd_free_diff(diff);
+    assert_int_equal(lyd_diff_apply(&third, NULL, patch), 0);
+    LY_TREE_FOR(third, iter) {
+        /* only the implicit nodes are left */
+        assert_int_equal(iter->dflt, 1);
+    }
+    lyd_free_withsiblings(third);
+    free(patch);
+}
+
+static void
+test_paths(void **state)
+{
+    struct state *st = (*state);
+    const char *xml1 = "<df xmlns=\"urn:libyang:tests:defaults\">"
+                         "<foo>1</foo>"
+                         "<llist>1</llist><llist>2</llist>"
+                         "<list><name>a</name><value>1</value></list>"
+                       "</df>";
+    const char *xml2 = "<df xmlns=\"urn:libyang:tests:defaults\">"
+                         "<foo>2</foo>"
+                         "<llist>2</llist><llist>3</llist>"
+                         "<list><name>a</name><value>5</value></list>"
+                         "<list><name>it's</name><value>3</value></list>"
+                       "</df>";
+    struct lyd_difflist *diff;
+    struct lyd_node *node;
+    char **paths, *str;
+    int i;
+
+    assert_ptr_not_equal((st->first = lyd_parse_mem(st->ctx, xml1, LYD_XML, LYD_OPT_CONFIG)), NULL);
+    assert_ptr_not_equal((st->second = lyd_parse_mem(st->ctx, xml2, LYD_XML, LYD_OPT_CONFIG)), NULL);
+    assert_ptr_not_equal((diff = lyd_diff(st->first, st->second, 0)), NULL);
+    assert_ptr_not_equal((paths = lyd_diff_paths(diff)), NULL);
+
+    for (i = 0; diff->type[i] != LYD_DIFF_END; ++i) {
+        if ((diff->type[i] == LYD_DIFF_DELETED) || (diff->type[i] == LYD_DIFF_MOVEDAFTER1)) {
+            node = diff->first[i];
+        } else {
+            node = diff->second[i];
+        }
+        assert_ptr_not_equal(paths[i], NULL);
+        assert_string_equal(paths[i], (str = lyd_path(node)));
+        free(str);
+    }
+    assert_ptr_equal(paths[i], NULL);
+
+    assert_string_equal(paths[0], "/defaults:df/foo");
+    assert_string_equal(paths[1], "/defaults:df/list[name='a']/value");
+    assert_string_equal(paths[2], "/defaults:df/llist[.='1']");
+    assert_string_equal(paths[3], "/defaults:df/llist[.='3']");
+    assert_string_equal(paths[4], "/defaults:df/llist[.='3']");
+    assert_string_equal(paths[5], "/defaults:df/list[name=\"it's\"]");
+    free(paths);
+    lyd_free_diff(diff);
+}
+
+static void
+test_roots(void **state)
+{
+    struct state *st = (*state);
+    const char *yang = "module roots {namespace urn:libyang:tests:roots; prefix r;"
+                         "list item {key name; leaf name {type string;} leaf value {type uint32;}}"
+                         "leaf-list tag {type string;}}";
+    struct lyd_node *node, *third;
+    struct lyd_difflist *diff;
+    struct ly_set *set;
+    char path[64], value[16];
+    int i;
+
+    /* enough top-level siblings to have them indexed */
+    assert_ptr_not_equal(lys_parse_mem(st->ctx, yang, LYS_IN_YANG), NULL);
+    for (i = 0; i < 32; ++i) {
+        sprintf(path, "/roots:item[name='i%d']/value", i);
+        sprintf(value, "%d", i);
+        node = lyd_new_path(st->first, st->ctx, path, value, 0, 0);
+        assert_ptr_not_equal(node, NULL);
+        if (!st->first) {
+            st->first = node;
+        }
+    }
+    assert_ptr_not_equal(lyd_new_path(st->first, st->ctx, "/roots:tag", "a", 0, 0), NULL);
+
+    /* existing instances are found, not created again */
+    assert_ptr_equal(lyd_new_path(st->first, st->ctx, "/roots:item[name='i5']/value", "5", 0, LYD_PATH_OPT_UPDATE), NULL);
+    node = lyd_new_path(st->first, st->ctx, "/roots:item[name='i5']/value", "55", 0, LYD_PATH_OPT_UPDATE);
+    assert_ptr_not_equal(node, NULL);
+    assert_int_equal(((struct lyd_node_leaf_list *)node)->value.uint32, 55);
+    assert_int_equal(lyd_validate(&st->first, LYD_OPT_CONFIG, NULL), 0);
+
+    /* duplicate instance */
+    node = lyd_new_path(NULL, st->ctx, "/roots:item[name='i17']", NULL, 0, 0);
+    assert_ptr_not_equal(node, NULL);
+    assert_int_equal(lyd_insert_sibling(&st->first, node), 0);
+    assert_int_not_equal(lyd_validate(&st->first, LYD_OPT_CONFIG, NULL), 0);
+    /* the duplicate is still reported after another change */
+    assert_ptr_not_equal((third = lyd_new_path(st->first, NULL, "/roots:item[name='new']", NULL, 0, 0)), NULL);
+    assert_int_not_equal(lyd_validate(&st->first, LYD_OPT_CONFIG, NULL), 0);
+    lyd_free(third);
+    lyd_free(node);
+    assert_int_equal(lyd_validate(&st->first, LYD_OPT_CONFIG, NULL), 0);
+
+    /* diff */
+    st->second = lyd_dup_withsiblings(st->first, LYD_DUP_OPT_RECURSIVE);
+    assert_ptr_not_equal(st->second, NULL);
+    assert_ptr_not_equal(lyd_new_path(st->second, NULL, "/roots:item[name='i20']/value", "2", 0, LYD_PATH_OPT_UPDATE), NULL);
+    assert_ptr_not_equal((diff = lyd_diff(st->first, st->second, 0)), NULL);
+    assert_int_equal(diff->type[0], LYD_DIFF_CHANGED);
+    assert_int_equal(((struct lyd_node_leaf_list *)diff->second[0])->value.uint32, 2);
+    assert_int_equal(diff->type[1], LYD_DIFF_END);
+    lyd_free_diff(diff);
+
+    /* merge */
+    third = lyd_new_path(NULL, st->ctx, "/roots:item[name='i40']/value", "40", 0, 0);
+    assert_ptr_not_equal(third, NULL);
+    assert_ptr_not_equal(lyd_new_path(third, NULL, "/roots:item[name='i3']/value", "33", 0, 0), NULL);
+    assert_ptr_not_equal(lyd_new_path(third, NULL, "/roots:tag", "a", 0, 0), NULL);
+    assert_int_equal(lyd_merge(st->first, third, LYD_OPT_DESTRUCT), 0);
+    set = lyd_find_path(st->first, "/roots:*");
+    assert_ptr_not_equal(set, NULL);
+    assert_int_equal(set->number, 34);
+    ly_set_free(set);
+    set = lyd_find_path(st->first, "/roots:item[name='i3']/value");
+    assert_ptr_not_equal(set, NULL);
+    assert_int_equal(set->number, 1);
+    assert_int_equal(((struct lyd_node_leaf_list *)set->set.d[0])->value.uint32, 33);
+    ly_set_free(set);
+
+    /* unlink the first sibling, the rest is still found */
+    node = st->first;
+    st->first = st->first->next;
+    lyd_free(node);
+    assert_ptr_equal(lyd_new_path(st->first, NULL, "/roots:item[name='i31']/value", "31", 0, LYD_PATH_OPT_UPDATE), NULL);
+    assert_ptr_not_equal((node = lyd_new_path(st->first, NULL, "/roots:item[name='i0']", NULL, 0, 0)), NULL);
+    assert_ptr_equal(lyd_first_sibling(node), st->first);
+    assert_int_equal(lyd_validate(&st->first, LYD_OPT_CONFIG, NULL), 0);
+}
+
 int main(void)
 {
     const struct CMUnitTest tests[] = {
@@ -575,7 +780,10 @@ int main(void)
                     cmocka_unit_test_setup_teardown(test_move3, setup_f, teardown_f),
                     cmocka_unit_test_setup_teardown(test_mix1, setup_f, teardown_f),
                     cmocka_unit_test_setup_teardown(test_mix2, setup_f, teardown_f),
-                    cmocka_unit_test_setup_teardown(test_wd1, setup_f, teardown_f), };
+                    cmocka_unit_test_setup_teardown(test_wd1, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_patch, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_paths, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_roots, setup_f, teardown_f), };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
@@ -450,6 +450,17 @@ test_ly_ctx_load_module(void **state)
     assert_string_equal("b", module->name);
 }
 
+static uint32_t
+dict_used_count(struct ly_ctx *ctx)
+{
+    uint32_t i, used = 0;
+
+    for (i = 0; i < LYDICT_SHARD_COUNT; ++i) {
+        used += ctx->dict.shards[i].hash_tab->used;
+    }
+    return used;
+}
+
 static void
 test_ly_ctx_clean(void **state)
 {
@@ -464,25 +475,25 @@ test_ly_ctx_clean(void **state)
     /* remember starting values */
     setid = ctx->models.module_set_id;
     modules_count = ctx->models.used;
-    dict_used = ctx->dict.hash_tab->used;
+    dict_used = dict_used_count(ctx);
 
     /* add a module */
     mod = ly_ctx_load_module(ctx, "x", NULL);
     assert_ptr_not_equal(mod, NULL);
     assert_int_equal(modules_count + 1, ctx->models.used);
-    assert_int_not_equal(dict_used, ctx->dict.hash_tab->used);
+    assert_int_not_equal(dict_used, dict_used_count(ctx));
 
     /* clean the context */
     ly_ctx_clean(ctx, NULL);
     assert_int_equal(setid + 2, ctx->models.module_set_id);
     assert_int_equal(modules_count, ctx->models.used);
-    assert_int_equal(dict_used, ctx->dict.hash_tab->used);
+    assert_int_equal(dict_used, dict_used_count(ctx));
 
     /* add a module again ... */
     mod = ly_ctx_load_module(ctx, "x", NULL);
     assert_ptr_not_equal(mod, NULL);
     assert_int_equal(modules_count + 1, ctx->models.used);
-    assert_int_not_equal(dict_used, ctx->dict.hash_tab->used);
+    assert_int_not_equal(dict_used, dict_used_count(ctx));
 
     /* .. and add some string into dictionary */
     assert_ptr_not_equal(lydict_insert(ctx, "qwertyuiop", 0), NULL);
@@ -492,7 +503,7 @@ test_ly_ctx_clean(void **state)
     ly_ctx_clean(ctx, NULL);
     assert_int_equal(setid + 4, ctx->models.module_set_id);
     assert_int_equal(modules_count, ctx->models.used);
-    assert_int_equal(dict_used, ctx->dict.hash_tab->used);
+    assert_int_equal(dict_used, dict_used_count(ctx));
 
     /* cleanup */
     lydict_remove(ctx, "qwertyuiop");
@@ -547,7 +558,7 @@ test_ly_ctx_remove_module(void **state)
     /* remember starting values */
     setid = ctx->models.module_set_id;
     modules_count = ctx->models.used;
-    dict_used = ctx->dict.hash_tab->used;
+    dict_used = dict_used_count(ctx);
 
     mod = ly_ctx_load_module(ctx, "x", NULL);
     ly_ctx_remove_module(mod, NULL);
@@ -558,7 +569,7 @@ test_ly_ctx_remove_module(void **state)
     assert_true(setid < ctx->models.module_set_id);
     setid = ctx->models.module_set_id;
     assert_int_equal(modules_count + 2, ctx->models.used);
-    assert_int_not_equal(dict_used, ctx->dict.hash_tab->used);
+    assert_int_not_equal(dict_used, dict_used_count(ctx));
 
     /* remove the imported module (x), that should cause removing also the loaded module (y) */
     mod = ly_ctx_get_module(ctx, "x", NULL, 0);
@@ -567,7 +578,7 @@ test_ly_ctx_remove_module(void **state)
     assert_true(setid < ctx->models.module_set_id);
     setid = ctx->models.module_set_id;
     assert_int_equal(modules_count, ctx->models.used);
-    assert_int_equal(dict_used, ctx->dict.hash_tab->used);
+    assert_int_equal(dict_used, dict_used_count(ctx));
 
     /* add a module again ... */
     mod = ly_ctx_load_module(ctx, "y", NULL);
@@ -575,14 +586,14 @@ test_ly_ctx_remove_module(void **state)
     assert_true(setid < ctx->models.module_set_id);
     setid = ctx->models.module_set_id;
     assert_int_equal(modules_count + 2, ctx->models.used);
-    assert_int_not_equal(dict_used, ctx->dict.hash_tab->used);
+    assert_int_not_equal(dict_used, dict_used_count(ctx));
     /* ... now remove the loaded module, the imported module is supposed to be removed because it is not
      * used in any other module */
     ly_ctx_remove_module(mod, NULL);
     assert_true(setid < ctx->models.module_set_id);
     setid = ctx->models.module_set_id;
     assert_int_equal(modules_count, ctx->models.used);
-    assert_int_equal(dict_used, ctx->dict.hash_tab->used);
+    assert_int_equal(dict_used, dict_used_count(ctx));
 
     /* add a module again ... */
     mod = ly_ctx_load_module(ctx, "y", NULL);
@@ -590,7 +601,7 @@ test_ly_ctx_remove_module(void **state)
     assert_true(setid < ctx->models.module_set_id);
     setid = ctx->models.module_set_id;
     assert_int_equal(modules_count + 2, ctx->models.used);
-    assert_int_not_equal(dict_used, ctx->dict.hash_tab->used);
+    assert_int_not_equal(dict_used, dict_used_count(ctx));
     /* and mark even the imported module 'x' as implemented ... */
     assert_int_equal(lys_set_implemented(mod->imp[0].module), EXIT_SUCCESS);
     /* ... now remove the loaded module, the imported module is supposed to be kept because it is implemented */
@@ -598,7 +609,7 @@ test_ly_ctx_remove_module(void **state)
     assert_true(setid < ctx->models.module_set_id);
     setid = ctx->models.module_set_id;
     assert_int_equal(modules_count + 1, ctx->models.used);
-    assert_int_not_equal(dict_used, ctx->dict.hash_tab->used);
+    assert_int_not_equal(dict_used, dict_used_count(ctx));
     mod = ly_ctx_get_module(ctx, "y", NULL, 0);
     assert_ptr_equal(mod, NULL);
     mod = ly_ctx_get_module(ctx, "x", NULL, 0);
@@ -610,7 +621,7 @@ test_ly_ctx_remove_module(void **state)
     assert_true(setid < ctx->models.module_set_id);
     setid = ctx->models.module_set_id;
     assert_int_equal(modules_count + 2, ctx->models.used);
-    assert_int_not_equal(dict_used, ctx->dict.hash_tab->used);
+    assert_int_not_equal(dict_used, dict_used_count(ctx));
     /* and add another one also importing module 'x' ... */
     assert_ptr_not_equal(ly_ctx_load_module(ctx, "z", NULL), NULL);
     assert_true(setid < ctx->models.module_set_id);
@@ -622,7 +633,7 @@ test_ly_ctx_remove_module(void **state)
     assert_true(setid < ctx->models.module_set_id);
     setid = ctx->models.module_set_id;
     assert_int_equal(modules_count + 2, ctx->models.used);
-    assert_int_not_equal(dict_used, ctx->dict.hash_tab->used);
+    assert_int_not_equal(dict_used, dict_used_count(ctx));
     mod = ly_ctx_get_module(ctx, "y", NULL, 0);
     assert_ptr_equal(mod, NULL);
     mod = ly_ctx_get_module(ctx, "x", NULL, 0);
@@ -1552,6 +1563,87 @@ test_ly_set_dup(void **state)
     ly_set_free(second_set);
 }
 
+void
+test_ly_set_reserve(void **state)
+{
+    (void) state;
+    struct ly_set *set;
+    int items[3];
+
+    set = ly_set_new();
+    assert_non_null(set);
+
+    assert_int_equal(ly_set_reserve(set, 100), 0);
+    assert_true(set->size >= 100);
+    assert_int_equal(set->number, 0);
+
+    /* reserving less space keeps the set as it is */
+    assert_int_equal(ly_set_add(set, &items[0], 0), 0);
+    assert_int_equal(ly_set_reserve(set, 1), 0);
+    assert_true(set->size >= 100);
+    assert_int_equal(set->number, 1);
+    assert_ptr_equal(set->set.g[0], &items[0]);
+
+    assert_int_equal(ly_set_reserve(NULL, 1), -1);
+
+    ly_set_free(set);
+}
+
+void
+test_ly_set_large(void **state)
+{
+    (void) state;
+    struct ly_set *set, *dup;
+    int items[200], i;
+
+    set = ly_set_new();
+    assert_non_null(set);
+
+    for (i = 0; i < 200; ++i) {
+        assert_int_equal(ly_set_add(set, &items[i], 0), i);
+    }
+    /* duplicates are not added */
+    for (i = 0; i < 200; ++i) {
+        assert_int_equal(ly_set_add(set, &items[i], 0), i);
+    }
+    assert_int_equal(set->number, 200);
+
+    /* removing moves the last item */
+    assert_int_equal(ly_set_rm(set, &items[10]), EXIT_SUCCESS);
+    assert_int_equal(ly_set_contains(set, &items[10]), -1);
+    assert_int_equal(ly_set_contains(set, &items[199]), 10);
+    assert_int_equal(ly_set_rm_index(set, 199 - 1), EXIT_SUCCESS);
+    assert_int_equal(ly_set_contains(set, &items[198]), -1);
+    assert_int_equal(ly_set_rm(set, &items[10]), EXIT_FAILURE);
+    assert_int_equal(set->number, 198);
+    assert_int_equal(ly_set_add(set, &items[10], 0), 198);
+
+    dup = ly_set_dup(set);
+    assert_non_null(dup);
+    assert_int_equal(dup->number, 199);
+    for (i = 0; i < 198; ++i) {
+        assert_int_equal(ly_set_contains(dup, &items[i]), ly_set_contains(set, &items[i]));
+    }
+
+    /* a set with duplicates still works */
+    assert_int_equal(ly_set_add(set, &items[0], LY_SET_OPT_USEASLIST), 199);
+    assert_int_equal(ly_set_contains(set, &items[0]), 0);
+    assert_int_equal(ly_set_rm_index(set, 0), EXIT_SUCCESS);
+    assert_int_equal(ly_set_contains(set, &items[0]), 0);
+    assert_int_equal(ly_set_add(set, &items[5], 0), 5);
+
+    ly_set_clean(set);
+    assert_int_equal(set->number, 0);
+    assert_int_equal(ly_set_contains(set, &items[5]), -1);
+    for (i = 0; i < 100; ++i) {
+        assert_int_equal(ly_set_add(set, &items[i], 0), i);
+    }
+    assert_int_equal(ly_set_contains(set, &items[50]), 50);
+
+    ly_set_free(set);
+    ly_set_free(dup);
+}
+
 void
 test_ly_set_merge(void **state)
 {
@@ -1689,6 +1781,8 @@ int main(void)
         cmocka_unit_test(test_ly_ctx_destroy),
         cmocka_unit_test_setup_teardown(test_ly_path_xml2json, setup_f, teardown_f),
         cmocka_unit_test_setup_teardown(test_ly_set_dup, setup_f, teardown_f),
+        cmocka_unit_test(test_ly_set_reserve),
+        cmocka_unit_test(test_ly_set_large),
         cmocka_unit_test_setup_teardown(test_ly_vecode, setup_f, teardown_f),
         cmocka_unit_test_setup_teardown(test_ly_errmsg, setup_f, teardown_f),
     };
@@ -0,0 +1,363 @@
+/**
+ * @file test_snapshot.c
+ * @brief Cmocka tests for context snapshots.
+ *
+ * Copyright (c) 2018 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "tests/config.h"
+#include "libyang.h"
+
+struct state {
+    struct ly_ctx *ctx;
+    struct ly_ctx *restored;
+    struct lyd_node *data;
+    char *image;
+};
+
+static const char *sub =
+    "submodule snap-sub {"
+    "  yang-version 1.1;"
+    "  belongs-to snap { prefix s; }"
+    "  typedef percent { type uint8 { range \"0..100\"; } }"
+    "  grouping stats {"
+    "    leaf count { type uint32; default 0; }"
+    "    leaf ratio { type percent; units percent; }"
+    "  }"
+    "}";
+
+static const char *schema =
+    "module snap {"
+    "  yang-version 1.1;"
+    "  namespace \"urn:libyang:tests:snap\";"
+    "  prefix s;"
+    "  include snap-sub;"
+    "  import ietf-yang-metadata { prefix md; }"
+    "  import ietf-interfaces { prefix if; }"
+    "  revision 2018-10-01 { description \"Initial.\"; }"
+    "  md:annotation origin { type string; }"
+    "  feature fast;"
+    "  feature faster { if-feature \"fast or not-fast\"; }"
+    "  feature not-fast;"
+    "  identity base-id;"
+    "  identity derived-id { base base-id; }"
+    "  typedef name-type {"
+    "    type string { length \"1..32\"; pattern \"[a-z][a-z0-9-]*\"; pattern \"x.*\" { modifier invert-match; } }"
+    "  }"
+    "  container top {"
+    "    presence \"enables the top\";"
+    "    must \"count(item) < 10\" { error-message \"too many\"; }"
+    "    list item {"
+    "      key \"name\";"
+    "      unique \"value\";"
+    "      leaf name { type name-type; }"
+    "      leaf value { type int32 { range \"-5..5 | 10\"; } }"
+    "      leaf ref { type leafref { path \"../../item/name\"; } }"
+    "      leaf id { type identityref { base base-id; } }"
+    "      leaf flags { type bits { bit a; bit b { if-feature fast; position 5; } } }"
+    "      leaf kind { type enumeration { enum one; enum two { value 7; } } }"
+    "      leaf mixed { type union { type int8; type enumeration { enum none; } } }"
+    "      leaf amount { type decimal64 { fraction-digits 2; range \"0..10\"; } }"
+    "      leaf-list tags { type string; default \"a\"; default \"b\"; ordered-by user; }"
+    "      uses stats { refine count { default 1; } }"
+    "      choice mode {"
+    "        default auto;"
+    "        case auto { leaf auto { type empty; } }"
+    "        leaf manual { type string; when \"../value > 0\"; }"
+    "      }"
+    "      action reset { input { leaf force { type boolean; } } output { leaf done { type boolean; } } }"
+    "    }"
+    "    anydata extra;"
+    "    leaf fast-only { if-feature \"fast and not not-fast\"; type string; }"
+    "    leaf gone { type string; }"
+    "    leaf changed { type string; default \"x\"; }"
+    "  }"
+    "  grouping grp {"
+    "    container inner { leaf deep { type string; } }"
+    "  }"
+    "  container used {"
+    "    uses grp { augment inner { leaf added { type string; } } }"
+    "  }"
+    "  augment \"/if:interfaces/if:interface\" {"
+    "    when \"if:name != 'lo'\";"
+    "    leaf speed { type uint64; }"
+    "  }"
+    "  rpc ping { input { leaf host { type string; mandatory true; } } }"
+    "  notification event { leaf severity { type uint8; } }"
+    "}";
+
+static const char *deviations =
+    "module snap-dev {"
+    "  namespace \"urn:libyang:tests:snap-dev\";"
+    "  prefix d;"
+    "  import snap { prefix s; }"
+    "  deviation \"/s:top/s:gone\" { deviate not-supported; }"
+    "  deviation \"/s:top/s:changed\" { deviate replace { default \"y\"; } deviate add { must \". != 'z'\"; } }"
+    "}";
+
+static const char *
+sub_clb(const char *mod_name, const char *mod_rev, const char *submod_name, const char *sub_rev, void *user_data,
+        LYS_INFORMAT *format, void (**free_module_data)(void *model_data, void *user_data))
+{
+    (void)mod_name;
+    (void)mod_rev;
+    (void)sub_rev;
+    (void)user_data;
+
+    *free_module_data = NULL;
+    if (submod_name && !strcmp(submod_name, "snap-sub")) {
+        *format = LYS_IN_YANG;
+        return sub;
+    }
+    return NULL;
+}
+
+static int
+setup_f(void **state)
+{
+    struct state *st;
+
+    (*state) = st = calloc(1, sizeof *st);
+    if (!st) {
+        fprintf(stderr, "Memory allocation error");
+        return -1;
+    }
+
+    st->ctx = ly_ctx_new(TESTS_DIR"/schema/yang/ietf", 0);
+    if (!st->ctx) {
+        fprintf(stderr, "Failed to create context.\n");
+        goto error;
+    }
+    if (!ly_ctx_load_module(st->ctx, "ietf-ip", NULL) || !ly_ctx_load_module(st->ctx, "ietf-snmp", NULL)
+            || !ly_ctx_load_module(st->ctx, "ietf-system", NULL) || !ly_ctx_load_module(st->ctx, "ietf-netconf-acm", NULL)
+            || !ly_ctx_load_module(st->ctx, "iana-if-type", NULL)) {
+        fprintf(stderr, "Failed to load data models.\n");
+        goto error;
+    }
+    ly_ctx_set_module_imp_clb(st->ctx, sub_clb, NULL);
+    if (!lys_parse_mem(st->ctx, schema, LYS_IN_YANG)) {
+        fprintf(stderr, "Failed to load data model \"snap\".\n");
+        goto error;
+    }
+    if (!lys_parse_mem(st->ctx, deviations, LYS_IN_YANG)) {
+        fprintf(stderr, "Failed to load data model \"snap-dev\".\n");
+        goto error;
+    }
+    lys_features_enable(ly_ctx_get_module(st->ctx, "snap", NULL, 0), "fast");
+
+    return 0;
+
+error:
+    ly_ctx_destroy(st->ctx, NULL);
+    free(st);
+    (*state) = NULL;
+
+    return -1;
+}
+
+static int
+teardown_f(void **state)
+{
+    struct state *st = (*state);
+
+    lyd_free_withsiblings(st->data);
+    ly_ctx_destroy(st->restored, NULL);
+    ly_ctx_destroy(st->ctx, NULL);
+    free(st->image);
+    free(st);
+    (*state) = NULL;
+
+    return 0;
+}
+
+static void
+compare_contexts(struct ly_ctx *ctx1, struct ly_ctx *ctx2)
+{
+    const struct lys_module *mod1, *mod2;
+    const struct lys_submodule *sub1, *sub2;
+    uint32_t idx1 = 0, idx2 = 0;
+    char *str1, *str2;
+    unsigned int i;
+    LYS_OUTFORMAT formats[] = {LYS_OUT_YANG, LYS_OUT_YIN, LYS_OUT_TREE, LYS_OUT_INFO};
+
+    assert_int_equal(ly_ctx_internal_modules_count(ctx1), ly_ctx_internal_modules_count(ctx2));
+    assert_int_equal(ly_ctx_get_module_set_id(ctx1), ly_ctx_get_module_set_id(ctx2));
+    assert_int_equal(ly_ctx_get_options(ctx1), ly_ctx_get_options(ctx2));
+
+    while ((mod1 = ly_ctx_get_module_iter(ctx1, &idx1))) {
+        mod2 = ly_ctx_get_module_iter(ctx2, &idx2);
+        assert_non_null(mod2);
+        assert_ptr_equal(mod2->ctx, ctx2);
+        assert_string_equal(mod1->name, mod2->name);
+        assert_int_equal(mod1->implemented, mod2->implemented);
+        assert_ptr_equal(ly_ctx_get_module(ctx2, mod1->name, mod1->rev_size ? mod1->rev[0].date : NULL, 0), mod2);
+
+        for (i = 0; i < sizeof formats / sizeof *formats; ++i) {
+            assert_int_equal(lys_print_mem(&str1, mod1, formats[i], NULL, 0, 0), 0);
+            assert_int_equal(lys_print_mem(&str2, mod2, formats[i], NULL, 0, 0), 0);
+            assert_string_equal(str1, str2);
+            free(str1);
+            free(str2);
+        }
+
+        for (i = 0; i < mod1->inc_size; ++i) {
+            sub1 = mod1->inc[i].submodule;
+            sub2 = mod2->inc[i].submodule;
+            assert_ptr_equal(sub2->belongsto, mod2);
+            assert_int_equal(lys_print_mem(&str1, (const struct lys_module *)sub1, LYS_OUT_YANG, NULL, 0, 0), 0);
+            assert_int_equal(lys_print_mem(&str2, (const struct lys_module *)sub2, LYS_OUT_YANG, NULL, 0, 0), 0);
+            assert_string_equal(str1, str2);
+            free(str1);
+            free(str2);
+        }
+    }
+    assert_null(ly_ctx_get_module_iter(ctx2, &idx2));
+}
+
+static void
+use_context(struct state *st)
+{
+    const struct lys_module *mod;
+    const struct lys_node *node;
+    struct lyd_node *node_data;
+    const char *xml =
+        "<top xmlns=\"urn:libyang:tests:snap\">"
+          "<item><name>a</name><value>1</value><id>derived-id</id><flags>b</flags><kind>two</kind><mixed>none</mixed>"
+            "<amount>2.5</amount><ratio>50</ratio><manual>m</manual></item>"
+          "<item><name>b</name><value>2</value><ref>a</ref><tags>c</tags></item>"
+          "<fast-only>yes</fast-only>"
+        "</top>"
+        "<interfaces xmlns=\"urn:ietf:params:xml:ns:yang:ietf-interfaces\">"
+          "<interface><name>eth0</name><type xmlns:ianaift=\"urn:ietf:params:xml:ns:yang:iana-if-type\">ianaift:ethernetCsmacd</type>"
+            "<speed xmlns=\"urn:libyang:tests:snap\">1000</speed>"
+            "<ipv4 xmlns=\"urn:ietf:params:xml:ns:yang:ietf-ip\"><mtu>1500</mtu></ipv4>"
+          "</interface>"
+        "</interfaces>";
+    char *str;
+
+    mod = ly_ctx_get_module(st->restored, "snap", NULL, 1);
+    assert_non_null(mod);
+    assert_int_equal(lys_features_state(mod, "fast"), 1);
+    assert_int_equal(lys_features_state(mod, "faster"), 0);
+
+    node = ly_ctx_get_node(st->restored, NULL, "/snap:top/item/count", 0);
+    assert_non_null(node);
+    assert_string_equal(((struct lys_node_leaf *)node)->dflt, "1");
+    assert_null(ly_ctx_get_node(st->restored, NULL, "/snap:top/gone", 0));
+
+    /* data are parsed and validated with the schemas of the restored context */
+    st->data = lyd_parse_mem(st->restored, xml, LYD_XML, LYD_OPT_CONFIG);
+    assert_non_null(st->data);
+    assert_int_equal(lyd_print_mem(&str, st->data, LYD_JSON, LYP_WITHSIBLINGS | LYP_WD_ALL), 0);
+    assert_non_null(strstr(str, "\"changed\":\"y\""));
+    assert_non_null(strstr(str, "\"snap:speed\":\"1000\""));
+    free(str);
+
+    node_data = lyd_new_path(st->data, NULL, "/snap:top/item[name='c']/ref", "q", 0, 0);
+    assert_non_null(node_data);
+    assert_int_not_equal(lyd_validate(&st->data, LYD_OPT_CONFIG, NULL), 0);
+
+    /* the restored context can still be changed */
+    assert_non_null(ly_ctx_load_module(st->restored, "ietf-netconf", NULL));
+    assert_int_equal(lys_features_disable(mod, "fast"), 0);
+    assert_null(ly_ctx_get_node(st->restored, NULL, "/snap:top/fast-only", 0));
+}
+
+static void
+test_snapshot_mem(void **state)
+{
+    struct state *st = (*state);
+    size_t size;
+
+    assert_int_equal(ly_ctx_snapshot_mem(st->ctx, &st->image, &size), EXIT_SUCCESS);
+    assert_non_null(st->image);
+
+    st->restored = ly_ctx_new_snapshot_mem(st->image, size);
+    assert_non_null(st->restored);
+    compare_contexts(st->ctx, st->restored);
+    use_context(st);
+}
+
+static void
+test_snapshot_path(void **state)
+{
+    struct state *st = (*state);
+    char path[] = "/tmp/libyang-test-snapshot-XXXXXX";
+    int fd;
+
+    fd = mkstemp(path);
+    assert_int_not_equal(fd, -1);
+    close(fd);
+
+    assert_int_equal(ly_ctx_snapshot_path(st->ctx, path), EXIT_SUCCESS);
+    st->restored = ly_ctx_new_snapshot_path(path);
+    unlink(path);
+    assert_non_null(st->restored);
+    compare_contexts(st->ctx, st->restored);
+
+    /* snapshot of a restored context */
+    ly_ctx_destroy(st->ctx, NULL);
+    st->ctx = st->restored;
+    st->restored = NULL;
+    assert_int_equal(ly_ctx_snapshot_path(st->ctx, path), EXIT_SUCCESS);
+    st->restored = ly_ctx_new_snapshot_path(path);
+    unlink(path);
+    assert_non_null(st->restored);
+    compare_contexts(st->ctx, st->restored);
+    use_context(st);
+}
+
+static void
+test_snapshot_invalid(void **state)
+{
+    struct state *st = (*state);
+    size_t size;
+
+    assert_int_equal(ly_ctx_snapshot_mem(st->ctx, &st->image, &size), EXIT_SUCCESS);
+
+    /* truncated */
+    assert_null(ly_ctx_new_snapshot_mem(st->image, size - 1));
+    assert_null(ly_ctx_new_snapshot_mem(st->image, 4));
+
+    /* different build */
+    st->image[12] ^= 0xff;
+    assert_null(ly_ctx_new_snapshot_mem(st->image, size));
+    st->image[12] ^= 0xff;
+
+    /* not a snapshot */
+    st->image[0] = 'X';
+    assert_null(ly_ctx_new_snapshot_mem(st->image, size));
+    st->image[0] = 'L';
+
+    assert_null(ly_ctx_new_snapshot_path(TESTS_DIR"/schema/yang/ietf/ietf-ip.yang"));
+    assert_null(ly_ctx_new_snapshot_path("/nonexisting/snapshot"));
+
+    st->restored = ly_ctx_new_snapshot_mem(st->image, size);
+    assert_non_null(st->restored);
+}
+
+int
+main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_snapshot_mem, setup_f, teardown_f),
+        cmocka_unit_test_setup_teardown(test_snapshot_path, setup_f, teardown_f),
+        cmocka_unit_test_setup_teardown(test_snapshot_invalid, setup_f, teardown_f),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
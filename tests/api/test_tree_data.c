@@ -351,6 +351,26 @@ error:
     fail();
 }
 
+static void
+test_lyd_parse_mem_empty(void **state)
+{
+    (void) state; /* unused */
+    struct lyd_node *node;
+
+    /* only comments and processing instructions, no data (except for the default nodes) */
+    ly_errno = LY_SUCCESS;
+    node = lyd_parse_mem(ctx, "<?xml version=\"1.0\"?>\n<!-- x -->\n", LYD_XML, LYD_OPT_CONFIG);
+    assert_int_equal(ly_errno, LY_SUCCESS);
+    lyd_free_withsiblings(node);
+
+    /* unterminated comment and processing instruction are invalid, not empty */
+    assert_null(lyd_parse_mem(ctx, "<!-- x", LYD_XML, LYD_OPT_CONFIG));
+    assert_int_equal(ly_errno, LY_EVALID);
+    ly_errno = LY_SUCCESS;
+    assert_null(lyd_parse_mem(ctx, "<?xml version=\"1.0\"", LYD_XML, LYD_OPT_CONFIG));
+    assert_int_equal(ly_errno, LY_EVALID);
+}
+
 static void
 test_lyd_parse_fd(void **state)
 {
@@ -1588,11 +1608,76 @@ test_lyd_print_clb_json(void **state)
     free(buf);
 }
 
+static void
+test_lyd_print_large(void **state)
+{
+    (void) state; /* unused */
+    struct buff *buf = NULL;
+    struct stat sb;
+    char file_name[20], *value, *mem = NULL, *result;
+    int fd = -1;
+
+    /* the output does not fit into the write buffer, so it has to be flushed several times */
+    value = malloc(20001);
+    assert_ptr_not_equal(value, NULL);
+    memset(value, 'a', 20000);
+    value[20000] = '\0';
+    assert_int_equal(lyd_change_leaf((struct lyd_node_leaf_list *)root->child, value), 0);
+    free(value);
+
+    assert_int_equal(lyd_print_mem(&mem, root, LYD_JSON, LYP_FORMAT), 0);
+    assert_ptr_not_equal(mem, NULL);
+    assert_true(strlen(mem) > 20000);
+
+    memset(file_name, 0, sizeof(file_name));
+    strncpy(file_name, TMP_TEMPLATE, sizeof(file_name));
+    fd = mkstemp(file_name);
+    assert_int_not_equal(fd, -1);
+    assert_int_equal(lyd_print_fd(fd, root, LYD_JSON, LYP_FORMAT), 0);
+    assert_int_equal(fstat(fd, &sb), 0);
+    assert_int_equal(sb.st_size, strlen(mem));
+    result = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    assert_ptr_not_equal(result, MAP_FAILED);
+    assert_memory_equal(result, mem, sb.st_size);
+    munmap(result, sb.st_size);
+    close(fd);
+    unlink(file_name);
+
+    buf = calloc(1, sizeof *buf);
+    assert_ptr_not_equal(buf, NULL);
+    buf->cmp = mem;
+    assert_int_equal(lyd_print_clb(custom_lyd_print_clb, buf, root, LYD_JSON, LYP_FORMAT), 0);
+    assert_int_equal(buf->len, strlen(mem));
+
+    free(buf);
+    free(mem);
+}
+
+static void
+test_lyd_print_empty(void **state)
+{
+    (void) state; /* unused */
+    char *mem = NULL;
+
+    /* nothing is printed, but the memory output is still an allocated empty string */
+    assert_int_equal(lyd_print_mem(&mem, NULL, LYD_XML, 0), 0);
+    assert_ptr_not_equal(mem, NULL);
+    assert_string_equal(mem, "");
+    free(mem);
+    mem = NULL;
+
+    assert_int_equal(lyd_print_mem(&mem, NULL, LYD_XML, LYP_FORMAT), 0);
+    assert_ptr_not_equal(mem, NULL);
+    assert_string_equal(mem, "");
+    free(mem);
+}
+
 static void
 test_lyd_path(void **state)
 {
     (void) state; /* unused */
     char *str;
+    size_t size;
 
     str = lyd_path(root);
     assert_ptr_not_equal(str, NULL);
@@ -1603,6 +1688,15 @@ test_lyd_path(void **state)
     assert_ptr_not_equal(str, NULL);
     assert_string_equal(str, "/a:x/bubba");
     free(str);
+
+    /* reused buffer */
+    str = NULL;
+    size = 0;
+    assert_int_equal(lyd_path_buf(root->child, &str, &size), 10);
+    assert_string_equal(str, "/a:x/bubba");
+    assert_int_equal(lyd_path_buf(root, &str, &size), 4);
+    assert_string_equal(str, "/a:x");
+    free(str);
 }
 
 static void
@@ -1910,11 +2004,322 @@ test_lyd_print_path(void **state)
     }
 }
 
+static void
+test_lyd_schema_child_index(void **state)
+{
+    (void) state; /* unused */
+    struct ly_ctx *new_ctx;
+    struct lyd_node *data, *node;
+    const char *yang_wide = "module wide { namespace urn:wide; prefix w;"
+        "container c { leaf l1 {type string;} leaf l2 {type string;} leaf l3 {type string;}"
+        "leaf l4 {type string;} leaf l5 {type string;} leaf l6 {type string;}"
+        "choice ch { leaf l7 {type string;} case k { leaf l8 {type string;} } } } }";
+    const char *yang_aug = "module wide-aug { namespace urn:wide-aug; prefix wa; import wide {prefix w;}"
+        "augment /w:c { leaf l2 {type string;} leaf extra {type string;} } }";
+    const char *xml = "<c xmlns=\"urn:wide\"><l6>6</l6><l8>8</l8><l2>2</l2>"
+                      "<l2 xmlns=\"urn:wide-aug\">a2</l2><extra xmlns=\"urn:wide-aug\">e</extra></c>";
+    const char *json = "{\"wide:c\":{\"l6\":\"6\",\"l8\":\"8\",\"l2\":\"2\",\"wide-aug:l2\":\"a2\","
+                       "\"wide-aug:extra\":\"e\"}}";
+    const char *yang_feat = "module wide-feat { namespace urn:wide-feat; prefix wf; import wide {prefix w;}"
+        "feature f; augment /w:c { if-feature f; leaf ft {type string;} } }";
+    const char *xml_feat = "<c xmlns=\"urn:wide\"><l6>6</l6><ft xmlns=\"urn:wide-feat\">f</ft></c>";
+    const struct lys_module *mod;
+
+    new_ctx = ly_ctx_new(NULL, 0);
+    assert_non_null(new_ctx);
+    assert_non_null(lys_parse_mem(new_ctx, yang_wide, LYS_IN_YANG));
+
+    /* populate the child index, the augment nodes are not known yet */
+    data = lyd_new_path(NULL, new_ctx, "/wide:c/l8", "8", 0, 0);
+    assert_non_null(data);
+    assert_string_equal(data->child->schema->name, "l8");
+    assert_null(lyd_new_path(data, NULL, "/wide:c/extra", "e", 0, 0));
+    ly_errno = 0;
+    lyd_free_withsiblings(data);
+
+    /* the index must notice the new augment */
+    assert_non_null(lys_parse_mem(new_ctx, yang_aug, LYS_IN_YANG));
+
+    data = lyd_parse_mem(new_ctx, xml, LYD_XML, LYD_OPT_CONFIG | LYD_OPT_STRICT);
+    assert_non_null(data);
+    node = data->child->prev;
+    assert_string_equal(node->schema->name, "extra");
+    assert_string_equal(lys_node_module(node->schema)->name, "wide-aug");
+    node = node->prev;
+    assert_string_equal(node->schema->name, "l2");
+    assert_string_equal(lys_node_module(node->schema)->name, "wide-aug");
+    lyd_free_withsiblings(data);
+
+    data = lyd_parse_mem(new_ctx, json, LYD_JSON, LYD_OPT_CONFIG | LYD_OPT_STRICT);
+    assert_non_null(data);
+    node = data->child->prev->prev;
+    assert_string_equal(node->schema->name, "l2");
+    assert_string_equal(lys_node_module(node->schema)->name, "wide-aug");
+
+    node = lyd_new_path(data, NULL, "/wide:c/wide-aug:extra", "e2", 0, LYD_PATH_OPT_UPDATE);
+    assert_non_null(node);
+    assert_string_equal(lys_node_module(node->schema)->name, "wide-aug");
+    lyd_free_withsiblings(data);
+
+    /* the nodes of an augment with a disabled feature are found the same way as by lys_getnext(),
+     * only the parsers check the augment if-features */
+    mod = lys_parse_mem(new_ctx, yang_feat, LYS_IN_YANG);
+    assert_non_null(mod);
+    assert_null(lyd_parse_mem(new_ctx, xml_feat, LYD_XML, LYD_OPT_CONFIG | LYD_OPT_STRICT));
+    ly_errno = 0;
+    data = lyd_new_path(NULL, new_ctx, "/wide:c/l6", "6", 0, 0);
+    assert_non_null(data);
+    node = lyd_new_path(data, NULL, "/wide:c/wide-feat:ft", "f", 0, 0);
+    assert_non_null(node);
+    assert_string_equal(lys_node_module(node->schema)->name, "wide-feat");
+    lyd_free_withsiblings(data);
+    assert_int_equal(lys_features_enable(mod, "f"), 0);
+    data = lyd_parse_mem(new_ctx, xml_feat, LYD_XML, LYD_OPT_CONFIG | LYD_OPT_STRICT);
+    assert_non_null(data);
+    assert_string_equal(data->child->prev->schema->name, "ft");
+    lyd_free_withsiblings(data);
+
+    ly_ctx_destroy(new_ctx, NULL);
+}
+
+static void
+test_lyd_free_arena(void **state)
+{
+    (void) state; /* unused */
+    struct lyd_node *data, *next, *elem, *moved;
+    char *xml, *mem;
+    int i, len;
+    LYD_FORMAT formats[] = {LYD_XML, LYD_JSON, LYD_LYB};
+
+    /* enough list instances to fill several arena chunks */
+    xml = malloc(300 * 128);
+    assert_non_null(xml);
+    for (i = 0, len = 0; i < 300; ++i) {
+        len += sprintf(xml + len, "<l xmlns=\"urn:a\"><key1>%d</key1><key2>%d</key2><value>v%d</value></l>",
+                       i / 256, i % 256, i);
+    }
+
+    data = lyd_parse_mem(ctx, xml, LYD_XML, LYD_OPT_CONFIG);
+    assert_non_null(data);
+    assert_int_equal(data->arena, 0);
+    lyd_free_withsiblings(data);
+
+    data = lyd_parse_mem(ctx, xml, LYD_XML, LYD_OPT_CONFIG | LYD_OPT_ARENA);
+    free(xml);
+    assert_non_null(data);
+    LY_TREE_FOR(data, elem) {
+        if (elem->dflt) {
+            /* created by the validation */
+            assert_int_equal(elem->arena, 0);
+            continue;
+        }
+        assert_int_equal(elem->arena, 1);
+        assert_int_equal(elem->child->arena, 1);
+        assert_int_equal(elem->child->prev->arena, 1);
+    }
+
+    for (i = 0; i < 3; ++i) {
+        mem = NULL;
+        lyd_print_mem(&mem, data, formats[i], LYP_WITHSIBLINGS);
+        assert_non_null(mem);
+        lyd_free_arena(data);
+
+        data = lyd_parse_mem(ctx, mem, formats[i], LYD_OPT_CONFIG | LYD_OPT_ARENA);
+        free(mem);
+        assert_non_null(data);
+        LY_TREE_DFS_BEGIN(data, next, elem) {
+            assert_int_equal(elem->arena, !elem->dflt);
+            LY_TREE_DFS_END(data, next, elem);
+        }
+    }
+
+    /* free a node in the middle, move another one out of the tree */
+    lyd_free(data->next->next);
+    moved = data->next->next->next;
+    lyd_unlink(moved);
+    assert_int_equal(moved->arena, 1);
+
+    /* free the tree from one of its nodes, the moved node must stay valid */
+    lyd_free_arena(data->next->child);
+    assert_string_equal(moved->schema->name, "l");
+    assert_string_equal(((struct lyd_node_leaf_list *)moved->child->prev)->value_str, "v4");
+    lyd_free_arena(moved);
+}
+
+static void
+test_lyd_validate_incremental(void **state)
+{
+    (void) state; /* unused */
+    struct ly_ctx *new_ctx;
+    struct lyd_node *data, *node;
+    struct ly_set *set;
+    const char *yang = "module incr { namespace urn:incr; prefix i;"
+        "container top { leaf limit {type uint8; default 3;}"
+        "list item { key name; unique addr; leaf name {type string;} leaf addr {type string;}"
+        "leaf val {type uint8; must \". <= /i:top/i:limit\";}"
+        "leaf need {when \"../val > 2\"; mandatory true; type string;}"
+        "container opts { leaf o {when \"../../val > 1\"; type string; default x;} } } }"
+        "leaf base {type string;} leaf uses-base {must \"/i:base\"; type string;} }";
+    const char *xml = "<top xmlns=\"urn:incr\"><item><name>a</name><addr>1</addr><val>1</val></item>"
+                      "<item><name>b</name><addr>2</addr><val>3</val><need>n</need></item></top>";
+
+    new_ctx = ly_ctx_new(NULL, 0);
+    assert_non_null(new_ctx);
+    assert_non_null(lys_parse_mem(new_ctx, yang, LYS_IN_YANG));
+    data = lyd_parse_mem(new_ctx, xml, LYD_XML, LYD_OPT_CONFIG);
+    assert_non_null(data);
+
+    /* a change in a remote node breaks the must condition */
+    node = lyd_new_path(data, NULL, "/incr:top/limit", "2", 0, LYD_PATH_OPT_UPDATE);
+    assert_non_null(node);
+    assert_int_not_equal(lyd_validate(&data, LYD_OPT_CONFIG | LYD_OPT_VAL_INCR, NULL), 0);
+    assert_int_equal(lyd_change_leaf((struct lyd_node_leaf_list *)node, "5"), 0);
+    assert_int_equal(lyd_validate(&data, LYD_OPT_CONFIG | LYD_OPT_VAL_INCR, NULL), 0);
+    LY_TREE_FOR(data->child, node) {
+        assert_int_equal(node->validity & (LYD_VAL_SUBTREE | LYD_VAL_DIRTY), 0);
+    }
+    assert_int_equal(data->validity & (LYD_VAL_SUBTREE | LYD_VAL_DIRTY), 0);
+
+    /* the when condition of a mandatory leaf becomes true */
+    assert_non_null(lyd_new_path(data, NULL, "/incr:top/item[name='a']/val", "4", 0, LYD_PATH_OPT_UPDATE));
+    assert_int_not_equal(lyd_validate(&data, LYD_OPT_CONFIG | LYD_OPT_VAL_INCR, NULL), 0);
+    assert_non_null(lyd_new_path(data, NULL, "/incr:top/item[name='a']/need", "n", 0, 0));
+    assert_int_equal(lyd_validate(&data, LYD_OPT_CONFIG | LYD_OPT_VAL_INCR, NULL), 0);
+
+    /* the default leaf depending on the changed value is removed and added back */
+    set = lyd_find_path(data, "/incr:top/item/opts/o");
+    assert_non_null(set);
+    assert_int_equal(set->number, 2);
+    ly_set_free(set);
+    assert_non_null(lyd_new_path(data, NULL, "/incr:top/item[name='a']/val", "1", 0, LYD_PATH_OPT_UPDATE));
+    set = lyd_find_path(data, "/incr:top/item[name='a']/need");
+    assert_non_null(set);
+    assert_int_equal(set->number, 1);
+    lyd_free(set->set.d[0]);
+    ly_set_free(set);
+    assert_int_equal(lyd_validate(&data, LYD_OPT_CONFIG | LYD_OPT_VAL_INCR, NULL), 0);
+    set = lyd_find_path(data, "/incr:top/item/opts/o");
+    assert_non_null(set);
+    assert_int_equal(set->number, 1);
+    ly_set_free(set);
+
+    /* removing a mandatory leaf */
+    set = lyd_find_path(data, "/incr:top/item[name='b']/need");
+    assert_non_null(set);
+    assert_int_equal(set->number, 1);
+    lyd_free(set->set.d[0]);
+    ly_set_free(set);
+    assert_int_not_equal(lyd_validate(&data, LYD_OPT_CONFIG | LYD_OPT_VAL_INCR, NULL), 0);
+    assert_non_null(lyd_new_path(data, NULL, "/incr:top/item[name='b']/need", "n", 0, 0));
+    assert_int_equal(lyd_validate(&data, LYD_OPT_CONFIG | LYD_OPT_VAL_INCR, NULL), 0);
+
+    /* removing a top-level node another one depends on */
+    assert_non_null(lyd_new_path(data, NULL, "/incr:base", "b", 0, 0));
+    assert_non_null(lyd_new_path(data, NULL, "/incr:uses-base", "u", 0, 0));
+    assert_int_equal(lyd_validate(&data, LYD_OPT_CONFIG | LYD_OPT_VAL_INCR, NULL), 0);
+    set = lyd_find_path(data, "/incr:base");
+    assert_non_null(set);
+    assert_int_equal(set->number, 1);
+    lyd_free(set->set.d[0]);
+    ly_set_free(set);
+    LY_TREE_FOR(data, node) {
+        assert_int_equal(node->validity & LYD_VAL_TOPDEL, LYD_VAL_TOPDEL);
+    }
+    assert_int_not_equal(lyd_validate(&data, LYD_OPT_CONFIG | LYD_OPT_VAL_INCR, NULL), 0);
+    assert_non_null(lyd_new_path(data, NULL, "/incr:base", "b", 0, 0));
+    assert_int_equal(lyd_validate(&data, LYD_OPT_CONFIG | LYD_OPT_VAL_INCR, NULL), 0);
+    LY_TREE_FOR(data, node) {
+        assert_int_equal(node->validity & (LYD_VAL_TOPDEL | LYD_VAL_SUBTREE | LYD_VAL_DIRTY), 0);
+    }
+
+    /* unique constraint of a newly created instance */
+    assert_non_null(lyd_new_path(data, NULL, "/incr:top/item[name='c']/addr", "2", 0, 0));
+    assert_int_not_equal(lyd_validate(&data, LYD_OPT_CONFIG | LYD_OPT_VAL_INCR, NULL), 0);
+
+    /* only data trees can be validated incrementally */
+    assert_int_not_equal(lyd_validate(&data, LYD_OPT_GET | LYD_OPT_VAL_INCR, NULL), 0);
+
+    lyd_free_withsiblings(data);
+    ly_ctx_destroy(new_ctx, NULL);
+}
+
+static void
+test_lyd_validate_parallel(void **state)
+{
+    (void) state; /* unused */
+    struct ly_ctx *new_ctx;
+    struct lyd_node *data;
+    char *xml, *path = NULL, *msg = NULL;
+    int i, j, len;
+    const char *yang = "module par { namespace urn:par; prefix p;"
+        "container a { list e { key k; unique u; leaf k {type uint32;} leaf u {type uint32;}"
+        "leaf v {type uint32; must \". < 1000\";} leaf lr {type leafref {path \"../../e/k\";}}"
+        "leaf xr {type leafref {path \"/p:b/p:e/p:k\";}} leaf m {type uint32; must \". <= /p:c/p:limit\";} } }"
+        "container b { list e { key k; leaf k {type uint32;} leaf iid {type instance-identifier;} } }"
+        "container c { leaf limit {type uint32; default 100;} }"
+        "list top { key k; leaf k {type uint32;} leaf r {type leafref {path \"/p:top/p:k\";}} } }";
+
+    new_ctx = ly_ctx_new(NULL, 0);
+    assert_non_null(new_ctx);
+    assert_int_equal(ly_ctx_get_validation_threads(new_ctx), 0);
+    ly_ctx_set_validation_threads(new_ctx, 4);
+    assert_int_equal(ly_ctx_get_validation_threads(new_ctx), 4);
+    assert_non_null(lys_parse_mem(new_ctx, yang, LYS_IN_YANG));
+
+    xml = malloc(16384);
+    assert_non_null(xml);
+    for (j = 0; j < 3; ++j) {
+        /* valid data, a broken local must, a broken cross-tree leafref */
+        len = sprintf(xml, "<a xmlns=\"urn:par\">");
+        for (i = 0; i < 40; ++i) {
+            len += sprintf(xml + len, "<e><k>%d</k><u>%d</u><v>%d</v><lr>%d</lr><xr>%d</xr><m>%d</m></e>", i, i,
+                           ((j == 1) && (i == 30)) ? 1000 : i, (i + 1) % 40, ((j == 2) && (i == 20)) ? 50 : i, i);
+        }
+        len += sprintf(xml + len, "</a><b xmlns=\"urn:par\">");
+        for (i = 0; i < 40; ++i) {
+            len += sprintf(xml + len, "<e><k>%d</k><iid xmlns:p=\"urn:par\">/p:a/p:e[p:k='%d']/p:v</iid></e>", i, i);
+        }
+        len += sprintf(xml + len, "</b>");
+        for (i = 0; i < 20; ++i) {
+            len += sprintf(xml + len, "<top xmlns=\"urn:par\"><k>%d</k><r>%d</r></top>", i, 19 - i);
+        }
+
+        data = lyd_parse_mem(new_ctx, xml, LYD_XML, LYD_OPT_CONFIG | LYD_OPT_TRUSTED);
+        assert_non_null(data);
+        if (!j) {
+            assert_int_equal(lyd_validate(&data, LYD_OPT_CONFIG | LYD_OPT_VAL_PARALLEL, NULL), 0);
+            /* the default container was created */
+            assert_string_equal(data->prev->schema->name, "c");
+            lyd_free_withsiblings(data);
+            continue;
+        }
+
+        assert_int_not_equal(lyd_validate(&data, LYD_OPT_CONFIG | LYD_OPT_VAL_PARALLEL, NULL), 0);
+        path = strdup(ly_errpath(new_ctx));
+        msg = strdup(ly_errmsg(new_ctx));
+        lyd_free_withsiblings(data);
+
+        /* the same error as if validated serially */
+        data = lyd_parse_mem(new_ctx, xml, LYD_XML, LYD_OPT_CONFIG | LYD_OPT_TRUSTED);
+        assert_non_null(data);
+        assert_int_not_equal(lyd_validate(&data, LYD_OPT_CONFIG, NULL), 0);
+        assert_string_equal(ly_errpath(new_ctx), path);
+        assert_string_equal(ly_errmsg(new_ctx), msg);
+        assert_string_equal(path, (j == 1) ? "/par:a/e[k='30']/v" : "/par:a/e[k='20']/xr");
+        free(path);
+        free(msg);
+        lyd_free_withsiblings(data);
+    }
+
+    free(xml);
+    ly_ctx_destroy(new_ctx, NULL);
+}
 
 int main(void)
 {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(test_lyd_parse_mem),
+        cmocka_unit_test_setup_teardown(test_lyd_parse_mem_empty, setup_f, teardown_f),
         cmocka_unit_test(test_lyd_parse_fd),
         cmocka_unit_test(test_lyd_parse_path),
         cmocka_unit_test(test_lyd_parse_xml),
@@ -1949,6 +2354,8 @@ int main(void)
         cmocka_unit_test_setup_teardown(test_lyd_print_clb_xml, setup_f, teardown_f),
         cmocka_unit_test_setup_teardown(test_lyd_print_clb_xml_format, setup_f, teardown_f),
         cmocka_unit_test_setup_teardown(test_lyd_print_clb_json, setup_f, teardown_f),
+        cmocka_unit_test_setup_teardown(test_lyd_print_large, setup_f, teardown_f),
+        cmocka_unit_test_setup_teardown(test_lyd_print_empty, setup_f, teardown_f),
         cmocka_unit_test_setup_teardown(test_lyd_path, setup_f, teardown_f),
         cmocka_unit_test_setup_teardown(test_lyd_leaf_type, setup_f2, teardown_f2),
         cmocka_unit_test_setup_teardown(test_lyd_validation_dflt_empty_containers, setup_f, teardown_f),
@@ -1961,6 +2368,10 @@ int main(void)
         cmocka_unit_test_setup_teardown(test_lyd_new_output_anydata, setup_f3, teardown_f3),
         cmocka_unit_test_setup_teardown(test_lyd_first_sibling, setup_f, teardown_f),
         cmocka_unit_test_setup_teardown(test_lyd_print_path, setup_f, teardown_f),
+        cmocka_unit_test(test_lyd_schema_child_index),
+        cmocka_unit_test_setup_teardown(test_lyd_free_arena, setup_f, teardown_f),
+        cmocka_unit_test(test_lyd_validate_incremental),
+        cmocka_unit_test(test_lyd_validate_parallel),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
@@ -227,12 +227,71 @@ test_dup_to_ctx_leafrefs(void **state)
     free(printed);
 }
 
+static void
+test_dup_subtree(void **state)
+{
+    struct state *st = (*state);
+    const struct lys_module *mod;
+    const char *sch = "module x {"
+                    "  namespace urn:x;"
+                    "  prefix x;"
+                    "  container x {"
+                    "    list l { key k; leaf k { type string; } leaf v { type int8; } }"
+                    "    leaf-list ll { type string; }"
+                    "    leaf a { type string; } } }";
+    const char *data = "<x xmlns=\"urn:x\">"
+                         "<l><k>1</k><v>1</v></l><l><k>2</k><v>2</v></l><l><k>3</k><v>3</v></l>"
+                         "<l><k>4</k><v>4</v></l><l><k>5</k><v>5</v></l>"
+                         "<ll>a</ll><ll>b</ll><a>hello</a>"
+                       "</x>";
+    char *printed = NULL;
+    struct lyd_difflist *diff;
+    struct ly_set *set;
+
+    mod = lys_parse_mem(st->ctx1, sch, LYS_IN_YANG);
+    assert_ptr_not_equal(mod, NULL);
+
+    st->dt1 = lyd_parse_mem(st->ctx1, data, LYD_XML, LYD_OPT_CONFIG);
+    assert_ptr_not_equal(st->dt1, NULL);
+
+    st->dt2 = lyd_dup(st->dt1, LYD_DUP_OPT_RECURSIVE);
+    assert_ptr_not_equal(st->dt2, NULL);
+    lyd_print_mem(&printed, st->dt2, LYD_XML, 0);
+    assert_string_equal(printed, data);
+    free(printed);
+
+    /* the instances are found in the duplicate */
+    set = lyd_find_path(st->dt2, "/x:x/l[k='4']/v");
+    assert_ptr_not_equal(set, NULL);
+    assert_int_equal(set->number, 1);
+    assert_ptr_equal(set->set.d[0]->parent->parent, st->dt2);
+    ly_set_free(set);
+    assert_ptr_equal(lyd_new_path(st->dt2, NULL, "/x:x/ll", "b", 0, LYD_PATH_OPT_UPDATE), NULL);
+    assert_int_equal(lyd_validate(&st->dt2, LYD_OPT_CONFIG, NULL), 0);
+
+    diff = lyd_diff(st->dt1, st->dt2, 0);
+    assert_ptr_not_equal(diff, NULL);
+    assert_int_equal(diff->type[0], LYD_DIFF_END);
+    lyd_free_diff(diff);
+
+    /* changing the duplicate does not affect the original */
+    assert_ptr_not_equal(lyd_new_path(st->dt2, NULL, "/x:x/l[k='4']/v", "40", 0, LYD_PATH_OPT_UPDATE), NULL);
+    diff = lyd_diff(st->dt1, st->dt2, 0);
+    assert_ptr_not_equal(diff, NULL);
+    assert_int_equal(diff->type[0], LYD_DIFF_CHANGED);
+    assert_int_equal(((struct lyd_node_leaf_list *)diff->first[0])->value.int8, 4);
+    assert_int_equal(((struct lyd_node_leaf_list *)diff->second[0])->value.int8, 40);
+    assert_int_equal(diff->type[1], LYD_DIFF_END);
+    lyd_free_diff(diff);
+}
+
 int main(void)
 {
     const struct CMUnitTest tests[] = {
                     cmocka_unit_test_setup_teardown(test_dup_to_ctx, setup_f, teardown_f),
                     cmocka_unit_test_setup_teardown(test_dup_to_ctx_bits, setup_f, teardown_f),
-                    cmocka_unit_test_setup_teardown(test_dup_to_ctx_leafrefs, setup_f, teardown_f),};
+                    cmocka_unit_test_setup_teardown(test_dup_to_ctx_leafrefs, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_dup_subtree, setup_f, teardown_f),};
 
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
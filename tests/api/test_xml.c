@@ -427,6 +427,32 @@ test_lyxml_print_clb(void **state)
     lyxml_free(ctx, xml);
 }
 
+static ssize_t
+failing_lyxml_print_clb(void *arg, const void *buf, size_t count)
+{
+    (void)arg;
+    (void)buf;
+    (void)count;
+
+    return -1;
+}
+
+static void
+test_lyxml_print_clb_fail(void **state)
+{
+    (void) state; /* unused */
+    struct lyxml_elem *xml;
+    const char *path = TESTS_DIR"/api/files/a.xml";
+
+    xml = lyxml_parse_path(ctx, path, 0);
+    assert_non_null(xml);
+
+    /* the output is buffered, the failed write is noticed when it is flushed */
+    assert_int_equal(lyxml_print_clb(failing_lyxml_print_clb, NULL, xml, 0), -1);
+
+    lyxml_free(ctx, xml);
+}
+
 static void
 test_lyxml_unlink(void **state)
 {
@@ -592,6 +618,58 @@ test_lyxml_xmlns_correct_format(void **state)
     lyxml_free(ctx, xml);
 }
 
+void
+test_lyxml_parse_text(void **state)
+{
+    (void)state;
+    struct lyxml_elem *xml = NULL;
+    char *data, *expected;
+    int i, len;
+
+    /* long text with references, CDATA and brackets behind the plain runs, at every offset */
+    data = malloc(4096);
+    expected = malloc(4096);
+    assert_non_null(data);
+    assert_non_null(expected);
+    for (len = 0; len < 80; len++) {
+        i = sprintf(data, "<x a=\"");
+        memset(data + i, 'v', len);
+        i += len;
+        i += sprintf(data + i, "&quot;<\">");
+        memset(data + i, 't', len);
+        i += len;
+        i += sprintf(data + i, "&lt;&#x42;]\t\n<![CDATA[<&]]]>");
+        memset(data + i, 'u', len);
+        strcpy(data + i + len, "</x>");
+
+        xml = lyxml_parse_mem(ctx, data, 0);
+        assert_ptr_not_equal(xml, NULL);
+
+        memset(expected, 'v', len);
+        strcpy(expected + len, "\"<");
+        assert_string_equal(expected, xml->attr->value);
+        memset(expected, 't', len);
+        i = len + sprintf(expected + len, "<B]\t\n<&]");
+        memset(expected + i, 'u', len);
+        expected[i + len] = '\0';
+        assert_string_equal(expected, xml->content);
+        lyxml_free(ctx, xml);
+    }
+
+    /* invalid content behind a plain run */
+    memset(data, 'a', 100);
+    strcpy(data, "<x>");
+    strcpy(data + 100, "]]></x>");
+    assert_ptr_equal(lyxml_parse_mem(ctx, data, 0), NULL);
+    strcpy(data + 100, "\x01</x>");
+    assert_ptr_equal(lyxml_parse_mem(ctx, data, 0), NULL);
+    strcpy(data + 100, "<![CDATA[</x>");
+    assert_ptr_equal(lyxml_parse_mem(ctx, data, 0), NULL);
+
+    free(data);
+    free(expected);
+}
+
 int main(void)
 {
     const struct CMUnitTest tests[] = {
@@ -602,6 +680,7 @@ int main(void)
         cmocka_unit_test_setup_teardown(test_lyxml_print_fd, setup_f, teardown_f),
         cmocka_unit_test_setup_teardown(test_lyxml_print_mem, setup_f, teardown_f),
         cmocka_unit_test_setup_teardown(test_lyxml_print_clb, setup_f, teardown_f),
+        cmocka_unit_test_setup_teardown(test_lyxml_print_clb_fail, setup_f, teardown_f),
         cmocka_unit_test_setup_teardown(test_lyxml_unlink, setup_f, teardown_f),
         cmocka_unit_test_setup_teardown(test_lyxml_get_attr, setup_f, teardown_f),
         cmocka_unit_test_setup_teardown(test_lyxml_get_ns, setup_f, teardown_f),
@@ -609,6 +688,7 @@ int main(void)
         cmocka_unit_test_setup_teardown(test_lyxml_free_withsiblings, setup_f, teardown_f),
         cmocka_unit_test_setup_teardown(test_lyxml_xmlns_wrong_format, setup_f, teardown_f),
         cmocka_unit_test_setup_teardown(test_lyxml_xmlns_correct_format, setup_f, teardown_f),
+        cmocka_unit_test_setup_teardown(test_lyxml_parse_text, setup_f, teardown_f),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
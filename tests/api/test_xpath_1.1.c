@@ -111,6 +111,36 @@ test_func_re_match(void **state)
     assert_int_equal(st->set->number, 2);
 }
 
+static void
+test_func_re_match2(void **state)
+{
+    struct state *st = (*state);
+    int i;
+
+    st->dt = lyd_parse_mem(st->ctx, data1, LYD_XML, LYD_OPT_CONFIG);
+    assert_ptr_not_equal(st->dt, NULL);
+
+    /* the compiled pattern is reused */
+    for (i = 0; i < 3; ++i) {
+        st->set = lyd_find_path(st->dt, "/xpath-1.1:top/*[re-match(., 'a+b+c+')]");
+        assert_ptr_not_equal(st->set, NULL);
+        assert_int_equal(st->set->number, 2);
+        ly_set_free(st->set);
+    }
+
+    st->set = lyd_find_path(st->dt, "/xpath-1.1:top/*[re-match(., 'a+b+c+.*')]");
+    assert_ptr_not_equal(st->set, NULL);
+    assert_int_equal(st->set->number, 2);
+    ly_set_free(st->set);
+
+    /* invalid patterns are not cached */
+    for (i = 0; i < 2; ++i) {
+        st->set = lyd_find_path(st->dt, "/xpath-1.1:top/*[re-match(., 'a+[b')]");
+        assert_ptr_equal(st->set, NULL);
+        assert_int_equal(ly_vecode(st->ctx), LYVE_INREGEX);
+    }
+}
+
 static void
 test_func_deref(void **state)
 {
@@ -288,6 +318,7 @@ main(void)
 {
     const struct CMUnitTest tests[] = {
         cmocka_unit_test_setup_teardown(test_func_re_match, setup_f, teardown_f),
+        cmocka_unit_test_setup_teardown(test_func_re_match2, setup_f, teardown_f),
         cmocka_unit_test_setup_teardown(test_func_deref, setup_f, teardown_f),
         cmocka_unit_test_setup_teardown(test_func_derived_from1, setup_f, teardown_f),
         cmocka_unit_test_setup_teardown(test_func_derived_from2, setup_f, teardown_f),
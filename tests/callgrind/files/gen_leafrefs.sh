@@ -0,0 +1,15 @@
+#!/bin/sh
+
+echo '<interfaces xmlns="urn:libyang:test:leafrefs">' > leafrefs.xml
+for i in $(seq 1000)
+do
+  echo "    <interface><name>if$i</name><mtu>1500</mtu></interface>" >> leafrefs.xml
+done
+echo '</interfaces>' >> leafrefs.xml
+
+echo '<references xmlns="urn:libyang:test:leafrefs">' >> leafrefs.xml
+for i in $(seq 2000)
+do
+  echo "    <reference><id>$i</id><interface>if$(( (i - 1) % 1000 + 1 ))</interface></reference>" >> leafrefs.xml
+done
+echo '</references>' >> leafrefs.xml
@@ -0,0 +1,8 @@
+#!/bin/sh
+
+echo '<entries xmlns="urn:libyang:test:whens">' > whens.xml
+for i in $(seq 5000)
+do
+  echo "    <entry><id>$i</id><mode>basic</mode><limit>$i</limit></entry>" >> whens.xml
+done
+echo '</entries>' >> whens.xml
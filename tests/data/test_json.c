@@ -247,6 +247,26 @@ static const char *error_num_data_005 =
 "}"
 ;
 
+/* member names with escapes, explicit module names and unknown names */
+static const char *names_data =
+"{"
+  "\"n\\u0075mbers:nums\": {"
+    "\"num1\": 1,"
+    "\"numbers:num2\": 2,"
+    "\"num\\u0033\": 3"
+  "}"
+"}"
+;
+
+static const char *names_data_unknown =
+"{"
+  "\"numbers:nums\": {"
+    "\"num1\": 1,"
+    "\"numbers:num\": 2"
+  "}"
+"}"
+;
+
 /* the string length is greater than 1024 - 3 */
 static const char *string_data_001 =
 "{"
@@ -602,6 +622,41 @@ test_parse_error_numbers(void **state)
     assert_ptr_equal(st->dt, NULL);
 }
 
+static void
+test_parse_member_names(void **state)
+{
+    struct lyd_node_leaf_list *leaf;
+    struct state *st;
+    const char *modules[] = {"numbers"};
+    int module_count = 1;
+
+    if (setup_f(&st, TESTS_DIR "/data/files", modules, module_count)) {
+        fail();
+    }
+
+    (*state) = st;
+
+    st->dt = lyd_parse_mem(st->ctx, names_data, LYD_JSON, LYD_OPT_CONFIG | LYD_OPT_STRICT);
+    assert_ptr_not_equal(st->dt, NULL);
+    assert_string_equal(st->dt->schema->name, "nums");
+
+    leaf = (struct lyd_node_leaf_list *)st->dt->child;
+    assert_string_equal(leaf->schema->name, "num1");
+    assert_string_equal(leaf->value_str, "1");
+    leaf = (struct lyd_node_leaf_list *)leaf->next;
+    assert_string_equal(leaf->schema->name, "num2");
+    assert_string_equal(leaf->value_str, "2");
+    leaf = (struct lyd_node_leaf_list *)leaf->next;
+    assert_string_equal(leaf->schema->name, "num3");
+    assert_string_equal(leaf->value_str, "3");
+    lyd_free_withsiblings(st->dt);
+
+    /* a prefix of a known name must not match */
+    st->dt = lyd_parse_mem(st->ctx, names_data_unknown, LYD_JSON, LYD_OPT_CONFIG | LYD_OPT_STRICT);
+    assert_ptr_equal(st->dt, NULL);
+    assert_string_equal(ly_errmsg(st->ctx), "Unknown element \"num\".");
+}
+
 static void
 test_parse_string(void **state)
 {
@@ -701,6 +756,7 @@ main(void)
                     cmocka_unit_test_teardown(test_parse_if, teardown_f),
                     cmocka_unit_test_teardown(test_parse_numbers, teardown_f),
                     cmocka_unit_test_teardown(test_parse_error_numbers, teardown_f),
+                    cmocka_unit_test_teardown(test_parse_member_names, teardown_f),
                     cmocka_unit_test_teardown(test_parse_string, teardown_f),
                     };
 
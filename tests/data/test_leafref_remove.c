@@ -14,6 +14,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <setjmp.h>
 #include <stdarg.h>
 #include <cmocka.h>
@@ -124,12 +125,160 @@ test_leafref_unlink2(void **state)
     assert_int_equal(r, 0);
 }
 
+static void
+test_leafref_remove_many(void **state)
+{
+    (void)state;
+    struct ly_ctx *ctx;
+    struct lyd_node *data, *node;
+    char path[64], value[16];
+    int i, r;
+    const char *schema =
+    "module lrmany {"
+        "yang-version 1.1;"
+        "namespace urn:libyang:tests:lrmany;"
+        "prefix lm;"
+        "container targets {"
+            "list target {"
+                "key id;"
+                "leaf id {type uint8;}"
+                "leaf name {type string;}"
+            "}"
+        "}"
+        "leaf-list link {"
+            "type leafref {path \"/lm:targets/lm:target/lm:name\";}"
+        "}"
+        "leaf-list weak-link {"
+            "type leafref {path \"/lm:targets/lm:target/lm:name\"; require-instance false;}"
+        "}"
+    "}";
+
+    ctx = ly_ctx_new(NULL, 0);
+    assert_ptr_not_equal(ctx, NULL);
+    assert_ptr_not_equal(lys_parse_mem(ctx, schema, LYS_IN_YANG), NULL);
+
+    /* enough leafrefs with an absolute path for the target index to be used */
+    data = NULL;
+    for (i = 1; i <= 16; ++i) {
+        sprintf(path, "/lrmany:targets/target[id='%d']/name", i);
+        sprintf(value, "name%d", i);
+        node = lyd_new_path(data, ctx, path, value, 0, 0);
+        assert_ptr_not_equal(node, NULL);
+        if (!data) {
+            data = node;
+        }
+        node = lyd_new_path(data, ctx, "/lrmany:link", value, 0, 0);
+        assert_ptr_not_equal(node, NULL);
+        node = lyd_new_path(data, ctx, "/lrmany:weak-link", value, 0, 0);
+        assert_ptr_not_equal(node, NULL);
+    }
+    r = lyd_validate(&data, LYD_OPT_CONFIG, NULL);
+    assert_int_equal(r, 0);
+
+    /* every link is resolved to its target */
+    LY_TREE_FOR(data, node) {
+        if (!strcmp(node->schema->name, "link")) {
+            assert_int_equal(((struct lyd_node_leaf_list *)node)->value_type, LY_TYPE_LEAFREF);
+            assert_ptr_not_equal(((struct lyd_node_leaf_list *)node)->value.leafref, NULL);
+            assert_string_equal(((struct lyd_node_leaf_list *)((struct lyd_node_leaf_list *)node)->value.leafref)->value_str,
+                                ((struct lyd_node_leaf_list *)node)->value_str);
+        }
+    }
+
+    /* remove a target referenced by both a required and a not-required leafref */
+    lyd_free(data->child->prev);
+    r = lyd_validate(&data, LYD_OPT_CONFIG, NULL);
+    assert_int_not_equal(r, 0);
+    assert_int_equal(ly_vecode(ctx), LYVE_NOLEAFREF);
+
+    /* the weak link alone is fine */
+    LY_TREE_FOR(data, node) {
+        if (!strcmp(node->schema->name, "link") && !strcmp(((struct lyd_node_leaf_list *)node)->value_str, "name16")) {
+            lyd_free(node);
+            break;
+        }
+    }
+    r = lyd_validate(&data, LYD_OPT_CONFIG, NULL);
+    assert_int_equal(r, 0);
+
+    lyd_free_withsiblings(data);
+    ly_ctx_destroy(ctx, NULL);
+}
+
+static void
+test_leafref_remove_many_uses(void **state)
+{
+    (void)state;
+    struct ly_ctx *ctx;
+    struct lyd_node *data, *node;
+    char path[64], value[16];
+    int i, r;
+    const char *schema =
+    "module lruses {"
+        "yang-version 1.1;"
+        "namespace urn:libyang:tests:lruses;"
+        "prefix lu;"
+        "grouping targets {"
+            "list target {"
+                "key id;"
+                "leaf id {type uint8;}"
+            "}"
+        "}"
+        "uses targets;"
+        "choice ch {"
+            "case a {"
+                "container other {"
+                    "leaf-list name {type string;}"
+                "}"
+            "}"
+        "}"
+        "leaf-list link {"
+            "type leafref {path \"/lu:target/lu:id\";}"
+        "}"
+        "leaf-list other-link {"
+            "type leafref {path \"/lu:other/lu:name\";}"
+        "}"
+    "}";
+
+    ctx = ly_ctx_new(NULL, 0);
+    assert_ptr_not_equal(ctx, NULL);
+    assert_ptr_not_equal(lys_parse_mem(ctx, schema, LYS_IN_YANG), NULL);
+
+    /* targets in top-level uses and choice, enough leafrefs for the target index to be used */
+    data = NULL;
+    for (i = 1; i <= 16; ++i) {
+        sprintf(path, "/lruses:target[id='%d']", i);
+        sprintf(value, "%d", i);
+        node = lyd_new_path(data, ctx, path, NULL, 0, 0);
+        assert_ptr_not_equal(node, NULL);
+        if (!data) {
+            data = node;
+        }
+        assert_ptr_not_equal(lyd_new_path(data, ctx, "/lruses:link", value, 0, 0), NULL);
+        assert_ptr_not_equal(lyd_new_path(data, ctx, "/lruses:other/name", value, 0, 0), NULL);
+        assert_ptr_not_equal(lyd_new_path(data, ctx, "/lruses:other-link", value, 0, 0), NULL);
+    }
+    r = lyd_validate(&data, LYD_OPT_CONFIG, NULL);
+    assert_int_equal(r, 0);
+
+    /* a missing target is still detected */
+    assert_ptr_not_equal(lyd_new_path(data, ctx, "/lruses:link", "17", 0, 0), NULL);
+    r = lyd_validate(&data, LYD_OPT_CONFIG, NULL);
+    assert_int_not_equal(r, 0);
+    assert_int_equal(ly_vecode(ctx), LYVE_NOLEAFREF);
+
+    lyd_free_withsiblings(data);
+    ly_ctx_destroy(ctx, NULL);
+}
+
 int main(void)
 {
     const struct CMUnitTest tests[] = {
                     cmocka_unit_test_setup_teardown(test_leafref_free, setup_f, teardown_f),
                     cmocka_unit_test_setup_teardown(test_leafref_unlink, setup_f, teardown_f),
-                    cmocka_unit_test_setup_teardown(test_leafref_unlink2, setup_f, teardown_f), };
+                    cmocka_unit_test_setup_teardown(test_leafref_unlink2, setup_f, teardown_f),
+                    cmocka_unit_test(test_leafref_remove_many),
+                    cmocka_unit_test(test_leafref_remove_many_uses), };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
 }
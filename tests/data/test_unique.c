@@ -144,6 +144,50 @@ test_un_empty(void **state)
     assert_ptr_not_equal(st->dt, NULL);
 }
 
+static void
+test_un_siblings(void **state)
+{
+    struct state *st = (*state);
+    const char *xml1 = "<un xmlns=\"urn:libyang:tests:unique\">"
+                        "<list><name>x</name><a>1</a>"
+                          "<list2><name>a</name><cont><a>1</a><b>1</b></cont></list2>"
+                          "<list2><name>b</name><cont><a>1</a><b>2</b></cont></list2>"
+                          "<list2><name>c</name><cont><a>2</a><b>1</b></cont></list2>"
+                        "</list>"
+                        "<list><name>y</name><a>2</a>"
+                          "<list2><name>a</name><cont><a>1</a><b>1</b></cont></list2>"
+                          "<list2><name>b</name><cont><a>1</a><b>2</b></cont></list2>"
+                        "</list>"
+                       "</un>";
+    const char *xml2 = "<un xmlns=\"urn:libyang:tests:unique\">"
+                        "<list><name>x</name><a>1</a>"
+                          "<list2><name>a</name><cont><a>1</a><b>1</b></cont></list2>"
+                          "<list2><name>b</name><cont><a>1</a><b>2</b></cont></list2>"
+                          "<list2><name>c</name><cont><a>1</a><b>1</b></cont></list2>"
+                        "</list>"
+                       "</un>";
+    struct ly_set *set;
+
+    /* instances in different parents do not collide */
+    st->dt = lyd_parse_mem(st->ctx, xml1, LYD_XML, LYD_OPT_CONFIG);
+    assert_ptr_not_equal(st->dt, NULL);
+
+    /* changing a value makes the instances collide */
+    set = lyd_find_path(st->dt, "/unique:un/list[name='x']/list2[name='c']/cont/a");
+    assert_ptr_not_equal(set, NULL);
+    assert_int_equal(set->number, 1);
+    assert_int_equal(lyd_change_leaf((struct lyd_node_leaf_list *)set->set.d[0], "1"), 0);
+    ly_set_free(set);
+    assert_int_not_equal(lyd_validate(&st->dt, LYD_OPT_CONFIG, NULL), 0);
+    assert_int_equal(ly_vecode(st->ctx), LYVE_NOUNIQ);
+    lyd_free(st->dt);
+
+    st->dt = lyd_parse_mem(st->ctx, xml2, LYD_XML, LYD_OPT_CONFIG);
+    assert_ptr_equal(st->dt, NULL);
+    assert_int_equal(ly_errno, LY_EVALID);
+    assert_int_equal(ly_vecode(st->ctx), LYVE_NOUNIQ);
+}
+
 static void
 test_schema_inpath(void **state)
 {
@@ -170,6 +214,7 @@ int main(void)
                     cmocka_unit_test_setup_teardown(test_un_correct, setup_f, teardown_f),
                     cmocka_unit_test_setup_teardown(test_un_defaults, setup_f, teardown_f),
                     cmocka_unit_test_setup_teardown(test_un_empty, setup_f, teardown_f),
+                    cmocka_unit_test_setup_teardown(test_un_siblings, setup_f, teardown_f),
                     cmocka_unit_test_setup_teardown(test_schema_inpath, setup_f, teardown_f),
     };
 
@@ -125,6 +125,9 @@ test_half_full(void **state)
     assert_int_equal(lyht_find(ht, &l, l, NULL), 1);
 }
 
+#define REC_EMPTY(i) (ht->ctrl[i] == LYHT_CTRL_EMPTY)
+#define GET_REC_VAL(rec) (*((int *)&(rec)->val))
+
 static void
 test_resize(void **state)
 {
@@ -139,17 +142,15 @@ test_resize(void **state)
     assert_int_equal(ht->size, 16);
 
     for (i = 0; i < 2; ++i) {
-        rec = lyht_get_rec(ht->recs, ht->rec_size, i);
-        assert_int_equal(rec->hits, 0);
+        assert_true(REC_EMPTY(i));
     }
     for (; i < 8; ++i) {
         rec = lyht_get_rec(ht->recs, ht->rec_size, i);
-        assert_int_equal(rec->hits, 1);
+        assert_false(REC_EMPTY(i));
         assert_int_equal(rec->hash, i);
     }
     for (; i < 16; ++i) {
-        rec = lyht_get_rec(ht->recs, ht->rec_size, i);
-        assert_int_equal(rec->hits, 0);
+        assert_true(REC_EMPTY(i));
     }
 
     for (i = 0; i < 2; ++i) {
@@ -173,8 +174,6 @@ test_resize(void **state)
     }
 }
 
-#define GET_REC_VAL(rec) (*((int *)&(rec)->val))
-
 static void
 test_collisions(void **state)
 {
@@ -188,52 +187,42 @@ test_collisions(void **state)
 
     /* check all records */
     for (i = 0; i < 2; ++i) {
-        rec = lyht_get_rec(ht->recs, ht->rec_size, i);
-        assert_int_equal(rec->hits, 0);
+        assert_true(REC_EMPTY(i));
     }
-    rec = lyht_get_rec(ht->recs, ht->rec_size, i);
-    assert_int_equal(rec->hits, 4);
-    assert_int_equal(GET_REC_VAL(rec), i);
-    ++i;
     for (; i < 6; ++i) {
         rec = lyht_get_rec(ht->recs, ht->rec_size, i);
-        assert_int_equal(rec->hits, 1);
+        assert_false(REC_EMPTY(i));
         assert_int_equal(GET_REC_VAL(rec), i);
     }
     for (; i < 8; ++i) {
-        rec = lyht_get_rec(ht->recs, ht->rec_size, i);
-        assert_int_equal(rec->hits, 0);
+        assert_true(REC_EMPTY(i));
     }
 
+    /* the following collision is shifted into the place of the removed record */
     i = 4;
     assert_int_equal(lyht_remove(ht, &i, 2), 0);
 
     rec = lyht_get_rec(ht->recs, ht->rec_size, i);
-    assert_int_equal(rec->hits, -1);
+    assert_int_equal(GET_REC_VAL(rec), 5);
+    assert_true(REC_EMPTY(5));
 
     i = 2;
     assert_int_equal(lyht_remove(ht, &i, 2), 0);
 
     /* check all records */
     for (i = 0; i < 2; ++i) {
-        rec = lyht_get_rec(ht->recs, ht->rec_size, i);
-        assert_int_equal(rec->hits, 0);
+        assert_true(REC_EMPTY(i));
     }
     rec = lyht_get_rec(ht->recs, ht->rec_size, i);
-    assert_int_equal(rec->hits, 2);
-    assert_int_equal(GET_REC_VAL(rec), 5);
+    assert_false(REC_EMPTY(i));
+    assert_int_equal(GET_REC_VAL(rec), 3);
     ++i;
     rec = lyht_get_rec(ht->recs, ht->rec_size, i);
-    assert_int_equal(rec->hits, 1);
-    assert_int_equal(GET_REC_VAL(rec), 3);
+    assert_false(REC_EMPTY(i));
+    assert_int_equal(GET_REC_VAL(rec), 5);
     ++i;
-    for (; i < 6; ++i) {
-        rec = lyht_get_rec(ht->recs, ht->rec_size, i);
-        assert_int_equal(rec->hits, -1);
-    }
     for (; i < 8; ++i) {
-        rec = lyht_get_rec(ht->recs, ht->rec_size, i);
-        assert_int_equal(rec->hits, 0);
+        assert_true(REC_EMPTY(i));
     }
 
     for (i = 0; i < 3; ++i) {
@@ -255,17 +244,8 @@ test_collisions(void **state)
     assert_int_equal(lyht_remove(ht, &i, 2), 0);
 
     /* check all records */
-    for (i = 0; i < 2; ++i) {
-        rec = lyht_get_rec(ht->recs, ht->rec_size, i);
-        assert_int_equal(rec->hits, 0);
-    }
-    for (; i < 6; ++i) {
-        rec = lyht_get_rec(ht->recs, ht->rec_size, i);
-        assert_int_equal(rec->hits, -1);
-    }
-    for (; i < 8; ++i) {
-        rec = lyht_get_rec(ht->recs, ht->rec_size, i);
-        assert_int_equal(rec->hits, 0);
+    for (i = 0; i < 8; ++i) {
+        assert_true(REC_EMPTY(i));
     }
 }
 
@@ -293,21 +273,23 @@ test_invalid_move(void **state)
     assert_int_equal(lyht_insert(ht, &a[6], 6, NULL), 0);
     assert_int_equal(lyht_insert(ht, &a[7], 7, NULL), 0);
 
-    /* these are the invalid values */
-    for (i = 1; i < 4; ++i) {
-        rec = lyht_get_rec(ht->recs, ht->rec_size, i);
-        assert_int_equal(rec->hits, -1);
+    /* the collision was moved right behind its hash index, no removed records remain */
+    rec = lyht_get_rec(ht->recs, ht->rec_size, 1);
+    assert_int_equal(GET_REC_VAL(rec), 4);
+    for (i = 2; i < 5; ++i) {
+        assert_true(REC_EMPTY(i));
     }
 
     /* if all the values were being moved correctly, this succeeds */
     assert_int_equal(lyht_insert(ht, &a[8], 0, NULL), 0);
 
-    rec = lyht_get_rec(ht->recs, ht->rec_size, 0);
-    assert_int_equal(rec->hits, 3);
-    rec = lyht_get_rec(ht->recs, ht->rec_size, 1);
-    assert_int_equal(rec->hits, 1);
-    rec = lyht_get_rec(ht->recs, ht->rec_size, 2);
-    assert_int_equal(rec->hits, 1);
+    for (i = 0; i < 3; ++i) {
+        rec = lyht_get_rec(ht->recs, ht->rec_size, i);
+        assert_false(REC_EMPTY(i));
+        assert_int_equal(rec->hash, 0);
+    }
+    assert_int_equal(lyht_find(ht, &a[4], 0, NULL), 0);
+    assert_int_equal(lyht_find(ht, &a[8], 0, NULL), 0);
 }
 
 static void
@@ -353,6 +335,44 @@ test_invalid_move2(void **state)
     assert_int_equal(lyht_find(ht, &a[8 + 3], 3, NULL), 0);
 }
 
+static void
+test_wrap_around(void **state)
+{
+    int i, *match, a[] = { 7, 15, 23, 0 };
+    struct ht_rec *rec;
+
+    (void)state;
+
+    for (i = 0; i < 3; ++i) {
+        assert_int_equal(lyht_insert(ht, &a[i], 7, NULL), 0);
+    }
+    assert_int_equal(lyht_insert(ht, &a[3], 0, NULL), 0);
+
+    /* the collisions continue from the beginning */
+    rec = lyht_get_rec(ht->recs, ht->rec_size, 1);
+    assert_int_equal(GET_REC_VAL(rec), 23);
+    rec = lyht_get_rec(ht->recs, ht->rec_size, 2);
+    assert_int_equal(GET_REC_VAL(rec), 0);
+
+    /* all the following records are shifted back across the end */
+    assert_int_equal(lyht_remove(ht, &a[0], 7), 0);
+    rec = lyht_get_rec(ht->recs, ht->rec_size, 7);
+    assert_int_equal(GET_REC_VAL(rec), 15);
+    rec = lyht_get_rec(ht->recs, ht->rec_size, 0);
+    assert_int_equal(GET_REC_VAL(rec), 23);
+    rec = lyht_get_rec(ht->recs, ht->rec_size, 1);
+    assert_int_equal(GET_REC_VAL(rec), 0);
+    assert_true(REC_EMPTY(2));
+
+    /* values with equal hashes are returned in the order they were inserted */
+    assert_int_equal(lyht_find(ht, &a[1], 7, (void **)&match), 0);
+    assert_int_equal(*match, 15);
+    assert_int_equal(lyht_find_next(ht, &a[1], 7, (void **)&match), 0);
+    assert_int_equal(*match, 23);
+    assert_int_equal(lyht_find_next(ht, &a[2], 7, NULL), 1);
+    assert_int_equal(lyht_find(ht, &a[3], 0, NULL), 0);
+}
+
 int main(void)
 {
     const struct CMUnitTest tests[] = {
@@ -362,6 +382,7 @@ int main(void)
         cmocka_unit_test_setup_teardown(test_collisions, setup_f, teardown_f),
         cmocka_unit_test_setup_teardown(test_invalid_move, setup_f, teardown_f),
         cmocka_unit_test_setup_teardown(test_invalid_move2, setup_f, teardown_f),
+        cmocka_unit_test_setup_teardown(test_wrap_around, setup_f, teardown_f),
     };
 
     /*ly_verb(LY_LLDBG);
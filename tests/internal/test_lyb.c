@@ -658,6 +658,171 @@ test_leafrefs(void **state)
     check_data_tree(st->dt1, st->dt2);
 }
 
+static void
+test_version1(void **state)
+{
+    struct state *st = (*state);
+    struct lyd_node *dt3;
+    FILE *f;
+    long len;
+    char *v1;
+    int ret;
+
+    ly_ctx_set_searchdir(st->ctx, TESTS_DIR"/data/files");
+    assert_non_null(ly_ctx_load_module(st->ctx, "annotations", NULL));
+
+    st->dt1 = lyd_parse_path(st->ctx, TESTS_DIR"/data/files/annotations.xml", LYD_XML, LYD_OPT_CONFIG);
+    assert_ptr_not_equal(st->dt1, NULL);
+
+    /* the same data printed in LYB version 1, with attributes and subtrees split into several chunks */
+    f = fopen(TESTS_DIR"/data/files/annotations-v1.lyb", "r");
+    assert_non_null(f);
+    fseek(f, 0, SEEK_END);
+    len = ftell(f);
+    rewind(f);
+    v1 = malloc(len);
+    assert_non_null(v1);
+    assert_int_equal(fread(v1, 1, len, f), len);
+    fclose(f);
+
+    assert_int_equal(lyd_lyb_data_length(v1), len);
+
+    st->dt2 = lyd_parse_mem(st->ctx, v1, LYD_LYB, LYD_OPT_CONFIG | LYD_OPT_STRICT);
+    assert_ptr_not_equal(st->dt2, NULL);
+
+    check_data_tree(st->dt1, st->dt2);
+
+    /* current version is printed, it must be smaller and parse into the same data */
+    ret = lyd_print_mem(&st->mem, st->dt2, LYD_LYB, LYP_WITHSIBLINGS);
+    assert_int_equal(ret, 0);
+    assert_int_equal(st->mem[3], LYB_VERSION_2);
+    assert_true(lyd_lyb_data_length(st->mem) < len);
+
+    dt3 = lyd_parse_mem(st->ctx, st->mem, LYD_LYB, LYD_OPT_CONFIG | LYD_OPT_STRICT);
+    assert_ptr_not_equal(dt3, NULL);
+
+    check_data_tree(st->dt1, dt3);
+    lyd_free_withsiblings(dt3);
+
+    /* unknown version */
+    v1[3] = 0x7f;
+    assert_null(lyd_parse_mem(st->ctx, v1, LYD_LYB, LYD_OPT_CONFIG | LYD_OPT_STRICT));
+    assert_int_equal(ly_errno, LY_EINVAL);
+    free(v1);
+}
+
+static void
+test_filter(void **state)
+{
+    struct state *st = (*state);
+    struct ly_set *filter, *set;
+    int ret;
+
+    assert_non_null(ly_ctx_load_module(st->ctx, "ietf-ip", NULL));
+    assert_non_null(ly_ctx_load_module(st->ctx, "iana-if-type", NULL));
+
+    st->dt1 = lyd_parse_path(st->ctx, TESTS_DIR"/data/files/ietf-interfaces.json", LYD_JSON, LYD_OPT_CONFIG);
+    assert_ptr_not_equal(st->dt1, NULL);
+
+    ret = lyd_print_mem(&st->mem, st->dt1, LYD_LYB, LYP_WITHSIBLINGS);
+    assert_int_equal(ret, 0);
+
+    /* only addresses, interfaces with just their keys */
+    filter = ly_ctx_find_path(st->ctx, "/ietf-interfaces:interfaces/ietf-interfaces:interface/ietf-ip:ipv4/ietf-ip:address");
+    assert_non_null(filter);
+    assert_int_equal(filter->number, 1);
+
+    st->dt2 = lyd_parse_mem(st->ctx, st->mem, LYD_LYB, LYD_OPT_CONFIG | LYD_OPT_STRICT | LYD_OPT_LYB_FILTER, filter);
+    assert_ptr_not_equal(st->dt2, NULL);
+
+    set = lyd_find_path(st->dt2, "/ietf-interfaces:interfaces/interface/name");
+    assert_int_equal(set->number, 3);
+    ly_set_free(set);
+    set = lyd_find_path(st->dt2, "/ietf-interfaces:interfaces/interface/description");
+    assert_int_equal(set->number, 0);
+    ly_set_free(set);
+    set = lyd_find_path(st->dt2, "/ietf-interfaces:interfaces/interface/ietf-ip:ipv4/mtu");
+    assert_int_equal(set->number, 0);
+    ly_set_free(set);
+    set = lyd_find_path(st->dt2, "/ietf-interfaces:interfaces/interface/ietf-ip:ipv4/address/prefix-length");
+    assert_int_equal(set->number, 2);
+    ly_set_free(set);
+    ly_set_free(filter);
+
+    /* a leaf and a node with no data */
+    filter = ly_ctx_find_path(st->ctx, "/ietf-interfaces:interfaces/ietf-interfaces:interface/ietf-interfaces:description");
+    assert_non_null(filter);
+    assert_int_equal(ly_set_merge(filter, ly_ctx_find_path(st->ctx, "/ietf-interfaces:interfaces-state"), 0), 1);
+
+    lyd_free_withsiblings(st->dt2);
+    st->dt2 = lyd_parse_mem(st->ctx, st->mem, LYD_LYB, LYD_OPT_CONFIG | LYD_OPT_STRICT | LYD_OPT_LYB_FILTER, filter);
+    assert_ptr_not_equal(st->dt2, NULL);
+    assert_null(st->dt2->next);
+
+    set = lyd_find_path(st->dt2, "/ietf-interfaces:interfaces/interface/description");
+    assert_int_equal(set->number, 3);
+    ly_set_free(set);
+    set = lyd_find_path(st->dt2, "/ietf-interfaces:interfaces/interface/ietf-ip:ipv4");
+    assert_int_equal(set->number, 0);
+    ly_set_free(set);
+    ly_set_free(filter);
+
+    /* nothing matches */
+    filter = ly_ctx_find_path(st->ctx, "/ietf-interfaces:interfaces-state");
+    assert_non_null(filter);
+
+    lyd_free_withsiblings(st->dt2);
+    st->dt2 = lyd_parse_mem(st->ctx, st->mem, LYD_LYB, LYD_OPT_CONFIG | LYD_OPT_STRICT | LYD_OPT_LYB_FILTER, filter);
+    assert_null(st->dt2);
+    assert_int_equal(ly_errno, LY_SUCCESS);
+
+    /* invalid filter node */
+    ly_set_clean(filter);
+    ly_set_add(filter, (void *)ly_ctx_get_node(st->ctx, NULL, "/ietf-interfaces:interfaces-state/interface/statistics", 0), 0);
+    ly_set_add(filter, ly_ctx_get_module(st->ctx, "ietf-ip", NULL, 1)->augment, 0);
+    assert_int_equal(filter->number, 2);
+
+    st->dt2 = lyd_parse_mem(st->ctx, st->mem, LYD_LYB, LYD_OPT_CONFIG | LYD_OPT_STRICT | LYD_OPT_LYB_FILTER, filter);
+    assert_null(st->dt2);
+    assert_int_equal(ly_errno, LY_EINVAL);
+
+    /* only for LYB */
+    assert_null(lyd_parse_path(st->ctx, TESTS_DIR"/data/files/ietf-interfaces.json", LYD_JSON,
+                               LYD_OPT_CONFIG | LYD_OPT_LYB_FILTER, filter));
+    assert_int_equal(ly_errno, LY_EINVAL);
+    ly_set_free(filter);
+}
+
+static void
+test_filter_leafrefs(void **state)
+{
+    struct state *st = (*state);
+    struct ly_set *filter;
+    int ret;
+
+    ly_ctx_set_searchdir(st->ctx, TESTS_DIR"/data/files");
+    assert_non_null(ly_ctx_load_module(st->ctx, "leafrefs2", NULL));
+
+    st->dt1 = lyd_parse_path(st->ctx, TESTS_DIR"/data/files/leafrefs2.json", LYD_JSON, LYD_OPT_CONFIG | LYD_OPT_STRICT);
+    assert_ptr_not_equal(st->dt1, NULL);
+
+    ret = lyd_print_mem(&st->mem, st->dt1, LYD_LYB, LYP_WITHSIBLINGS);
+    assert_int_equal(ret, 0);
+
+    /* leafref without its target */
+    filter = ly_ctx_find_path(st->ctx, "/leafrefs2:cont/leafrefs2:lref-bits");
+    assert_non_null(filter);
+
+    st->dt2 = lyd_parse_mem(st->ctx, st->mem, LYD_LYB, LYD_OPT_CONFIG | LYD_OPT_STRICT | LYD_OPT_LYB_FILTER, filter);
+    ly_set_free(filter);
+    assert_ptr_not_equal(st->dt2, NULL);
+
+    assert_non_null(st->dt2->child);
+    assert_null(st->dt2->child->next);
+    assert_string_equal(st->dt2->child->schema->name, "lref-bits");
+    assert_string_equal(((struct lyd_node_leaf_list *)st->dt2->child)->value_str, "bit1 bit3");
+}
+
 int
 main(void)
 {
@@ -676,6 +841,9 @@ main(void)
         cmocka_unit_test_setup_teardown(test_submodule_feature, setup_f, teardown_f),
         cmocka_unit_test_setup_teardown(test_coliding_augments, setup_f, teardown_f),
         cmocka_unit_test_setup_teardown(test_leafrefs, setup_f, teardown_f),
+        cmocka_unit_test_setup_teardown(test_version1, setup_f, teardown_f),
+        cmocka_unit_test_setup_teardown(test_filter, setup_f, teardown_f),
+        cmocka_unit_test_setup_teardown(test_filter_leafrefs, setup_f, teardown_f),
     };
 
     return cmocka_run_group_tests(tests, NULL, NULL);
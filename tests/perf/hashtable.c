@@ -0,0 +1,180 @@
+/**
+ * @file hashtable.c
+ * @brief performance test - hash table workloads of the dictionary and data node children.
+ *
+ * Copyright (c) 2018 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <libyang/libyang.h>
+
+static const char *schema =
+    "module htperf {"
+    "  namespace \"urn:libyang:performance:hashtable\";"
+    "  prefix h;"
+    "  container cont {"
+    "    list lst {"
+    "      key \"k\";"
+    "      leaf k { type uint32; }"
+    "      leaf v { type string; }"
+    "    }"
+    "  }"
+    "}";
+
+static struct timespec start;
+
+static void
+timer_start(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &start);
+}
+
+static void
+timer_print(const char *what, int count)
+{
+    struct timespec end;
+    double secs;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%-28s %8d ops  %8.1f ns/op\n", what, count, secs * 1e9 / count);
+}
+
+static int
+dict_workload(struct ly_ctx *ctx, int count)
+{
+    const char **strs;
+    char buf[32];
+    int i;
+
+    strs = malloc(count * sizeof *strs);
+    if (!strs) {
+        return 1;
+    }
+
+    timer_start();
+    for (i = 0; i < count; ++i) {
+        sprintf(buf, "string-%d", i);
+        strs[i] = lydict_insert(ctx, buf, 0);
+    }
+    timer_print("dictionary insert new", count);
+
+    timer_start();
+    for (i = 0; i < count; ++i) {
+        sprintf(buf, "string-%d", i);
+        lydict_insert(ctx, buf, 0);
+    }
+    timer_print("dictionary insert existing", count);
+
+    timer_start();
+    for (i = 0; i < count; ++i) {
+        lydict_remove(ctx, strs[i]);
+    }
+    timer_print("dictionary remove reference", count);
+
+    timer_start();
+    for (i = 0; i < count; ++i) {
+        lydict_remove(ctx, strs[i]);
+    }
+    timer_print("dictionary remove last", count);
+
+    free(strs);
+    return 0;
+}
+
+static int
+children_workload(struct ly_ctx *ctx, const struct lys_module *mod, int count)
+{
+    struct lyd_node *cont, *list, *next, *iter;
+    char buf[64], key[16];
+    int i;
+
+    cont = lyd_new(NULL, mod, "cont");
+    if (!cont) {
+        return 1;
+    }
+
+    timer_start();
+    for (i = 0; i < count; ++i) {
+        sprintf(key, "%d", i);
+        list = lyd_new(cont, mod, "lst");
+        if (!list || !lyd_new_leaf(list, mod, "k", key)) {
+            goto error;
+        }
+    }
+    timer_print("children insert", count);
+
+    /* the list instances are found in the children hash table of the container */
+    timer_start();
+    for (i = 0; i < count; ++i) {
+        sprintf(buf, "/htperf:cont/lst[k='%d']/v", i);
+        if (!lyd_new_path(cont, ctx, buf, "value", 0, LYD_PATH_OPT_UPDATE)) {
+            goto error;
+        }
+    }
+    timer_print("children find", count);
+
+    timer_start();
+    i = 0;
+    LY_TREE_FOR_SAFE(cont->child, next, iter) {
+        lyd_free(iter);
+        ++i;
+    }
+    timer_print("children remove", i);
+
+    lyd_free(cont);
+    return 0;
+
+error:
+    lyd_free(cont);
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    struct ly_ctx *ctx;
+    const struct lys_module *mod;
+    int count = 200000, ret = 1;
+
+    if (argc > 1) {
+        count = atoi(argv[1]);
+    }
+
+    /* libyang context */
+    ctx = ly_ctx_new(NULL, 0);
+    if (!ctx) {
+        fprintf(stderr, "Failed to create context.\n");
+        return 1;
+    }
+
+    /* schema */
+    mod = lys_parse_mem(ctx, schema, LYS_IN_YANG);
+    if (!mod) {
+        fprintf(stderr, "Failed to load data model.\n");
+        goto cleanup;
+    }
+
+    if (dict_workload(ctx, count)) {
+        fprintf(stderr, "Dictionary workload failed.\n");
+        goto cleanup;
+    }
+    if (children_workload(ctx, mod, count)) {
+        fprintf(stderr, "Data children workload failed.\n");
+        goto cleanup;
+    }
+    ret = 0;
+
+cleanup:
+    ly_ctx_destroy(ctx, NULL);
+    return ret;
+}
@@ -0,0 +1,157 @@
+/**
+ * @file parallel.c
+ * @brief performance test - parsing data in several threads sharing one context.
+ *
+ * Copyright (c) 2016 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <libyang/libyang.h>
+
+struct thread_arg {
+    struct ly_ctx *ctx;
+    const char *data;
+    int count;
+    int failed;
+};
+
+static void *
+parse_thread(void *arg)
+{
+    struct thread_arg *targ = arg;
+    struct lyd_node *data;
+    int i;
+
+    for (i = 0; i < targ->count; ++i) {
+        data = lyd_parse_mem(targ->ctx, targ->data, LYD_XML, LYD_OPT_CONFIG);
+        if (!data) {
+            targ->failed = 1;
+            break;
+        }
+        lyd_free_withsiblings(data);
+    }
+
+    return NULL;
+}
+
+static char *
+read_file(const char *path)
+{
+    FILE *f;
+    char *buf;
+    long size;
+
+    f = fopen(path, "r");
+    if (!f) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    buf = malloc(size + 1);
+    if (buf && (fread(buf, 1, size, f) != (size_t)size)) {
+        free(buf);
+        buf = NULL;
+    }
+    if (buf) {
+        buf[size] = '\0';
+    }
+    fclose(f);
+    return buf;
+}
+
+int main(int argc, char *argv[])
+{
+    struct ly_ctx *ctx;
+    struct thread_arg *args = NULL;
+    pthread_t *threads = NULL;
+    struct timespec start, end;
+    char *data = NULL;
+    double secs, base = 0;
+    int max_threads = 8, count = 20, n, i, ret = 1;
+
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s model.yin data.xml [max-threads] [parses-per-thread]\n", argv[0]);
+        return 1;
+    }
+    if (argc > 3) {
+        max_threads = atoi(argv[3]);
+    }
+    if (argc > 4) {
+        count = atoi(argv[4]);
+    }
+
+    /* libyang context */
+    ctx = ly_ctx_new(NULL, 0);
+    if (!ctx) {
+        fprintf(stderr, "Failed to create context.\n");
+        return 1;
+    }
+
+    /* schema */
+    if (!lys_parse_path(ctx, argv[1], strstr(argv[1], ".yin") ? LYS_IN_YIN : LYS_IN_YANG)) {
+        fprintf(stderr, "Failed to load data model.\n");
+        goto cleanup;
+    }
+
+    /* data */
+    data = read_file(argv[2]);
+    if (!data) {
+        fprintf(stderr, "Failed to read data.\n");
+        goto cleanup;
+    }
+
+    threads = malloc(max_threads * sizeof *threads);
+    args = malloc(max_threads * sizeof *args);
+    if (!threads || !args) {
+        fprintf(stderr, "Memory allocation error.\n");
+        goto cleanup;
+    }
+
+    printf("threads  parses/s  speedup\n");
+    for (n = 1; n <= max_threads; n *= 2) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < n; ++i) {
+            args[i].ctx = ctx;
+            args[i].data = data;
+            args[i].count = count;
+            args[i].failed = 0;
+            pthread_create(&threads[i], NULL, parse_thread, &args[i]);
+        }
+        for (i = 0; i < n; ++i) {
+            pthread_join(threads[i], NULL);
+            if (args[i].failed) {
+                fprintf(stderr, "Failed to parse data.\n");
+                goto cleanup;
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        if (n == 1) {
+            base = count / secs;
+        }
+        printf("%7d  %8.1f  %7.2f\n", n, (n * count) / secs, (n * count) / secs / base);
+    }
+    ret = 0;
+
+cleanup:
+    free(threads);
+    free(args);
+    free(data);
+    ly_ctx_destroy(ctx, NULL);
+
+    return ret;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file snapshot.c
+ * @brief performance test - creating a context by parsing the schemas and from a snapshot.
+ *
+ * Copyright (c) 2018 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <libyang/libyang.h>
+
+static struct timespec start;
+
+static void
+timer_start(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &start);
+}
+
+static void
+timer_print(const char *what, int count)
+{
+    struct timespec end;
+    double secs;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%-28s %8d ops  %8.3f ms/op\n", what, count, secs * 1e3 / count);
+}
+
+static struct ly_ctx *
+create_ctx(const char *search_dir, int argc, char *argv[])
+{
+    struct ly_ctx *ctx;
+    int i;
+
+    ctx = ly_ctx_new(search_dir, 0);
+    if (!ctx) {
+        return NULL;
+    }
+    for (i = 0; i < argc; ++i) {
+        if (!ly_ctx_load_module(ctx, argv[i], NULL)) {
+            ly_ctx_destroy(ctx, NULL);
+            return NULL;
+        }
+    }
+    return ctx;
+}
+
+int main(int argc, char *argv[])
+{
+    struct ly_ctx *ctx;
+    char *image = NULL;
+    size_t size;
+    int i, count = 100, ret = 1;
+
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <search-dir> <module> [<module> ...]\n", argv[0]);
+        return 1;
+    }
+
+    timer_start();
+    for (i = 0; i < count; ++i) {
+        ctx = create_ctx(argv[1], argc - 2, argv + 2);
+        if (!ctx) {
+            fprintf(stderr, "Failed to create context.\n");
+            return 1;
+        }
+        ly_ctx_destroy(ctx, NULL);
+    }
+    timer_print("parse schemas", count);
+
+    ctx = create_ctx(argv[1], argc - 2, argv + 2);
+    if (!ctx || ly_ctx_snapshot_mem(ctx, &image, &size)) {
+        fprintf(stderr, "Failed to create snapshot.\n");
+        goto cleanup;
+    }
+    ly_ctx_destroy(ctx, NULL);
+    printf("snapshot size %zu bytes\n", size);
+
+    timer_start();
+    for (i = 0; i < count; ++i) {
+        ctx = ly_ctx_new_snapshot_mem(image, size);
+        if (!ctx) {
+            fprintf(stderr, "Failed to restore snapshot.\n");
+            goto cleanup;
+        }
+        ly_ctx_destroy(ctx, NULL);
+    }
+    timer_print("restore snapshot", count);
+    ctx = NULL;
+    ret = 0;
+
+cleanup:
+    ly_ctx_destroy(ctx, NULL);
+    free(image);
+    return ret;
+}